@@ -10,12 +10,23 @@
 #include <string>
 #include <sstream>
 #include <queue>
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
 
+// Without GLUT only the headless mode is available
+#ifdef USE_GLUT
 #ifdef __APPLE__
 #include <glut.h>
 #else
 #include <GL/glut.h>
 #endif
+#endif
 
 #include "../Fubi/FubiCore.h"
 #include "../FubiUtils.h"
@@ -26,10 +37,12 @@
 
 using namespace Fubi;
 
+#ifdef USE_GLUT
 // Some additional OpenGL defines
 #define GL_GENERATE_MIPMAP_SGIS           0x8191
 #define GL_GENERATE_MIPMAP_HINT_SGIS      0x8192
 #define GL_BGRA                           0x80E1
+#endif
 
 
 // Some global variables for the application
@@ -44,6 +57,8 @@ bool displayOSCMessages = true;
 bool checkCombinations = true;
 bool sendOSCCombinations = true;
 bool multiUserMode = false;
+// No window, no images: only tracking, recognition and OSC output (--headless)
+bool headlessMode = false;
 
 
 short g_showInfo = 0;
@@ -62,6 +77,8 @@ bool perfMode = true;
 std::string perfRecognizersFile("MashtaCycleRecognizersPerf.xml");
 std::string installRecognizersFile("MashtaCycleRecognizersInstall.xml");
 std::string currentRecognizersFile;
+// Written when profiling is switched off with 'f'
+std::string profilingFile("FubiProfilingStats.txt");
 
 /////////// OSC defines
 #define OSCPKT_OSTREAM_OUTPUT
@@ -71,32 +88,56 @@ const std::string host = "localhost";
 oscpkt::UdpSocket sock;
 std::string comboName ="";
 MappingMashtaCycle *mapping;
+std::mutex mappingMutex; // mapping is changed by the keyboard, but used by the OSC thread
 double comboStart = 0.0f;
 double comboDisplayRefresh = 0.33; // seconds
 
-// Function called each frame for all tracked users
-void checkPostures(unsigned int userID)
+// Tracking runs in its own thread, the display and the OSC sender consume its snapshots
+const unsigned int renderConsumerID = 0;
+const unsigned int oscConsumerID = 1;
+std::thread* oscThread = 0x0;
+std::atomic<bool> oscThreadRunning(false);
+// Set by the signal handler of the headless mode, which may not touch anything else
+volatile std::sig_atomic_t stopRequested = 0;
+// Recognitions taken from Fubi, the ones of the current snapshot and the ones that are not yet contained in a snapshot
+std::vector<Fubi::RecognitionEvent> recognitionEvents;
+unsigned int numRecognitionEvents = 0;
+// Recognizers for which the mapping has been resolved
+unsigned int mappedRecognizerSetID = 0;
+unsigned int mappedNumCombinations = 0;
+
+// Function called each snapshot for all checked users with the recognitions up to this snapshot
+void checkPostures(const Fubi::TrackingSnapshot& snapshot, const Fubi::UserSnapshot& user)
 {
     //
 	//std::vector<Fubi::SkeletonJoint::Joint> joints;
-	FubiUser* user = Fubi::getUser(userID);
+	unsigned int userID = user.m_id;
 	oscpkt::PacketWriter pw;
     bool recognized = false;
-    
-	for (unsigned int i= 0; i < getNumUserDefinedCombinationRecognizers(); ++i)
+
+	for (unsigned int i= 0; i < numRecognitionEvents; ++i)
 	{
-        if (getCombinationRecognitionProgressOn(getUserDefinedCombinationRecognizerName(i), userID) == Fubi::RecognitionResult::RECOGNIZED)
+		const Fubi::RecognitionEvent& event = recognitionEvents[i];
+		// Only the recognitions of this user that happened up to this snapshot with the current recognizers
+		bool newRecognition = event.m_userID == userID && event.m_frameID <= snapshot.m_frameID
+			&& event.m_recognizerSetID == snapshot.m_recognizerSetID && event.m_combinationIndex < snapshot.m_combinationNames.size();
+        if (newRecognition)
 		{
             //if a combination is recognized, send OSC message according to the mapping
             recognized = true;
-			comboName = getUserDefinedCombinationRecognizerName(i);
+			comboName = snapshot.m_combinationNames[event.m_combinationIndex];
             comboStart = Fubi::getCurrentTime();
             
             FubiCore* core = FubiCore::getInstance();
             if (core)
                 core->setCurrentGesture(comboName,userID);
             
-            std::vector<MessageToSend> msg = mapping->getOSCMessage(user, comboName);
+            std::vector<MessageToSend> msg;
+			{
+				std::lock_guard<std::mutex> lock(mappingMutex);
+				msg = mapping->getOSCMessage(&user, event.m_combinationIndex);
+			}
+			FubiProfileScope profile(Fubi::ProfilingStage::OSC_SEND);
 			for(unsigned int i=0; i<msg.size(); i++)
 			{
                 oscpkt::Message combiMsg;
@@ -119,13 +160,13 @@ void checkPostures(unsigned int userID)
 				}
 			}
 		}
-        
-        if(Fubi::getCurrentTime() > comboStart + comboDisplayRefresh ){
-            FubiCore* core = FubiCore::getInstance();
-            if (core)
-                core->setCurrentGesture("",userID);
-        }
 	}
+
+    if(Fubi::getCurrentTime() > comboStart + comboDisplayRefresh ){
+        FubiCore* core = FubiCore::getInstance();
+        if (core)
+            core->setCurrentGesture("",userID);
+    }
     
     /*if(!recognized)
      {
@@ -157,17 +198,17 @@ void checkPostures(unsigned int userID)
 }
 
 //
-void checkTrackingState(std::deque<unsigned int> usersIDs)
+void checkTrackingState(const Fubi::TrackingSnapshot& snapshot, unsigned int numUsers)
 {
-	FubiUser* user;
+	const Fubi::UserSnapshot* user;
 	unsigned int userID;
 	oscpkt::PacketWriter pw;
     std::ostringstream message;
     
-	for(unsigned int i=0; i<usersIDs.size(); i++)
+	for(unsigned int i=0; i<numUsers; i++)
 	{
-		userID = usersIDs[i];
-		user = Fubi::getUser(userID);
+		user = &snapshot.m_users[i];
+		userID = user->m_id;
 		if(user->m_isTracked && user->m_inScene && !trackingStates[userID])
 		{
 			//Tracking starts
@@ -178,7 +219,7 @@ void checkTrackingState(std::deque<unsigned int> usersIDs)
 			// Tracking ends
 			trackingStates[userID] = false;
 			oscpkt::Message trackingMsg;
-            message << "/mediacycle/browser/" << usersIDs[i] << "/released";
+            message << "/mediacycle/browser/" << userID << "/released";
             
 			trackingMsg.init(message.str());
 			pw.startBundle().addMessage(trackingMsg).endBundle();
@@ -190,11 +231,74 @@ void checkTrackingState(std::deque<unsigned int> usersIDs)
 	}
 }
 
+// OSC thread: sends the messages for each new tracking snapshot
+void oscSenderLoop()
+{
+	while (oscThreadRunning && !stopRequested)
+	{
+		bool isNew = false;
+		const Fubi::TrackingSnapshot* snapshot = getTrackingSnapshot(oscConsumerID, &isNew);
+		if (!snapshot || !isNew)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		// Resolve the mapping once for new recognizers, the recognitions only refer to the combination index
+		if (snapshot->m_recognizerSetID != mappedRecognizerSetID || snapshot->m_combinationNames.size() != mappedNumCombinations)
+		{
+			std::lock_guard<std::mutex> lock(mappingMutex);
+			mapping->setCombinationNames(snapshot->m_combinationNames);
+			mappedRecognizerSetID = snapshot->m_recognizerSetID;
+			mappedNumCombinations = snapshot->m_combinationNames.size();
+		}
+
+		// Take all recognitions that happened since the last snapshot (and maybe some after this one)
+		while (true)
+		{
+			if (numRecognitionEvents == recognitionEvents.size())
+				recognitionEvents.resize(numRecognitionEvents + 16);
+			if (!pollRecognitionEvent(recognitionEvents[numRecognitionEvents]))
+				break;
+			++numRecognitionEvents;
+		}
+
+		// Check users tracking state for 'nbUsersTracked' (users are sorted by distance in the snapshot)
+		unsigned int numUsers = std::min<unsigned int>(snapshot->m_numUsers, nbUsersTracked);
+		if(numUsers>0)
+			checkTrackingState(*snapshot, numUsers);
+
+		// Check gestures of nbUsersTracked closest users or only of the closest one
+		if(!multiUserMode)
+			numUsers = std::min<unsigned int>(numUsers, 1);
+		for(unsigned int i=0; i<numUsers; i++)
+		{
+			const Fubi::UserSnapshot& user = snapshot->m_users[i];
+			// Recognitions that happened while not checked are not sent
+			if(trackingStates[user.m_id] && checkCombinations)
+				checkPostures(*snapshot, user);
+		}
+
+		// Keep the recognitions that are not yet contained in this snapshot for the next one
+		unsigned int numLaterEvents = 0;
+		for (unsigned int i = 0; i < numRecognitionEvents; ++i)
+		{
+			if (recognitionEvents[i].m_frameID > snapshot->m_frameID)
+				std::swap(recognitionEvents[numLaterEvents++], recognitionEvents[i]);
+		}
+		numRecognitionEvents = numLaterEvents;
+	}
+}
+
 void reloadRecognizersFromXML(std::string XMLFile)
 {
+	// Don't let the tracking thread run without recognizers in between
+	lockTracking();
     clearUserDefinedRecognizers();
     //
-    if (loadRecognizersFromXML(XMLFile.c_str()))
+    bool loaded = loadRecognizersFromXML(XMLFile.c_str());
+	unlockTracking();
+    if (loaded)
     {
         std::cout << "Succesfully reloaded ";
         //combinationsJoints = getCombinations();
@@ -205,6 +309,20 @@ void reloadRecognizersFromXML(std::string XMLFile)
     std::cout << "recognizers from xml file " << XMLFile << std::endl;
 }
 
+// Keeps the stats of profiling that is still running when the application ends
+void writeProfilingStats()
+{
+	if (isProfilingEnabled() && dumpProfilingStats(profilingFile.c_str()))
+		std::cout << "profiling stats written to " << profilingFile << std::endl;
+}
+
+// Ends the headless mode on Ctrl+C or when the process is asked to terminate
+void stopHeadlessMode(int)
+{
+	stopRequested = 1;
+}
+
+#ifdef USE_GLUT
 void glutIdle (void)
 {
 	// Display the frame
@@ -216,12 +334,17 @@ void glutDisplay (void)
 {
 	if (g_exitNextFrame)
 	{
+		oscThreadRunning = false;
+		oscThread->join();
+		delete oscThread;
+		writeProfilingStats();
 		release();
 		exit (0);
 	}
     
-	// Update the sensor
-	updateSensor();
+	// The sensor is updated in the tracking thread, only render when it has published a new frame
+	bool newFrame = false;
+	getTrackingSnapshot(renderConsumerID, &newFrame);
     
 	ImageType::Type type = ImageType::Depth;
 	ImageNumChannels::Channel numChannels = ImageNumChannels::C4;
@@ -238,7 +361,8 @@ void glutDisplay (void)
 	else if (g_showInfo == 3)
 		mod = DepthImageModification::StretchValueRange;
     
-	getImage(buffer, type, numChannels, ImageDepth::D8, options, mod);
+	if (newFrame)
+		getImage(buffer, type, numChannels, ImageDepth::D8, options, mod);
     
 	// Clear the OpenGL buffers
 	glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -255,7 +379,8 @@ void glutDisplay (void)
 	glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP_SGIS, GL_TRUE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, dWidth, dHeight, 0, GL_BGRA, GL_UNSIGNED_BYTE, g_depthData);
+	if (newFrame)
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, dWidth, dHeight, 0, GL_BGRA, GL_UNSIGNED_BYTE, g_depthData);
     
 	// Display the OpenGL texture map
 	if(displayImage)
@@ -280,31 +405,6 @@ void glutDisplay (void)
 		glEnd();
 		glDisable(GL_TEXTURE_2D);
 	}
-    //
-	// Check users tracking state for 'nbUsersTracked'
-	std::deque<unsigned int> usersIDs = getClosestUserIDs(nbUsersTracked);
-	if(usersIDs.size()>0)
-		checkTrackingState(usersIDs);
-    
-    if(multiUserMode)
-    {
-        // Check gestures of nbUsersTracked closest users
-        for(int i=0; i<usersIDs.size(); i++)
-        {
-            if(trackingStates[usersIDs[i]] && checkCombinations)
-                checkPostures(usersIDs[i]);
-        }
-    }
-    else
-    {
-        // Check closest user's gestures
-        unsigned int closestID = getClosestUserID();
-        if (closestID > 0)
-        {
-            if(trackingStates[closestID] && checkCombinations)
-                checkPostures(closestID);
-        }
-    }
     //
 	// Swap the OpenGL display buffers
 	glutSwapBuffers();
@@ -347,10 +447,18 @@ void glutKeyboard (unsigned char key, int x, int y)
             else
                 currentRecognizersFile = installRecognizersFile;
             reloadRecognizersFromXML(currentRecognizersFile);
+            std::lock_guard<std::mutex> lock(mappingMutex);
             mapping->changeMode(perfMode);
         }
             break;
 
+        case 'f':
+            enableProfiling(!isProfilingEnabled());
+            std::cout << "profiling: " << isProfilingEnabled() << std::endl;
+            if(!isProfilingEnabled() && dumpProfilingStats(profilingFile.c_str()))
+                std::cout << "profiling stats written to " << profilingFile << std::endl;
+            break;
+
         case 't':
 			g_showInfo = (g_showInfo+1) % 4;
             break;
@@ -383,9 +491,54 @@ void glutKeyboard (unsigned char key, int x, int y)
 		}
 	}
 }
+#endif
+
+void printUsage(const char* programName)
+{
+	std::cout << "Usage: " << programName << " [--headless] [--profile] [--record <file>] [--replay <file> [--fast] [--loop] | --synthetic <users> [--fast]]" << std::endl
+		<< "  --headless       run without window, only send the recognized gestures via OSC (stop with Ctrl+C)" << std::endl
+		<< "  --profile        measure the tracking stages from the start, written to " << profilingFile << " on exit" << std::endl
+		<< "  --record <file>  record the tracked skeletons of the sensor" << std::endl
+		<< "  --replay <file>  use a recording instead of a sensor" << std::endl
+		<< "  --synthetic <n>  use n generated users performing the gestures instead of a sensor" << std::endl
+		<< "  --fast           replay/generate as fast as possible instead of in real time" << std::endl
+		<< "  --loop           restart the replay at the end of the recording" << std::endl;
+}
 
 int main(int argc, char ** argv)
 {
+	std::string recordFile, replayFile;
+	bool replayFast = false, replayLoop = false;
+	int syntheticUsers = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if (arg == "--headless")
+			headlessMode = true;
+		else if (arg == "--profile")
+			enableProfiling(true);
+		else if (arg == "--record" && i+1 < argc)
+			recordFile = argv[++i];
+		else if (arg == "--replay" && i+1 < argc)
+			replayFile = argv[++i];
+		else if (arg == "--synthetic" && i+1 < argc)
+			syntheticUsers = atoi(argv[++i]);
+		else if (arg == "--fast")
+			replayFast = true;
+		else if (arg == "--loop")
+			replayLoop = true;
+		else
+		{
+			printUsage(argv[0]);
+			return (arg == "--help" || arg == "-h") ? 0 : 1;
+		}
+	}
+#ifndef USE_GLUT
+	if (!headlessMode)
+		std::cout << "Built without GLUT, running headless" << std::endl;
+	headlessMode = true;
+#endif
+
     // Initialize UDP socket for OSC
 	sock.connectTo(host, OSC_PORT);
 	if (!sock.isOk()) {
@@ -412,17 +565,33 @@ int main(int argc, char ** argv)
     //
     
 	// Alternative init without xml
-	init(SensorOptions(StreamOptions(), StreamOptions(-1, -1, -1), StreamOptions(-1, -1, -1)));
+	SensorOptions sensorOptions(StreamOptions(), StreamOptions(-1, -1, -1), StreamOptions(-1, -1, -1));
+	if (!replayFile.empty())
+	{
+		sensorOptions.m_type = SensorType::REPLAY;
+		sensorOptions.m_replayOptions = ReplayOptions(replayFile, !replayFast, replayLoop);
+	}
+	else if (syntheticUsers > 0)
+	{
+		sensorOptions.m_type = SensorType::SYNTHETIC;
+		sensorOptions.m_syntheticOptions = SyntheticOptions(syntheticUsers, 0, 0, !replayFast);
+	}
+	init(sensorOptions);
+	if (!recordFile.empty())
+		startRecording(recordFile.c_str());
     
 	getDepthResolution(dWidth, dHeight);
 	getRgbResolution(rgbWidth, rgbHeight);
 	getIRResolution(irWidth, irHeight);
     
-	g_depthData = new unsigned char[dWidth*dHeight*4];
-	if ( rgbWidth > 0 && rgbHeight > 0)
-		g_rgbData = new unsigned char[rgbWidth*rgbHeight*3];
-	if (irWidth > 0 && irHeight > 0)
-		g_irData = new unsigned char[irWidth*irHeight*4];
+	if (!headlessMode)
+	{
+		g_depthData = new unsigned char[dWidth*dHeight*4];
+		if ( rgbWidth > 0 && rgbHeight > 0)
+			g_rgbData = new unsigned char[rgbWidth*rgbHeight*3];
+		if (irWidth > 0 && irHeight > 0)
+			g_irData = new unsigned char[irWidth*irHeight*4];
+	}
     
 	memset(g_currentPostures, 0, sizeof(g_currentPostures));
     
@@ -447,27 +616,49 @@ int main(int argc, char ** argv)
     
 	//combinationsJoints = getCombinations();
     //
+	// Tracking and recognition run independently of the display from now on
+	startTrackingThread();
+	oscThreadRunning = true;
+	if (headlessMode)
+	{
+		// Nothing to display, so the main thread sends the OSC messages until it gets stopped
+		std::signal(SIGINT, stopHeadlessMode);
+		std::signal(SIGTERM, stopHeadlessMode);
+		std::cout << "Running headless, stop with Ctrl+C" << std::endl;
+		oscSenderLoop();
+	}
+#ifdef USE_GLUT
+	else
+	{
+		oscThread = new std::thread(oscSenderLoop);
+		//
 #if defined ( WIN32 ) || defined( _WINDOWS )
-    SetWindowPos( GetConsoleWindow(), HWND_TOP, dWidth+10, 0, 0, 0,
-                 SWP_NOOWNERZORDER | SWP_NOSIZE | SWP_NOZORDER );
+		SetWindowPos( GetConsoleWindow(), HWND_TOP, dWidth+10, 0, 0, 0,
+					 SWP_NOOWNERZORDER | SWP_NOSIZE | SWP_NOZORDER );
 #endif
-    
-	// OpenGL init
-	glutInit(&argc, argv);
-	glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
-	glutInitWindowSize(dWidth, dHeight);
-	glutCreateWindow ("FUBI - Recognizer OpenGL test");
-	//glutFullScreen();
-    
-	glutKeyboardFunc(glutKeyboard);
-	glutDisplayFunc(glutDisplay);
-	glutIdleFunc(glutIdle);
-    
-	glDisable(GL_DEPTH_TEST);
-	glEnable(GL_TEXTURE_2D);
-    
-	// Per frame code is in glutDisplay
-	glutMainLoop();
+
+		// OpenGL init
+		glutInit(&argc, argv);
+		glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
+		glutInitWindowSize(dWidth, dHeight);
+		glutCreateWindow ("FUBI - Recognizer OpenGL test");
+		//glutFullScreen();
+
+		glutKeyboardFunc(glutKeyboard);
+		glutDisplayFunc(glutDisplay);
+		glutIdleFunc(glutIdle);
+
+		glDisable(GL_DEPTH_TEST);
+		glEnable(GL_TEXTURE_2D);
+
+		// Per frame rendering code is in glutDisplay, tracking and OSC run in their own threads
+		glutMainLoop();
+		oscThreadRunning = false;
+		oscThread->join();
+		delete oscThread;
+	}
+#endif
+	writeProfilingStats();
 	release();
     
 	delete[] g_depthData;
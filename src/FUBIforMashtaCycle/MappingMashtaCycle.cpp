@@ -44,6 +44,7 @@ void MappingMashtaCycle::changeMode(bool newMode)
             initPerfMapping();
         else
             initInstallMapping();
+        updateCombinationControls();
         std::cout << "Mode changed to " << mode << std::endl;
     }
 
@@ -77,20 +78,53 @@ void MappingMashtaCycle::initInstallMapping()
 }
 
 
-std::vector<MessageToSend> MappingMashtaCycle::getOSCMessage(FubiUser* user, std::string comboName)
+void MappingMashtaCycle::setCombinationNames(const std::vector<std::string>& names)
+{
+    combinationNames = names;
+    updateCombinationControls();
+}
+
+void MappingMashtaCycle::updateCombinationControls()
+{
+    combinationControls.assign(combinationNames.size(), NB_SOUND_CONTROL);
+    for(unsigned int i=0; i<combinationNames.size(); i++)
+    {
+        std::map<std::string, MashtaSoundControl>::iterator it = mapping.find(combinationNames[i]);
+        if(it != mapping.end())
+            combinationControls[i] = it->second;
+    }
+}
+
+std::vector<MessageToSend> MappingMashtaCycle::getOSCMessage(const Fubi::UserSnapshot* user, std::string comboName)
 {
-	std::vector<MessageToSend> vecmts;
-    
 	std::map<std::string, MashtaSoundControl>::iterator  it = mapping.find(comboName);
 	
     
     if(it == mapping.end())
     {
         std::cout << "Combination " << comboName << " not found " << std::endl;
-		return vecmts;
+		return std::vector<MessageToSend>();
     }
     
-	switch(it->second)
+	return controlMessages(user, it->second);
+}
+
+std::vector<MessageToSend> MappingMashtaCycle::getOSCMessage(const Fubi::UserSnapshot* user, unsigned int comboIndex)
+{
+    if(comboIndex >= combinationControls.size() || combinationControls[comboIndex] == NB_SOUND_CONTROL)
+    {
+        std::cout << "Combination " << (comboIndex < combinationNames.size() ? combinationNames[comboIndex] : "") << " not found " << std::endl;
+		return std::vector<MessageToSend>();
+    }
+
+	return controlMessages(user, combinationControls[comboIndex]);
+}
+
+std::vector<MessageToSend> MappingMashtaCycle::controlMessages(const Fubi::UserSnapshot* user, MashtaSoundControl control)
+{
+	std::vector<MessageToSend> vecmts;
+
+	switch(control)
 	{
 		case LOOP:
 			vecmts.push_back(loopMessage(user));
@@ -147,7 +181,7 @@ std::vector<MessageToSend> MappingMashtaCycle::getOSCMessage(FubiUser* user, std
 	return vecmts;
 }
 
-MessageToSend MappingMashtaCycle::getOSCPositionMessage(FubiUser* user)
+MessageToSend MappingMashtaCycle::getOSCPositionMessage(const Fubi::UserSnapshot* user)
 {
     return positionMessage(user);
 }
@@ -168,7 +202,7 @@ int MappingMashtaCycle::boundValue(float *value, float up, float low)
 		return 0;
 }
 
-MessageToSend MappingMashtaCycle::loopMessage(FubiUser* user)
+MessageToSend MappingMashtaCycle::loopMessage(const Fubi::UserSnapshot* user)
 {
     	MessageToSend mts;
     	std::ostringstream mes;
@@ -177,7 +211,7 @@ MessageToSend MappingMashtaCycle::loopMessage(FubiUser* user)
 	return mts;
 }
 
-MessageToSend MappingMashtaCycle::stopMessage(FubiUser* user)
+MessageToSend MappingMashtaCycle::stopMessage(const Fubi::UserSnapshot* user)
 {
 	MessageToSend mts;
     	std::ostringstream mes;
@@ -186,7 +220,7 @@ MessageToSend MappingMashtaCycle::stopMessage(FubiUser* user)
 	return mts;
 }
 
-MessageToSend MappingMashtaCycle::reverbFreezeMessage(FubiUser* user)
+MessageToSend MappingMashtaCycle::reverbFreezeMessage(const Fubi::UserSnapshot* user)
 {
 	MessageToSend mts;
     	std::ostringstream mes;
@@ -206,7 +240,7 @@ const float propMinY = 0.67; //proportion of distance head-torso on which the re
 const float propMaxY =1.8; //proportion of distance head-torso on which the reverb damping or volume is 1
 const float propMinX = 1; //proportion of distance between shoulders on which the reverb mix is 0
 const float propMaxX =3.0; //proportion of distance between shoulders on which the reverb mix is 1
-MessageToSend MappingMashtaCycle::volumeMessage(FubiUser* user)
+MessageToSend MappingMashtaCycle::volumeMessage(const Fubi::UserSnapshot* user)
 {
 	MessageToSend mts;
     	std::ostringstream mes;
@@ -239,7 +273,7 @@ MessageToSend MappingMashtaCycle::volumeMessage(FubiUser* user)
 	return mts;
 }
 
-MessageToSend MappingMashtaCycle::reverbMixMessage(FubiUser* user)
+MessageToSend MappingMashtaCycle::reverbMixMessage(const Fubi::UserSnapshot* user)
 {
 	MessageToSend mts;
     	std::ostringstream mes;
@@ -262,7 +296,7 @@ MessageToSend MappingMashtaCycle::reverbMixMessage(FubiUser* user)
 	return mts;
 }
 
-MessageToSend MappingMashtaCycle::reverbDampingMessage(FubiUser* user)
+MessageToSend MappingMashtaCycle::reverbDampingMessage(const Fubi::UserSnapshot* user)
 {
 	MessageToSend mts;
     	std::ostringstream mes;
@@ -287,7 +321,7 @@ MessageToSend MappingMashtaCycle::reverbDampingMessage(FubiUser* user)
 	return mts;
 }
 
-MessageToSend MappingMashtaCycle::volumeMessage(FubiUser* user, float defaultValue)
+MessageToSend MappingMashtaCycle::volumeMessage(const Fubi::UserSnapshot* user, float defaultValue)
 {
 	MessageToSend mts;
     	std::ostringstream mes;
@@ -300,7 +334,7 @@ MessageToSend MappingMashtaCycle::volumeMessage(FubiUser* user, float defaultVal
 	return mts;
 }
 
-MessageToSend MappingMashtaCycle::speedMessage(FubiUser* user)
+MessageToSend MappingMashtaCycle::speedMessage(const Fubi::UserSnapshot* user)
 {
 	MessageToSend mts;
     	std::ostringstream mes;
@@ -318,7 +352,7 @@ MessageToSend MappingMashtaCycle::speedMessage(FubiUser* user)
 	return mts;
 }
 
-MessageToSend MappingMashtaCycle::speedMessage(FubiUser* user, float defaultValue)
+MessageToSend MappingMashtaCycle::speedMessage(const Fubi::UserSnapshot* user, float defaultValue)
 {
 	MessageToSend mts;
     	std::ostringstream mes;
@@ -331,7 +365,7 @@ MessageToSend MappingMashtaCycle::speedMessage(FubiUser* user, float defaultValu
 	return mts;
 }
 
-MessageToSend MappingMashtaCycle::panMessage(FubiUser* user)
+MessageToSend MappingMashtaCycle::panMessage(const Fubi::UserSnapshot* user)
 {
 	MessageToSend mts;
     	std::ostringstream mes;
@@ -350,7 +384,7 @@ MessageToSend MappingMashtaCycle::panMessage(FubiUser* user)
 	return mts;
 }
 
-MessageToSend MappingMashtaCycle::panMessage(FubiUser* user, float defaultValue)
+MessageToSend MappingMashtaCycle::panMessage(const Fubi::UserSnapshot* user, float defaultValue)
 {
 	MessageToSend mts;
     	std::ostringstream mes;
@@ -363,7 +397,7 @@ MessageToSend MappingMashtaCycle::panMessage(FubiUser* user, float defaultValue)
 	return mts;
 }
 
-MessageToSend MappingMashtaCycle::positionMessage(FubiUser* user)
+MessageToSend MappingMashtaCycle::positionMessage(const Fubi::UserSnapshot* user)
 {
 	MessageToSend mts;
     	std::ostringstream mes;
@@ -395,7 +429,7 @@ MessageToSend MappingMashtaCycle::positionMessage(FubiUser* user)
 	return mts;
 }
 
-MessageToSend MappingMashtaCycle::pauseAllMessage(FubiUser* user)
+MessageToSend MappingMashtaCycle::pauseAllMessage(const Fubi::UserSnapshot* user)
 {
     	MessageToSend mts;
     	std::ostringstream mes;
@@ -404,7 +438,7 @@ MessageToSend MappingMashtaCycle::pauseAllMessage(FubiUser* user)
 	return mts;
 }
 
-MessageToSend MappingMashtaCycle::killAllMessage(FubiUser* user)
+MessageToSend MappingMashtaCycle::killAllMessage(const Fubi::UserSnapshot* user)
 {
     	MessageToSend mts;
     	std::ostringstream mes;
@@ -2,7 +2,7 @@
 #include <string>
 #include <vector>
 #include <map>
-#include "../Fubi/FubiUser.h"
+#include "../Fubi/FubiTrackingSnapshot.h"
 
 struct MessageToSend
 {
@@ -34,8 +34,12 @@ public:
 	MappingMashtaCycle(void);
 	MappingMashtaCycle(float sw, float sd, float sdo);
 	~MappingMashtaCycle(void);
-	std::vector<MessageToSend> getOSCMessage(FubiUser* user, std::string comboName);
-    MessageToSend getOSCPositionMessage(FubiUser* user);
+	std::vector<MessageToSend> getOSCMessage(const Fubi::UserSnapshot* user, std::string comboName);
+	// Same with the index of the combination in the names given to setCombinationNames()
+	std::vector<MessageToSend> getOSCMessage(const Fubi::UserSnapshot* user, unsigned int comboIndex);
+	// Resolves the mapping for the combination names of the loaded recognizers
+	void setCombinationNames(const std::vector<std::string>& names);
+    MessageToSend getOSCPositionMessage(const Fubi::UserSnapshot* user);
     void changeMode(bool newMode);
     void newSceneSize(float sw, float sd, float sdo);
 
@@ -44,26 +48,31 @@ private:
     int boundValue(float *value, float up, float low);
     void initPerfMapping();
     void initInstallMapping();
+    void updateCombinationControls();
+    std::vector<MessageToSend> controlMessages(const Fubi::UserSnapshot* user, MashtaSoundControl control);
 
-    MessageToSend loopMessage(FubiUser* user);
-    MessageToSend stopMessage(FubiUser* user);
-    MessageToSend reverbFreezeMessage(FubiUser* user);
-    MessageToSend volumeMessage(FubiUser* user);
-    MessageToSend volumeMessage(FubiUser* user, float defaultValue);
-    MessageToSend speedMessage(FubiUser* user);
-    MessageToSend speedMessage(FubiUser* user, float defaultValue);
-    MessageToSend reverbMixMessage(FubiUser* user);
-    MessageToSend reverbDampingMessage(FubiUser* user);
-    MessageToSend panMessage(FubiUser* user);
-    MessageToSend panMessage(FubiUser* user, float defaultValue);
-    MessageToSend positionMessage(FubiUser* user);
-    MessageToSend pauseAllMessage(FubiUser* user);
-    MessageToSend killAllMessage(FubiUser* user);
+    MessageToSend loopMessage(const Fubi::UserSnapshot* user);
+    MessageToSend stopMessage(const Fubi::UserSnapshot* user);
+    MessageToSend reverbFreezeMessage(const Fubi::UserSnapshot* user);
+    MessageToSend volumeMessage(const Fubi::UserSnapshot* user);
+    MessageToSend volumeMessage(const Fubi::UserSnapshot* user, float defaultValue);
+    MessageToSend speedMessage(const Fubi::UserSnapshot* user);
+    MessageToSend speedMessage(const Fubi::UserSnapshot* user, float defaultValue);
+    MessageToSend reverbMixMessage(const Fubi::UserSnapshot* user);
+    MessageToSend reverbDampingMessage(const Fubi::UserSnapshot* user);
+    MessageToSend panMessage(const Fubi::UserSnapshot* user);
+    MessageToSend panMessage(const Fubi::UserSnapshot* user, float defaultValue);
+    MessageToSend positionMessage(const Fubi::UserSnapshot* user);
+    MessageToSend pauseAllMessage(const Fubi::UserSnapshot* user);
+    MessageToSend killAllMessage(const Fubi::UserSnapshot* user);
 
 	bool reverbFreeze[16];
     bool perfMode; // true for performance mode, false for installation mode
 	float sceneWidth, sceneDepth, sceneDepthOffset;
     
 	std::map<std::string, MashtaSoundControl> mapping;
+	// Mapping resolved per combination index, NB_SOUND_CONTROL if not mapped
+	std::vector<std::string> combinationNames;
+	std::vector<MashtaSoundControl> combinationControls;
 };
 
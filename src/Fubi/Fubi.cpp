@@ -79,6 +79,8 @@ namespace Fubi
 #ifdef USE_KINECT_SDK
 		ret |= SensorType::KINECTSDK;
 #endif
+		ret |= SensorType::REPLAY;
+		ret |= SensorType::SYNTHETIC;
 		return ret;
 	}
 
@@ -94,6 +96,137 @@ namespace Fubi
 			core->updateSensor();
 	}
 
+	FUBI_API bool startTrackingThread()
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			return core->startTrackingThread();
+		return false;
+	}
+
+	FUBI_API void stopTrackingThread()
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			core->stopTrackingThread();
+	}
+
+	FUBI_API bool isTrackingThreadRunning()
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			return core->isTrackingThreadRunning();
+		return false;
+	}
+
+	FUBI_API const Fubi::TrackingSnapshot* getTrackingSnapshot(unsigned int consumerID /*= 0*/, bool* isNewSnapshot /*= 0x0*/)
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			return core->getTrackingSnapshot(consumerID, isNewSnapshot);
+		if (isNewSnapshot)
+			*isNewSnapshot = false;
+		return 0x0;
+	}
+
+	FUBI_API bool pollRecognitionEvent(Fubi::RecognitionEvent& event)
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			return core->pollRecognitionEvent(event);
+		return false;
+	}
+
+	FUBI_API void setRecognitionEventCallback(Fubi::RecognitionEventCallback callback, void* userData /*= 0x0*/)
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			core->setRecognitionEventCallback(callback, userData);
+	}
+
+	FUBI_API void setRecognitionEventUserStates(bool enable)
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			core->setRecognitionEventUserStates(enable);
+	}
+
+	FUBI_API void setSnapshotLocalTransformations(bool enable)
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			core->setSnapshotLocalTransformations(enable);
+	}
+
+	FUBI_API void setNumUserUpdateThreads(unsigned int numThreads)
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			core->setNumUserUpdateThreads(numThreads);
+	}
+
+	FUBI_API void lockTracking()
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			core->lockTracking();
+	}
+
+	FUBI_API void unlockTracking()
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			core->unlockTracking();
+	}
+
+	FUBI_API void enableProfiling(bool enable)
+	{
+		FubiProfiler::enable(enable);
+	}
+
+	FUBI_API bool isProfilingEnabled()
+	{
+		return FubiProfiler::isEnabled();
+	}
+
+	FUBI_API bool getProfilingStats(ProfilingStage::Stage stage, ProfilingStats& stats)
+	{
+		return FubiProfiler::getStats(stage, stats);
+	}
+
+	FUBI_API void resetProfiling()
+	{
+		FubiProfiler::reset();
+	}
+
+	FUBI_API bool dumpProfilingStats(const char* fileName)
+	{
+		return FubiProfiler::dumpToFile(fileName);
+	}
+
+	FUBI_API bool startRecording(const char* fileName, bool withImages /*= false*/)
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			return core->startRecording(fileName, withImages);
+		return false;
+	}
+
+	FUBI_API void stopRecording()
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			core->stopRecording();
+	}
+
+	FUBI_API bool isRecording()
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			return core->isRecording();
+		return false;
+	}
+
 	FUBI_API bool getImage(unsigned char* outputImage, ImageType::Type type, ImageNumChannels::Channel numChannels, ImageDepth::Depth depth,
 		unsigned int renderOptions /*= (RenderOptions::Shapes | RenderOptions::Skeletons | RenderOptions::UserCaptions)*/,
 		DepthImageModification::Modification depthModifications /*= DepthImageModification::UseHistogram*/,
@@ -153,6 +286,14 @@ namespace Fubi
 		return Fubi::RecognitionResult::NOT_RECOGNIZED;
 	}
 
+	FUBI_API Fubi::RecognitionResult::Result getCombinationRecognitionProgressOnByIndex(unsigned int recognizerIndex, unsigned int userID, std::vector<FubiUser::TrackingData>* userStates /*= 0x0*/, bool restart /*= true*/)
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			return core->getCombinationRecognitionProgressOnByIndex(recognizerIndex, userID, userStates, restart);
+		return Fubi::RecognitionResult::NOT_RECOGNIZED;
+	}
+
 	FUBI_API Fubi::RecognitionResult::Result getCombinationRecognitionProgressOn(const char* recognizerName, unsigned int userID, std::vector<FubiUser::TrackingData>* userStates /*= 0x0*/, bool restart /*= true*/)
 	{
 		FubiCore* core = FubiCore::getInstance();
@@ -168,6 +309,13 @@ namespace Fubi
 			core->enableCombinationRecognition(combinationID, userID, enable);
 	}
 
+	FUBI_API void enableCombinationRecognitionByIndex(unsigned int combinationIndex, unsigned int userID, bool enable)
+	{
+		FubiCore* core = FubiCore::getInstance();
+		if (core)
+			core->enableCombinationRecognitionByIndex(combinationIndex, userID, enable);
+	}
+
 	FUBI_API void enableCombinationRecognition(const char* combinationName, unsigned int userID, bool enable)
 	{
 		FubiCore* core = FubiCore::getInstance();
@@ -446,7 +594,9 @@ namespace Fubi
 			FubiUser* user = core->getUser(userId);
 			if (user)
 			{
-				return &user->m_currentTrackingData;
+				// The data may be read completely, including local transformations not used by any recognizer
+				user->updateLocalTransformations(LocalTransformationJoints::all());
+				return &user->getCurrentTrackingData();
 			}
 		}
 		return 0;
@@ -460,7 +610,8 @@ namespace Fubi
 			FubiUser* user = core->getUser(userId);
 			if (user)
 			{
-				return &user->m_lastTrackingData;
+				user->updateLocalTransformations(LocalTransformationJoints::all(), true);
+				return &user->getLastTrackingData();
 			}
 		}
 		return 0;
@@ -30,6 +30,8 @@
 #include "FubiPredefinedGestures.h"
 #include "FubiUtils.h"
 #include "FubiUser.h"
+#include "FubiTrackingSnapshot.h"
+#include "FubiProfiler.h"
 
 /**
  * \mainpage Fubi - Full Body Interaction Framework
@@ -177,6 +179,152 @@ namespace Fubi
 	 */
 	FUBI_API void updateSensor();
 
+	/**
+	 * \brief Starts a thread that continuously updates the sensor and all recognizers (instead of calling updateSensor() yourself)
+	 *        and publishes a snapshot of all users for each new tracking frame.
+	 *        User defined combinations are automatically checked for all tracked users, counted in the snapshots
+	 *        and reported as recognition events (see pollRecognitionEvent()), so don't use getCombinationRecognitionProgressOn() for them while the thread is running.
+	 * 
+	 * @return true if the thread is running
+	 */
+	FUBI_API bool startTrackingThread();
+
+	/**
+	 * \brief Stops the tracking thread, afterwards you have to call updateSensor() yourself again
+	 * 
+	 */
+	FUBI_API void stopTrackingThread();
+
+	/**
+	 * \brief Whether the tracking thread is currently running
+	 * 
+	 */
+	FUBI_API bool isTrackingThreadRunning();
+
+	/**
+	 * \brief Get the latest snapshot published by the tracking thread
+	 *        Each thread that wants to read snapshots has to use its own consumer id
+	 * 
+	 * @param consumerID id of the calling consumer from 0 to Fubi::MaxSnapshotConsumers-1
+	 * @param isNewSnapshot (= 0x0) if given, set to whether the snapshot has been published since the last call with the same consumer id
+	 * @return pointer to the snapshot that stays valid until the next call with the same consumer id, 0x0 for an invalid consumer id
+	 */
+	FUBI_API const Fubi::TrackingSnapshot* getTrackingSnapshot(unsigned int consumerID = 0, bool* isNewSnapshot = 0x0);
+
+	/**
+	 * \brief Takes the next user defined combination recognized by the tracking thread, in the order of their recognition.
+	 *        The events are sent at the end of the tracking frame the combination has been completed in,
+	 *        so there is no need to compare the combination counts of the snapshots.
+	 *        Only one thread may take the events, up to Fubi::MaxRecognitionEvents are kept until then.
+	 * 
+	 * @param event the event to fill, its m_userStates keep their memory for the next events
+	 * @return true if there was an event, false if there are no more events
+	 */
+	FUBI_API bool pollRecognitionEvent(Fubi::RecognitionEvent& event);
+
+	/**
+	 * \brief Sets a function that the tracking thread calls for each recognition event (in addition to the ones that can be polled).
+	 *        It is called while the tracking thread holds the tracking lock, so it should return quickly.
+	 * 
+	 * @param callback the function to call, 0x0 to remove it
+	 * @param userData (= 0x0) passed to the callback
+	 */
+	FUBI_API void setRecognitionEventCallback(Fubi::RecognitionEventCallback callback, void* userData = 0x0);
+
+	/**
+	 * \brief Whether the recognition events contain the tracking data of the user at each state transition of the combination.
+	 *        Disabled by default, as the tracking data has to be copied for each event.
+	 * 
+	 */
+	FUBI_API void setRecognitionEventUserStates(bool enable);
+
+	/**
+	 * \brief Whether the tracking snapshots contain the local positions and orientations of all joints.
+	 *        Disabled by default, as then only the local transformations used by the loaded recognizers have to be calculated,
+	 *        the ones of the other joints are not valid in the snapshots.
+	 * 
+	 */
+	FUBI_API void setSnapshotLocalTransformations(bool enable);
+
+	/**
+	 * \brief Lets updateSensor() process the tracking data of the users in parallel,
+	 *        which is useful for many users with many recognizers. Disabled by default.
+	 *        Note that user defined recognizers are then applied from different threads for different users.
+	 * 
+	 * @param numThreads number of worker threads in addition to the updating one, 0 for updating the users one after the other
+	 */
+	FUBI_API void setNumUserUpdateThreads(unsigned int numThreads);
+
+	/**
+	 * \brief Blocks the tracking thread until unlockTracking() is called,
+	 *        needed for accessing the users (e.g. getUser()) directly while the tracking thread is running.
+	 *        Loading recognizers, switching the sensor and getting images already lock on their own.
+	 * 
+	 */
+	FUBI_API void lockTracking();
+
+	/**
+	 * \brief Releases the lock acquired with lockTracking()
+	 * 
+	 */
+	FUBI_API void unlockTracking();
+
+	/**
+	 * \brief Starts or stops measuring the durations of the different parts of a tracking frame (see Fubi::ProfilingStage).
+	 *        Disabled by default, the measurements are then skipped at almost no cost.
+	 * 
+	 * @param enable whether to collect new measurements, already collected ones are kept until resetProfiling() is called
+	 */
+	FUBI_API void enableProfiling(bool enable);
+
+	/**
+	 * \brief Whether the durations of the tracking frame stages are currently measured
+	 */
+	FUBI_API bool isProfilingEnabled();
+
+	/**
+	 * \brief Get the latency distribution of one stage measured since profiling has been enabled or reset
+	 * 
+	 * @param stage the stage to query
+	 * @param stats number of samples, mean, 50th, 95th and 99th percentile and maximum of the durations in milliseconds
+	 * @return false if there are no measurements for that stage yet
+	 */
+	FUBI_API bool getProfilingStats(ProfilingStage::Stage stage, ProfilingStats& stats);
+
+	/**
+	 * \brief Discards all profiling measurements
+	 */
+	FUBI_API void resetProfiling();
+
+	/**
+	 * \brief Writes the profiling stats of all stages to a tab separated text file
+	 * 
+	 * @param fileName name of the file to (over)write
+	 * @return true if the file has been written successfully
+	 */
+	FUBI_API bool dumpProfilingStats(const char* fileName);
+
+	/**
+	 * \brief Starts recording the user ids, joint positions, orientations and confidences of every new sensor frame to a file.
+	 *        The recording can be replayed instead of a real sensor with the sensor type SensorType::REPLAY
+	 *        and the file name set in SensorOptions::m_replayOptions.
+	 * 
+	 * @param fileName name of the file to (over)write
+	 * @param withImages whether to also record the depth and user label images (about 1 MB per frame)
+	 * @return true if the file could be created and a sensor is active
+	 */
+	FUBI_API bool startRecording(const char* fileName, bool withImages = false);
+
+	/**
+	 * \brief Stops and closes the current recording
+	 */
+	FUBI_API void stopRecording();
+
+	/**
+	 * \brief Whether a recording is running
+	 */
+	FUBI_API bool isRecording();
+
 	/**
 	 * \brief retrieve an image from one of the OpenNI production nodes with specific format and optionally enhanced by different
 	 *        tracking information 
@@ -262,6 +410,18 @@ namespace Fubi
 	 */
 	FUBI_API Fubi::RecognitionResult::Result getCombinationRecognitionProgressOn(Combinations::Combination combinationID, unsigned int userID, std::vector<FubiUser::TrackingData>* userStates = 0x0, bool restart = true);
 
+	/**
+	 * \brief Checks a user defined combination recognizer for its progress
+	 * 
+	 * @param recognizerIndex index of the combination, see getUserDefinedCombinationRecognizerIndex()
+	 * @param userID the OpenNI user id of the user to be checked
+	 * @param userStates (= 0x0) pointer to a vector of tracking data that represents the tracking information of the user
+	 *		  during the recognition of each state
+	 * @param restart (=true) if set to true, the recognizer automatically restarts, so the combination can be recognized again.
+	 * @return RECOGNIZED in case of a succesful detection, TRACKING_ERROR if a needed joint is currently not tracked, NOT_RECOGNIZED else
+	 */
+	FUBI_API Fubi::RecognitionResult::Result getCombinationRecognitionProgressOnByIndex(unsigned int recognizerIndex, unsigned int userID, std::vector<FubiUser::TrackingData>* userStates = 0x0, bool restart = true);
+
 	/**
 	 * \brief Checks a user defined combination recognizer for its progress
 	 * 
@@ -283,6 +443,15 @@ namespace Fubi
 	 */
 	FUBI_API void enableCombinationRecognition(Combinations::Combination combinationID, unsigned int userID, bool enable);
 
+	/**
+	 * \brief Starts or stops the recognition process of a user defined combination for one user
+	 * 
+	 * @param combinationIndex index of the combination, see getUserDefinedCombinationRecognizerIndex()
+	 * @param userID the OpenNI user id of the user for whom the recognizers should be modified
+	 * @param enable if set to true, the recognizer will be started (if not already stared), else it stops
+	 */
+	FUBI_API void enableCombinationRecognitionByIndex(unsigned int combinationIndex, unsigned int userID, bool enable);
+
 	/**
 	 * \brief Starts or stops the recognition process of a user defined combination for one user
 	 * 
@@ -470,6 +639,8 @@ namespace Fubi
 
 	/**
 	 * \brief Returns the index of a user defined combination recognizer
+	 *        The index stays valid until the recognizers are cleared, so it can be resolved once after loading
+	 *        and used with getCombinationRecognitionProgressOnByIndex() and enableCombinationRecognitionByIndex()
 	 * 
 	 * @param recognizerName name of the recognizer
 	 * @return returns the recognizer name or -1 if not found
@@ -42,6 +42,10 @@
 // Uncomment to print more information about the progress of the combination recognizers to the console
 //#define COMBINATIONREC_DEBUG_LOGGING
 
+// Uncomment to leave the face joints out of the calculated orientations and local transformations,
+// e.g. for sensors that never provide them (see FubiSkeleton.h)
+//#define FUBI_SKELETON_WITHOUT_FACE
+
 
 // Log level options (Do not modify!)
 // 0=all messages 1=errors, warnings, and infos 2= errors and warnings 3=errors and infos 4=errors only 5=silent
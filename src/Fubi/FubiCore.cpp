@@ -19,6 +19,7 @@
 
 // Image processing
 #include "FubiImageProcessing.h"
+#include "FubiProfiler.h"
 
 #ifdef USE_OPENNI2
 // OpenNI v2.x integration
@@ -32,6 +33,9 @@
 // Kinect SDK integration
 #include "FubiKinectSDKSensor.h"
 #endif
+// Replay of recordings, always available
+#include "FubiReplaySensor.h"
+#include "FubiSyntheticSensor.h"
 
 // File reading for Xml parsing
 #include <fstream>
@@ -39,16 +43,26 @@
 // Sorting and more
 #include <algorithm>
 #include <iostream>
+#include <cstring>
+
+// Sleeping in the tracking thread
+#include <chrono>
 
 using namespace Fubi;
 using namespace std;
 
+// Copy of the state drawn by getImage() and saveImage(), each rendering thread has its own one
+// So only the copying blocks the tracking thread, the drawing runs without the tracking lock
+static thread_local FubiImageProcessing::RenderData s_renderData;
+
 const std::string FubiCore::s_emtpyString;
 
 FubiCore* FubiCore::s_instance = 0x0;
 
 FubiCore::~FubiCore()
 {
+	stopTrackingThread();
+
 	for (unsigned int i = 0; i < Postures::NUM_POSTURES; ++i)
 	{
 		delete m_postureRecognizers[i];
@@ -63,10 +77,16 @@ FubiCore::~FubiCore()
 	}
 	m_numUsers = 0;
 
+	delete m_userUpdatePool;
+
+	stopRecording();
 	delete m_sensor;
 }
 
-FubiCore::FubiCore() : m_numUsers(0), m_sensor(0x0)
+FubiCore::FubiCore() : m_numUsers(0), m_sensor(0x0), m_frameTimeStamp(0), m_frameHasNewData(false), m_userUpdatePool(0x0), m_trackingThread(0x0), m_trackingThreadRunning(false),
+	m_snapshotFrameID(0), m_recognizerSetID(0),
+	m_recognitionEventCallback(0x0), m_recognitionEventUserData(0x0), m_recognitionEventUserStates(false),
+	m_snapshotLocalTransformations(false), m_recorder(0x0)
 {
 
 	for (unsigned int i = 0; i < MaxUsers; ++i)
@@ -107,6 +127,8 @@ bool FubiCore::initFromXml(const char* xmlPath, Fubi::SkeletonTrackingProfile::P
 
 bool FubiCore::initSensorWithOptions(const Fubi::SensorOptions& options)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
+
 	delete m_sensor;
 	m_sensor = 0x0;
 	bool succes = false;
@@ -147,6 +169,16 @@ bool FubiCore::initSensorWithOptions(const Fubi::SensorOptions& options)
 		Fubi_logErr("Kinect SDK sensor is not activated\n -Did you forget to uncomment the USE_OPENNIX/USE_KINECTSDK define in the FubiConfig.h?\n");	
 #endif
 	}
+	else if (options.m_type == SensorType::REPLAY)
+	{
+		m_sensor = new FubiReplaySensor();
+		succes = m_sensor->initWithOptions(options);
+	}
+	else if (options.m_type == SensorType::SYNTHETIC)
+	{
+		m_sensor = new FubiSyntheticSensor();
+		succes = m_sensor->initWithOptions(options);
+	}
 	else if (options.m_type == SensorType::NONE)
 	{
 		Fubi_logInfo("FubiCore: Current sensor deactivated, now in non-tracking mode!\n");
@@ -166,14 +198,277 @@ void FubiCore::updateSensor()
 {
 	if (m_sensor)
 	{
-		m_sensor->update();
+		{
+			FubiProfileScope profile(ProfilingStage::SENSOR_UPDATE);
+			m_sensor->update();
+		}
+
+		// One time stamp for the whole frame, preferably the one of the sensor
+		m_frameTimeStamp = m_sensor->getTrackingTimeStamp();
+		if (m_frameTimeStamp < 0)
+			m_frameTimeStamp = currentTime();
+		// Only ask once per frame, as some sensors reset the flag when asked
+		m_frameHasNewData = m_sensor->hasNewTrackingData();
 
 		// Get the current number and ids of users, adapt the useridTouser map
 		// init new users and update tracking info
 		updateUsers();
+
+		if (m_recorder && m_frameHasNewData)
+			recordFrame();
 	}
 }
 
+bool FubiCore::startRecording(const char* fileName, bool withImages /*= false*/)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
+
+	stopRecording();
+	if (m_sensor == 0x0)
+	{
+		Fubi_logErr("FubiCore: Cannot record without an active sensor!\n");
+		return false;
+	}
+
+	const StreamOptions& depthOptions = m_sensor->getDepthOptions();
+	RecordingInfo info(depthOptions.m_width, depthOptions.m_height, withImages, withImages);
+	m_recorder = new FubiRecordingWriter();
+	if (!m_recorder->open(fileName, info))
+	{
+		delete m_recorder;
+		m_recorder = 0x0;
+		return false;
+	}
+	Fubi_logInfo("FubiCore: Recording to \"%s\".\n", fileName);
+	return true;
+}
+
+void FubiCore::stopRecording()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
+
+	if (m_recorder)
+	{
+		// Wait for the writer thread to finish the file
+		m_recorder->close();
+		Fubi_logInfo("FubiCore: Recording stopped after %d frames, %d frames dropped.\n", m_recorder->getNumWrittenFrames(), m_recorder->getNumDroppedFrames());
+		delete m_recorder;
+		m_recorder = 0x0;
+	}
+}
+
+void FubiCore::recordFrame()
+{
+	RecordedFrame& frame = m_recordedFrame;
+	frame.m_timeStamp = m_frameTimeStamp;
+
+	unsigned int userIDs[MaxUsers];
+	frame.m_numUsers = std::min<unsigned short>(m_sensor->getUserIDs(userIDs), MaxUsers);
+	for (unsigned short i = 0; i < frame.m_numUsers; ++i)
+	{
+		RecordedUser& user = frame.m_users[i];
+		user.m_id = userIDs[i];
+		user.m_isTracked = m_sensor->isTracking(user.m_id);
+		for (unsigned int j = 0; j < SkeletonJoint::NUM_JOINTS; ++j)
+			m_sensor->getSkeletonJointData(user.m_id, (SkeletonJoint::Joint) j, user.m_positions[j], user.m_orientations[j]);
+	}
+
+	const RecordingInfo& info = m_recorder->getInfo();
+	const unsigned int imageSize = info.m_depthWidth * info.m_depthHeight;
+	const unsigned short* depthData = info.m_hasDepthData ? m_sensor->getDepthData() : 0x0;
+	if (depthData)
+		frame.m_depthData.assign(depthData, depthData + imageSize);
+	else
+		frame.m_depthData.clear();
+	const unsigned short* userLabelData = info.m_hasUserLabelData ? m_sensor->getUserLabelData() : 0x0;
+	if (userLabelData)
+		frame.m_userLabelData.assign(userLabelData, userLabelData + imageSize);
+	else
+		frame.m_userLabelData.clear();
+
+	// A dropped frame is only a gap in the recording, a failing disk ends it
+	if (!m_recorder->writeFrame(frame) && m_recorder->hasFailed())
+	{
+		Fubi_logErr("FubiCore: Writing the recording failed, recording stopped!\n");
+		stopRecording();
+	}
+}
+
+bool FubiCore::startTrackingThread()
+{
+	if (m_trackingThread)
+	{
+		Fubi_logWrn("FubiCore: Tracking thread already running!\n");
+		return true;
+	}
+
+	m_trackingThreadRunning = true;
+	m_trackingThread = new std::thread(&FubiCore::trackingThreadLoop, this);
+	Fubi_logInfo("FubiCore: Tracking thread started.\n");
+	return true;
+}
+
+void FubiCore::stopTrackingThread()
+{
+	if (m_trackingThread)
+	{
+		m_trackingThreadRunning = false;
+		m_trackingThread->join();
+		delete m_trackingThread;
+		m_trackingThread = 0x0;
+		Fubi_logInfo("FubiCore: Tracking thread stopped.\n");
+	}
+}
+
+void FubiCore::trackingThreadLoop()
+{
+	while (m_trackingThreadRunning)
+	{
+		bool hasSensor = false, newData = false;
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
+			hasSensor = m_sensor != 0x0;
+			if (hasSensor)
+			{
+				updateSensor();
+				newData = m_frameHasNewData;
+				if (newData)
+				{
+					sendRecognitionEvents();
+					publishTrackingSnapshot();
+				}
+			}
+		}
+
+		// Give the sensor some time for the next frame (also let others acquire the lock)
+		if (!newData)
+			std::this_thread::sleep_for(std::chrono::milliseconds(hasSensor ? 1 : 10));
+	}
+}
+
+void FubiCore::sendRecognitionEvents()
+{
+	unsigned int numCombinations = m_userDefinedCombinationRecognizers.size();
+	for (unsigned short i = 0; i < m_numUsers; ++i)
+	{
+		FubiUser* user = m_users[i];
+		if (user->m_isTracked && user->m_inScene)
+		{
+			std::vector<unsigned int>& counts = m_combinationRecognitionCounts[user->m_id];
+			if (counts.size() != numCombinations)
+				counts.resize(numCombinations, 0);
+		}
+
+		// Only the combinations the user has completed in this frame, nothing to check for all others
+		for (unsigned int j = 0; j < user->m_recognizedCombinations.size(); ++j)
+		{
+			CombinationRecognizer* rec = user->m_recognizedCombinations[j];
+			unsigned int index = (unsigned int) rec->getUserDefinedIndex();
+			if (index >= numCombinations)
+				continue;
+
+			RecognitionEvent& event = m_recognitionEvent;
+			event.m_userID = user->m_id;
+			event.m_combinationIndex = index;
+			event.m_recognizerSetID = m_recognizerSetID;
+			// The snapshot of this frame is published next
+			event.m_frameID = m_snapshotFrameID + 1;
+			event.m_timeStamp = user->getCurrentTrackingData().timeStamp;
+			event.m_userStates.clear();
+			// Restart the recognizer for the next performance
+			rec->getRecognitionProgress(m_recognitionEventUserStates ? &event.m_userStates : 0x0, true);
+
+			std::vector<unsigned int>& counts = m_combinationRecognitionCounts[user->m_id];
+			if (counts.size() != numCombinations)
+				counts.resize(numCombinations, 0);
+			counts[index]++;
+
+			// Dropped if nobody takes the events from the queue
+			m_recognitionEvents.push(event);
+			if (m_recognitionEventCallback)
+				m_recognitionEventCallback(event, m_recognitionEventUserData);
+		}
+		user->m_recognizedCombinations.clear();
+	}
+}
+
+bool FubiCore::pollRecognitionEvent(Fubi::RecognitionEvent& event)
+{
+	return m_recognitionEvents.pop(event);
+}
+
+void FubiCore::setRecognitionEventCallback(Fubi::RecognitionEventCallback callback, void* userData)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
+	m_recognitionEventCallback = callback;
+	m_recognitionEventUserData = userData;
+}
+
+void FubiCore::setRecognitionEventUserStates(bool enable)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
+	m_recognitionEventUserStates = enable;
+}
+
+void FubiCore::setSnapshotLocalTransformations(bool enable)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
+	m_snapshotLocalTransformations = enable;
+}
+
+void FubiCore::publishTrackingSnapshot()
+{
+	TrackingSnapshot& snapshot = m_snapshotBuffers[0].getWriteBuffer();
+	snapshot.m_frameID = ++m_snapshotFrameID;
+	snapshot.m_timeStamp = m_frameTimeStamp;
+	snapshot.m_recognizerSetID = m_recognizerSetID;
+	snapshot.m_combinationNames.resize(m_userDefinedCombinationRecognizers.size());
+	for (unsigned int i = 0; i < m_userDefinedCombinationRecognizers.size(); ++i)
+		snapshot.m_combinationNames[i] = m_userDefinedCombinationRecognizers[i].first;
+
+	// Store the users sorted according to their distance
+	std::deque<FubiUser*> closestUsers = getClosestUsers();
+	snapshot.m_numUsers = (unsigned short) closestUsers.size();
+	for (unsigned short i = 0; i < snapshot.m_numUsers; ++i)
+	{
+		FubiUser* user = closestUsers[i];
+		UserSnapshot& userSnapshot = snapshot.m_users[i];
+		userSnapshot.m_id = user->m_id;
+		userSnapshot.m_inScene = user->m_inScene;
+		userSnapshot.m_isTracked = user->m_isTracked;
+		if (m_snapshotLocalTransformations)
+			user->updateLocalTransformations(LocalTransformationJoints::all());
+		userSnapshot.m_currentTrackingData = user->getCurrentTrackingData();
+		std::map<unsigned int, std::vector<unsigned int> >::const_iterator counts = m_combinationRecognitionCounts.find(user->m_id);
+		if (counts != m_combinationRecognitionCounts.end())
+			userSnapshot.m_combinationRecognitionCounts = counts->second;
+		else
+			userSnapshot.m_combinationRecognitionCounts.assign(snapshot.m_combinationNames.size(), 0);
+	}
+
+	// The other consumers get a copy of the same snapshot
+	for (unsigned int i = 1; i < MaxSnapshotConsumers; ++i)
+	{
+		m_snapshotBuffers[i].getWriteBuffer() = snapshot;
+		m_snapshotBuffers[i].publish();
+	}
+	m_snapshotBuffers[0].publish();
+}
+
+const Fubi::TrackingSnapshot* FubiCore::getTrackingSnapshot(unsigned int consumerID /*= 0*/, bool* isNewSnapshot /*= 0x0*/)
+{
+	if (consumerID >= MaxSnapshotConsumers)
+	{
+		Fubi_logErr("FubiCore: Invalid snapshot consumer id %u, only %u consumers supported!\n", consumerID, MaxSnapshotConsumers);
+		return 0x0;
+	}
+
+	bool isNew = m_snapshotBuffers[consumerID].fetch();
+	if (isNewSnapshot)
+		*isNewSnapshot = isNew;
+	return &m_snapshotBuffers[consumerID].getReadBuffer();
+}
+
 
 Fubi::RecognitionResult::Result FubiCore::recognizeGestureOn(Postures::Posture postureID, unsigned int userID)
 {
@@ -311,16 +606,23 @@ void FubiCore::enableCombinationRecognition(Combinations::Combination combinatio
 	}
 }
 
-void FubiCore::enableCombinationRecognition(const std::string& combinationName, unsigned int userID, bool enable)
+void FubiCore::enableCombinationRecognitionByIndex(unsigned int combinationIndex, unsigned int userID, bool enable)
 {
 	FubiUser* user = getUser(userID);
 	if (user)
 	{	
 		// Found user
-		user->enableCombinationRecognition(getUserDefinedCombinationRecognizer(combinationName), enable);
+		user->enableCombinationRecognition(getUserDefinedCombinationRecognizer(combinationIndex), enable);
 	}
 }
 
+void FubiCore::enableCombinationRecognition(const std::string& combinationName, unsigned int userID, bool enable)
+{
+	int combinationIndex = getUserDefinedCombinationRecognizerIndex(combinationName);
+	if (combinationIndex >= 0)
+		enableCombinationRecognitionByIndex((unsigned) combinationIndex, userID, enable);
+}
+
 bool FubiCore::getAutoStartCombinationRecognition(Fubi::Combinations::Combination combinationID /*= Fubi::Combinations::NUM_COMBINATIONS*/)
 {
 	if (m_autoStartCombinationRecognizers[Fubi::Combinations::NUM_COMBINATIONS])
@@ -380,20 +682,27 @@ Fubi::RecognitionResult::Result FubiCore::getCombinationRecognitionProgressOn(Co
 	return Fubi::RecognitionResult::NOT_RECOGNIZED;
 }
 
-Fubi::RecognitionResult::Result FubiCore::getCombinationRecognitionProgressOn(const std::string& recognizerName, unsigned int userID, std::vector<FubiUser::TrackingData>* userStates, bool restart)
+Fubi::RecognitionResult::Result FubiCore::getCombinationRecognitionProgressOnByIndex(unsigned int combinationIndex, unsigned int userID, std::vector<FubiUser::TrackingData>* userStates, bool restart)
 {
 	FubiUser* user = getUser(userID);
 	if (user)
 	{
-		std::map<string, CombinationRecognizer*>::iterator rec = user->m_userDefinedCombinationRecognizers.find(recognizerName);
 		// Found the user
-		if (rec != user->m_userDefinedCombinationRecognizers.end() && rec->second)
-			return rec->second->getRecognitionProgress(userStates, restart);
+		if (combinationIndex < user->m_userDefinedCombinationRecognizers.size() && user->m_userDefinedCombinationRecognizers[combinationIndex])
+			return user->m_userDefinedCombinationRecognizers[combinationIndex]->getRecognitionProgress(userStates, restart);
 		return Fubi::RecognitionResult::NOT_RECOGNIZED;
 	}
 	return Fubi::RecognitionResult::NOT_RECOGNIZED;
 }
 
+Fubi::RecognitionResult::Result FubiCore::getCombinationRecognitionProgressOn(const std::string& recognizerName, unsigned int userID, std::vector<FubiUser::TrackingData>* userStates, bool restart)
+{
+	int combinationIndex = getUserDefinedCombinationRecognizerIndex(recognizerName);
+	if (combinationIndex >= 0)
+		return getCombinationRecognitionProgressOnByIndex((unsigned) combinationIndex, userID, userStates, restart);
+	return Fubi::RecognitionResult::NOT_RECOGNIZED;
+}
+
 FubiUser* FubiCore::getUser(unsigned int userId)
 {
 	map<unsigned int, FubiUser*>::const_iterator iter = m_userIDToUsers.find(userId);
@@ -406,6 +715,8 @@ FubiUser* FubiCore::getUser(unsigned int userId)
 
 void FubiCore::updateUsers()
 {
+	FubiProfileScope profile(ProfilingStage::UPDATE_USERS);
+
 	static unsigned int userIDs[MaxUsers];
 
 	if (m_sensor)
@@ -480,12 +791,36 @@ void FubiCore::updateUsers()
 			}
 
 			// Now the user has to be in the correct slot and everything should be set correctly
-			
-			bool wasTracked = user->m_isTracked;
-			// get the tracking data from the sensor
-			user->updateTrackingData(m_sensor);
+		}
+
+		// Get the tracking data from the sensor
+		bool wasTracked[MaxUsers];
+		for (unsigned int i = 0; i < m_numUsers; ++i)
+		{
+			wasTracked[i] = m_users[i]->m_isTracked;
+			m_usersToProcess[i] = m_users[i]->fetchTrackingData(m_sensor, m_frameHasNewData, m_frameTimeStamp);
+		}
+
+		// Process it for all users (in parallel if activated)
+		if (m_userUpdatePool)
+			m_userUpdatePool->parallelFor(m_numUsers, &FubiCore::processUserTask, this);
+		else
+		{
+			for (unsigned int i = 0; i < m_numUsers; ++i)
+				processUserTask(this, i);
+		}
+
+		// Finger counts are not updated in parallel, as they share the depth image of the sensor
+		for (unsigned int i = 0; i < m_numUsers; ++i)
+		{
+			if (m_usersToProcess[i])
+				m_users[i]->updateFingerCount();
+		}
 
-			if (!wasTracked && user->m_isTracked)
+		for (unsigned int i = 0; i < m_numUsers; ++i)
+		{
+			FubiUser* user = m_users[i];
+			if (!wasTracked[i] && user->m_isTracked)
 			{
 				// User tracking has started for this one!
 				// Autostart posture combination detection
@@ -525,6 +860,31 @@ void FubiCore::updateUsers()
 	}
 }
 
+void FubiCore::processUserTask(void* core, unsigned int userIndex)
+{
+	FubiCore* self = (FubiCore*) core;
+	if (self->m_usersToProcess[userIndex])
+		self->m_users[userIndex]->processTrackingData();
+}
+
+void FubiCore::setNumUserUpdateThreads(unsigned int numThreads)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
+
+	if (numThreads != getNumUserUpdateThreads())
+	{
+		delete m_userUpdatePool;
+		m_userUpdatePool = 0x0;
+		if (numThreads > 0)
+		{
+			m_userUpdatePool = new FubiThreadPool(numThreads);
+			Fubi_logInfo("FubiCore: Updating users in parallel on %u additional threads.\n", numThreads);
+		}
+		else
+			Fubi_logInfo("FubiCore: Updating users sequentially.\n");
+	}
+}
+
 unsigned int FubiCore::addJointRelationRecognizer(SkeletonJoint::Joint joint, SkeletonJoint::Joint relJoint,
 	const Vec3f& minValues /*= Vec3f(-Math::MaxFloat,-Math::MaxFloat, -Math::MaxFloat)*/, 
 	const Vec3f& maxValues /*= Vec3f(Math::MaxFloat, Math::MaxFloat, Math::MaxFloat)*/, 
@@ -591,7 +951,8 @@ unsigned int FubiCore::addLinearMovementRecognizer(SkeletonJoint::Joint joint,	c
 		const char* name /*= 0*/,
 		float minConfidence /*=-1*/,
 		float maxAngleDiff /*= 45.0f*/, 
-		bool useOnlyCorrectDirectionComponent /*= true*/)
+		bool useOnlyCorrectDirectionComponent /*= true*/,
+		float velocityWindow /*= 0*/)
 {
 	string sName;
 	if (name != 0)
@@ -601,14 +962,14 @@ unsigned int FubiCore::addLinearMovementRecognizer(SkeletonJoint::Joint joint,	c
 	{
 		// As a new one at the end
 		atIndex = m_userDefinedRecognizers.size();
-		m_userDefinedRecognizers.push_back(pair<string, IGestureRecognizer*>(sName, createRecognizer(joint, direction, minVel, maxVel, useLocalPositions, minConfidence, maxAngleDiff, useOnlyCorrectDirectionComponent)));
+		m_userDefinedRecognizers.push_back(pair<string, IGestureRecognizer*>(sName, createRecognizer(joint, direction, minVel, maxVel, useLocalPositions, minConfidence, maxAngleDiff, useOnlyCorrectDirectionComponent, velocityWindow)));
 	}
 	else 
 	{
 		// Replacing an old one
 		delete m_userDefinedRecognizers[atIndex].second;
 		m_userDefinedRecognizers[atIndex].first = sName;
-		m_userDefinedRecognizers[atIndex].second = createRecognizer(joint, direction, minVel, maxVel, useLocalPositions, minConfidence, maxAngleDiff, useOnlyCorrectDirectionComponent);
+		m_userDefinedRecognizers[atIndex].second = createRecognizer(joint, direction, minVel, maxVel, useLocalPositions, minConfidence, maxAngleDiff, useOnlyCorrectDirectionComponent, velocityWindow);
 	}
 	// Return index
 	return atIndex;
@@ -620,7 +981,8 @@ unsigned int FubiCore::addLinearMovementRecognizer(SkeletonJoint::Joint joint, S
 	int atIndex /*=  -1*/, const char* name /*= 0*/,
 	float minConfidence /*=-1*/,
 	float maxAngleDiff /*= 45.0f*/, 
-	bool useOnlyCorrectDirectionComponent /*= true*/)
+	bool useOnlyCorrectDirectionComponent /*= true*/,
+	float velocityWindow /*= 0*/)
 {
 	string sName;
 	if (name != 0)
@@ -630,14 +992,14 @@ unsigned int FubiCore::addLinearMovementRecognizer(SkeletonJoint::Joint joint, S
 	{
 		// As a new one at the end
 		atIndex = m_userDefinedRecognizers.size();
-		m_userDefinedRecognizers.push_back(pair<string, IGestureRecognizer*>(sName, createRecognizer(joint, relJoint, direction, minVel, maxVel, useLocalPositions, minConfidence, maxAngleDiff, useOnlyCorrectDirectionComponent)));
+		m_userDefinedRecognizers.push_back(pair<string, IGestureRecognizer*>(sName, createRecognizer(joint, relJoint, direction, minVel, maxVel, useLocalPositions, minConfidence, maxAngleDiff, useOnlyCorrectDirectionComponent, velocityWindow)));
 	}
 	else 
 	{
 		// Replacing an old one
 		delete m_userDefinedRecognizers[atIndex].second;
 		m_userDefinedRecognizers[atIndex].first = sName;
-		m_userDefinedRecognizers[atIndex].second = createRecognizer(joint, relJoint, direction, minVel, maxVel, useLocalPositions, minConfidence, maxAngleDiff, useOnlyCorrectDirectionComponent);
+		m_userDefinedRecognizers[atIndex].second = createRecognizer(joint, relJoint, direction, minVel, maxVel, useLocalPositions, minConfidence, maxAngleDiff, useOnlyCorrectDirectionComponent, velocityWindow);
 	}
 	// Return index
 	return atIndex;
@@ -682,6 +1044,8 @@ unsigned short FubiCore::getCurrentUsers(FubiUser*** userContainer)
 
 bool FubiCore::addCombinationRecognizer(const std::string& xmlDefinition)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
+
 	bool loaded = false;
 
 	// copy string to buffer
@@ -709,6 +1073,8 @@ bool FubiCore::addCombinationRecognizer(const std::string& xmlDefinition)
 
 bool FubiCore::loadRecognizersFromXML(const std::string& fileName)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
+
 	// Open the file and copy the data to a buffer
 	fstream file;
 	file.open (fileName.c_str(), fstream::in | fstream::binary );
@@ -998,6 +1364,11 @@ bool FubiCore::loadRecognizersFromXML(const std::string& fileName)
 			if (attr)
 				useOnlyCorrectDirectionComponent = removeWhiteSpacesAndToLower(attr->value()) != "false";
 
+			float velocityWindow = 0;
+			attr = recNode->first_attribute("velocityWindow");
+			if (attr)
+				velocityWindow = (float) atof(attr->value());
+
 			SkeletonJoint::Joint joint = SkeletonJoint::RIGHT_HAND;
 			SkeletonJoint::Joint relJoint = SkeletonJoint::NUM_JOINTS;
 			bool useRelative = false;
@@ -1100,9 +1471,9 @@ bool FubiCore::loadRecognizersFromXML(const std::string& fileName)
 			if (useRelative)
 			{
 				if (visible)
-					addLinearMovementRecognizer(joint, relJoint, direction, minVel, maxVel, localPos, -1, name.c_str(), minConf, maxAngleDiff, useOnlyCorrectDirectionComponent);
+					addLinearMovementRecognizer(joint, relJoint, direction, minVel, maxVel, localPos, -1, name.c_str(), minConf, maxAngleDiff, useOnlyCorrectDirectionComponent, velocityWindow);
 				else
-					m_hiddenUserDefinedRecognizers.push_back(pair<string, IGestureRecognizer*>(name, createRecognizer(joint, relJoint, direction, minVel, maxVel, localPos, minConf, maxAngleDiff, useOnlyCorrectDirectionComponent)));
+					m_hiddenUserDefinedRecognizers.push_back(pair<string, IGestureRecognizer*>(name, createRecognizer(joint, relJoint, direction, minVel, maxVel, localPos, minConf, maxAngleDiff, useOnlyCorrectDirectionComponent, velocityWindow)));
 			}
 			else
 			{
@@ -1110,13 +1481,124 @@ bool FubiCore::loadRecognizersFromXML(const std::string& fileName)
 					addLinearMovementRecognizer(joint, 
 						direction, minVel, maxVel,
 						localPos,
-						-1, name.c_str(), minConf, maxAngleDiff, useOnlyCorrectDirectionComponent);
+						-1, name.c_str(), minConf, maxAngleDiff, useOnlyCorrectDirectionComponent, velocityWindow);
 				else
-					m_hiddenUserDefinedRecognizers.push_back(pair<string, IGestureRecognizer*>(name, createRecognizer(joint, direction, minVel, maxVel, localPos, minConf, maxAngleDiff, useOnlyCorrectDirectionComponent)));
+					m_hiddenUserDefinedRecognizers.push_back(pair<string, IGestureRecognizer*>(name, createRecognizer(joint, direction, minVel, maxVel, localPos, minConf, maxAngleDiff, useOnlyCorrectDirectionComponent, velocityWindow)));
 			}
 			loadedAnything = true;
 		}
 
+		for(recNode = node->first_node("TrajectoryRecognizer"); recNode; recNode = recNode->next_sibling("TrajectoryRecognizer"))
+		{
+			std::string name;
+			rapidxml::xml_attribute<>* attr = recNode->first_attribute("name");
+			if (attr)
+				name = attr->value();
+
+			bool visible = true;
+			attr = recNode->first_attribute("visibility");
+			if (attr)
+				visible = removeWhiteSpacesAndToLower(attr->value()) != "hidden";
+
+			bool localPos = false;
+			attr = recNode->first_attribute("useLocalPositions");
+			if (attr)
+				localPos = removeWhiteSpacesAndToLower(attr->value()) != "false";
+
+			float minConf = globalMinConf;
+			rapidxml::xml_attribute<>* minConfA = recNode->first_attribute("minConfidence");
+			if (minConfA)
+				minConf = (float)atof(minConfA->value());
+
+			BodyMeasurement::Measurement measure = BodyMeasurement::NUM_MEASUREMENTS;
+			rapidxml::xml_attribute<>* measuringUnit = recNode->first_attribute("measuringUnit");
+			if (measuringUnit)
+				measure = Fubi::getBodyMeasureID(measuringUnit->value());
+
+			SkeletonJoint::Joint joint = SkeletonJoint::RIGHT_HAND;
+			SkeletonJoint::Joint relJoint = SkeletonJoint::NUM_JOINTS;
+			rapidxml::xml_node<>* jointNode = recNode->first_node("Joints");
+			if (jointNode)
+			{
+//
+				vector<SkeletonJoint::Joint> sj;
+				attr = jointNode->first_attribute("main");
+				if (attr)
+				{
+					joint = getJointID(attr->value());
+					sj.push_back(joint);
+				}
+				attr = jointNode->first_attribute("relative");
+				if (attr)
+				{
+					relJoint = getJointID(attr->value());
+					sj.push_back(relJoint);
+				}
+                m_jointsRecognizers.push_back(pair<string, vector<SkeletonJoint::Joint> >(name, sj));
+//
+			}
+
+			float duration = 1.0f;
+			unsigned int numSamples = 32;
+			float warpingWindow = 0.1f;
+			float maxDistance = Math::MaxFloat;
+			rapidxml::xml_node<>* matchingNode = recNode->first_node("Matching");
+			if (matchingNode)
+			{
+				attr = matchingNode->first_attribute("duration");
+				if (attr)
+					duration = (float) atof(attr->value());
+				attr = matchingNode->first_attribute("numSamples");
+				if (attr)
+					numSamples = (unsigned) atoi(attr->value());
+				attr = matchingNode->first_attribute("warpingWindow");
+				if (attr)
+					warpingWindow = (float) atof(attr->value());
+				attr = matchingNode->first_attribute("maxDistance");
+				if (attr)
+					maxDistance = (float) atof(attr->value());
+			}
+
+			std::vector<std::vector<Vec3f> > templates;
+			rapidxml::xml_node<>* templateNode;
+			for(templateNode = recNode->first_node("Template"); templateNode; templateNode = templateNode->next_sibling("Template"))
+			{
+				templates.push_back(std::vector<Vec3f>());
+				rapidxml::xml_node<>* pointNode;
+				for(pointNode = templateNode->first_node("Point"); pointNode; pointNode = pointNode->next_sibling("Point"))
+				{
+					Vec3f point;
+					attr = pointNode->first_attribute("x");
+					if (attr)
+						point.x = (float) atof(attr->value());
+					attr = pointNode->first_attribute("y");
+					if (attr)
+						point.y = (float) atof(attr->value());
+					attr = pointNode->first_attribute("z");
+					if (attr)
+						point.z = (float) atof(attr->value());
+					templates.back().push_back(point);
+				}
+				if (templates.back().size() < 2)
+				{
+					Fubi_logWrn("XML_Warning - Template with less than two points in \"%s\" ignored!\n", name.c_str());
+					templates.pop_back();
+				}
+			}
+			if (templates.empty())
+				Fubi_logWrn("XML_Warning - No templates in \"%s\", it will never be recognized!\n", name.c_str());
+
+			IGestureRecognizer* rec = createRecognizer(joint, relJoint, templates, duration, numSamples, warpingWindow, maxDistance, localPos, minConf, measure);
+			// The trajectory has to be sampled with every frame, also while the recognizer is not used in a combination
+			rec->requestHistoryWindows(m_jointHistoryWindows);
+			rec->requestLocalTransformations(m_localTransformationJoints);
+			if (visible)
+				m_userDefinedRecognizers.push_back(pair<string, IGestureRecognizer*>(name, rec));
+			else
+				m_hiddenUserDefinedRecognizers.push_back(pair<string, IGestureRecognizer*>(name, rec));
+			loadedAnything = true;
+		}
+
 		for(recNode = node->first_node("FingerCountRecognizer"); recNode; recNode = recNode->next_sibling("FingerCountRecognizer"))
 		{
 			std::string name;
@@ -1212,6 +1694,25 @@ bool FubiCore::loadRecognizersFromXML(const std::string& fileName)
 	return loadedAnything;
 }
 
+void FubiCore::compileRecognizers(const std::vector<IGestureRecognizer*>& recognizers)
+{
+	for (unsigned int i = 0; i < recognizers.size(); ++i)
+	{
+		recognizers[i]->compileInto(m_jointRelationTable);
+		recognizers[i]->requestHistoryWindows(m_jointHistoryWindows);
+		recognizers[i]->requestLocalTransformations(m_localTransformationJoints);
+
+		std::string key;
+		if (recognizers[i]->getDefinitionKey(key))
+		{
+			std::map<std::string, unsigned int>::iterator slot = m_recognizerCacheSlots.find(key);
+			if (slot == m_recognizerCacheSlots.end())
+				slot = m_recognizerCacheSlots.insert(std::pair<std::string, unsigned int>(key, (unsigned int) m_recognizerCacheSlots.size())).first;
+			recognizers[i]->m_cacheSlot = (int) slot->second;
+		}
+	}
+}
+
 bool FubiCore::loadCombinationRecognizerFromXML(rapidxml::xml_node<>* node, float globalMinConfidence)
 {
 	bool succes = false;
@@ -1232,6 +1733,15 @@ bool FubiCore::loadCombinationRecognizerFromXML(rapidxml::xml_node<>* node, floa
 			rec->setWaitUntilLastStateRecognizersStop(lowerValue != "0" && lowerValue != "false");
 		}
 
+		attr = node->first_attribute("maxConcurrentAttempts");
+		if (attr)
+		{
+			int maxAttempts = atoi(attr->value());
+			if (maxAttempts < 1)
+				Fubi_logWrn("XML_Warning - Invalid maxConcurrentAttempts \"%s\" in \"%s\", using 1 instead!\n", attr->value(), name.c_str());
+			rec->setMaxConcurrentAttempts((maxAttempts > 0) ? (unsigned int) maxAttempts : 1);
+		}
+
 		rapidxml::xml_node<>* stateNode;
 		int stateNum;
 		for(stateNode = node->first_node("State"), stateNum = 1; stateNode; stateNode = stateNode->next_sibling("State"), stateNum++)
@@ -1598,6 +2108,10 @@ bool FubiCore::loadCombinationRecognizerFromXML(rapidxml::xml_node<>* node, floa
 
 			if (recognizerRefs.size() > 0 || notRecognizerRefs.size() > 0)
 			{
+				compileRecognizers(recognizerRefs);
+				compileRecognizers(notRecognizerRefs);
+				compileRecognizers(alternativeRecognizerRefs);
+				compileRecognizers(alternativeNotRecognizerRefs);
 				// Add state to the recognizer
 				rec->addState(recognizerRefs, notRecognizerRefs, minDuration, maxDuration, timeForTransition, maxInterruption, noInterrruptionBeforeMinDuration, alternativeRecognizerRefs, alternativeNotRecognizerRefs);
 			}
@@ -1612,6 +2126,7 @@ bool FubiCore::loadCombinationRecognizerFromXML(rapidxml::xml_node<>* node, floa
 		{
 			succes = true;
 			// Add the recognizer to the templates
+			rec->setUserDefinedIndex((int) m_userDefinedCombinationRecognizers.size());
 			m_userDefinedCombinationRecognizers.push_back(std::pair<string, CombinationRecognizer*>(name, rec));
 
 			if (getAutoStartCombinationRecognition(Fubi::Combinations::NUM_COMBINATIONS))
@@ -1742,6 +2257,12 @@ std::deque<FubiUser*> FubiCore::getClosestUsers(int maxNumUsers /*= -1*/)
 
 void FubiCore::clearUserDefinedRecognizers()
 {
+	std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
+
+	// Counts of the old recognizers are meaningless now
+	m_combinationRecognitionCounts.clear();
+	m_recognizerSetID++;
+
 	for (unsigned int i = 0; i < Fubi::MaxUsers; i++)
 	{
 		m_users[i]->clearUserDefinedCombinationRecognizers();
@@ -1770,6 +2291,11 @@ void FubiCore::clearUserDefinedRecognizers()
 		delete iter2->second;
 	}
 	m_hiddenUserDefinedRecognizers.clear();
+
+	m_jointRelationTable.clear();
+	m_jointHistoryWindows.clear();
+	m_localTransformationJoints = LocalTransformationJoints();
+	m_recognizerCacheSlots.clear();
 //
 	m_jointsRecognizers.clear();
 	m_jointsCombinations.clear();
@@ -1881,6 +2407,7 @@ Vec3f FubiCore::realWorldToProjective(const Vec3f& realWorldVec, int xRes /*= 64
 
 void FubiCore::resetTracking()
 {
+	std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
 	if (m_sensor)
 	{
 		for (unsigned short i = 0; i < m_numUsers; ++i)
@@ -1895,11 +2422,16 @@ bool FubiCore::getImage(unsigned char* outputImage, ImageType::Type type, ImageN
 		DepthImageModification::Modification depthModifications /*= DepthImageModification::UseHistogram*/,
         unsigned int userId /*= 0*/, Fubi::SkeletonJoint::Joint jointOfInterest /*= Fubi::SkeletonJoint::NUM_JOINTS*/)
 {
-    return FubiImageProcessing::getImage(m_sensor, outputImage, type, numChannels, depth, renderOptions, depthModifications, userId, jointOfInterest, m_current_gesture);
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
+		FubiImageProcessing::copyRenderData(m_sensor, s_renderData, type, renderOptions, m_current_gesture);
+	}
+	return FubiImageProcessing::getImage(s_renderData, outputImage, type, numChannels, depth, renderOptions, depthModifications, userId, jointOfInterest);
 }
 
 void FubiCore::setCurrentGesture(std::string gesture, unsigned int userId /*= 0*/)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
     this->m_current_gesture[userId] = gesture;
 }
 
@@ -1908,7 +2440,11 @@ bool FubiCore::saveImage(const char* fileName, int jpegQuality, ImageType::Type
 	DepthImageModification::Modification depthModifications /*= DepthImageModification::UseHistogram*/,
 	unsigned int userId /*= 0*/, Fubi::SkeletonJoint::Joint jointOfInterest /*= Fubi::SkeletonJoint::NUM_JOINTS*/)
 {
-	return FubiImageProcessing::saveImage(m_sensor, fileName, jpegQuality, type, numChannels, depth, renderOptions, depthModifications, userId, jointOfInterest);
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_trackingMutex);
+		FubiImageProcessing::copyRenderData(m_sensor, s_renderData, type, renderOptions, m_current_gesture);
+	}
+	return FubiImageProcessing::saveImage(s_renderData, fileName, jpegQuality, type, numChannels, depth, renderOptions, depthModifications, userId, jointOfInterest);
 }
 
 void FubiCore::getColorForUserID(unsigned int id, float& r, float& g, float& b)
@@ -16,10 +16,17 @@
 #include "FubiUtils.h"
 #include "FubiUser.h"
 #include "FubiISensor.h"
+#include "FubiTrackingSnapshot.h"
+#include "FubiTripleBuffer.h"
+#include "FubiThreadPool.h"
+#include "FubiRecording.h"
+#include "FubiSPSCQueue.h"
 
 // Recognizer interfaces
 #include "GestureRecognizer/IGestureRecognizer.h"
 #include "GestureRecognizer/CombinationRecognizer.h"
+#include "GestureRecognizer/JointRelationTable.h"
+#include "FubiJointHistory.h"
 
 // STL containers
 #include <map>
@@ -27,6 +34,11 @@
 #include <string>
 #include <set>
 
+// Tracking thread
+#include <thread>
+#include <mutex>
+#include <atomic>
+
 // XML parsing
 #include "rapidxml.hpp"
 
@@ -111,6 +123,38 @@ public:
 
 	void updateSensor();
 
+	// Start/stop a thread that continuously updates the sensor and the recognizers and publishes snapshots of the users
+	bool startTrackingThread();
+	void stopTrackingThread();
+	bool isTrackingThreadRunning() { return m_trackingThread != 0x0; }
+
+	// Get the latest snapshot published by the tracking thread for one consumer thread
+	// The snapshot stays valid until the next call with the same consumer id
+	const Fubi::TrackingSnapshot* getTrackingSnapshot(unsigned int consumerID = 0, bool* isNewSnapshot = 0x0);
+
+	// Update the users in parallel on the given number of additional threads (0 = update them one after the other)
+	void setNumUserUpdateThreads(unsigned int numThreads);
+	unsigned int getNumUserUpdateThreads() { return m_userUpdatePool ? m_userUpdatePool->getNumThreads() : 0; }
+
+	// Take the next user defined combination recognized by the tracking thread, returns false if there is none
+	// Only one thread may take the events
+	bool pollRecognitionEvent(Fubi::RecognitionEvent& event);
+	// Call the given function on the tracking thread for each recognition, 0x0 to remove it
+	void setRecognitionEventCallback(Fubi::RecognitionEventCallback callback, void* userData);
+	// Whether the events contain the tracking data of the user at each state transition
+	void setRecognitionEventUserStates(bool enable);
+	// Whether the snapshots contain the local transformations of all joints, otherwise only the ones used by the recognizers are valid
+	void setSnapshotLocalTransformations(bool enable);
+
+	// Exclusive access to the users, recognizers and the sensor while the tracking thread is running
+	void lockTracking() { m_trackingMutex.lock(); }
+	void unlockTracking() { m_trackingMutex.unlock(); }
+
+	// Record the sensor tracking data of all following frames for the replay sensor, optionally with depth and user label images
+	bool startRecording(const char* fileName, bool withImages = false);
+	void stopRecording();
+	bool isRecording() { return m_recorder != 0x0; }
+
 	// Get the floor plane
 	Fubi::Plane getFloor();
 
@@ -145,14 +189,16 @@ public:
 		const char* name = 0,
 		float minConfidence =-1,
 		float maxAngleDiff = 45.0f, 
-		bool useOnlyCorrectDirectionComponent = true);
+		bool useOnlyCorrectDirectionComponent = true,
+		float velocityWindow = 0);
 	unsigned int addLinearMovementRecognizer(Fubi::SkeletonJoint::Joint joint,	const Fubi::Vec3f& direction, float minVel, float maxVel = Fubi::Math::MaxFloat, 
 		bool useLocalPositions = false,
 		int atIndex = -1,
 		const char* name = 0,
 		float minConfidence =-1,
 		float maxAngleDiff = 45.0f, 
-		bool useOnlyCorrectDirectionComponent = true);
+		bool useOnlyCorrectDirectionComponent = true,
+		float velocityWindow = 0);
 	unsigned int addFingerCountRecognizer(Fubi::SkeletonJoint::Joint handJoint,
 		unsigned int minFingers, unsigned int maxFingers,
 		int atIndex = -1,
@@ -174,11 +220,13 @@ public:
 	Fubi::RecognitionResult::Result recognizeGestureOn(unsigned int recognizerIndex, unsigned int userID);
 	Fubi::RecognitionResult::Result recognizeGestureOn(const std::string& recognizerName, unsigned int userID);
 	Fubi::RecognitionResult::Result getCombinationRecognitionProgressOn(Fubi::Combinations::Combination combinationID, unsigned int userID, std::vector<FubiUser::TrackingData>* userStates, bool restart);
+	Fubi::RecognitionResult::Result getCombinationRecognitionProgressOnByIndex(unsigned int combinationIndex, unsigned int userID, std::vector<FubiUser::TrackingData>* userStates, bool restart);
 	Fubi::RecognitionResult::Result getCombinationRecognitionProgressOn(const std::string& recognizerName, unsigned int userID, std::vector<FubiUser::TrackingData>* userStates, bool restart);
 
 	// Enable a posture combination recognition manually
 	void enableCombinationRecognition(Fubi::Combinations::Combination combinationID, unsigned int userID, bool enable);
-	// Enable a user defined posture combination recognition manually
+	// Enable a user defined posture combination recognition manually, by its index or name
+	void enableCombinationRecognitionByIndex(unsigned int combinationIndex, unsigned int userID, bool enable);
 	void enableCombinationRecognition(const std::string& combinationName, unsigned int userID, bool enable);
 	// Or auto activate all for each new user
 	void setAutoStartCombinationRecognition(bool enable, Fubi::Combinations::Combination combinationID = Fubi::Combinations::NUM_COMBINATIONS);
@@ -304,6 +352,13 @@ public:
 
 	FubiISensor* getSensor() { return m_sensor; }
 
+	// All joint relations of the loaded combination recognizers, evaluated by each user once per frame
+	const JointRelationTable& getJointRelationTable() { return m_jointRelationTable; }
+	// Windows of the joint history requested by the loaded combination recognizers, updated by each user once per frame
+	const JointHistoryWindows& getJointHistoryWindows() { return m_jointHistoryWindows; }
+	// Joints of which the loaded combination recognizers use the local transformations, calculated by each user once per frame
+	const Fubi::LocalTransformationJoints& getLocalTransformationJoints() { return m_localTransformationJoints; }
+
 	// initialize sensro with an options file
 	bool initSensorWithOptions(const Fubi::SensorOptions& options);
 //
@@ -324,8 +379,23 @@ private:
 	// Update FubiUser -> OpenNI ID mapping 
 	void updateUsers();
 
+	// Task for the user update pool: process the tracking data of the user at the given index
+	static void processUserTask(void* core, unsigned int userIndex);
+
+	// Main loop of the tracking thread
+	void trackingThreadLoop();
+	// Count the user defined combinations the users have completed in this frame and send the recognition events
+	void sendRecognitionEvents();
+	// Fill the snapshot buffers with the current state and publish them
+	void publishTrackingSnapshot();
+	// Write the current sensor frame to the recording
+	void recordFrame();
+
 	// Load a combination recognizer from the given xml node
 	bool loadCombinationRecognizerFromXML(rapidxml::xml_node<>* node, float globalMinConfidence);
+	// Add the recognizers referenced by a combination to the tables for batch evaluation
+	// and assign the same result cache slot to recognizers with the same definition
+	void compileRecognizers(const std::vector<IGestureRecognizer*>& recognizers);
 
 	// The singleton instance of the tracker
 	static FubiCore* s_instance;
@@ -364,4 +434,47 @@ private:
 
 	FubiISensor* m_sensor;
     FubiUserGesture m_current_gesture;
+
+	// Time stamp of the current sensor frame shared by all users and recognizers
+	double m_frameTimeStamp;
+	// Whether the sensor has delivered new tracking data in the current frame
+	bool m_frameHasNewData;
+
+	// Optional workers for updating the users in parallel
+	FubiThreadPool* m_userUpdatePool;
+	// Users that received new tracking data in the current frame
+	bool m_usersToProcess[Fubi::MaxUsers];
+
+	// Tracking thread and the lock for everything it touches
+	std::thread* m_trackingThread;
+	std::atomic<bool> m_trackingThreadRunning;
+	std::recursive_mutex m_trackingMutex;
+	// One snapshot buffer per consumer thread
+	FubiTripleBuffer<Fubi::TrackingSnapshot> m_snapshotBuffers[Fubi::MaxSnapshotConsumers];
+	unsigned int m_snapshotFrameID;
+	// Combination recognition counts per user id and the id of the current recognizer set
+	std::map<unsigned int, std::vector<unsigned int> > m_combinationRecognitionCounts;
+	unsigned int m_recognizerSetID;
+
+	// Recognitions for the consumer of the tracking thread, the event is reused for each recognition
+	FubiSPSCQueue<Fubi::RecognitionEvent, Fubi::MaxRecognitionEvents> m_recognitionEvents;
+	Fubi::RecognitionEvent m_recognitionEvent;
+	Fubi::RecognitionEventCallback m_recognitionEventCallback;
+	void* m_recognitionEventUserData;
+	bool m_recognitionEventUserStates;
+	bool m_snapshotLocalTransformations;
+
+	// Current recording, 0x0 if not recording
+	FubiRecordingWriter* m_recorder;
+	// Reused for each recorded frame
+	Fubi::RecordedFrame m_recordedFrame;
+
+	// Joint relations referenced by the user defined combination recognizers
+	JointRelationTable m_jointRelationTable;
+	// Joint history windows referenced by the user defined combination recognizers
+	JointHistoryWindows m_jointHistoryWindows;
+	// Local transformations used by the user defined combination recognizers
+	Fubi::LocalTransformationJoints m_localTransformationJoints;
+	// Result cache slot per recognizer definition key
+	std::map<std::string, unsigned int> m_recognizerCacheSlots;
 };
@@ -11,6 +11,7 @@
 #pragma once
 
 #include "FubiUtils.h"
+#include "FubiSPSCQueue.h"
 
 // The Fubi Sensor interface offers depth/rgb/ir image streams and user tracking data
 class FubiISensor
@@ -85,6 +86,13 @@ public:
 	// Return real world to projective according to openni sensor
 	virtual Fubi::Vec3f realWorldToProjective(const Fubi::Vec3f& realWorldVec) = 0;
 
+	// Get the time stamp of the current tracking frame in seconds on the clock of Fubi::currentTime()
+	// Returns -1 if the sensor does not provide time stamps, the time of the update is used instead
+	virtual double getTrackingTimeStamp()
+	{
+		return -1;
+	}
+
 	// TODO: setOptions?
 
 	// Get Options
@@ -96,6 +104,39 @@ public:
 	Fubi::SensorType::Type getType() { return m_options.m_type; }
 
 protected:
+	// A user event reported by a driver callback that has to be applied in update()
+	struct UserEvent
+	{
+		enum Type
+		{
+			NEW_USER,
+			EXIT_USER,
+			REENTER_USER
+		};
+		Type m_type;
+		unsigned int m_id;
+	};
+
+	// Queue a user event, may be called from one driver thread without blocking it
+	void pushUserEvent(UserEvent::Type type, unsigned int id)
+	{
+		UserEvent event;
+		event.m_type = type;
+		event.m_id = id;
+		if (!m_userEvents.push(event))
+			Fubi_logWrn("User event queue full, dropped event %d for user %d!\n", type, id);
+	}
+
+	// Get the next queued user event in update(), returns false if there is none
+	bool popUserEvent(UserEvent& event)
+	{
+		return m_userEvents.pop(event);
+	}
+
 	Fubi::SensorOptions m_options;
 
+private:
+	// User events from the driver callbacks
+	FubiSPSCQueue<UserEvent, 256> m_userEvents;
+
 };
\ No newline at end of file
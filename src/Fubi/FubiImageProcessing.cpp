@@ -47,6 +47,7 @@ using namespace cv;
 
 #include "Fubi.h"
 #include "FubiUser.h"
+#include "FubiProfiler.h"
 
 #include <queue>
 #include <sstream>
@@ -74,15 +75,126 @@ const float FubiImageProcessing::m_colors[MaxUsers+1][3] =
 	{.5f,1.f,1.f}
 };
 
-float FubiImageProcessing::m_depthHist[Fubi::MaxDepth];
-unsigned short FubiImageProcessing::m_lastMaxDepth = Fubi::MaxDepth;
-double lastTick, currTick, fps;
-int tickIndex = 0;
-
 FubiImageProcessing::FubiImageProcessing()
 {
 }
 
+FubiImageProcessing::RenderData::RenderData()
+	: m_numUsers(0), m_depthHist(Fubi::MaxDepth, 0), m_lastMaxDepth(Fubi::MaxDepth),
+	  m_lastTick(0), m_fps(0), m_tickIndex(0)
+{
+}
+
+FubiImageProcessing::RenderData::~RenderData()
+{
+	for (unsigned int i = 0; i < Fubi::MaxUsers; ++i)
+	{
+		releaseImage(m_users[i].m_leftFingerCountImage.image);
+		releaseImage(m_users[i].m_rightFingerCountImage.image);
+	}
+}
+
+// Copy one stream of the sensor, leaves the target empty if the sensor does not provide it
+template<class T>
+static void copyStream(const T* source, const Fubi::StreamOptions& options, int numChannels, std::vector<T>& target)
+{
+	if (source && options.isValid())
+		target.assign(source, source + options.m_width*options.m_height*numChannels);
+	else
+		target.clear();
+}
+
+void FubiImageProcessing::copyRenderData(FubiISensor* sensor, RenderData& data, Fubi::ImageType::Type type, unsigned int renderOptions, const FubiUserGesture& currentGestures)
+{
+	data.m_gestures = currentGestures;
+
+	// Only the streams that are drawn, the vectors keep their memory for the next image
+	data.m_rgbData.clear();
+	data.m_irData.clear();
+	data.m_depthData.clear();
+	data.m_userLabelData.clear();
+	if (sensor)
+	{
+		data.m_depthOptions = sensor->getDepthOptions();
+		data.m_rgbOptions = sensor->getRgbOptions();
+		data.m_irOptions = sensor->getIROptions();
+		if (type == ImageType::Color)
+			copyStream(sensor->getRgbData(), data.m_rgbOptions, 3, data.m_rgbData);
+		else if (type == ImageType::IR)
+			copyStream(sensor->getIrData(), data.m_irOptions, 1, data.m_irData);
+		else
+			copyStream(sensor->getDepthData(), data.m_depthOptions, 1, data.m_depthData);
+		if (type == ImageType::Depth || (renderOptions & RenderOptions::Shapes))
+			copyStream(sensor->getUserLabelData(), data.m_depthOptions, 1, data.m_userLabelData);
+	}
+	else
+	{
+		data.m_depthOptions.invalidate();
+		data.m_rgbOptions.invalidate();
+		data.m_irOptions.invalidate();
+	}
+
+	FubiUser** users;
+	data.m_numUsers = Fubi::getCurrentUsers(&users);
+	for (unsigned short i = 0; i < data.m_numUsers; ++i)
+	{
+		FubiUser* user = users[i];
+		RenderData::User& userData = data.m_users[i];
+		userData.m_id = user->m_id;
+		userData.m_isTracked = user->m_isTracked;
+		if (renderOptions & (RenderOptions::LocalOrientCaptions | RenderOptions::LocalPosCaptions))
+		{
+			// Not necessarily used by any recognizer
+			user->updateLocalTransformations(LocalTransformationJoints::all());
+		}
+		userData.m_trackingData = user->getCurrentTrackingData();
+		std::copy(user->m_bodyMeasurements, user->m_bodyMeasurements + BodyMeasurement::NUM_MEASUREMENTS, userData.m_bodyMeasurements);
+
+		if (renderOptions & RenderOptions::FingerShapes)
+		{
+			copyFingerCountImage(user->getFingerCountImageData(true), userData.m_leftFingerCountImage);
+			copyFingerCountImage(user->getFingerCountImageData(false), userData.m_rightFingerCountImage);
+		}
+
+		userData.m_facePoints.clear();
+		userData.m_faceTriangles.clear();
+		if (sensor && (renderOptions & RenderOptions::DetailedFaceShapes))
+		{
+			int num = sensor->getFacePoints(user->m_id, 0x0, true);
+			if (num > 0)
+			{
+				userData.m_facePoints.resize(num);
+				userData.m_faceTriangles.resize(num);
+				sensor->getFacePoints(user->m_id, &userData.m_facePoints[0], false, &userData.m_faceTriangles[0]);
+			}
+		}
+	}
+}
+
+void FubiImageProcessing::copyFingerCountImage(const FingerCountImageData* source, FingerCountImageData& target)
+{
+	void* image = target.image;
+	target = *source;
+	target.image = 0x0;
+#ifdef USE_OPENCV
+	IplImage* sourceImage = (IplImage*) source->image;
+	IplImage* targetImage = (IplImage*) image;
+	if (sourceImage)
+	{
+		if (targetImage && targetImage->width == sourceImage->width && targetImage->height == sourceImage->height
+			&& targetImage->depth == sourceImage->depth && targetImage->nChannels == sourceImage->nChannels)
+		{
+			// Reuse the own image
+			cvCopy(sourceImage, targetImage);
+			target.image = targetImage;
+			return;
+		}
+		target.image = cvCloneImage(sourceImage);
+	}
+#endif
+	releaseImage(image);
+}
+
 void FubiImageProcessing::getColorForUserID(unsigned int id, float& r, float& g, float& b)
 {
 	unsigned int nColorID = id % MaxUsers;
@@ -92,12 +204,13 @@ void FubiImageProcessing::getColorForUserID(unsigned int id, float& r, float& g,
 }
 
 
-bool FubiImageProcessing::getImage(FubiISensor* sensor, unsigned char* outputImage, ImageType::Type type, ImageNumChannels::Channel numChannels, ImageDepth::Depth depth, 
+bool FubiImageProcessing::getImage(RenderData& data, unsigned char* outputImage, ImageType::Type type, ImageNumChannels::Channel numChannels, ImageDepth::Depth depth, 
 	unsigned int renderOptions /*= (RenderOptions::Shapes | RenderOptions::Skeletons | RenderOptions::UserCaptions)*/,
 	DepthImageModification::Modification depthModifications /*= DepthImageModification::UseHistogram*/,
-    unsigned int userId /*= 0*/, Fubi::SkeletonJoint::Joint jointOfInterest /*= Fubi::SkeletonJoint::NUM_JOINTS*/,
-    FubiUserGesture current_gestures/*=FubiUserGesture()*/)
-{	
+    unsigned int userId /*= 0*/, Fubi::SkeletonJoint::Joint jointOfInterest /*= Fubi::SkeletonJoint::NUM_JOINTS*/)
+{
+	FubiProfileScope profile(ProfilingStage::GET_IMAGE);
+	
 	bool succes = false;
 	int applyThreshold = 0;
 
@@ -107,8 +220,9 @@ bool FubiImageProcessing::getImage(FubiISensor* sensor, unsigned char* outputIma
 	if (type == ImageType::Color)
 	{
 		bool swapRAndB = (renderOptions & RenderOptions::SwapRAndB) != 0;
-		succes = drawColorImage(sensor, outputImage, numChannels, depth, swapRAndB);
-		Fubi::getRgbResolution(width, height);
+		succes = drawColorImage(data, outputImage, numChannels, depth, swapRAndB);
+		width = data.m_rgbOptions.m_width;
+		height = data.m_rgbOptions.m_height;
 		
 		// Color image has by default the channel order RGB
 		// As the tracking info's default is BGR we have to switch the swapRAndB option for the rest of the rendering
@@ -119,8 +233,9 @@ bool FubiImageProcessing::getImage(FubiISensor* sensor, unsigned char* outputIma
 	}
 	else if (type == ImageType::Depth)
 	{
-		succes = drawDepthImage(sensor, outputImage, numChannels, depth, depthModifications, renderOptions);
-		Fubi::getDepthResolution(width, height);
+		succes = drawDepthImage(data, outputImage, numChannels, depth, depthModifications, renderOptions);
+		width = data.m_depthOptions.m_width;
+		height = data.m_depthOptions.m_height;
 		if ((userId != 0) && depthModifications != DepthImageModification::UseHistogram && depthModifications != DepthImageModification::ConvertToRGB)
 		{
 			if (jointOfInterest == SkeletonJoint::NUM_JOINTS || jointOfInterest == SkeletonJoint::TORSO)
@@ -133,13 +248,15 @@ bool FubiImageProcessing::getImage(FubiISensor* sensor, unsigned char* outputIma
 	}
 	else if (type == ImageType::IR)
 	{
-		succes = drawIRImage(sensor, outputImage, numChannels, depth);
-		Fubi::getIRResolution(width, height);
+		succes = drawIRImage(data, outputImage, numChannels, depth);
+		width = data.m_irOptions.m_width;
+		height = data.m_irOptions.m_height;
 	}
 	else if (type == ImageType::Blank)
 	{
 		succes = true;
-		Fubi::getDepthResolution(width, height);
+		width = data.m_depthOptions.m_width;
+		height = data.m_depthOptions.m_height;
 		if (width <= 0 || height <= 0)
 		{
 			// "Fake" standard resolution
@@ -154,27 +271,27 @@ bool FubiImageProcessing::getImage(FubiISensor* sensor, unsigned char* outputIma
 	if(succes)
 	{
 #ifdef USE_OPENCV
-		if(tickIndex == 0)
+		if(data.m_tickIndex == 0)
 		{
-			currTick = Fubi::getCurrentTime();
-			fps = 30.0/(currTick-lastTick);
-			lastTick = currTick;
+			double currTick = Fubi::getCurrentTime();
+			data.m_fps = 30.0/(currTick-data.m_lastTick);
+			data.m_lastTick = currTick;
 		}
 
 		std::string s = "fps:";
 		std::ostringstream os;
-		os << setprecision(3) << fps;
+		os << setprecision(3) << data.m_fps;
 
 
         if(userId == 0){
-            for(FubiUserGesture::iterator current_gesture = current_gestures.begin(); current_gesture != current_gestures.end(); current_gesture++){
+            for(FubiUserGesture::const_iterator current_gesture = data.m_gestures.begin(); current_gesture != data.m_gestures.end(); current_gesture++){
                 if(current_gesture->second !="")
                     os << " user id " << current_gesture->first << " gesture '" << current_gesture->second << "'";
             }
         }
         else{
-            FubiUserGesture::iterator current_gesture = current_gestures.find(userId);
-            if(current_gesture !=current_gestures.end()){
+            FubiUserGesture::const_iterator current_gesture = data.m_gestures.find(userId);
+            if(current_gesture !=data.m_gestures.end()){
                 if(current_gesture->second !="")
                     os << " user id " << current_gesture->first << " gesture '" << current_gesture->second << "'";
             }
@@ -190,7 +307,7 @@ bool FubiImageProcessing::getImage(FubiISensor* sensor, unsigned char* outputIma
 		cvPutText(image, s.c_str(), cvPoint(8, 12), &font, cvScalar(255, 255, 255, 255));
 		cvReleaseImageHeader(&image);
 
-		tickIndex = (tickIndex+1) % 30;
+		data.m_tickIndex = (data.m_tickIndex+1) % 30;
 #endif
 	}
 //	
@@ -201,7 +318,7 @@ bool FubiImageProcessing::getImage(FubiISensor* sensor, unsigned char* outputIma
 #ifdef USE_OPENCV
 		IplImage* image = cvCreateImageHeader(cvSize(width, height), (depth == ImageDepth::D8) ? IPL_DEPTH_8U : IPL_DEPTH_16U, numChannels);
 		image->imageData = (char*) outputImage;
-		succes = setROIToUserJoint(image, userId, jointOfInterest, applyThreshold);
+		succes = setROIToUserJoint(data, image, userId, jointOfInterest, applyThreshold);
 		if (succes)
 		{
 			// Get the set roi
@@ -226,138 +343,133 @@ bool FubiImageProcessing::getImage(FubiISensor* sensor, unsigned char* outputIma
 	// Add tracking info
 	if (succes && (renderOptions != RenderOptions::None))
 	{
-		drawTrackingInfo(sensor, outputImage, width, height, numChannels, depth, renderOptions);
+		drawTrackingInfo(data, outputImage, width, height, numChannels, depth, renderOptions);
 	}
 
 	return succes;
 }
 
-void FubiImageProcessing::drawFingerCountImage(unsigned int userID, bool leftHand, unsigned char* outputImage, int width, int height, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth)
+void FubiImageProcessing::drawFingerCountImage(const RenderData& data, const RenderData::User& user, bool leftHand, unsigned char* outputImage, int width, int height, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth)
 {
 #ifdef USE_OPENCV
-	FubiUser* user = Fubi::getUser(userID);
-	if (user)
+	// Check scaling
+	Fubi::Vec3f ImageToDepthScale(1.0f, 1.0f, 1.0f);
+	int depthWidth = data.m_depthOptions.m_width, depthHeight = data.m_depthOptions.m_height;
+	if (depthWidth > 0 && depthHeight > 0)
 	{
-		// Check scaling
-		Fubi::Vec3f ImageToDepthScale(1.0f, 1.0f, 1.0f);
-		int depthWidth = 0, depthHeight = 0;
-		getDepthResolution(depthWidth, depthHeight);
-		if (depthWidth > 0 && depthHeight > 0)
-		{
-			ImageToDepthScale.x = (float)width/(float)depthWidth;
-			ImageToDepthScale.y = (float)height/(float)depthHeight;
-		}	
+		ImageToDepthScale.x = (float)width/(float)depthWidth;
+		ImageToDepthScale.y = (float)height/(float)depthHeight;
+	}	
 
-		// Copy the finger count images to the wanted place
-		const FingerCountImageData* fCountD = user->getFingerCountImageData(leftHand);
-		if (Fubi::getCurrentTime() - fCountD->timeStamp < 0.33f && fCountD->image)
-		{
-			const FingerCountImageData* fCIData = fCountD;
-			IplImage* fCImage = (IplImage*)fCIData->image;
-			
-			CvSize scaledSize = cvSize(int(ImageToDepthScale.x*fCImage->width + 0.5f), int(ImageToDepthScale.y*fCImage->height + 0.5f));
-			CvPoint scaledPoint = cvPoint(int(ImageToDepthScale.x*fCIData->posX + 0.5f), int(ImageToDepthScale.y*fCIData->posY + 0.5f));
+	// Copy the finger count images to the wanted place
+	const FingerCountImageData* fCountD = leftHand ? &user.m_leftFingerCountImage : &user.m_rightFingerCountImage;
+	if (Fubi::getCurrentTime() - fCountD->timeStamp < 0.33f && fCountD->image)
+	{
+		const FingerCountImageData* fCIData = fCountD;
+		IplImage* fCImage = (IplImage*)fCIData->image;
+		
+		CvSize scaledSize = cvSize(int(ImageToDepthScale.x*fCImage->width + 0.5f), int(ImageToDepthScale.y*fCImage->height + 0.5f));
+		CvPoint scaledPoint = cvPoint(int(ImageToDepthScale.x*fCIData->posX + 0.5f), int(ImageToDepthScale.y*fCIData->posY + 0.5f));
 
-			double maxValue = 255.0;
+		double maxValue = 255.0;
 
-			// Convert the finger count image to an image with correct depth and size
-			IplImage* fImage = cvCreateImage(scaledSize, depth, 4);
-			if (depth == ImageDepth::D16)
-			{
-				IplImage* d16Image = cvCreateImage(cvSize(fCImage->width, fCImage->height), IPL_DEPTH_16U, 4);
-				cvConvertScale(fCImage, d16Image, (double)Math::MaxUShort16 / 255.0);
-				maxValue = (double)Math::MaxUShort16;
-				cvResize(d16Image, fImage);
-				cvReleaseImage(&d16Image);
-			}
-			else
-				cvResize(fCImage, fImage);
+		// Convert the finger count image to an image with correct depth and size
+		IplImage* fImage = cvCreateImage(scaledSize, depth, 4);
+		if (depth == ImageDepth::D16)
+		{
+			IplImage* d16Image = cvCreateImage(cvSize(fCImage->width, fCImage->height), IPL_DEPTH_16U, 4);
+			cvConvertScale(fCImage, d16Image, (double)Math::MaxUShort16 / 255.0);
+			maxValue = (double)Math::MaxUShort16;
+			cvResize(d16Image, fImage);
+			cvReleaseImage(&d16Image);
+		}
+		else
+			cvResize(fCImage, fImage);
 
-			// Now copy the finger count image into the correct place with respect to the channels
-			if (depth == ImageDepth::D16)
+		// Now copy the finger count image into the correct place with respect to the channels
+		if (depth == ImageDepth::D16)
+		{
+			const unsigned short* pLineStart = (unsigned short*)fImage->imageData;
+			const unsigned short* pfImage = (unsigned short*)fImage->imageData;
+			unsigned short* pDestLineStart = (unsigned short*)outputImage;
+			unsigned short* pDestImage = (unsigned short*)outputImage;
+			// Now add the shapes to the image
+			for (int j = 0; j < scaledSize.height; j++)
 			{
-				const unsigned short* pLineStart = (unsigned short*)fImage->imageData;
-				const unsigned short* pfImage = (unsigned short*)fImage->imageData;
-				unsigned short* pDestLineStart = (unsigned short*)outputImage;
-				unsigned short* pDestImage = (unsigned short*)outputImage;
-				// Now add the shapes to the image
-				for (int j = 0; j < scaledSize.height; j++)
+				pLineStart = ((unsigned short*)fImage->imageData) + j*scaledSize.width*4;
+				pDestLineStart = ((unsigned short*)outputImage) + (j+scaledPoint.y)*width*numChannels;
+				for(int i = 0; i < scaledSize.width; i++)
 				{
-					pLineStart = ((unsigned short*)fImage->imageData) + j*scaledSize.width*4;
-					pDestLineStart = ((unsigned short*)outputImage) + (j+scaledPoint.y)*width*numChannels;
-					for(int i = 0; i < scaledSize.width; i++)
-					{
-						pfImage = pLineStart + i*4;
-						pDestImage = pDestLineStart + (i+scaledPoint.x)*numChannels;
+					pfImage = pLineStart + i*4;
+					pDestImage = pDestLineStart + (i+scaledPoint.x)*numChannels;
 
-						if (pfImage[3] > 0)
+					if (pfImage[3] > 0)
+					{
+						double alpha = pfImage[3] / maxValue;
+						double dAlpha = 1.0 - alpha;
+						if (numChannels == 1)
 						{
-							double alpha = pfImage[3] / maxValue;
-							double dAlpha = 1.0 - alpha;
-							if (numChannels == 1)
-							{
-								unsigned short greyValue = (unsigned short)(0.114*pfImage[0] + 0.587*pfImage[1] + 0.299*pfImage[2]);
-								pDestImage[0] = (unsigned short)(alpha*greyValue + dAlpha*pDestImage[0] + 0.5);
-							}
-							else
+							unsigned short greyValue = (unsigned short)(0.114*pfImage[0] + 0.587*pfImage[1] + 0.299*pfImage[2]);
+							pDestImage[0] = (unsigned short)(alpha*greyValue + dAlpha*pDestImage[0] + 0.5);
+						}
+						else
+						{
+							pDestImage[0] = (unsigned short)(alpha*pfImage[0] + dAlpha*pDestImage[0] + 0.5);
+							pDestImage[1] = (unsigned short)(alpha*pfImage[1] + dAlpha*pDestImage[1] + 0.5);
+							pDestImage[2] = (unsigned short)(alpha*pfImage[2] + dAlpha*pDestImage[2] + 0.5);
+							
+							if (numChannels == 4)
 							{
-								pDestImage[0] = (unsigned short)(alpha*pfImage[0] + dAlpha*pDestImage[0] + 0.5);
-								pDestImage[1] = (unsigned short)(alpha*pfImage[1] + dAlpha*pDestImage[1] + 0.5);
-								pDestImage[2] = (unsigned short)(alpha*pfImage[2] + dAlpha*pDestImage[2] + 0.5);
-								
-								if (numChannels == 4)
-								{
-									pDestImage[3] = std::max(pDestImage[3], pfImage[3]);
-								}
+								pDestImage[3] = std::max(pDestImage[3], pfImage[3]);
 							}
 						}
 					}
 				}
 			}
-			else
+		}
+		else
+		{
+			const unsigned char* pLineStart = (unsigned char*)fImage->imageData;
+			const unsigned char* pfImage = (unsigned char*)fImage->imageData;
+			unsigned char* pDestLineStart = outputImage;
+			unsigned char* pDestImage = outputImage;
+			// Now add the shapes to the image
+			for (int j = 0; j < scaledSize.height; j++)
 			{
-				const unsigned char* pLineStart = (unsigned char*)fImage->imageData;
-				const unsigned char* pfImage = (unsigned char*)fImage->imageData;
-				unsigned char* pDestLineStart = outputImage;
-				unsigned char* pDestImage = outputImage;
-				// Now add the shapes to the image
-				for (int j = 0; j < scaledSize.height; j++)
+				pLineStart = (unsigned char*)fImage->imageData + j*scaledSize.width*4;
+				pDestLineStart = outputImage + (j+scaledPoint.y)*width*numChannels;
+				for(int i = 0; i < scaledSize.width; i++)
 				{
-					pLineStart = (unsigned char*)fImage->imageData + j*scaledSize.width*4;
-					pDestLineStart = outputImage + (j+scaledPoint.y)*width*numChannels;
-					for(int i = 0; i < scaledSize.width; i++)
-					{
-						pfImage = pLineStart + i*4;
-						pDestImage = pDestLineStart + (i+scaledPoint.x)*numChannels;
+					pfImage = pLineStart + i*4;
+					pDestImage = pDestLineStart + (i+scaledPoint.x)*numChannels;
 
-						if (pfImage[3] > 0)
+					if (pfImage[3] > 0)
+					{
+						double alpha = pfImage[3] / maxValue;
+						double dAlpha = 1.0 - alpha;
+						if (numChannels == 1)
 						{
-							double alpha = pfImage[3] / maxValue;
-							double dAlpha = 1.0 - alpha;
-							if (numChannels == 1)
+							unsigned char greyValue = (unsigned char)(0.114*pfImage[0] + 0.587*pfImage[1] + 0.299*pfImage[2]);
+							pDestImage[0] = (unsigned char)(alpha*greyValue + dAlpha*pDestImage[0] + 0.5);
+						}
+						else
+						{
+							pDestImage[0] = (unsigned char)(alpha*pfImage[0] + dAlpha*pDestImage[0] + 0.5);
+							pDestImage[1] = (unsigned char)(alpha*pfImage[1] + dAlpha*pDestImage[1] + 0.5);
+							pDestImage[2] = (unsigned char)(alpha*pfImage[2] + dAlpha*pDestImage[2] + 0.5);
+							
+							if (numChannels == 4)
 							{
-								unsigned char greyValue = (unsigned char)(0.114*pfImage[0] + 0.587*pfImage[1] + 0.299*pfImage[2]);
-								pDestImage[0] = (unsigned char)(alpha*greyValue + dAlpha*pDestImage[0] + 0.5);
-							}
-							else
-							{
-								pDestImage[0] = (unsigned char)(alpha*pfImage[0] + dAlpha*pDestImage[0] + 0.5);
-								pDestImage[1] = (unsigned char)(alpha*pfImage[1] + dAlpha*pDestImage[1] + 0.5);
-								pDestImage[2] = (unsigned char)(alpha*pfImage[2] + dAlpha*pDestImage[2] + 0.5);
-								
-								if (numChannels == 4)
-								{
-									pDestImage[3] = std::max(pDestImage[3], pfImage[3]);
-								}
+								pDestImage[3] = std::max(pDestImage[3], pfImage[3]);
 							}
 						}
 					}
 				}
 			}
-
-			// Release temporary image
-			cvReleaseImage(&fImage);			
 		}
+
+		// Release temporary image
+		cvReleaseImage(&fImage);			
 	}
 #else
 	static double lastWarning = -99;
@@ -369,123 +481,119 @@ void FubiImageProcessing::drawFingerCountImage(unsigned int userID, bool leftHan
 #endif
 }
 
-void FubiImageProcessing::drawTrackingInfo(FubiISensor* sensor, unsigned char* outputImage, int width, int height, ImageNumChannels::Channel numChannels, ImageDepth::Depth depth, unsigned int renderOptions)
+void FubiImageProcessing::drawTrackingInfo(const RenderData& data, unsigned char* outputImage, int width, int height, ImageNumChannels::Channel numChannels, ImageDepth::Depth depth, unsigned int renderOptions)
 {
-	FubiUser** users;
-	unsigned short numUsers = Fubi::getCurrentUsers(&users);
+	const RenderData::User* users = data.m_users;
+	unsigned short numUsers = data.m_numUsers;
 
 	if (numUsers > 0)
 	{
 		// Render the user shapes
 		if (renderOptions & RenderOptions::Shapes)
 		{
-			if (sensor)
+			// Get user labels
+			const unsigned short* pImageStart = data.m_userLabelData.empty() ? 0x0 : &data.m_userLabelData[0];
+			if (pImageStart)
 			{
-				// Get user labels
-				const unsigned short* pImageStart = sensor->getUserLabelData();
-				if (pImageStart)
+				// Check for tracking/calibration per id
+				bool trackedIDs[Fubi::MaxUsers];
+				memset(trackedIDs, 0, sizeof(bool)*(Fubi::MaxUsers));
+				for (unsigned short i = 0; i < numUsers; i++)
 				{
-					// Check for tracking/calibration per id
-					bool trackedIDs[Fubi::MaxUsers];
-					memset(trackedIDs, 0, sizeof(bool)*(Fubi::MaxUsers));
-					for (unsigned short i = 0; i < numUsers; i++)
-					{
-						trackedIDs[users[i]->m_id] = users[i]->m_isTracked;
-					}
+					trackedIDs[users[i].m_id] = users[i].m_isTracked;
+				}
 
-					// Check scaling
-					Fubi::Vec3f ImageToDepthScale(1.0f, 1.0f, 1.0f);
+				// Check scaling
+				Fubi::Vec3f ImageToDepthScale(1.0f, 1.0f, 1.0f);
 
-					int depthWidth = 0, depthHeight = 0;
-					getDepthResolution(depthWidth, depthHeight);
-					if (depthWidth > 0 && depthHeight > 0)
-					{
-						ImageToDepthScale.x = (float)depthWidth / (float)width;
-						ImageToDepthScale.y = (float)depthHeight / (float)height;
-					}
+				int depthWidth = data.m_depthOptions.m_width, depthHeight = data.m_depthOptions.m_height;
+				if (depthWidth > 0 && depthHeight > 0)
+				{
+					ImageToDepthScale.x = (float)depthWidth / (float)width;
+					ImageToDepthScale.y = (float)depthHeight / (float)height;
+				}
 
-					const unsigned short* pLineStart = pImageStart;
-					const unsigned short* pLabels = pImageStart;
-					unsigned int nColorID = 0;
-					if (depth == ImageDepth::D16)
+				const unsigned short* pLineStart = pImageStart;
+				const unsigned short* pLabels = pImageStart;
+				unsigned int nColorID = 0;
+				if (depth == ImageDepth::D16)
+				{
+					unsigned short* pDestImage = (unsigned short*) outputImage;
+					// Now add the shapes to the image
+					for (int j = 0; j < height; j++)
 					{
-						unsigned short* pDestImage = (unsigned short*) outputImage;
-						// Now add the shapes to the image
-						for (int j = 0; j < height; j++)
+						pLineStart = pImageStart + int(j*ImageToDepthScale.y + 0.5f)*depthWidth;
+						for(int i = 0; i < width; i++)
 						{
-							pLineStart = pImageStart + int(j*ImageToDepthScale.y + 0.5f)*depthWidth;
-							for(int i = 0; i < width; i++)
-							{
-								pLabels = pLineStart + int(i*ImageToDepthScale.x + 0.5f);
-								if (*pLabels != 0 )
-								{														
-									// Add user shapes (tracked users highlighted)
-									nColorID = (*pLabels) % (MaxUsers+1);
+							pLabels = pLineStart + int(i*ImageToDepthScale.x + 0.5f);
+							if (*pLabels != 0 )
+							{														
+								// Add user shapes (tracked users highlighted)
+								nColorID = (*pLabels) % (MaxUsers+1);
+
+								if (renderOptions & RenderOptions::SwapRAndB)
+									pDestImage[0] = (unsigned short)(pDestImage[0]*m_colors[nColorID][2]);
+								else
+									pDestImage[0] = (unsigned short)(pDestImage[0]*m_colors[nColorID][0]);
 
+								if ( numChannels > 1)
+								{
+									pDestImage[1] = (unsigned short)(pDestImage[1]*m_colors[nColorID][1]);
 									if (renderOptions & RenderOptions::SwapRAndB)
-										pDestImage[0] = (unsigned short)(pDestImage[0]*m_colors[nColorID][2]);
+										pDestImage[2] = (unsigned short)(pDestImage[2]*m_colors[nColorID][0]);
 									else
-										pDestImage[0] = (unsigned short)(pDestImage[0]*m_colors[nColorID][0]);
-
-									if ( numChannels > 1)
+										pDestImage[2] = (unsigned short)(pDestImage[2]*m_colors[nColorID][2]);
+									if (numChannels == 4)
 									{
-										pDestImage[1] = (unsigned short)(pDestImage[1]*m_colors[nColorID][1]);
-										if (renderOptions & RenderOptions::SwapRAndB)
-											pDestImage[2] = (unsigned short)(pDestImage[2]*m_colors[nColorID][0]);
+										if (trackedIDs[(*pLabels)] || (*pLabels) == 0)
+											pDestImage[3] = Math::MaxUShort16;
 										else
-											pDestImage[2] = (unsigned short)(pDestImage[2]*m_colors[nColorID][2]);
-										if (numChannels == 4)
-										{
-											if (trackedIDs[(*pLabels)] || (*pLabels) == 0)
-												pDestImage[3] = Math::MaxUShort16;
-											else
-												pDestImage[3] = Math::MaxUShort16 / 2;
-										}
+											pDestImage[3] = Math::MaxUShort16 / 2;
 									}
 								}
-								pDestImage+=numChannels;
 							}
+							pDestImage+=numChannels;
 						}
 					}
-					else
+				}
+				else
+				{
+					unsigned char* pDestImage = outputImage;
+					// Now add the shapes to the image
+					for (int j = 0; j < height; j++)
 					{
-						unsigned char* pDestImage = outputImage;
-						// Now add the shapes to the image
-						for (int j = 0; j < height; j++)
+						pLineStart = pImageStart + int(j*ImageToDepthScale.y + 0.5f)*depthWidth;
+						for(int i = 0; i < width; i++)
 						{
-							pLineStart = pImageStart + int(j*ImageToDepthScale.y + 0.5f)*depthWidth;
-							for(int i = 0; i < width; i++)
-							{
-								pLabels = pLineStart + int(i*ImageToDepthScale.x + 0.5f);
-								if (*pLabels != 0 )
-								{							
-									// Add user shapes (tracked users highlighted)
-									nColorID = (*pLabels) % (MaxUsers+1);
+							pLabels = pLineStart + int(i*ImageToDepthScale.x + 0.5f);
+							if (*pLabels != 0 )
+							{							
+								// Add user shapes (tracked users highlighted)
+								nColorID = (*pLabels) % (MaxUsers+1);
+								if (renderOptions & RenderOptions::SwapRAndB)
+									pDestImage[0] = (unsigned char)(pDestImage[0]*m_colors[nColorID][2]);
+								else
+									pDestImage[0] = (unsigned char)(pDestImage[0]*m_colors[nColorID][0]);
+								if ( numChannels > 1)
+								{
+									pDestImage[1] = (unsigned char)(pDestImage[1]*m_colors[nColorID][1]);
 									if (renderOptions & RenderOptions::SwapRAndB)
-										pDestImage[0] = (unsigned char)(pDestImage[0]*m_colors[nColorID][2]);
+										pDestImage[2] = (unsigned char)(pDestImage[2]*m_colors[nColorID][0]);
 									else
-										pDestImage[0] = (unsigned char)(pDestImage[0]*m_colors[nColorID][0]);
-									if ( numChannels > 1)
+										pDestImage[2] = (unsigned char)(pDestImage[2]*m_colors[nColorID][2]);
+									if (numChannels == 4)
 									{
-										pDestImage[1] = (unsigned char)(pDestImage[1]*m_colors[nColorID][1]);
-										if (renderOptions & RenderOptions::SwapRAndB)
-											pDestImage[2] = (unsigned char)(pDestImage[2]*m_colors[nColorID][0]);
+										if (trackedIDs[(*pLabels)] || (*pLabels) == 0)
+											pDestImage[3] = 255;
 										else
-											pDestImage[2] = (unsigned char)(pDestImage[2]*m_colors[nColorID][2]);
-										if (numChannels == 4)
-										{
-											if (trackedIDs[(*pLabels)] || (*pLabels) == 0)
-												pDestImage[3] = 255;
-											else
-												pDestImage[3] = 128;
-										}
+											pDestImage[3] = 128;
 									}
 								}
-								pDestImage+=numChannels;
 							}
+							pDestImage+=numChannels;
 						}
-					}	
-				}
+					}
+				}	
 			}
 		}
 
@@ -494,53 +602,53 @@ void FubiImageProcessing::drawTrackingInfo(FubiISensor* sensor, unsigned char* o
 
 		for (unsigned short i = 0; i < numUsers; i++)
 		{
-			if (users[i]->m_currentTrackingData.jointPositions[SkeletonJoint::TORSO].m_confidence > 0
-				&& users[i]->m_currentTrackingData.jointPositions[SkeletonJoint::TORSO].m_position.z > 100.0f)
+			if (users[i].m_trackingData.jointPositions[SkeletonJoint::TORSO].m_confidence > 0
+				&& users[i].m_trackingData.jointPositions[SkeletonJoint::TORSO].m_position.z > 100.0f)
 			{
 				// First render finger shapes if wanted
 				if (renderOptions & RenderOptions::FingerShapes)
 				{
 					// For left
-					drawFingerCountImage(users[i]->m_id, true, outputImage, width, height, numChannels, depth);
+					drawFingerCountImage(data, users[i], true, outputImage, width, height, numChannels, depth);
 					// and right hand
-					drawFingerCountImage(users[i]->m_id, false, outputImage, width, height, numChannels, depth);
+					drawFingerCountImage(data, users[i], false, outputImage, width, height, numChannels, depth);
 				}
 
-				if (users[i]->m_isTracked)
+				if (users[i].m_isTracked)
 				{
 					if (renderOptions
 					& (RenderOptions::Skeletons | RenderOptions::GlobalOrientCaptions | RenderOptions::LocalOrientCaptions
 					| RenderOptions::GlobalPosCaptions | RenderOptions::LocalPosCaptions))
 					{
 						// Draw the user's skeleton
-						drawLimb(users[i]->m_id, SkeletonJoint::NECK, SkeletonJoint::HEAD, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::NECK, SkeletonJoint::HEAD, outputImage, width, height, numChannels, depth, renderOptions);
 
-						drawLimb(users[i]->m_id, SkeletonJoint::LEFT_SHOULDER, SkeletonJoint::NECK, outputImage, width, height, numChannels, depth, renderOptions);
-						drawLimb(users[i]->m_id, SkeletonJoint::LEFT_SHOULDER, SkeletonJoint::LEFT_ELBOW, outputImage, width, height, numChannels, depth, renderOptions);
-						drawLimb(users[i]->m_id, SkeletonJoint::LEFT_ELBOW, SkeletonJoint::LEFT_HAND, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::LEFT_SHOULDER, SkeletonJoint::NECK, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::LEFT_SHOULDER, SkeletonJoint::LEFT_ELBOW, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::LEFT_ELBOW, SkeletonJoint::LEFT_HAND, outputImage, width, height, numChannels, depth, renderOptions);
 
-						drawLimb(users[i]->m_id, SkeletonJoint::NECK, SkeletonJoint::RIGHT_SHOULDER, outputImage, width, height, numChannels, depth, renderOptions);
-						drawLimb(users[i]->m_id, SkeletonJoint::RIGHT_SHOULDER, SkeletonJoint::RIGHT_ELBOW, outputImage, width, height, numChannels, depth, renderOptions);
-						drawLimb(users[i]->m_id, SkeletonJoint::RIGHT_ELBOW, SkeletonJoint::RIGHT_HAND, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::NECK, SkeletonJoint::RIGHT_SHOULDER, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::RIGHT_SHOULDER, SkeletonJoint::RIGHT_ELBOW, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::RIGHT_ELBOW, SkeletonJoint::RIGHT_HAND, outputImage, width, height, numChannels, depth, renderOptions);
 
-						drawLimb(users[i]->m_id, SkeletonJoint::TORSO, SkeletonJoint::LEFT_SHOULDER, outputImage, width, height, numChannels, depth, renderOptions);
-						drawLimb(users[i]->m_id, SkeletonJoint::RIGHT_SHOULDER, SkeletonJoint::TORSO, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::TORSO, SkeletonJoint::LEFT_SHOULDER, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::RIGHT_SHOULDER, SkeletonJoint::TORSO, outputImage, width, height, numChannels, depth, renderOptions);
 
-						drawLimb(users[i]->m_id, SkeletonJoint::TORSO, SkeletonJoint::LEFT_HIP, outputImage, width, height, numChannels, depth, renderOptions);
-						drawLimb(users[i]->m_id, SkeletonJoint::LEFT_HIP, SkeletonJoint::LEFT_KNEE, outputImage, width, height, numChannels, depth, renderOptions);
-						drawLimb(users[i]->m_id, SkeletonJoint::LEFT_KNEE, SkeletonJoint::LEFT_FOOT, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::TORSO, SkeletonJoint::LEFT_HIP, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::LEFT_HIP, SkeletonJoint::LEFT_KNEE, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::LEFT_KNEE, SkeletonJoint::LEFT_FOOT, outputImage, width, height, numChannels, depth, renderOptions);
 
-						drawLimb(users[i]->m_id, SkeletonJoint::TORSO, SkeletonJoint::RIGHT_HIP, outputImage, width, height, numChannels, depth, renderOptions);
-						drawLimb(users[i]->m_id, SkeletonJoint::RIGHT_HIP, SkeletonJoint::RIGHT_KNEE, outputImage, width, height, numChannels, depth, renderOptions);
-						drawLimb(users[i]->m_id, SkeletonJoint::RIGHT_KNEE, SkeletonJoint::RIGHT_FOOT, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::TORSO, SkeletonJoint::RIGHT_HIP, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::RIGHT_HIP, SkeletonJoint::RIGHT_KNEE, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::RIGHT_KNEE, SkeletonJoint::RIGHT_FOOT, outputImage, width, height, numChannels, depth, renderOptions);
 
 						// TODO: wrists and ankles?
 
 						// Never draw joint captions for this one as we already have...
-						/*drawLimb(users[i]->m_id, SkeletonJoint::WAIST, SkeletonJoint::RIGHT_HIP, outputImage, width, height, numChannels, depth,
+						/*drawLimb(data, users[i], SkeletonJoint::WAIST, SkeletonJoint::RIGHT_HIP, outputImage, width, height, numChannels, depth,
 							(renderOptions & ~(RenderOptions::GlobalOrientCaptions | RenderOptions::LocalOrientCaptions
 							| RenderOptions::GlobalPosCaptions | RenderOptions::LocalPosCaptions)));*/
-						drawLimb(users[i]->m_id, SkeletonJoint::LEFT_HIP, SkeletonJoint::RIGHT_HIP, outputImage, width, height, numChannels, depth,
+						drawLimb(data, users[i], SkeletonJoint::LEFT_HIP, SkeletonJoint::RIGHT_HIP, outputImage, width, height, numChannels, depth,
 							(renderOptions & ~(RenderOptions::GlobalOrientCaptions | RenderOptions::LocalOrientCaptions
 							| RenderOptions::GlobalPosCaptions | RenderOptions::LocalPosCaptions)));
 					}
@@ -566,20 +674,18 @@ void FubiImageProcessing::drawTrackingInfo(FubiISensor* sensor, unsigned char* o
 						// Convert to projective (screen coordinates)
 						Fubi::Vec3f depthToImageScale(1.0f, 1.0f, 1.0f);
 
-						int depthWidth = 0, depthHeight = 0;
-						getDepthResolution(depthWidth, depthHeight);
+						int depthWidth = data.m_depthOptions.m_width, depthHeight = data.m_depthOptions.m_height;
 						if (depthWidth > 0 && depthHeight > 0)
 						{
 							depthToImageScale.x = (float)width / (float)depthWidth;
 							depthToImageScale.y = (float)height / (float)depthHeight;
 						}
 
-						int num = sensor->getFacePoints(users[i]->m_id, 0x0, true);
+						int num = (int) users[i].m_facePoints.size();
 						if (num > 0)
 						{
-							Fubi::Vec3f* points  = new Fubi::Vec3f[num];
-							Fubi::Vec3f* triangles  = new Fubi::Vec3f[num];
-							sensor->getFacePoints(users[i]->m_id, points, false, triangles);
+							const Fubi::Vec3f* points = &users[i].m_facePoints[0];
+							const Fubi::Vec3f* triangles = &users[i].m_faceTriangles[0];
 
 							/*
 							// Code for projected 2d points
@@ -633,7 +739,7 @@ void FubiImageProcessing::drawTrackingInfo(FubiISensor* sensor, unsigned char* o
 							}*/
 
 							float r, g, b;
-							getColorForUserID(users[i]->m_id, r, g, b);
+							getColorForUserID(users[i].m_id, r, g, b);
 							for (int i = 0; i < num; ++i)
 							{
 								Fubi::Vec3f pos1 = Fubi::realWorldToProjective(points[(int)triangles[i].x]);
@@ -649,17 +755,15 @@ void FubiImageProcessing::drawTrackingInfo(FubiISensor* sensor, unsigned char* o
 								cvLine(image, cvPoint((int)pos2.x, (int)pos2.y), cvPoint((int)pos3.x, (int)pos3.y), cvScalar(maxValue*(1.0f-b), maxValue*(1.0f-g), maxValue*(1.0f-r), maxValue));
 								cvLine(image, cvPoint((int)pos1.x, (int)pos1.y), cvPoint((int)pos3.x, (int)pos3.y), cvScalar(maxValue*(1.0f-b), maxValue*(1.0f-g), maxValue*(1.0f-r), maxValue));
 							}
-							delete[] points;
-							delete[] triangles;
 						}
 					}
 					else if (renderOptions & RenderOptions::Skeletons)
 					{
-						drawLimb(users[i]->m_id, SkeletonJoint::HEAD, SkeletonJoint::FACE_NOSE, outputImage, width, height, numChannels, depth, renderOptions);
-						drawLimb(users[i]->m_id, SkeletonJoint::FACE_CHIN, SkeletonJoint::FACE_RIGHT_EAR, outputImage, width, height, numChannels, depth, renderOptions);
-						drawLimb(users[i]->m_id, SkeletonJoint::FACE_RIGHT_EAR, SkeletonJoint::FACE_FOREHEAD, outputImage, width, height, numChannels, depth, renderOptions);
-						drawLimb(users[i]->m_id, SkeletonJoint::FACE_FOREHEAD, SkeletonJoint::FACE_LEFT_EAR, outputImage, width, height, numChannels, depth, renderOptions);
-						drawLimb(users[i]->m_id, SkeletonJoint::FACE_LEFT_EAR, SkeletonJoint::FACE_CHIN, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::HEAD, SkeletonJoint::FACE_NOSE, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::FACE_CHIN, SkeletonJoint::FACE_RIGHT_EAR, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::FACE_RIGHT_EAR, SkeletonJoint::FACE_FOREHEAD, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::FACE_FOREHEAD, SkeletonJoint::FACE_LEFT_EAR, outputImage, width, height, numChannels, depth, renderOptions);
+						drawLimb(data, users[i], SkeletonJoint::FACE_LEFT_EAR, SkeletonJoint::FACE_CHIN, outputImage, width, height, numChannels, depth, renderOptions);
 					}
 				}
 				if (renderOptions & RenderOptions::UserCaptions)
@@ -669,24 +773,24 @@ void FubiImageProcessing::drawTrackingInfo(FubiISensor* sensor, unsigned char* o
 					ss.setf(ios::fixed,ios::floatfield); 
 					ss.precision(0);
 
-					Fubi::Vec3f pos = users[i]->m_currentTrackingData.jointPositions[SkeletonJoint::TORSO].m_position;
+					Fubi::Vec3f pos = users[i].m_trackingData.jointPositions[SkeletonJoint::TORSO].m_position;
 
-					if (users[i]->m_isTracked)
+					if (users[i].m_isTracked)
 					{
 						// Tracking
-						ss << "User"  << users[i]->m_id << "@(" << pos.x << "," << pos.y << "," << pos.z << ") Tracking";
+						ss << "User"  << users[i].m_id << "@(" << pos.x << "," << pos.y << "," << pos.z << ") Tracking";
 					}
 					else
 					{
 						// Not yet tracked = Calibrating
-						ss << "User"  << users[i]->m_id << "@(" << pos.x << "," << pos.y << "," << pos.z << ") Calibrating";
+						ss << "User"  << users[i].m_id << "@(" << pos.x << "," << pos.y << "," << pos.z << ") Calibrating";
 					}
 
 					string label = ss.str();
 
 					// print text
 					float r, g, b;
-					getColorForUserID(users[i]->m_id, r, g, b);
+					getColorForUserID(users[i].m_id, r, g, b);
 					if (renderOptions & RenderOptions::SwapRAndB)
 						swap(r, b);
 					double maxValue = (depth == ImageDepth::D16) ? Math::MaxUShort16 : 255;
@@ -695,8 +799,7 @@ void FubiImageProcessing::drawTrackingInfo(FubiISensor* sensor, unsigned char* o
 					Fubi::Vec3f posProjective = Fubi::realWorldToProjective(pos);
 
 					Fubi::Vec3f depthToImageScale(1.0f, 1.0f, 1.0f);
-					int depthWidth = 0, depthHeight = 0;
-					getDepthResolution(depthWidth, depthHeight);
+					int depthWidth = data.m_depthOptions.m_width, depthHeight = data.m_depthOptions.m_height;
 					if (depthWidth > 0 && depthHeight > 0)
 					{
 						depthToImageScale.x = (float)width / (float)depthWidth;
@@ -731,25 +834,25 @@ void FubiImageProcessing::drawTrackingInfo(FubiISensor* sensor, unsigned char* o
 
 				if (renderOptions & RenderOptions::BodyMeasurements)
 				{
-					drawBodyMeasurement(users[i]->m_id, SkeletonJoint::RIGHT_FOOT, SkeletonJoint::HEAD, BodyMeasurement::BODY_HEIGHT,
+					drawBodyMeasurement(data, users[i], SkeletonJoint::RIGHT_FOOT, SkeletonJoint::HEAD, BodyMeasurement::BODY_HEIGHT,
 						outputImage, width, height, numChannels, depth, renderOptions);
-					drawBodyMeasurement(users[i]->m_id, SkeletonJoint::WAIST, SkeletonJoint::NECK, BodyMeasurement::TORSO_HEIGHT,
+					drawBodyMeasurement(data, users[i], SkeletonJoint::WAIST, SkeletonJoint::NECK, BodyMeasurement::TORSO_HEIGHT,
 						outputImage, width, height, numChannels, depth, renderOptions);
-					drawBodyMeasurement(users[i]->m_id, SkeletonJoint::RIGHT_SHOULDER, SkeletonJoint::LEFT_SHOULDER, BodyMeasurement::SHOULDER_WIDTH,
+					drawBodyMeasurement(data, users[i], SkeletonJoint::RIGHT_SHOULDER, SkeletonJoint::LEFT_SHOULDER, BodyMeasurement::SHOULDER_WIDTH,
 						outputImage, width, height, numChannels, depth, renderOptions);
-					drawBodyMeasurement(users[i]->m_id, SkeletonJoint::RIGHT_HIP, SkeletonJoint::LEFT_HIP, BodyMeasurement::HIP_WIDTH,
+					drawBodyMeasurement(data, users[i], SkeletonJoint::RIGHT_HIP, SkeletonJoint::LEFT_HIP, BodyMeasurement::HIP_WIDTH,
 						outputImage, width, height, numChannels, depth, renderOptions);
-					drawBodyMeasurement(users[i]->m_id, SkeletonJoint::RIGHT_SHOULDER, SkeletonJoint::RIGHT_HAND, BodyMeasurement::ARM_LENGTH,
+					drawBodyMeasurement(data, users[i], SkeletonJoint::RIGHT_SHOULDER, SkeletonJoint::RIGHT_HAND, BodyMeasurement::ARM_LENGTH,
 						outputImage, width, height, numChannels, depth, renderOptions);
-					drawBodyMeasurement(users[i]->m_id, SkeletonJoint::LEFT_SHOULDER, SkeletonJoint::LEFT_ELBOW, BodyMeasurement::UPPER_ARM_LENGTH,
+					drawBodyMeasurement(data, users[i], SkeletonJoint::LEFT_SHOULDER, SkeletonJoint::LEFT_ELBOW, BodyMeasurement::UPPER_ARM_LENGTH,
 						outputImage, width, height, numChannels, depth, renderOptions);
-					drawBodyMeasurement(users[i]->m_id, SkeletonJoint::LEFT_ELBOW, SkeletonJoint::LEFT_HAND, BodyMeasurement::LOWER_ARM_LENGTH,
+					drawBodyMeasurement(data, users[i], SkeletonJoint::LEFT_ELBOW, SkeletonJoint::LEFT_HAND, BodyMeasurement::LOWER_ARM_LENGTH,
 						outputImage, width, height, numChannels, depth, renderOptions);
-					drawBodyMeasurement(users[i]->m_id, SkeletonJoint::RIGHT_FOOT, SkeletonJoint::RIGHT_HIP, BodyMeasurement::LEG_LENGTH,
+					drawBodyMeasurement(data, users[i], SkeletonJoint::RIGHT_FOOT, SkeletonJoint::RIGHT_HIP, BodyMeasurement::LEG_LENGTH,
 						outputImage, width, height, numChannels, depth, renderOptions);
-					drawBodyMeasurement(users[i]->m_id, SkeletonJoint::LEFT_HIP, SkeletonJoint::LEFT_KNEE, BodyMeasurement::UPPER_LEG_LENGTH,
+					drawBodyMeasurement(data, users[i], SkeletonJoint::LEFT_HIP, SkeletonJoint::LEFT_KNEE, BodyMeasurement::UPPER_LEG_LENGTH,
 						outputImage, width, height, numChannels, depth, renderOptions);
-					drawBodyMeasurement(users[i]->m_id, SkeletonJoint::LEFT_KNEE, SkeletonJoint::LEFT_FOOT, BodyMeasurement::LOWER_LEG_LENGTH,
+					drawBodyMeasurement(data, users[i], SkeletonJoint::LEFT_KNEE, SkeletonJoint::LEFT_FOOT, BodyMeasurement::LOWER_LEG_LENGTH,
 						outputImage, width, height, numChannels, depth, renderOptions);
 				}
 			}
@@ -759,15 +862,16 @@ void FubiImageProcessing::drawTrackingInfo(FubiISensor* sensor, unsigned char* o
 }
 
 
-bool FubiImageProcessing::drawDepthImage(FubiISensor* sensor, unsigned char* outputImage, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, Fubi::DepthImageModification::Modification depthModifications, unsigned int renderOptions)
+bool FubiImageProcessing::drawDepthImage(RenderData& data, unsigned char* outputImage, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, Fubi::DepthImageModification::Modification depthModifications, unsigned int renderOptions)
 {
-	if (sensor)
+	if (!data.m_depthData.empty())
 	{
 		// Get options for the resolution
-		Fubi::StreamOptions options = sensor->getDepthOptions();
+		const Fubi::StreamOptions& options = data.m_depthOptions;
 
 		// Get depth data	
-		const unsigned short* pDepth = sensor->getDepthData();
+		const unsigned short* pDepth = &data.m_depthData[0];
+		float* depthHist = &data.m_depthHist[0];
 
 		if (options.isValid() && pDepth != 0)
 		{
@@ -788,7 +892,7 @@ bool FubiImageProcessing::drawDepthImage(FubiISensor* sensor, unsigned char* out
 				// Calculate depth histogram
 				unsigned short nIndex = 0;
 				float nNumberOfPoints = 0;		
-				memset(m_depthHist, 0, m_lastMaxDepth*sizeof(float));
+				memset(depthHist, 0, data.m_lastMaxDepth*sizeof(float));
 				maxDepth = 0;
 				for (unsigned short nY=0; nY<options.m_height; nY++)
 				{
@@ -797,7 +901,7 @@ bool FubiImageProcessing::drawDepthImage(FubiISensor* sensor, unsigned char* out
 						nValue = *pDepth;
 						if (nValue != 0)
 						{
-							m_depthHist[nValue]++;
+							depthHist[nValue]++;
 							nNumberOfPoints++;
 							if (nValue > maxDepth)
 								maxDepth = nValue;
@@ -805,20 +909,20 @@ bool FubiImageProcessing::drawDepthImage(FubiISensor* sensor, unsigned char* out
 						pDepth++;
 					}
 				}
-				m_lastMaxDepth = maxDepth;
+				data.m_lastMaxDepth = maxDepth;
 
 				if (nNumberOfPoints > 0 && maxDepth > 0)
 				{
 					// Already add first value
-					m_depthHist[1] += m_depthHist[0];
+					depthHist[1] += depthHist[0];
 					// Calculate the rest
 					for (nIndex=2; nIndex<maxDepth; nIndex++)
 					{
-						m_depthHist[nIndex] += m_depthHist[nIndex-1];
-						m_depthHist[nIndex-1] = 1.0f - (m_depthHist[nIndex-1] / nNumberOfPoints);
+						depthHist[nIndex] += depthHist[nIndex-1];
+						depthHist[nIndex-1] = 1.0f - (depthHist[nIndex-1] / nNumberOfPoints);
 					}
 					// And divide the last one
-					m_depthHist[maxDepth] = 1.0f - (m_depthHist[maxDepth] / nNumberOfPoints);
+					depthHist[maxDepth] = 1.0f - (depthHist[maxDepth] / nNumberOfPoints);
 				}
 			}
 			else if (depthModifications == DepthImageModification::StretchValueRange
@@ -838,7 +942,7 @@ bool FubiImageProcessing::drawDepthImage(FubiISensor* sensor, unsigned char* out
 				}
 			}
 
-			const unsigned short* pLabels = sensor->getUserLabelData();
+			const unsigned short* pLabels = data.m_userLabelData.empty() ? 0x0 : &data.m_userLabelData[0];
 			// Get user labels
 			if (pLabels == 0x0)
 			{
@@ -847,7 +951,7 @@ bool FubiImageProcessing::drawDepthImage(FubiISensor* sensor, unsigned char* out
 				renderOptions |= RenderOptions::Background;
 			}
 
-			pDepth = sensor->getDepthData();
+			pDepth = &data.m_depthData[0];
 			unsigned char* p8DestImage;
 			unsigned short* p16DestImage;
 			int max = Math::MaxUShort16;
@@ -871,7 +975,7 @@ bool FubiImageProcessing::drawDepthImage(FubiISensor* sensor, unsigned char* out
 						nValue = *pDepth;
 						if (depthModifications == DepthImageModification::UseHistogram)
 						{
-							nValue = (unsigned short)((float)max * m_depthHist[nValue]);
+							nValue = (unsigned short)((float)max * depthHist[nValue]);
 							nValue2 = nValue1 = nValue;
 						}
 						else if (depthModifications == DepthImageModification::ConvertToRGB)
@@ -1013,7 +1117,7 @@ bool FubiImageProcessing::drawDepthImage(FubiISensor* sensor, unsigned char* out
 	return false;
 }
 
-bool FubiImageProcessing::saveImage(FubiISensor* sensor, const char* fileName, int jpegQuality, 
+bool FubiImageProcessing::saveImage(RenderData& data, const char* fileName, int jpegQuality, 
 	Fubi::ImageType::Type type, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth,
 	unsigned int renderOptions /*= (Fubi::RenderOptions::Shapes | Fubi::RenderOptions::Skeletons | Fubi::RenderOptions::UserCaptions)*/,
 	Fubi::DepthImageModification::Modification depthModifications /*= Fubi::DepthImageModification::UseHistogram*/,
@@ -1021,75 +1125,72 @@ bool FubiImageProcessing::saveImage(FubiISensor* sensor, const char* fileName, i
 {
 	bool succes = false;
 #ifdef USE_OPENCV
-	if (sensor)
-	{
-		IplImage* image = 0;
-		int applyThreshold = 0;
-		Fubi::StreamOptions options;
+	IplImage* image = 0;
+	int applyThreshold = 0;
+	Fubi::StreamOptions options;
 
-		if (type == ImageType::Color)
+	if (type == ImageType::Color)
+	{
+		options = data.m_rgbOptions;
+		if (options.isValid())
 		{
-			options = sensor->getRgbOptions();
-			if (options.isValid())
-			{
-				image = cvCreateImage(cvSize(options.m_width, options.m_height), depth, numChannels);
-				// Color image has by default the channel order RGB
-				// As OpenCV wants BGR as the default, we use the SwapRAndB option in the opposite way
-				succes = drawColorImage(sensor, (unsigned char*)(image->imageData), numChannels, depth, (renderOptions & RenderOptions::SwapRAndB) == 0);
-			}
+			image = cvCreateImage(cvSize(options.m_width, options.m_height), depth, numChannels);
+			// Color image has by default the channel order RGB
+			// As OpenCV wants BGR as the default, we use the SwapRAndB option in the opposite way
+			succes = drawColorImage(data, (unsigned char*)(image->imageData), numChannels, depth, (renderOptions & RenderOptions::SwapRAndB) == 0);
 		}
-		else if (type == ImageType::IR)
+	}
+	else if (type == ImageType::IR)
+	{
+		options = data.m_irOptions;
+		if (options.isValid())
 		{
-			options = sensor->getIROptions();
-			if (options.isValid())
-			{
-				image = cvCreateImage(cvSize(options.m_width, options.m_height), depth, numChannels);
-				succes = drawIRImage(sensor, (unsigned char*)(image->imageData), numChannels, depth);
-			}
+			image = cvCreateImage(cvSize(options.m_width, options.m_height), depth, numChannels);
+			succes = drawIRImage(data, (unsigned char*)(image->imageData), numChannels, depth);
 		}
-		else
+	}
+	else
+	{
+		options = data.m_depthOptions;
+		if (options.isValid())
 		{
-			options = sensor->getDepthOptions();
-			if (options.isValid())
+			image = cvCreateImage(cvSize(options.m_width, options.m_height), depth, numChannels);
+			if ((userId != 0) && depthModifications != DepthImageModification::UseHistogram && depthModifications != DepthImageModification::ConvertToRGB)
 			{
-				image = cvCreateImage(cvSize(options.m_width, options.m_height), depth, numChannels);
-				if ((userId != 0) && depthModifications != DepthImageModification::UseHistogram && depthModifications != DepthImageModification::ConvertToRGB)
-				{
-					if (jointOfInterest == SkeletonJoint::NUM_JOINTS || jointOfInterest == SkeletonJoint::TORSO)
-						applyThreshold = 400;
-					else if (jointOfInterest == SkeletonJoint::HEAD)
-						applyThreshold = 200;
-					else
-						applyThreshold = 75;
-				}
-				succes = drawDepthImage(sensor, (unsigned char*)(image->imageData), numChannels, depth, depthModifications, renderOptions);
+				if (jointOfInterest == SkeletonJoint::NUM_JOINTS || jointOfInterest == SkeletonJoint::TORSO)
+					applyThreshold = 400;
+				else if (jointOfInterest == SkeletonJoint::HEAD)
+					applyThreshold = 200;
+				else
+					applyThreshold = 75;
 			}
+			succes = drawDepthImage(data, (unsigned char*)(image->imageData), numChannels, depth, depthModifications, renderOptions);
 		}
+	}
 
-		if (succes && userId != 0)
-		{
-			succes = succes && setROIToUserJoint(image, userId, jointOfInterest, applyThreshold);
-		}
+	if (succes && userId != 0)
+	{
+		succes = succes && setROIToUserJoint(data, image, userId, jointOfInterest, applyThreshold);
+	}
 
-		if (succes && (renderOptions != RenderOptions::None))
-		{
+	if (succes && (renderOptions != RenderOptions::None))
+	{
 
-			drawTrackingInfo(sensor, (unsigned char*)(image->imageData), options.m_width, options.m_height, numChannels, depth, renderOptions);
-		}
+		drawTrackingInfo(data, (unsigned char*)(image->imageData), options.m_width, options.m_height, numChannels, depth, renderOptions);
+	}
 
-		if (succes)
+	if (succes)
+	{
+		// Save to file with given quality
+		int quality[3] = 
 		{
-			// Save to file with given quality
-			int quality[3] = 
-			{
-				CV_IMWRITE_JPEG_QUALITY,
-				jpegQuality,
-				0,
-			};
-			succes = cvSaveImage(fileName, image, quality) != 0;
-		}
-		cvReleaseImage(&image);
+			CV_IMWRITE_JPEG_QUALITY,
+			jpegQuality,
+			0,
+		};
+		succes = cvSaveImage(fileName, image, quality) != 0;
 	}
+	cvReleaseImage(&image);
 #else
 	static double lastWarning = -99;
 	if (Fubi::currentTime() - lastWarning > 10)
@@ -1103,7 +1204,7 @@ bool FubiImageProcessing::saveImage(FubiISensor* sensor, const char* fileName, i
 }
 
 
-bool FubiImageProcessing::drawColorImage(FubiISensor* sensor, unsigned char* outputImage, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, bool swapBandR /*= false*/)
+bool FubiImageProcessing::drawColorImage(const RenderData& renderData, unsigned char* outputImage, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, bool swapBandR /*= false*/)
 {
 	// Catch unsupported cases
 	if (depth != ImageDepth::D8)
@@ -1111,12 +1212,12 @@ bool FubiImageProcessing::drawColorImage(FubiISensor* sensor, unsigned char* out
 		return false;
 	}
 
-	if (sensor)
+	if (!renderData.m_rgbData.empty())
 	{
 		// Get options for the resolution
-		Fubi::StreamOptions options = sensor->getRgbOptions();
+		const Fubi::StreamOptions& options = renderData.m_rgbOptions;
 		// Get image
-		const unsigned char* data = sensor->getRgbData();
+		const unsigned char* data = &renderData.m_rgbData[0];
 		if (options.isValid() && data != 0x0)
 		{
 			if (numChannels == ImageNumChannels::C3)
@@ -1183,15 +1284,15 @@ bool FubiImageProcessing::drawColorImage(FubiISensor* sensor, unsigned char* out
 	return false;
 }
 
-bool FubiImageProcessing::drawIRImage(FubiISensor* sensor, unsigned char* outputImage, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth)
+bool FubiImageProcessing::drawIRImage(const RenderData& data, unsigned char* outputImage, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth)
 {
-	if (sensor)
+	if (!data.m_irData.empty())
 	{
 		// Get options for the resolution
-		Fubi::StreamOptions options = sensor->getIROptions();
+		const Fubi::StreamOptions& options = data.m_irOptions;
 
 		// Get image		
-		const unsigned short* pIr = sensor->getIrData();
+		const unsigned short* pIr = &data.m_irData[0];
 		if (options.isValid() && pIr != 0x0)
 		{
 			unsigned short nValue = 0;
@@ -1248,16 +1349,15 @@ bool FubiImageProcessing::drawIRImage(FubiISensor* sensor, unsigned char* output
 }
 
 
-void FubiImageProcessing::drawLimb(unsigned int player, Fubi::SkeletonJoint::Joint eJoint1, Fubi::SkeletonJoint::Joint eJoint2, unsigned char* outputImage, int width, int height, 
+void FubiImageProcessing::drawLimb(const RenderData& data, const RenderData::User& user, Fubi::SkeletonJoint::Joint eJoint1, Fubi::SkeletonJoint::Joint eJoint2, unsigned char* outputImage, int width, int height, 
 	Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, unsigned int renderOptions)
 {
 #ifdef USE_OPENCV
-	FubiUser* user = Fubi::getUser(player);
-	if (user && user->m_isTracked)
+	if (user.m_isTracked)
 	{
 		// Get positions
-		SkeletonJointPosition joint1 = user->m_currentTrackingData.jointPositions[eJoint1];
-		SkeletonJointPosition joint2 = user->m_currentTrackingData.jointPositions[eJoint2];
+		SkeletonJointPosition joint1 = user.m_trackingData.jointPositions[eJoint1];
+		SkeletonJointPosition joint2 = user.m_trackingData.jointPositions[eJoint2];
 
 		// Check confidence
 		if (joint2.m_position.z > 100.0f)
@@ -1284,8 +1384,7 @@ void FubiImageProcessing::drawLimb(unsigned int player, Fubi::SkeletonJoint::Joi
 
 			Fubi::Vec3f depthToImageScale(1.0f, 1.0f, 1.0f);
 
-			int depthWidth = 0, depthHeight = 0;
-			getDepthResolution(depthWidth, depthHeight);
+			int depthWidth = data.m_depthOptions.m_width, depthHeight = data.m_depthOptions.m_height;
 			if (depthWidth > 0 && depthHeight > 0)
 			{
 				depthToImageScale.x = (float)width / (float)depthWidth;
@@ -1307,7 +1406,7 @@ void FubiImageProcessing::drawLimb(unsigned int player, Fubi::SkeletonJoint::Joi
 			}
 			else
 			{
-				getColorForUserID(player, r, g, b);
+				getColorForUserID(user.m_id, r, g, b);
 				if (renderOptions & RenderOptions::SwapRAndB)
 					swap(r, b);
 				if (joint2.m_confidence < 0.75f)
@@ -1345,22 +1444,22 @@ void FubiImageProcessing::drawLimb(unsigned int player, Fubi::SkeletonJoint::Joi
 
 				if (renderOptions & RenderOptions::LocalOrientCaptions)
 				{
-					Fubi::Vec3f jRot = user->m_currentTrackingData.localJointOrientations[eJoint2].m_orientation.getRot();
+					Fubi::Vec3f jRot = user.m_trackingData.localJointOrientations[eJoint2].m_orientation.getRot();
 					ss << Fubi::getJointName(eJoint2) << ":" << jRot.x << "/" << jRot.y << "/" << jRot.z;
 				}
 				else if (renderOptions & RenderOptions::GlobalOrientCaptions)
 				{
-					Fubi::Vec3f jRot = user->m_currentTrackingData.jointOrientations[eJoint2].m_orientation.getRot();
+					Fubi::Vec3f jRot = user.m_trackingData.jointOrientations[eJoint2].m_orientation.getRot();
 					ss << Fubi::getJointName(eJoint2) << ":" << jRot.x << "/" << jRot.y << "/" << jRot.z;
 				}
 				else if (renderOptions & RenderOptions::LocalPosCaptions)
 				{
-					const Fubi::Vec3f& jPos = user->m_currentTrackingData.localJointPositions[eJoint2].m_position;
+					const Fubi::Vec3f& jPos = user.m_trackingData.localJointPositions[eJoint2].m_position;
 					ss << Fubi::getJointName(eJoint2) << ":" << jPos.x << "/" << jPos.y << "/" << jPos.z;
 				}
 				else if (renderOptions & RenderOptions::GlobalPosCaptions)
 				{
-					const Fubi::Vec3f& jPos = user->m_currentTrackingData.jointPositions[eJoint2].m_position;
+					const Fubi::Vec3f& jPos = user.m_trackingData.jointPositions[eJoint2].m_position;
 					ss << Fubi::getJointName(eJoint2) << ":" << jPos.x << "/" << jPos.y << "/" << jPos.z;
 				}
 
@@ -1380,18 +1479,17 @@ void FubiImageProcessing::drawLimb(unsigned int player, Fubi::SkeletonJoint::Joi
 #endif
 }
 
-void FubiImageProcessing::drawBodyMeasurement(unsigned int player, Fubi::SkeletonJoint::Joint eJoint1, Fubi::SkeletonJoint::Joint eJoint2, Fubi::BodyMeasurement::Measurement bodyMeasure, unsigned char* outputImage, int width, int height, 
+void FubiImageProcessing::drawBodyMeasurement(const RenderData& data, const RenderData::User& user, Fubi::SkeletonJoint::Joint eJoint1, Fubi::SkeletonJoint::Joint eJoint2, Fubi::BodyMeasurement::Measurement bodyMeasure, unsigned char* outputImage, int width, int height, 
 	Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, unsigned int renderOptions)
 {
 #ifdef USE_OPENCV
-	FubiUser* user = Fubi::getUser(player);
-	if (user && user->m_isTracked)
+	if (user.m_isTracked)
 	{
 		// Get positions
-		SkeletonJointPosition joint1 = user->m_currentTrackingData.jointPositions[eJoint1];
-		SkeletonJointPosition joint2 = user->m_currentTrackingData.jointPositions[eJoint2];
+		SkeletonJointPosition joint1 = user.m_trackingData.jointPositions[eJoint1];
+		SkeletonJointPosition joint2 = user.m_trackingData.jointPositions[eJoint2];
 		// And the measurement
-		BodyMeasurementDistance bm = user->m_bodyMeasurements[bodyMeasure];
+		BodyMeasurementDistance bm = user.m_bodyMeasurements[bodyMeasure];
 
 		// Check confidence
 		if (joint2.m_position.z > 100.0f)
@@ -1418,8 +1516,7 @@ void FubiImageProcessing::drawBodyMeasurement(unsigned int player, Fubi::Skeleto
 
 			Fubi::Vec3f depthToImageScale(1.0f, 1.0f, 1.0f);
 
-			int depthWidth = 0, depthHeight = 0;
-			getDepthResolution(depthWidth, depthHeight);
+			int depthWidth = data.m_depthOptions.m_width, depthHeight = data.m_depthOptions.m_height;
 			if (depthWidth > 0 && depthHeight > 0)
 			{
 				depthToImageScale.x = (float)width / (float)depthWidth;
@@ -1441,7 +1538,7 @@ void FubiImageProcessing::drawBodyMeasurement(unsigned int player, Fubi::Skeleto
 			}
 			else
 			{
-				getColorForUserID(player, r, g, b);
+				getColorForUserID(user.m_id, r, g, b);
 				if (renderOptions & RenderOptions::SwapRAndB)
 					swap(r, b);
 				if (bm.m_confidence < 0.75f)
@@ -1474,87 +1571,92 @@ void FubiImageProcessing::drawBodyMeasurement(unsigned int player, Fubi::Skeleto
 }
 
 
-bool FubiImageProcessing::setROIToUserJoint(void* pImage, unsigned int userId, Fubi::SkeletonJoint::Joint jointOfInterest, int applyThreshold /*= 0*/)
+bool FubiImageProcessing::setROIToUserJoint(const RenderData& data, void* pImage, unsigned int userId, Fubi::SkeletonJoint::Joint jointOfInterest, int applyThreshold /*= 0*/)
+{
+	for (unsigned short i = 0; i < data.m_numUsers; ++i)
+	{
+		if (data.m_users[i].m_id == userId)
+			return setROIToUserJoint(pImage, data.m_users[i].m_trackingData, data.m_users[i].m_isTracked, data.m_depthOptions, jointOfInterest, applyThreshold);
+	}
+	return false;
+}
+
+bool FubiImageProcessing::setROIToUserJoint(void* pImage, const FubiUser::TrackingData& trackingData, bool isTracked, const Fubi::StreamOptions& depthOptions,
+	Fubi::SkeletonJoint::Joint jointOfInterest, int applyThreshold /*= 0*/)
 {
 	bool foundRoi = false;
 #ifdef USE_OPENCV
 	IplImage* image = (IplImage*)pImage;
 
-	// Check for the user
-	FubiUser* user = getUser(userId);
-	if (user)
+	// Cut out a shape roughly around the joint of interest
+	Fubi::Vec3f depthToImageScale(1.0f, 1.0f, 1.0f);
+	int depthWidth = depthOptions.m_width, depthHeight = depthOptions.m_height;
+	if (depthWidth > 0 && depthHeight > 0)
 	{
-		// Cut out a shape roughly around the joint of interest
-		Fubi::Vec3f depthToImageScale(1.0f, 1.0f, 1.0f);
-		int depthWidth = 0, depthHeight = 0;
-		getDepthResolution(depthWidth, depthHeight);
-		if (depthWidth > 0 && depthHeight > 0)
-		{
-			depthToImageScale.x = (float)image->width / (float)depthWidth;
-			depthToImageScale.y = (float)image->height / (float)depthHeight;
-		}
+		depthToImageScale.x = (float)image->width / (float)depthWidth;
+		depthToImageScale.y = (float)image->height / (float)depthHeight;
+	}
 
-		// First get the region of interest
-		int width = image->width;
-		int height = image->height;
-		int x = width/2, y = height/2;
-		float z = 0;
-		if (jointOfInterest == SkeletonJoint::NUM_JOINTS) // Cut out whole user
+	// First get the region of interest
+	int width = image->width;
+	int height = image->height;
+	int x = width/2, y = height/2;
+	float z = 0;
+	if (jointOfInterest == SkeletonJoint::NUM_JOINTS) // Cut out whole user
+	{
+		Fubi::Vec3f pos = trackingData.jointPositions[SkeletonJoint::TORSO].m_position;
+		z = pos.z;
+		pos = Fubi::realWorldToProjective(pos);
+		x = int(depthToImageScale.x * pos.x);
+		y = int(depthToImageScale.y * pos.y);
+		// clamp a rectangle about 90 x 200 cm
+		width = int(0.7 * image->width);
+		height = int(1.75 * image->height);
+		foundRoi = true;
+	}
+	else if (isTracked)	// Standard case
+	{
+		// Try to get the joint pos
+		SkeletonJointPosition jPos = trackingData.jointPositions[jointOfInterest];
+		if (jPos.m_confidence > 0.5f)
 		{
-			Fubi::Vec3f pos = user->m_currentTrackingData.jointPositions[SkeletonJoint::TORSO].m_position;
+			Fubi::Vec3f pos = jPos.m_position;
 			z = pos.z;
 			pos = Fubi::realWorldToProjective(pos);
 			x = int(depthToImageScale.x * pos.x);
 			y = int(depthToImageScale.y * pos.y);
-			// clamp a rectangle about 90 x 200 cm
-			width = int(0.7 * image->width);
-			height = int(1.75 * image->height);
+			// clamp a rectangle about 30 x 50 cm
+			width = int(0.234 * image->width);
+			height = int(0.4375 * image->height);
 			foundRoi = true;
 		}
-		else if (user->m_isTracked)	// Standard case
-		{
-			// Try to get the joint pos
-			SkeletonJointPosition jPos = user->m_currentTrackingData.jointPositions[jointOfInterest];
-			if (jPos.m_confidence > 0.5f)
-			{
-				Fubi::Vec3f pos = jPos.m_position;
-				z = pos.z;
-				pos = Fubi::realWorldToProjective(pos);
-				x = int(depthToImageScale.x * pos.x);
-				y = int(depthToImageScale.y * pos.y);
-				// clamp a rectangle about 30 x 50 cm
-				width = int(0.234 * image->width);
-				height = int(0.4375 * image->height);
-				foundRoi = true;
-			}
-		}
+	}
 
-		if (foundRoi)
+	if (foundRoi)
+	{
+		// Clamp z from 30 cm to 5 m, convert to meter, and invert it
+		float zFac = 1000.0f / clamp(z, 300.0f, 5000.0f);
+		// Apply z-factor
+		width = int(width*zFac + 0.5f);
+		height = int(height*zFac + 0.5f);
+		// Set x and y from center to upper left corner and clamp it
+		int upperLeftX = clamp(x-(width/2), 0, image->width-1);
+		int upperLeftY = clamp(y-(height/2), 0, image->height-1);
+
+		// Clamp size
+		width = clamp(width, 1, image->width-upperLeftX);
+		height = clamp(height, 1, image->height-upperLeftY);
+
+		// Now crop the part around the joint from the image
+		cvSetImageROI(image, cvRect(upperLeftX, upperLeftY, width, height));
+
+		if (applyThreshold > 0)
 		{
-			// Clamp z from 30 cm to 5 m, convert to meter, and invert it
-			float zFac = 1000.0f / clamp(z, 300.0f, 5000.0f);
-			// Apply z-factor
-			width = int(width*zFac + 0.5f);
-			height = int(height*zFac + 0.5f);
-			// Set x and y from center to upper left corner and clamp it
-			int upperLeftX = clamp(x-(width/2), 0, image->width-1);
-			int upperLeftY = clamp(y-(height/2), 0, image->height-1);
-
-			// Clamp size
-			width = clamp(width, 1, image->width-upperLeftX);
-			height = clamp(height, 1, image->height-upperLeftY);
-
-			// Now crop the part around the joint from the image
-			cvSetImageROI(image, cvRect(upperLeftX, upperLeftY, width, height));
-
-			if (applyThreshold > 0)
-			{
-				// Clamp depth values according to hand depth
-				int convertedZ = int(z + 0.5f);
-				if (image->depth != IPL_DEPTH_16U)
-					convertedZ = int((z * 255.0f / (float)Math::MaxUShort16) + 0.5f);
-				FubiImageProcessing::applyThreshold((void*)image, (unsigned int)clamp(convertedZ - applyThreshold, 0, MaxDepth), (unsigned int)clamp(convertedZ + applyThreshold, 0, MaxDepth), 0);
-			}
+			// Clamp depth values according to hand depth
+			int convertedZ = int(z + 0.5f);
+			if (image->depth != IPL_DEPTH_16U)
+				convertedZ = int((z * 255.0f / (float)Math::MaxUShort16) + 0.5f);
+			FubiImageProcessing::applyThreshold((void*)image, (unsigned int)clamp(convertedZ - applyThreshold, 0, MaxDepth), (unsigned int)clamp(convertedZ + applyThreshold, 0, MaxDepth), 0);
 		}
 	}
 #else
@@ -1903,10 +2005,13 @@ int FubiImageProcessing::applyFingerCount(FubiISensor* sensor, unsigned int user
 
 		// Retrieve the depth image
 		IplImage* image = cvCreateImage(cvSize(options.m_width, options.m_height), IPL_DEPTH_16U, 1);
-		drawDepthImage(sensor, (unsigned char*)image->imageData, ImageNumChannels::C1, ImageDepth::D16, DepthImageModification::Raw, RenderOptions::None);
+		const unsigned short* pDepth = sensor->getDepthData();
+		if (pDepth)
+			memcpy(image->imageData, pDepth, options.m_width*options.m_height*sizeof(unsigned short));
 
 		// Set Region of interest to the observed hand and apply a depth threshold
-		if (setROIToUserJoint(image, userID, leftHand ? SkeletonJoint::LEFT_HAND : SkeletonJoint::RIGHT_HAND, 75))
+		FubiUser* user = Fubi::getUser(userID);
+		if (user && setROIToUserJoint(image, user->getCurrentTrackingData(), user->m_isTracked, options, leftHand ? SkeletonJoint::LEFT_HAND : SkeletonJoint::RIGHT_HAND, 75))
 		{
 			// Convert the image back to 8 bit (easier to handle in the rest)		
 			IplImage* depthImage = cvCreateImage(cvSize(image->roi->width, image->roi->height), IPL_DEPTH_8U, 1);
@@ -16,22 +16,76 @@
 
 // Sensor interface for getting stream data
 #include "FubiISensor.h"
+// User tracking data that is copied for drawing
+#include "FubiUser.h"
+
+#include <vector>
 
 class FubiImageProcessing
 {
 public:
+	// Copy of the sensor streams and the user state that is drawn into an image
+	// Filled by copyRenderData() while the tracking is locked, the drawing then only works on the copy without holding the lock
+	struct RenderData
+	{
+		RenderData();
+		~RenderData();
+
+		// State of one user at the time of the copy
+		struct User
+		{
+			// OpenNI id of this user
+			unsigned int m_id;
+			// Whether the user is currently tracked
+			bool m_isTracked;
+			// The local transformations are only copied for the local captions
+			FubiUser::TrackingData m_trackingData;
+			Fubi::BodyMeasurementDistance m_bodyMeasurements[Fubi::BodyMeasurement::NUM_MEASUREMENTS];
+			// Own copies of the last finger count images, only for the finger shapes
+			Fubi::FingerCountImageData m_leftFingerCountImage, m_rightFingerCountImage;
+			// Face points and the point indices of the face triangles, only for the detailed face shapes
+			std::vector<Fubi::Vec3f> m_facePoints, m_faceTriangles;
+		};
+
+		// Stream options (invalid without sensor) and data (empty if not needed for the image)
+		Fubi::StreamOptions m_depthOptions, m_rgbOptions, m_irOptions;
+		std::vector<unsigned short> m_depthData, m_irData, m_userLabelData;
+		std::vector<unsigned char> m_rgbData;
+
+		// Valid users in the same order as returned by Fubi::getCurrentUsers()
+		unsigned short m_numUsers;
+		User m_users[Fubi::MaxUsers];
+
+		// Gesture displayed per user id
+		FubiUserGesture m_gestures;
+
+		// Drawing state kept from one image to the next
+		std::vector<float> m_depthHist;
+		unsigned short m_lastMaxDepth;
+		double m_lastTick, m_fps;
+		int m_tickIndex;
+
+	private:
+		// Owns the finger count image copies
+		RenderData(const RenderData&);
+		RenderData& operator=(const RenderData&);
+	};
+
 	// Get color of a user in the enhanced depth image
 	static void getColorForUserID(unsigned int id, float& r, float& g, float& b);
+
+	// Copy everything needed for drawing an image of the given type with the given render options
+	// Has to be called while the tracking is locked
+	static void copyRenderData(FubiISensor* sensor, RenderData& data, Fubi::ImageType::Type type, unsigned int renderOptions, const FubiUserGesture& currentGestures);
 	
-	// Draw an image into the given buffer, returns true if succesful
-	static bool getImage(FubiISensor* sensor, unsigned char* outputImage, Fubi::ImageType::Type type, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, 
+	// Draw an image from the copied data into the given buffer, returns true if succesful
+	static bool getImage(RenderData& data, unsigned char* outputImage, Fubi::ImageType::Type type, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, 
 		unsigned int renderOptions = (Fubi::RenderOptions::Shapes | Fubi::RenderOptions::Skeletons | Fubi::RenderOptions::UserCaptions),
 		Fubi::DepthImageModification::Modification depthModifications = Fubi::DepthImageModification::UseHistogram,
-        unsigned int userId = 0, Fubi::SkeletonJoint::Joint jointOfInterest = Fubi::SkeletonJoint::NUM_JOINTS,
-        FubiUserGesture current_gestures = FubiUserGesture() );
+        unsigned int userId = 0, Fubi::SkeletonJoint::Joint jointOfInterest = Fubi::SkeletonJoint::NUM_JOINTS);
 
-	// Save a picture of one user (or the whole scene if userId = 0)
-	static bool saveImage(FubiISensor* sensor, const char* fileName, int jpegQuality, 
+	// Save a picture of one user (or the whole scene if userId = 0) from the copied data
+	static bool saveImage(RenderData& data, const char* fileName, int jpegQuality, 
 		Fubi::ImageType::Type type, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth,
 		unsigned int renderOptions = (Fubi::RenderOptions::Shapes | Fubi::RenderOptions::Skeletons | Fubi::RenderOptions::UserCaptions),
 		Fubi::DepthImageModification::Modification depthModifications = Fubi::DepthImageModification::UseHistogram,
@@ -48,25 +102,30 @@ private:
 	FubiImageProcessing();
 
 	// Draw the color image of the sensor, returns true if succesful
-	static bool drawColorImage(FubiISensor* sensor, unsigned char* outputImage, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, bool swapBandR = false);
+	static bool drawColorImage(const RenderData& data, unsigned char* outputImage, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, bool swapBandR = false);
 	// Draw the ir image of the sensor, returns true if succesful
-	static bool drawIRImage(FubiISensor* sensor, unsigned char* outputImage, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth);
+	static bool drawIRImage(const RenderData& data, unsigned char* outputImage, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth);
 	// Draws the depth histogram with optional tracking info to the given image buffer, returns true if succesful
-	static bool drawDepthImage(FubiISensor* sensor, unsigned char* outputImage, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, Fubi::DepthImageModification::Modification depthModifications, unsigned int renderOptions);
+	static bool drawDepthImage(RenderData& data, unsigned char* outputImage, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, Fubi::DepthImageModification::Modification depthModifications, unsigned int renderOptions);
 	// Adds tracking info to a image
-	static void drawTrackingInfo(FubiISensor* sensor, unsigned char* outputImage, int width, int height, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, unsigned int renderOptions);
+	static void drawTrackingInfo(const RenderData& data, unsigned char* outputImage, int width, int height, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, unsigned int renderOptions);
 	// overlay the last finger count image onto the output image
-	static void drawFingerCountImage(unsigned int userID, bool leftHand, unsigned char* outputImage, int width, int height, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth);
+	static void drawFingerCountImage(const RenderData& data, const RenderData::User& user, bool leftHand, unsigned char* outputImage, int width, int height, Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth);
 
 	// Draw a single limp of a player in a image buffer
-	static void drawLimb(unsigned int player, Fubi::SkeletonJoint::Joint eJoint1, Fubi::SkeletonJoint::Joint eJoint2, unsigned char* outputImage, int width, int height,
+	static void drawLimb(const RenderData& data, const RenderData::User& user, Fubi::SkeletonJoint::Joint eJoint1, Fubi::SkeletonJoint::Joint eJoint2, unsigned char* outputImage, int width, int height,
 		Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, unsigned int renderOptions);
 	// Draw the label for a body measurement
-	static void drawBodyMeasurement(unsigned int player, Fubi::SkeletonJoint::Joint eJoint1, Fubi::SkeletonJoint::Joint eJoint2, Fubi::BodyMeasurement::Measurement bodyMeasure, unsigned char* outputImage, int width, int height, 
+	static void drawBodyMeasurement(const RenderData& data, const RenderData::User& user, Fubi::SkeletonJoint::Joint eJoint1, Fubi::SkeletonJoint::Joint eJoint2, Fubi::BodyMeasurement::Measurement bodyMeasure, unsigned char* outputImage, int width, int height, 
 	Fubi::ImageNumChannels::Channel numChannels, Fubi::ImageDepth::Depth depth, unsigned int renderOptions);
 
-	// Helper function for setting the image roi around the user joint (and thresholding the image) returns true if user and joint were found
-	static bool setROIToUserJoint(void* pImage, unsigned int userId, Fubi::SkeletonJoint::Joint jointOfInterest, int applyThreshold = 0);
+	// Helper function for setting the image roi around the user joint (and thresholding the image) returns true if the joint was found
+	static bool setROIToUserJoint(void* pImage, const FubiUser::TrackingData& trackingData, bool isTracked, const Fubi::StreamOptions& depthOptions,
+		Fubi::SkeletonJoint::Joint jointOfInterest, int applyThreshold = 0);
+	// Same for a user of the render data, also returns false if the user is not there
+	static bool setROIToUserJoint(const RenderData& data, void* pImage, unsigned int userId, Fubi::SkeletonJoint::Joint jointOfInterest, int applyThreshold = 0);
+	// Copy the last finger count image of a user into the own image of the render data
+	static void copyFingerCountImage(const Fubi::FingerCountImageData* source, Fubi::FingerCountImageData& target);
 	// Helper function for applying a two sided threshold (also for 16 bit images)
 	static void applyThreshold(void* pImage, unsigned int min, unsigned int max, unsigned int replaceValue = 0);
 
@@ -74,10 +133,6 @@ private:
 	// The processing steps will be visualized into the rgbImage if given
 	static int fingerCount(void * pDepthImage, void* pRgbaImage = 0x0, bool useContourDefectMode = false);
 
-	// Buffer for calculating the depth histogram
-	static float m_depthHist[Fubi::MaxDepth];
-	static unsigned short m_lastMaxDepth;
-
 	// The different colors for each user id
 	static const float m_colors[Fubi::MaxUsers+1][3];
 
@@ -0,0 +1,341 @@
+// ****************************************************************************************
+//
+// Fubi Joint History
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#include "FubiJointHistory.h"
+
+#include <algorithm>
+
+using namespace Fubi;
+
+unsigned int JointHistoryWindows::addWindow(double duration, float minConfidence, Fubi::SkeletonJoint::Joint joint, bool useLocalPositions)
+{
+	unsigned int index = 0;
+	while (index < m_windows.size() && (m_windows[index].m_duration != duration || m_windows[index].m_minConfidence != minConfidence))
+		++index;
+	if (index == m_windows.size())
+		m_windows.push_back(JointHistoryWindow(duration, minConfidence));
+
+	if (joint < SkeletonJoint::NUM_JOINTS)
+	{
+		if (useLocalPositions)
+			m_windows[index].m_localJoints |= 1u << joint;
+		else
+			m_windows[index].m_joints |= 1u << joint;
+	}
+	return index;
+}
+
+unsigned int JointHistoryWindows::addTrajectory(const JointHistoryTrajectory& trajectory)
+{
+	unsigned int index = 0;
+	while (index < m_trajectories.size() && m_trajectories[index] != trajectory)
+		++index;
+	if (index == m_trajectories.size())
+		m_trajectories.push_back(trajectory);
+	return index;
+}
+
+void FubiJointHistory::Sums::reset()
+{
+	m_count = m_t = m_t2 = m_t3 = m_t4 = 0;
+	for (unsigned int i = 0; i < 3; ++i)
+		m_p[i] = m_tp[i] = m_t2p[i] = 0;
+}
+
+void FubiJointHistory::Sums::add(double t, const float* position, double sign)
+{
+	double t2 = t*t;
+	m_count += sign;
+	m_t += sign*t;
+	m_t2 += sign*t2;
+	m_t3 += sign*t2*t;
+	m_t4 += sign*t2*t2;
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		double p = sign*position[i];
+		m_p[i] += p;
+		m_tp[i] += p*t;
+		m_t2p[i] += p*t2;
+	}
+}
+
+FubiJointHistory::FubiJointHistory() : m_numAddedFrames(0), m_numFrames(0)
+{
+	// Start the samples at the next cache line (64 bytes)
+	m_sampleStorage.resize(NumSampledJoints * Capacity * 4 + 16, 0);
+	size_t misalignment = (size_t) &m_sampleStorage[0] % 64;
+	m_samples = &m_sampleStorage[0] + ((misalignment > 0) ? (64 - misalignment) / sizeof(float) : 0);
+	for (unsigned int i = 0; i < Capacity; ++i)
+		m_timeStamps[i] = 0;
+}
+
+void FubiJointHistory::clear()
+{
+	m_numAddedFrames = 0;
+	m_numFrames = 0;
+	for (unsigned int i = 0; i < m_windows.size(); ++i)
+	{
+		WindowState& window = m_windows[i];
+		window.m_firstFrame = 0;
+		window.m_framesSinceRebuild = Capacity;
+	}
+	for (unsigned int i = 0; i < m_trajectories.size(); ++i)
+		m_trajectories[i].m_numSamples = 0;
+}
+
+void FubiJointHistory::addFrame(double timeStamp, const Fubi::SkeletonJointPosition* positions, const Fubi::SkeletonJointPosition* localPositions,
+	const std::vector<JointHistoryWindow>& windows, const std::vector<JointHistoryTrajectory>& trajectories)
+{
+	if (m_numFrames > 0)
+	{
+		// A repeated sensor frame would only add a second sample at the same time
+		double lastTimeStamp = getTimeStamp(0);
+		if (timeStamp == lastTimeStamp)
+			return;
+		if (timeStamp < lastTimeStamp)
+			clear();
+	}
+
+	// New or changed windows are rebuilt after adding the frame
+	if (m_windows.size() != windows.size())
+		m_windows.resize(windows.size());
+	unsigned int frame = m_numAddedFrames;
+	for (unsigned int i = 0; i < m_windows.size(); ++i)
+	{
+		WindowState& window = m_windows[i];
+		if (window.m_definition != windows[i])
+		{
+			window.m_definition = windows[i];
+			window.m_framesSinceRebuild = Capacity;
+		}
+		else
+		{
+			// Remove the frames that are too old now, at the latest before they get overwritten
+			double startTime = timeStamp - window.m_definition.m_duration;
+			while (window.m_firstFrame < frame
+				&& (window.m_firstFrame + Capacity <= frame || m_timeStamps[window.m_firstFrame % Capacity] < startTime))
+			{
+				updateWindowSums(window, window.m_firstFrame, -1.0);
+				++window.m_firstFrame;
+			}
+		}
+	}
+
+	for (unsigned int j = 0; j < SkeletonJoint::NUM_JOINTS; ++j)
+	{
+		float* sample = getSample(frame, j);
+		sample[0] = positions[j].m_position.x;
+		sample[1] = positions[j].m_position.y;
+		sample[2] = positions[j].m_position.z;
+		sample[3] = positions[j].m_confidence;
+		sample = getSample(frame, j + SkeletonJoint::NUM_JOINTS);
+		sample[0] = localPositions[j].m_position.x;
+		sample[1] = localPositions[j].m_position.y;
+		sample[2] = localPositions[j].m_position.z;
+		sample[3] = localPositions[j].m_confidence;
+	}
+	m_timeStamps[frame % Capacity] = timeStamp;
+	++m_numAddedFrames;
+	if (m_numFrames < Capacity)
+		++m_numFrames;
+
+	for (unsigned int i = 0; i < m_windows.size(); ++i)
+	{
+		WindowState& window = m_windows[i];
+		if (++window.m_framesSinceRebuild >= Capacity)
+			rebuildWindow(window);
+		else
+			updateWindowSums(window, frame, 1.0);
+	}
+
+	// Changed trajectories are restarted, their buffers only change size when the recognizer set is loaded
+	if (m_trajectories.size() != trajectories.size())
+		m_trajectories.resize(trajectories.size());
+	for (unsigned int i = 0; i < m_trajectories.size(); ++i)
+	{
+		TrajectoryState& trajectory = m_trajectories[i];
+		if (trajectory.m_definition != trajectories[i])
+		{
+			trajectory.m_definition = trajectories[i];
+			unsigned int capacity = 2;
+			if (trajectory.m_definition.m_minSampleInterval > 0)
+				capacity += (unsigned int) ceil(trajectory.m_definition.m_duration / trajectory.m_definition.m_minSampleInterval);
+			trajectory.m_positions.resize(capacity);
+			trajectory.m_times.resize(capacity);
+			trajectory.m_firstSample = 0;
+			trajectory.m_numSamples = 0;
+		}
+		addTrajectorySample(trajectory, timeStamp, positions, localPositions);
+	}
+}
+
+void FubiJointHistory::addTrajectorySample(TrajectoryState& trajectory, double timeStamp,
+	const Fubi::SkeletonJointPosition* positions, const Fubi::SkeletonJointPosition* localPositions)
+{
+	const JointHistoryTrajectory& definition = trajectory.m_definition;
+	if (definition.m_joint >= SkeletonJoint::NUM_JOINTS)
+		return;
+	const SkeletonJointPosition* samples = definition.m_useLocalPositions ? localPositions : positions;
+	if (samples[definition.m_joint].m_confidence < definition.m_minConfidence)
+		return;
+	Vec3f position = samples[definition.m_joint].m_position;
+	if (definition.m_relJoint < SkeletonJoint::NUM_JOINTS)
+	{
+		if (samples[definition.m_relJoint].m_confidence < definition.m_minConfidence)
+			return;
+		position -= samples[definition.m_relJoint].m_position;
+	}
+
+	unsigned int capacity = (unsigned int) trajectory.m_times.size();
+	if (trajectory.m_numSamples > 0)
+	{
+		// The trajectory is restarted after a longer gap without confident samples
+		unsigned int last = (trajectory.m_firstSample + trajectory.m_numSamples - 1) % capacity;
+		if (timeStamp - trajectory.m_times[last] > std::max(definition.m_duration * 0.25, 0.1))
+			trajectory.m_numSamples = 0;
+		else if (trajectory.m_numSamples > 1
+			&& trajectory.m_times[last] - trajectory.m_times[(last + capacity - 1) % capacity] < definition.m_minSampleInterval)
+		{
+			// The newest sample is only kept once it is far enough from the previous one, until then it is moved
+			trajectory.m_positions[last] = position;
+			trajectory.m_times[last] = timeStamp;
+			return;
+		}
+	}
+
+	if (trajectory.m_numSamples == capacity)
+	{
+		trajectory.m_firstSample = (trajectory.m_firstSample + 1) % capacity;
+		trajectory.m_numSamples--;
+	}
+	unsigned int index = (trajectory.m_firstSample + trajectory.m_numSamples) % capacity;
+	trajectory.m_positions[index] = position;
+	trajectory.m_times[index] = timeStamp;
+	trajectory.m_numSamples++;
+}
+
+void FubiJointHistory::rebuildWindow(WindowState& window)
+{
+	// Relative to the newest frame, so the times stay small until the next rebuild
+	unsigned int newestFrame = m_numAddedFrames - 1;
+	window.m_referenceTime = m_timeStamps[newestFrame % Capacity];
+	window.m_framesSinceRebuild = 0;
+	for (unsigned int j = 0; j < NumSampledJoints; ++j)
+		window.m_sums[j].reset();
+
+	double startTime = window.m_referenceTime - window.m_definition.m_duration;
+	window.m_firstFrame = newestFrame;
+	while (window.m_firstFrame > m_numAddedFrames - m_numFrames && m_timeStamps[(window.m_firstFrame - 1) % Capacity] >= startTime)
+		--window.m_firstFrame;
+	for (unsigned int frame = window.m_firstFrame; frame <= newestFrame; ++frame)
+		updateWindowSums(window, frame, 1.0);
+}
+
+void FubiJointHistory::updateWindowSums(WindowState& window, unsigned int frame, double sign)
+{
+	const JointHistoryWindow& definition = window.m_definition;
+	double t = m_timeStamps[frame % Capacity] - window.m_referenceTime;
+	for (unsigned int j = 0; j < SkeletonJoint::NUM_JOINTS; ++j)
+	{
+		unsigned int bit = 1u << j;
+		if (definition.m_joints & bit)
+		{
+			const float* sample = getSample(frame, j);
+			if (sample[3] >= definition.m_minConfidence)
+				window.m_sums[j].add(t, sample, sign);
+		}
+		if (definition.m_localJoints & bit)
+		{
+			const float* sample = getSample(frame, j + SkeletonJoint::NUM_JOINTS);
+			if (sample[3] >= definition.m_minConfidence)
+				window.m_sums[j + SkeletonJoint::NUM_JOINTS].add(t, sample, sign);
+		}
+	}
+}
+
+Fubi::SkeletonJointPosition FubiJointHistory::getPosition(unsigned int age, Fubi::SkeletonJoint::Joint joint, bool useLocalPositions /*= false*/) const
+{
+	const float* sample = getSample(m_numAddedFrames - 1 - age, useLocalPositions ? (joint + SkeletonJoint::NUM_JOINTS) : joint);
+	return SkeletonJointPosition(Vec3f(sample[0], sample[1], sample[2]), sample[3]);
+}
+
+const FubiJointHistory::Sums* FubiJointHistory::getSums(unsigned int window, Fubi::SkeletonJoint::Joint joint, bool useLocalPositions) const
+{
+	if (window >= m_windows.size() || joint >= SkeletonJoint::NUM_JOINTS)
+		return 0x0;
+	// Only the requested joints are summed up
+	const JointHistoryWindow& definition = m_windows[window].m_definition;
+	if (((useLocalPositions ? definition.m_localJoints : definition.m_joints) & (1u << joint)) == 0)
+		return 0x0;
+	return &m_windows[window].m_sums[useLocalPositions ? (joint + SkeletonJoint::NUM_JOINTS) : joint];
+}
+
+bool FubiJointHistory::getVelocity(unsigned int window, Fubi::SkeletonJoint::Joint joint, bool useLocalPositions, Fubi::Vec3f& velocity) const
+{
+	const Sums* sums = getSums(window, joint, useLocalPositions);
+	if (sums == 0x0 || sums->m_count < 1.5)
+		return false;
+
+	double denominator = sums->m_count*sums->m_t2 - sums->m_t*sums->m_t;
+	if (denominator <= 1e-12)
+		return false;
+	velocity.x = (float) ((sums->m_count*sums->m_tp[0] - sums->m_t*sums->m_p[0]) / denominator);
+	velocity.y = (float) ((sums->m_count*sums->m_tp[1] - sums->m_t*sums->m_p[1]) / denominator);
+	velocity.z = (float) ((sums->m_count*sums->m_tp[2] - sums->m_t*sums->m_p[2]) / denominator);
+	return true;
+}
+
+bool FubiJointHistory::getAcceleration(unsigned int window, Fubi::SkeletonJoint::Joint joint, bool useLocalPositions, Fubi::Vec3f& acceleration) const
+{
+	const Sums* sums = getSums(window, joint, useLocalPositions);
+	if (sums == 0x0 || sums->m_count < 2.5)
+		return false;
+
+	// Normal equations of p = a + b*t + c*t^2, solved for c with Cramer's rule
+	const double n = sums->m_count, s1 = sums->m_t, s2 = sums->m_t2, s3 = sums->m_t3, s4 = sums->m_t4;
+	double determinant = n*(s2*s4 - s3*s3) - s1*(s1*s4 - s3*s2) + s2*(s1*s3 - s2*s2);
+	if (fabs(determinant) <= 1e-15)
+		return false;
+	float c[3];
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		const double p0 = sums->m_p[i], p1 = sums->m_tp[i], p2 = sums->m_t2p[i];
+		c[i] = (float) ((n*(s2*p2 - p1*s3) - s1*(s1*p2 - p1*s2) + p0*(s1*s3 - s2*s2)) / determinant);
+	}
+	acceleration = Vec3f(2.0f*c[0], 2.0f*c[1], 2.0f*c[2]);
+	return true;
+}
+
+bool FubiJointHistory::getDisplacement(unsigned int window, Fubi::SkeletonJoint::Joint joint, bool useLocalPositions, Fubi::Vec3f& displacement) const
+{
+	Vec3f velocity(Math::NO_INIT);
+	if (!getVelocity(window, joint, useLocalPositions, velocity))
+		return false;
+	double span = getTimeStamp(0) - m_timeStamps[m_windows[window].m_firstFrame % Capacity];
+	displacement = velocity * (float) span;
+	return true;
+}
+
+unsigned int FubiJointHistory::getNumTrajectorySamples(unsigned int trajectory) const
+{
+	return (trajectory < m_trajectories.size()) ? m_trajectories[trajectory].m_numSamples : 0;
+}
+
+const Fubi::Vec3f& FubiJointHistory::getTrajectoryPosition(unsigned int trajectory, unsigned int index) const
+{
+	const TrajectoryState& state = m_trajectories[trajectory];
+	return state.m_positions[(state.m_firstSample + index) % state.m_positions.size()];
+}
+
+double FubiJointHistory::getTrajectoryTime(unsigned int trajectory, unsigned int index) const
+{
+	const TrajectoryState& state = m_trajectories[trajectory];
+	return state.m_times[(state.m_firstSample + index) % state.m_times.size()];
+}
@@ -0,0 +1,185 @@
+// ****************************************************************************************
+//
+// Fubi Joint History
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#pragma once
+
+#include "FubiUtils.h"
+
+#include <vector>
+
+// A time window over which the joint history of every user keeps the movement of some joints
+struct JointHistoryWindow
+{
+	JointHistoryWindow(double duration = 0, float minConfidence = 0) : m_duration(duration), m_minConfidence(minConfidence), m_joints(0), m_localJoints(0) {}
+
+	bool operator==(const JointHistoryWindow& other) const
+	{
+		return m_duration == other.m_duration && m_minConfidence == other.m_minConfidence
+			&& m_joints == other.m_joints && m_localJoints == other.m_localJoints;
+	}
+	bool operator!=(const JointHistoryWindow& other) const { return !(*this == other); }
+
+	// Length of the window in seconds
+	double m_duration;
+	// Samples of a joint with a lower confidence are left out
+	float m_minConfidence;
+	// Joints (one bit per joint) of which the global or local positions are used
+	unsigned int m_joints, m_localJoints;
+};
+
+// A trajectory of a joint relative to another one that the joint history of every user keeps for some seconds
+// Its samples are at least a minimum interval apart (apart from the newest one), so it covers the duration at any frame rate
+struct JointHistoryTrajectory
+{
+	JointHistoryTrajectory(Fubi::SkeletonJoint::Joint joint = Fubi::SkeletonJoint::NUM_JOINTS, Fubi::SkeletonJoint::Joint relJoint = Fubi::SkeletonJoint::NUM_JOINTS,
+		bool useLocalPositions = false, float minConfidence = 0, double duration = 0, double minSampleInterval = 0)
+		: m_joint(joint), m_relJoint(relJoint), m_useLocalPositions(useLocalPositions), m_minConfidence(minConfidence),
+		  m_duration(duration), m_minSampleInterval(minSampleInterval) {}
+
+	bool operator==(const JointHistoryTrajectory& other) const
+	{
+		return m_joint == other.m_joint && m_relJoint == other.m_relJoint && m_useLocalPositions == other.m_useLocalPositions
+			&& m_minConfidence == other.m_minConfidence && m_duration == other.m_duration && m_minSampleInterval == other.m_minSampleInterval;
+	}
+	bool operator!=(const JointHistoryTrajectory& other) const { return !(*this == other); }
+
+	Fubi::SkeletonJoint::Joint m_joint;
+	// NUM_JOINTS for absolute positions
+	Fubi::SkeletonJoint::Joint m_relJoint;
+	bool m_useLocalPositions;
+	// Frames in which one of the joints has a lower confidence are left out
+	float m_minConfidence;
+	// Length of the trajectory and minimum time between two samples in seconds
+	double m_duration, m_minSampleInterval;
+};
+
+// All windows and trajectories requested by the recognizers of the loaded recognizer set
+class JointHistoryWindows
+{
+public:
+	// Adds the joint to a window with the given duration and confidence and returns its index
+	unsigned int addWindow(double duration, float minConfidence, Fubi::SkeletonJoint::Joint joint, bool useLocalPositions);
+	// Adds the trajectory if there is no equal one yet and returns its index
+	unsigned int addTrajectory(const JointHistoryTrajectory& trajectory);
+
+	void clear() { m_windows.clear(); m_trajectories.clear(); }
+
+	const std::vector<JointHistoryWindow>& getWindows() const { return m_windows; }
+	const std::vector<JointHistoryTrajectory>& getTrajectories() const { return m_trajectories; }
+
+private:
+	std::vector<JointHistoryWindow> m_windows;
+	std::vector<JointHistoryTrajectory> m_trajectories;
+};
+
+// The joint positions of the last frames of a user in a ring buffer with a fixed capacity.
+// For every requested window, running sums of the samples inside it are updated with each frame,
+// so velocity, acceleration and displacement over the window are available in constant time.
+// The requested trajectories are sampled with every frame as well, but have their own buffers as they may be longer than the capacity.
+class FubiJointHistory
+{
+public:
+	// Number of frames kept, windows are cut to these frames
+	static const unsigned int Capacity = 128;
+
+	FubiJointHistory();
+
+	// Adds the positions of a new frame and updates the running sums of the windows and the trajectories
+	// A frame with the same time stamp as the last one is ignored, an older one restarts the history
+	void addFrame(double timeStamp, const Fubi::SkeletonJointPosition* positions, const Fubi::SkeletonJointPosition* localPositions,
+		const std::vector<JointHistoryWindow>& windows, const std::vector<JointHistoryTrajectory>& trajectories);
+
+	// Removes all frames
+	void clear();
+
+	unsigned int getNumFrames() const { return m_numFrames; }
+	// Position of a joint in an older frame (age 0 is the newest one), age has to be less than getNumFrames()
+	Fubi::SkeletonJointPosition getPosition(unsigned int age, Fubi::SkeletonJoint::Joint joint, bool useLocalPositions = false) const;
+	double getTimeStamp(unsigned int age) const { return m_timeStamps[(m_numAddedFrames - 1 - age) % Capacity]; }
+
+	// Movement of a joint within a window, all return false if there are not enough samples
+	// Velocity of the least squares line through the samples (at least two)
+	bool getVelocity(unsigned int window, Fubi::SkeletonJoint::Joint joint, bool useLocalPositions, Fubi::Vec3f& velocity) const;
+	// Acceleration of the least squares parabola through the samples (at least three)
+	bool getAcceleration(unsigned int window, Fubi::SkeletonJoint::Joint joint, bool useLocalPositions, Fubi::Vec3f& acceleration) const;
+	// Movement along the least squares line from the oldest to the newest frame inside the window
+	bool getDisplacement(unsigned int window, Fubi::SkeletonJoint::Joint joint, bool useLocalPositions, Fubi::Vec3f& displacement) const;
+
+	// Samples of a trajectory from the oldest (index 0) to the newest one, index has to be less than getNumTrajectorySamples()
+	unsigned int getNumTrajectorySamples(unsigned int trajectory) const;
+	const Fubi::Vec3f& getTrajectoryPosition(unsigned int trajectory, unsigned int index) const;
+	double getTrajectoryTime(unsigned int trajectory, unsigned int index) const;
+
+private:
+	// Global joints are followed by the local ones
+	static const unsigned int NumSampledJoints = 2 * Fubi::SkeletonJoint::NUM_JOINTS;
+
+	// Sums over the samples of one joint inside a window, times are relative to the reference time of the window
+	struct Sums
+	{
+		Sums() { reset(); }
+		void reset();
+		void add(double t, const float* position, double sign);
+
+		double m_count, m_t, m_t2, m_t3, m_t4;
+		double m_p[3], m_tp[3], m_t2p[3];
+	};
+
+	struct WindowState
+	{
+		// Rebuilt with the first frame
+		WindowState() : m_firstFrame(0), m_referenceTime(0), m_framesSinceRebuild(Capacity) {}
+
+		JointHistoryWindow m_definition;
+		// Absolute index of the oldest frame inside the window
+		unsigned int m_firstFrame;
+		double m_referenceTime;
+		// The sums are recalculated from scratch regularly so the rounding errors of removing samples can not add up
+		unsigned int m_framesSinceRebuild;
+		Sums m_sums[NumSampledJoints];
+	};
+
+	struct TrajectoryState
+	{
+		TrajectoryState() : m_firstSample(0), m_numSamples(0) {}
+
+		JointHistoryTrajectory m_definition;
+		// Ring buffer sized for the duration when the definition is set
+		std::vector<Fubi::Vec3f> m_positions;
+		std::vector<double> m_times;
+		unsigned int m_firstSample, m_numSamples;
+	};
+
+	float* getSample(unsigned int frame, unsigned int sampledJoint) { return m_samples + (sampledJoint * Capacity + frame % Capacity) * 4; }
+	const float* getSample(unsigned int frame, unsigned int sampledJoint) const { return m_samples + (sampledJoint * Capacity + frame % Capacity) * 4; }
+
+	// The samples point into the own storage
+	FubiJointHistory(const FubiJointHistory& other);
+	FubiJointHistory& operator=(const FubiJointHistory& other);
+
+	// Recalculate the sums of a window from the frames inside it
+	void rebuildWindow(WindowState& window);
+	// Add or remove the samples of a frame to the sums of a window
+	void updateWindowSums(WindowState& window, unsigned int frame, double sign);
+	const Sums* getSums(unsigned int window, Fubi::SkeletonJoint::Joint joint, bool useLocalPositions) const;
+	// Add the joint positions of a frame to a trajectory if they are confident enough
+	void addTrajectorySample(TrajectoryState& trajectory, double timeStamp, const Fubi::SkeletonJointPosition* positions, const Fubi::SkeletonJointPosition* localPositions);
+
+	// Samples as x, y, z, confidence, stored joint by joint with the frames of each joint in a row and aligned to cache lines
+	std::vector<float> m_sampleStorage;
+	float* m_samples;
+	double m_timeStamps[Capacity];
+	// Frames added since the last clear, the newest one has index m_numAddedFrames-1
+	unsigned int m_numAddedFrames;
+	unsigned int m_numFrames;
+
+	std::vector<WindowState> m_windows;
+	std::vector<TrajectoryState> m_trajectories;
+};
@@ -0,0 +1,243 @@
+// ****************************************************************************************
+//
+// Fubi Local Transformations
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#include "FubiLocalTransformations.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FUBI_LOCAL_TRANSFORMATIONS_SSE
+#include <emmintrin.h>
+#endif
+
+using namespace Fubi;
+
+namespace
+{
+	const unsigned int BlockSize = 4;
+	// Only the joints of the skeleton layout are calculated
+	const unsigned int NumPaddedJoints = ((Skeleton::NumLayoutJoints + BlockSize - 1) / BlockSize) * BlockSize;
+
+	// Joints of the whole block the joint belongs to
+	inline unsigned int blockBits(unsigned int joint)
+	{
+		return ((1u << BlockSize) - 1) << (joint / BlockSize * BlockSize);
+	}
+
+	// Gathers the transformations of the joints and the orientations of their parents, one joint per lane
+	// Only the blocks with at least one of the given joints are gathered
+	struct Gatherer
+	{
+		Gatherer(const SkeletonJointPosition* positions, const SkeletonJointOrientation* orientations, unsigned int joints,
+			float (*rot)[NumPaddedJoints], float (*parentRot)[NumPaddedJoints], float* rotConfidence, float* parentConfidence,
+			float* x, float* y, float* z, float* confidence)
+			: m_positions(positions), m_orientations(orientations), m_joints(joints), m_rot(rot), m_parentRot(parentRot),
+			  m_rotConfidence(rotConfidence), m_parentConfidence(parentConfidence), m_x(x), m_y(y), m_z(z), m_confidence(confidence)
+		{}
+
+		template<SkeletonJoint::Joint J>
+		void visit()
+		{
+			if ((m_joints & blockBits(J)) == 0)
+				return;
+			const SkeletonJointOrientation& orient = m_orientations[J];
+			const SkeletonJointOrientation& parentOrient = m_orientations[Skeleton::Parents[J]];
+			for (unsigned int e = 0; e < 9; ++e)
+			{
+				m_rot[e][J] = orient.m_orientation.x[e];
+				m_parentRot[e][J] = parentOrient.m_orientation.x[e];
+			}
+			m_rotConfidence[J] = orient.m_confidence;
+			m_parentConfidence[J] = parentOrient.m_confidence;
+			const SkeletonJointPosition& pos = m_positions[J];
+			m_x[J] = pos.m_position.x;
+			m_y[J] = pos.m_position.y;
+			m_z[J] = pos.m_position.z;
+			m_confidence[J] = pos.m_confidence;
+		}
+
+		const SkeletonJointPosition* m_positions;
+		const SkeletonJointOrientation* m_orientations;
+		unsigned int m_joints;
+		float (*m_rot)[NumPaddedJoints];
+		float (*m_parentRot)[NumPaddedJoints];
+		float* m_rotConfidence;
+		float* m_parentConfidence;
+		float *m_x, *m_y, *m_z, *m_confidence;
+	};
+}
+
+void Fubi::calculateLocalTransformations(const SkeletonJointPosition* positions, const SkeletonJointOrientation* orientations,
+	SkeletonJointPosition* localPositions, SkeletonJointOrientation* localOrientations, const LocalTransformationJoints& joints /*= LocalTransformationJoints::all()*/)
+{
+	const unsigned int allJoints = joints.m_positionJoints | joints.m_orientationJoints;
+	if (allJoints == 0)
+		return;
+
+	// Gather the orientations of the joints and of their parents, the padding gets the identity
+	float rot[9][NumPaddedJoints], parentRot[9][NumPaddedJoints], localRot[9][NumPaddedJoints];
+	float rotConfidence[NumPaddedJoints], parentConfidence[NumPaddedJoints], localRotConfidence[NumPaddedJoints];
+	// Same for the positions, with the padding at the origin
+	float x[NumPaddedJoints], y[NumPaddedJoints], z[NumPaddedJoints], confidence[NumPaddedJoints];
+	float localX[NumPaddedJoints], localY[NumPaddedJoints], localZ[NumPaddedJoints], localConfidence[NumPaddedJoints];
+	Gatherer gatherer(positions, orientations, allJoints, rot, parentRot, rotConfidence, parentConfidence, x, y, z, confidence);
+	Skeleton::ForEachJoint<>::apply(gatherer);
+	for (unsigned int j = Skeleton::NumLayoutJoints; j < NumPaddedJoints; ++j)
+	{
+		for (unsigned int e = 0; e < 9; ++e)
+			rot[e][j] = parentRot[e][j] = (e % 4 == 0) ? 1.0f : 0;
+		rotConfidence[j] = parentConfidence[j] = 0;
+		x[j] = y[j] = z[j] = confidence[j] = 0;
+	}
+
+	// The inverted torso transformation is the same for all local positions, so it is calculated only once
+	Matrix4f inverseTorsoTrans;
+	float torsoConfidence = 0;
+	if (joints.m_positionJoints != 0)
+	{
+		const SkeletonJointPosition& torsoPos = positions[SkeletonJoint::TORSO];
+		const SkeletonJointOrientation& torsoRot = orientations[SkeletonJoint::TORSO];
+		Matrix4f torsoTrans(torsoRot.m_orientation);
+		torsoTrans.x[12] = torsoPos.m_position.x;
+		torsoTrans.x[13] = torsoPos.m_position.y;
+		torsoTrans.x[14] = torsoPos.m_position.z;
+		inverseTorsoTrans = torsoTrans.inverted();
+		torsoConfidence = minf(torsoPos.m_confidence, torsoRot.m_confidence);
+	}
+
+	// The operations are done in the same order as in Matrix3f and Matrix4f, so the results are exactly the same
+	for (unsigned int block = 0; block < NumPaddedJoints; block += BlockSize)
+	{
+		const bool rotationsNeeded = (joints.m_orientationJoints & blockBits(block)) != 0;
+		const bool positionsNeeded = (joints.m_positionJoints & blockBits(block)) != 0;
+#ifdef FUBI_LOCAL_TRANSFORMATIONS_SSE
+		if (rotationsNeeded)
+		{
+			// Parent rotation inverted as in Matrix3f::inverted(): transposed and divided by the determinant, identity if singular
+			__m128 c[9];
+			for (unsigned int e = 0; e < 9; ++e)
+				c[e] = _mm_loadu_ps(&parentRot[e][block]);
+			__m128 det = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_mul_ps(c[0], c[4]), c[8]),
+				_mm_mul_ps(_mm_mul_ps(c[1], c[5]), c[6])),
+				_mm_mul_ps(_mm_mul_ps(c[2], c[3]), c[7])),
+				_mm_mul_ps(_mm_mul_ps(c[2], c[4]), c[6])),
+				_mm_mul_ps(_mm_mul_ps(c[1], c[3]), c[8])),
+				_mm_mul_ps(_mm_mul_ps(c[0], c[5]), c[7]));
+			__m128 singular = _mm_cmpeq_ps(det, _mm_setzero_ps());
+			__m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+			__m128 inv[9];
+			for (unsigned int i = 0; i < 3; ++i)
+			{
+				for (unsigned int j = 0; j < 3; ++j)
+				{
+					__m128 identity = _mm_set1_ps((i == j) ? 1.0f : 0);
+					inv[i*3+j] = _mm_or_ps(_mm_and_ps(singular, identity), _mm_andnot_ps(singular, _mm_mul_ps(c[j*3+i], invDet)));
+				}
+			}
+
+			// Local rotation = rotation * inverted parent rotation
+			__m128 a[9];
+			for (unsigned int e = 0; e < 9; ++e)
+				a[e] = _mm_loadu_ps(&rot[e][block]);
+			for (unsigned int col = 0; col < 3; ++col)
+			{
+				for (unsigned int row = 0; row < 3; ++row)
+				{
+					_mm_storeu_ps(&localRot[col*3+row][block], _mm_add_ps(_mm_add_ps(
+						_mm_mul_ps(a[row], inv[col*3]),
+						_mm_mul_ps(a[3+row], inv[col*3+1])),
+						_mm_mul_ps(a[6+row], inv[col*3+2])));
+				}
+			}
+			_mm_storeu_ps(&localRotConfidence[block], _mm_min_ps(_mm_loadu_ps(&rotConfidence[block]), _mm_loadu_ps(&parentConfidence[block])));
+		}
+
+		if (positionsNeeded)
+		{
+			// Local position = inverted torso transformation * position
+			__m128 px = _mm_loadu_ps(&x[block]), py = _mm_loadu_ps(&y[block]), pz = _mm_loadu_ps(&z[block]);
+			float* localCoords[3] = { &localX[block], &localY[block], &localZ[block] };
+			for (unsigned int i = 0; i < 3; ++i)
+			{
+				__m128 coord = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(px, _mm_set1_ps(inverseTorsoTrans.c[0][i])),
+					_mm_mul_ps(py, _mm_set1_ps(inverseTorsoTrans.c[1][i]))),
+					_mm_mul_ps(pz, _mm_set1_ps(inverseTorsoTrans.c[2][i]))),
+					_mm_set1_ps(inverseTorsoTrans.c[3][i]));
+				_mm_storeu_ps(localCoords[i], coord);
+			}
+			_mm_storeu_ps(&localConfidence[block], _mm_min_ps(_mm_loadu_ps(&confidence[block]), _mm_set1_ps(torsoConfidence)));
+		}
+#else
+		for (unsigned int k = block; k < block + BlockSize; ++k)
+		{
+			if (rotationsNeeded)
+			{
+				float c[9];
+				for (unsigned int e = 0; e < 9; ++e)
+					c[e] = parentRot[e][k];
+				float det = c[0]*c[4]*c[8] + c[1]*c[5]*c[6] + c[2]*c[3]*c[7] - c[2]*c[4]*c[6] - c[1]*c[3]*c[8] - c[0]*c[5]*c[7];
+				float inv[9];
+				if (det == 0)
+				{
+					for (unsigned int e = 0; e < 9; ++e)
+						inv[e] = (e % 4 == 0) ? 1.0f : 0;
+				}
+				else
+				{
+					float invDet = 1.0f / det;
+					for (unsigned int i = 0; i < 3; ++i)
+						for (unsigned int j = 0; j < 3; ++j)
+							inv[i*3+j] = c[j*3+i] * invDet;
+				}
+
+				for (unsigned int col = 0; col < 3; ++col)
+					for (unsigned int row = 0; row < 3; ++row)
+						localRot[col*3+row][k] = rot[row][k] * inv[col*3] + rot[3+row][k] * inv[col*3+1] + rot[6+row][k] * inv[col*3+2];
+				localRotConfidence[k] = minf(rotConfidence[k], parentConfidence[k]);
+			}
+
+			if (positionsNeeded)
+			{
+				localX[k] = x[k] * inverseTorsoTrans.c[0][0] + y[k] * inverseTorsoTrans.c[1][0] + z[k] * inverseTorsoTrans.c[2][0] + inverseTorsoTrans.c[3][0];
+				localY[k] = x[k] * inverseTorsoTrans.c[0][1] + y[k] * inverseTorsoTrans.c[1][1] + z[k] * inverseTorsoTrans.c[2][1] + inverseTorsoTrans.c[3][1];
+				localZ[k] = x[k] * inverseTorsoTrans.c[0][2] + y[k] * inverseTorsoTrans.c[1][2] + z[k] * inverseTorsoTrans.c[2][2] + inverseTorsoTrans.c[3][2];
+				localConfidence[k] = minf(confidence[k], torsoConfidence);
+			}
+		}
+#endif
+	}
+
+	for (unsigned int j = 0; j < Skeleton::NumLayoutJoints; ++j)
+	{
+		const unsigned int bit = 1u << j;
+		if (joints.m_orientationJoints & bit)
+		{
+			SkeletonJointOrientation& localOrient = localOrientations[j];
+			for (unsigned int e = 0; e < 9; ++e)
+				localOrient.m_orientation.x[e] = localRot[e][j];
+			localOrient.m_confidence = localRotConfidence[j];
+		}
+		if (joints.m_positionJoints & bit)
+		{
+			SkeletonJointPosition& localPos = localPositions[j];
+			localPos.m_position.x = localX[j];
+			localPos.m_position.y = localY[j];
+			localPos.m_position.z = localZ[j];
+			localPos.m_confidence = localConfidence[j];
+		}
+	}
+
+	// Torso is the root, so its local transformation is the same as the global one
+	const unsigned int torsoBit = 1u << SkeletonJoint::TORSO;
+	if (joints.m_orientationJoints & torsoBit)
+		localOrientations[SkeletonJoint::TORSO] = orientations[SkeletonJoint::TORSO];
+	if (joints.m_positionJoints & torsoBit)
+		localPositions[SkeletonJoint::TORSO] = positions[SkeletonJoint::TORSO];
+}
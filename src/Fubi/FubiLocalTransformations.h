@@ -0,0 +1,57 @@
+// ****************************************************************************************
+//
+// Fubi Local Transformations
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#pragma once
+
+#include "FubiSkeleton.h"
+
+namespace Fubi
+{
+	// Joints (one bit per joint) of which the local positions and local orientations are needed
+	struct LocalTransformationJoints
+	{
+		LocalTransformationJoints(unsigned int positionJoints = 0, unsigned int orientationJoints = 0)
+			: m_positionJoints(positionJoints), m_orientationJoints(orientationJoints) {}
+
+		static LocalTransformationJoints all()
+		{
+			const unsigned int allJoints = (1u << SkeletonJoint::NUM_JOINTS) - 1;
+			return LocalTransformationJoints(allJoints, allJoints);
+		}
+
+		void addPosition(SkeletonJoint::Joint joint)
+		{
+			if (joint < SkeletonJoint::NUM_JOINTS)
+				m_positionJoints |= 1u << joint;
+		}
+		void addOrientation(SkeletonJoint::Joint joint)
+		{
+			if (joint < SkeletonJoint::NUM_JOINTS)
+				m_orientationJoints |= 1u << joint;
+		}
+		LocalTransformationJoints& operator|=(const LocalTransformationJoints& other)
+		{
+			m_positionJoints |= other.m_positionJoints;
+			m_orientationJoints |= other.m_orientationJoints;
+			return *this;
+		}
+		bool isEmpty() const { return (m_positionJoints | m_orientationJoints) == 0; }
+
+		unsigned int m_positionJoints, m_orientationJoints;
+	};
+
+	// Calculates the local orientations (relative to the parent joint, see Skeleton::Parents) and the local positions (relative to the torso)
+	// of the joints of the skeleton layout at once, with the same results as calculateLocalRotation() and calculateLocalPosition().
+	// The joints are processed in blocks of four in structure of arrays layout, using SSE2 if available.
+	// Only the given joints are written, blocks without any of them are skipped.
+	void calculateLocalTransformations(const SkeletonJointPosition* positions, const SkeletonJointOrientation* orientations,
+		SkeletonJointPosition* localPositions, SkeletonJointOrientation* localOrientations,
+		const LocalTransformationJoints& joints = LocalTransformationJoints::all());
+}
@@ -77,6 +77,7 @@ static nite::JointType JointToNiteJoint(const SkeletonJoint::Joint j)
 }
 
 FubiOpenNI2Sensor::FubiOpenNI2Sensor()
+	: m_trackingTimeStamp(-1), m_timeStampOffset(0), m_timeStampOffsetValid(false)
 {
 	m_options.m_type = SensorType::OPENNI2;
 	memset(m_skeletonStates, nite::SKELETON_NONE, Fubi::MaxUsers*sizeof(nite::SkeletonState));
@@ -264,6 +265,16 @@ void FubiOpenNI2Sensor::update()
 			return;
 		}
 
+		// Convert the device time stamp (microseconds) to our clock, resync after device resets or if the clocks drifted apart
+		double deviceTime = m_currentTrackerFrame.getTimestamp() / 1000000.0;
+		double now = Fubi::currentTime();
+		if (!m_timeStampOffsetValid || fabs(deviceTime + m_timeStampOffset - now) > 0.5)
+		{
+			m_timeStampOffset = now - deviceTime;
+			m_timeStampOffsetValid = true;
+		}
+		m_trackingTimeStamp = deviceTime + m_timeStampOffset;
+
 		const nite::Array<nite::UserData>& users = m_currentTrackerFrame.getUsers();
 		for (int i = 0; i < users.getSize(); ++i)
 		{
@@ -443,7 +454,7 @@ void FubiOpenNI2Sensor::getSkeletonJointData(unsigned int id, Fubi::SkeletonJoin
 				{
 					// Not tracked return the center of mass instead
 					// that should be independent of tracking state
-					user->m_lastTrackingData.jointPositions[SkeletonJoint::TORSO] = user->m_currentTrackingData.jointPositions[SkeletonJoint::TORSO];
+					user->getLastTrackingData().jointPositions[SkeletonJoint::TORSO] = user->getCurrentTrackingData().jointPositions[SkeletonJoint::TORSO];
 					const nite::Point3f& point = userData->getCenterOfMass();
 					position.m_confidence = 0.5f; // leave confidence at 0.5 as this is not really the wanted position
 					position.m_position.x = point.x;
@@ -58,6 +58,9 @@ public:
 	// Return realworld to projective according to openni sensor
 	virtual Fubi::Vec3f realWorldToProjective(const Fubi::Vec3f& realWorldVec);
 
+	// Get the time stamp of the current tracker frame converted to Fubi::currentTime()
+	virtual double getTrackingTimeStamp() { return m_trackingTimeStamp; }
+
 private:
 	// set the options according to the current OpenNI config
 	void updateOptions();
@@ -78,6 +81,11 @@ private:
 
 	// The openni streams
 	openni::VideoStream			m_depth, m_color, m_ir;
+
+	// Time stamp of the current tracker frame and the offset from device time to Fubi::currentTime()
+	double m_trackingTimeStamp;
+	double m_timeStampOffset;
+	bool m_timeStampOffsetValid;
 };
 
 #endif
\ No newline at end of file
@@ -22,10 +22,6 @@
 
 #include <map>
 
-#if !defined(WIN32) && !defined(_WINDOWS) && !defined(_WIN32)
-#define Sleep sleep
-#endif
-
 #define CHECK_RC(nRetVal, what)										\
 	if (nRetVal != XN_STATUS_OK)									\
 {																\
@@ -91,7 +87,7 @@ static XnSkeletonJoint JointToXNSkeletonJoint(const SkeletonJoint::Joint j)
 }
 
 FubiOpenNISensor::FubiOpenNISensor()
-	:  m_applyingUserEvents(false),	m_hUserCallbacks(0x0),	m_hPoseDetected(0x0), m_hOutOfPose(0x0),
+	:  m_hUserCallbacks(0x0),	m_hPoseDetected(0x0), m_hOutOfPose(0x0),
 	m_hCalibrationStart(0x0), m_hCalibrationComplete(0x0), m_hExitUser(0x0), m_hReenterUser(0x0)
 {
 	m_strPose[0] = '\0';
@@ -476,65 +472,44 @@ void XN_CALLBACK_TYPE FubiOpenNISensor::CbNewUser(xn::UserGenerator& generator,
 	if (pCookie != 0x0)
 	{
 		FubiOpenNISensor* sensor = (FubiOpenNISensor*)pCookie;
-
-		while(sensor->m_applyingUserEvents)
-		{
-			// Wait until users are updated
-			Sleep(5);
-		}
-
-		sensor->m_newUsers.push_back(nId);
+		sensor->pushUserEvent(UserEvent::NEW_USER, nId);
 	}
 }
 
 void FubiOpenNISensor::applyUserEvents()
 {
-	m_applyingUserEvents = true;
-
-	// Update exited users
-	while (!m_exitUsers.empty())
+	// Apply the events in the order they happened
+	UserEvent event;
+	while (popUserEvent(event))
 	{
-		unsigned int nId = m_exitUsers.back();
-		m_exitUsers.pop_back();
-
-		FubiUser* user = Fubi::getUser(nId);
-		if (user)
+		if (event.m_type == UserEvent::NEW_USER)
 		{
-			user->m_inScene = false;
+			// Start calibration for new ones
+			startCalibration(event.m_id);
 		}
-	}
-
-	// And reentered ones
-	while (!m_reenteredUsers.empty())
-	{
-		unsigned int nId = m_reenteredUsers.back();
-		m_reenteredUsers.pop_back();
-
-		FubiUser* user = Fubi::getUser(nId);
-		if (user)
+		else
 		{
-			user->m_inScene = true;
+			// Update exited and reentered users
+			FubiUser* user = Fubi::getUser(event.m_id);
+			if (user)
+			{
+				user->m_inScene = (event.m_type == UserEvent::REENTER_USER);
+			}
 		}
 	}
+}
 
-	// And start calibration for new ones
-	while (!m_newUsers.empty())
+void FubiOpenNISensor::startCalibration(unsigned int id)
+{
+	// No calibration was loaded so we have to perform it
+	if (m_UserGenerator.GetSkeletonCap().NeedPoseForCalibration())
 	{
-		unsigned int nId = m_newUsers.back();
-		m_newUsers.pop_back();
-
-		// No calibration was loaded so we have to perform it
-		if (m_UserGenerator.GetSkeletonCap().NeedPoseForCalibration())
-		{
-			m_UserGenerator.GetPoseDetectionCap().StartPoseDetection(m_strPose, nId);
-		}
-		else
-		{
-			m_UserGenerator.GetSkeletonCap().RequestCalibration(nId, TRUE);
-		}
+		m_UserGenerator.GetPoseDetectionCap().StartPoseDetection(m_strPose, id);
+	}
+	else
+	{
+		m_UserGenerator.GetSkeletonCap().RequestCalibration(id, TRUE);
 	}
-
-	m_applyingUserEvents = false;
 }
 
 // Callback: An existing user was lost
@@ -551,14 +526,7 @@ void XN_CALLBACK_TYPE FubiOpenNISensor::CbExitUser(xn::UserGenerator& generator,
 	if (pCookie != 0x0)
 	{
 		FubiOpenNISensor* sensor = (FubiOpenNISensor*)pCookie;
-
-		while(sensor->m_applyingUserEvents)
-		{
-			// Wait until users are updated
-			Sleep(5);
-		}
-
-		sensor->m_exitUsers.push_back(nId);
+		sensor->pushUserEvent(UserEvent::EXIT_USER, nId);
 	}
 }
 
@@ -570,14 +538,7 @@ void XN_CALLBACK_TYPE FubiOpenNISensor::CbReenterUser(xn::UserGenerator& generat
 	if (pCookie != 0x0)
 	{
 		FubiOpenNISensor* sensor = (FubiOpenNISensor*)pCookie;
-
-		while(sensor->m_applyingUserEvents)
-		{
-			// Wait until users are updated
-			Sleep(10);
-		}
-
-		sensor->m_reenteredUsers.push_back(nId);
+		sensor->pushUserEvent(UserEvent::REENTER_USER, nId);
 	}
 }
 
@@ -693,7 +654,7 @@ void FubiOpenNISensor::getSkeletonJointData(unsigned int id, Fubi::SkeletonJoint
 		{
 			// Not tracked return the center of mass instead
 			// that should be independent of tracking state
-			user->m_lastTrackingData.jointPositions[SkeletonJoint::TORSO] = user->m_currentTrackingData.jointPositions[SkeletonJoint::TORSO];
+			user->getLastTrackingData().jointPositions[SkeletonJoint::TORSO] = user->getCurrentTrackingData().jointPositions[SkeletonJoint::TORSO];
 			XnPoint3D com;
 			m_UserGenerator.GetCoM(user->m_id, com);
 			position.m_confidence = 0.5f; // leave confidence at 0.5 as this is not really the wanted position
@@ -795,7 +756,8 @@ Fubi::Vec3f FubiOpenNISensor::realWorldToProjective(const Fubi::Vec3f& realWorld
 void FubiOpenNISensor::resetTracking(unsigned int id)
 {
 	m_UserGenerator.GetSkeletonCap().Reset(id);
-	m_newUsers.push_back(id);
+	// Called on the updating side, so calibrate directly instead of queueing it like the driver callbacks
+	startCalibration(id);
 }
 
 #endif
\ No newline at end of file
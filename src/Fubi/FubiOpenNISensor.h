@@ -17,8 +17,6 @@
 #include "FubiISensor.h"
 #include <XnCppWrapper.h>
 
-#include <vector>
-
 // The FubiOpenNISensor class is responsible for all OpenNI stuff
 class FubiOpenNISensor : public FubiISensor
 {
@@ -67,6 +65,9 @@ private:
 	// Checks for new users and starts the tracking/calibration process
 	void applyUserEvents();
 
+	// Starts the pose detection or calibration of a user
+	void startCalibration(unsigned int id);
+
 	// Create a mock depth generator with given options, returns true if succesfull
 	bool createMockDepth(const Fubi::StreamOptions& options);
 
@@ -91,12 +92,6 @@ private:
 	// Callback: Finished calibration
 	static void XN_CALLBACK_TYPE CbCalibrationComplete(xn::SkeletonCapability& capability, unsigned int user, XnCalibrationStatus calibrationStatus, void* pCookie);
 
-	// New users
-	std::vector<unsigned int> m_newUsers;
-	std::vector<unsigned int> m_exitUsers;
-	std::vector<unsigned int> m_reenteredUsers;
-	bool m_applyingUserEvents;
-
 	// Calibration pose name as requested by the openni user generator
 	char m_strPose[20];
 
@@ -0,0 +1,172 @@
+// ****************************************************************************************
+//
+// Fubi Profiler
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+
+#include "FubiProfiler.h"
+
+#include "FubiUtils.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+using namespace Fubi;
+
+std::atomic<bool> FubiProfiler::s_enabled(false);
+FubiProfiler::Histogram FubiProfiler::s_histograms[ProfilingStage::NUM_STAGES];
+
+unsigned long long FubiProfiler::now()
+{
+	return (unsigned long long) std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+unsigned int FubiProfiler::getBucket(unsigned long long duration)
+{
+	const unsigned long long numSubBuckets = 1ull << s_subBucketBits;
+	if (duration < numSubBuckets)
+		return (unsigned int) duration;
+
+	// Position of the highest set bit decides the power of two, the following bits the sub bucket
+	unsigned int highestBit = s_subBucketBits;
+	while ((duration >> (highestBit+1)) != 0)
+		++highestBit;
+	unsigned int subBucket = (unsigned int) ((duration >> (highestBit - s_subBucketBits)) & (numSubBuckets-1));
+	return ((highestBit - s_subBucketBits + 1) << s_subBucketBits) + subBucket;
+}
+
+unsigned long long FubiProfiler::getBucketCenter(unsigned int bucket)
+{
+	const unsigned int numSubBuckets = 1u << s_subBucketBits;
+	if (bucket < numSubBuckets)
+		return bucket;
+
+	unsigned int shift = (bucket >> s_subBucketBits) - 1;
+	unsigned long long lowerBound = ((unsigned long long) (numSubBuckets + (bucket & (numSubBuckets-1)))) << shift;
+	return lowerBound + ((1ull << shift) >> 1);
+}
+
+void FubiProfiler::addSample(ProfilingStage::Stage stage, unsigned long long duration)
+{
+	if (stage >= ProfilingStage::NUM_STAGES)
+		return;
+
+	Histogram& histogram = s_histograms[stage];
+	histogram.m_buckets[getBucket(duration)].fetch_add(1, std::memory_order_relaxed);
+	histogram.m_sum.fetch_add(duration, std::memory_order_relaxed);
+	unsigned long long currentMax = histogram.m_max.load(std::memory_order_relaxed);
+	while (duration > currentMax
+		&& !histogram.m_max.compare_exchange_weak(currentMax, duration, std::memory_order_relaxed))
+	{
+	}
+}
+
+bool FubiProfiler::getStats(ProfilingStage::Stage stage, ProfilingStats& stats)
+{
+	stats = ProfilingStats();
+	if (stage >= ProfilingStage::NUM_STAGES)
+		return false;
+
+	// Take a copy first, samples may be added concurrently
+	Histogram& histogram = s_histograms[stage];
+	static const unsigned int numPercentiles = 3;
+	const double percentiles[numPercentiles] = { 0.5, 0.95, 0.99 };
+	unsigned int counts[s_numBuckets];
+	unsigned long long numSamples = 0;
+	for (unsigned int i = 0; i < s_numBuckets; ++i)
+	{
+		counts[i] = histogram.m_buckets[i].load(std::memory_order_relaxed);
+		numSamples += counts[i];
+	}
+	if (numSamples == 0)
+		return false;
+	unsigned long long sum = histogram.m_sum.load(std::memory_order_relaxed);
+	unsigned long long maxDuration = histogram.m_max.load(std::memory_order_relaxed);
+
+	double results[numPercentiles] = { 0, 0, 0 };
+	unsigned int currentPercentile = 0;
+	unsigned long long samplesSoFar = 0;
+	for (unsigned int i = 0; i < s_numBuckets && currentPercentile < numPercentiles; ++i)
+	{
+		samplesSoFar += counts[i];
+		while (currentPercentile < numPercentiles && samplesSoFar >= percentiles[currentPercentile] * numSamples)
+		{
+			// Bucket centers may lie above the exact maximum
+			unsigned long long center = getBucketCenter(i);
+			results[currentPercentile] = (double) ((center < maxDuration) ? center : maxDuration);
+			++currentPercentile;
+		}
+	}
+
+	const double nsToMs = 1.0e-6;
+	stats.m_numSamples = (unsigned int) numSamples;
+	stats.m_mean = nsToMs * sum / numSamples;
+	stats.m_p50 = nsToMs * results[0];
+	stats.m_p95 = nsToMs * results[1];
+	stats.m_p99 = nsToMs * results[2];
+	stats.m_max = nsToMs * maxDuration;
+	return true;
+}
+
+void FubiProfiler::reset()
+{
+	for (unsigned int stage = 0; stage < ProfilingStage::NUM_STAGES; ++stage)
+	{
+		Histogram& histogram = s_histograms[stage];
+		for (unsigned int i = 0; i < s_numBuckets; ++i)
+			histogram.m_buckets[i].store(0, std::memory_order_relaxed);
+		histogram.m_sum.store(0, std::memory_order_relaxed);
+		histogram.m_max.store(0, std::memory_order_relaxed);
+	}
+}
+
+bool FubiProfiler::dumpToFile(const char* fileName)
+{
+	std::ofstream file(fileName);
+	if (!file.is_open())
+	{
+		Fubi_logErr("Could not open file \"%s\" for writing the profiling stats\n", fileName);
+		return false;
+	}
+
+	file << "stage\tsamples\tmean_ms\tp50_ms\tp95_ms\tp99_ms\tmax_ms" << std::endl;
+	file << std::fixed << std::setprecision(4);
+	for (unsigned int stage = 0; stage < ProfilingStage::NUM_STAGES; ++stage)
+	{
+		ProfilingStats stats;
+		getStats((ProfilingStage::Stage) stage, stats);
+		file << getStageName((ProfilingStage::Stage) stage) << "\t" << stats.m_numSamples << "\t" << stats.m_mean
+			<< "\t" << stats.m_p50 << "\t" << stats.m_p95 << "\t" << stats.m_p99 << "\t" << stats.m_max << std::endl;
+	}
+	return file.good();
+}
+
+const char* FubiProfiler::getStageName(ProfilingStage::Stage stage)
+{
+	switch (stage)
+	{
+	case ProfilingStage::SENSOR_UPDATE:
+		return "sensorUpdate";
+	case ProfilingStage::UPDATE_USERS:
+		return "updateUsers";
+	case ProfilingStage::LOCAL_TRANSFORMATIONS:
+		return "localTransformations";
+	case ProfilingStage::COMBINATION_RECOGNIZERS:
+		return "combinationRecognizers";
+	case ProfilingStage::FINGER_COUNT:
+		return "fingerCount";
+	case ProfilingStage::GET_IMAGE:
+		return "getImage";
+	case ProfilingStage::OSC_SEND:
+		return "oscSend";
+	default:
+		return "unknown";
+	}
+}
@@ -0,0 +1,127 @@
+// ****************************************************************************************
+//
+// Fubi Profiler
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#pragma once
+
+#include <atomic>
+
+namespace Fubi
+{
+	/**
+	* \brief Parts of a tracking frame whose durations can be measured by the profiler
+	*/
+	struct ProfilingStage
+	{
+		enum Stage
+		{
+			/** FubiISensor::update(), i.e. waiting for and reading the sensor data **/
+			SENSOR_UPDATE = 0,
+			/** FubiCore::updateUsers() including all per user stages below **/
+			UPDATE_USERS,
+			/** FubiUser::calculateLocalTransformations() for one user **/
+			LOCAL_TRANSFORMATIONS,
+			/** FubiUser::updateCombinationRecognizers() for one user **/
+			COMBINATION_RECOGNIZERS,
+			/** FubiUser::updateFingerCount() for one user **/
+			FINGER_COUNT,
+			/** FubiImageProcessing::getImage() **/
+			GET_IMAGE,
+			/** Building and sending the OSC messages of one recognized combination **/
+			OSC_SEND,
+			NUM_STAGES
+		};
+	};
+
+	/**
+	* \brief Latency distribution of one profiling stage, all durations in milliseconds
+	*/
+	struct ProfilingStats
+	{
+		ProfilingStats() : m_numSamples(0), m_mean(0), m_p50(0), m_p95(0), m_p99(0), m_max(0)
+		{}
+		unsigned int m_numSamples;
+		double m_mean;
+		double m_p50;
+		double m_p95;
+		double m_p99;
+		double m_max;
+	};
+}
+
+// Collects the durations of the profiling stages in lock-free histograms.
+// Samples can be added concurrently from any thread. While disabled, a FubiProfileScope only costs one relaxed atomic load.
+class FubiProfiler
+{
+public:
+	// Start or stop collecting samples, collected samples are kept until reset() is called
+	static void enable(bool enable) { s_enabled.store(enable, std::memory_order_relaxed); }
+	static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+	// Time in nanoseconds from a monotonic clock
+	static unsigned long long now();
+
+	// Adds one measured duration in nanoseconds to the histogram of the given stage
+	static void addSample(Fubi::ProfilingStage::Stage stage, unsigned long long duration);
+
+	// Percentiles of the samples collected so far, returns false if there are none
+	// The percentiles are accurate to about 6% (8 histogram buckets per power of two)
+	static bool getStats(Fubi::ProfilingStage::Stage stage, Fubi::ProfilingStats& stats);
+
+	// Discards all collected samples
+	static void reset();
+
+	// Writes the stats of all stages as a table to the given file
+	static bool dumpToFile(const char* fileName);
+
+	static const char* getStageName(Fubi::ProfilingStage::Stage stage);
+
+private:
+	// 8 linear buckets for 0-7ns, then 8 buckets per power of two up to 2^64ns
+	static const unsigned int s_subBucketBits = 3;
+	static const unsigned int s_numBuckets = (64 - s_subBucketBits + 1) << s_subBucketBits;
+
+	struct Histogram
+	{
+		std::atomic<unsigned int> m_buckets[s_numBuckets];
+		std::atomic<unsigned long long> m_sum;
+		std::atomic<unsigned long long> m_max;
+	};
+
+	static unsigned int getBucket(unsigned long long duration);
+	static unsigned long long getBucketCenter(unsigned int bucket);
+
+	static std::atomic<bool> s_enabled;
+	static Histogram s_histograms[Fubi::ProfilingStage::NUM_STAGES];
+};
+
+// Measures the time from construction to destruction for the given stage if the profiler is enabled
+class FubiProfileScope
+{
+public:
+	FubiProfileScope(Fubi::ProfilingStage::Stage stage)
+		: m_stage(stage), m_active(FubiProfiler::isEnabled()), m_start(0)
+	{
+		if (m_active)
+			m_start = FubiProfiler::now();
+	}
+	~FubiProfileScope()
+	{
+		if (m_active)
+			FubiProfiler::addSample(m_stage, FubiProfiler::now() - m_start);
+	}
+
+private:
+	FubiProfileScope(const FubiProfileScope&);
+	FubiProfileScope& operator=(const FubiProfileScope&);
+
+	Fubi::ProfilingStage::Stage m_stage;
+	bool m_active;
+	unsigned long long m_start;
+};
@@ -23,6 +23,9 @@
 // And linear gesture recognizers
 #include "GestureRecognizer/LinearMovementRecognizer.h"
 
+// Trajectory recognizers
+#include "GestureRecognizer/TrajectoryRecognizer.h"
+
 // And finger count recognizers
 #include "GestureRecognizer/FingerCountRecognizer.h"
 
@@ -122,9 +125,10 @@ namespace Fubi
 		bool useLocalPositions /*= false*/,
 		float minConfidence /*= -1.0f*/,
 		float maxAngleDiff /*= 45.0f*/, 
-		bool useOnlyCorrectDirectionComponent /*= true*/)
+		bool useOnlyCorrectDirectionComponent /*= true*/,
+		float velocityWindow /*= 0*/)
 	{
-		return new LinearMovementRecognizer(joint, relJoint, direction, minVel, maxVel, useLocalPositions, minConfidence, maxAngleDiff, useOnlyCorrectDirectionComponent);
+		return new LinearMovementRecognizer(joint, relJoint, direction, minVel, maxVel, useLocalPositions, minConfidence, maxAngleDiff, useOnlyCorrectDirectionComponent, velocityWindow);
 	}
 
 	IGestureRecognizer* createRecognizer(Fubi::SkeletonJoint::Joint joint,
@@ -133,9 +137,24 @@ namespace Fubi
 		bool useLocalPositions /*= false*/,
 		float minConfidence /*= -1.0f*/,
 		float maxAngleDiff /*= 45.0f*/, 
-		bool useOnlyCorrectDirectionComponent /*= true*/)
+		bool useOnlyCorrectDirectionComponent /*= true*/,
+		float velocityWindow /*= 0*/)
+	{
+		return new LinearMovementRecognizer(joint, direction, minVel, maxVel, useLocalPositions, minConfidence, maxAngleDiff, useOnlyCorrectDirectionComponent, velocityWindow);
+	}
+
+	IGestureRecognizer* createRecognizer(SkeletonJoint::Joint joint, SkeletonJoint::Joint relJoint,
+		const std::vector<std::vector<Fubi::Vec3f> >& templates,
+		float duration /*= 1.0f*/, unsigned int numSamples /*= 32*/,
+		float warpingWindow /*= 0.1f*/, float maxDistance /*= Fubi::Math::MaxFloat*/,
+		bool useLocalPositions /*= false*/,
+		float minConfidence /*= -1.0f*/,
+		Fubi::BodyMeasurement::Measurement measuringUnit /*= Fubi::BodyMeasurement::NUM_MEASUREMENTS*/)
 	{
-		return new LinearMovementRecognizer(joint, direction, minVel, maxVel, useLocalPositions, minConfidence, maxAngleDiff, useOnlyCorrectDirectionComponent);
+		TrajectoryRecognizer* rec = new TrajectoryRecognizer(joint, relJoint, duration, numSamples, warpingWindow, maxDistance, useLocalPositions, minConfidence, measuringUnit);
+		for (unsigned int i = 0; i < templates.size(); ++i)
+			rec->addTemplate(templates[i]);
+		return rec;
 	}
 
 	IGestureRecognizer* createRecognizer(Fubi::SkeletonJoint::Joint handJoint /*= RIGHT_HAND*/,
@@ -47,14 +47,25 @@ namespace Fubi
 		bool useLocalPositions = false,
 		float minConfidence = -1.0f,
 		float maxAngleDiff = 45.0f, 
-		bool useOnlyCorrectDirectionComponent = true);
+		bool useOnlyCorrectDirectionComponent = true,
+		float velocityWindow = 0);
 	IGestureRecognizer* createRecognizer(SkeletonJoint::Joint joint,
 		const Fubi::Vec3f& direction, 
 		float minVel, float maxVel = Fubi::Math::MaxFloat,
 		bool useLocalPositions = false,
 		float minConfidence = -1.0f,
 		float maxAngleDiff = 45.0f, 
-		bool useOnlyCorrectDirectionComponent = true);
+		bool useOnlyCorrectDirectionComponent = true,
+		float velocityWindow = 0);
+
+	// Create a trajectory recognizer with the given templates (each at least two points)
+	IGestureRecognizer* createRecognizer(SkeletonJoint::Joint joint, SkeletonJoint::Joint relJoint,
+		const std::vector<std::vector<Fubi::Vec3f> >& templates,
+		float duration = 1.0f, unsigned int numSamples = 32,
+		float warpingWindow = 0.1f, float maxDistance = Fubi::Math::MaxFloat,
+		bool useLocalPositions = false,
+		float minConfidence = -1.0f,
+		Fubi::BodyMeasurement::Measurement measuringUnit = Fubi::BodyMeasurement::NUM_MEASUREMENTS);
 
 	// Create a finger count recognizer
 	IGestureRecognizer* createRecognizer(Fubi::SkeletonJoint::Joint handJoint = Fubi::SkeletonJoint::RIGHT_HAND,
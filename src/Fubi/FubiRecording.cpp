@@ -0,0 +1,476 @@
+// ****************************************************************************************
+//
+// Fubi Recording
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+
+#include "FubiRecording.h"
+
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+#if defined ( WIN32 ) || defined( _WINDOWS )
+#	include <Windows.h>
+#else
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif
+
+using namespace Fubi;
+using namespace Fubi::RecordingFormat;
+
+static const char s_fileMagic[8] = "FUBIREC";
+static const char s_indexMagic[4] = { 'F', 'I', 'D', 'X' };
+
+// Helper functions for the quantization of the joint data
+static inline short quantize(float value, float scale)
+{
+	float scaled = value * scale;
+	if (scaled > 32767.0f)
+		scaled = 32767.0f;
+	else if (scaled < -32767.0f)
+		scaled = -32767.0f;
+	return (short) floorf(scaled + 0.5f);
+}
+
+static inline unsigned char quantizeConfidence(float confidence)
+{
+	if (confidence < 0)
+		confidence = 0;
+	else if (confidence > 1.0f)
+		confidence = 1.0f;
+	return (unsigned char) floorf(confidence * ConfidenceScale + 0.5f);
+}
+
+static inline unsigned int getFrameSize(unsigned int numUsers, const RecordingInfo& info)
+{
+	unsigned int imageSize = info.m_depthWidth * info.m_depthHeight * sizeof(unsigned short);
+	unsigned int size = sizeof(FrameHeader) + numUsers * sizeof(UserRecord)
+		+ (info.m_hasDepthData ? imageSize : 0) + (info.m_hasUserLabelData ? imageSize : 0);
+	// Keep the next frame 8 byte aligned
+	return (size + 7) & ~7u;
+}
+
+// Missing images are written black
+static inline char* writeImage(char* dst, const std::vector<unsigned short>& image, unsigned int numPixels)
+{
+	if (image.size() == numPixels)
+		memcpy(dst, &image[0], numPixels * sizeof(unsigned short));
+	else
+		memset(dst, 0, numPixels * sizeof(unsigned short));
+	return dst + numPixels * sizeof(unsigned short);
+}
+
+FubiRecordingWriter::FubiRecordingWriter() : m_numFrames(0), m_numDroppedFrames(0),
+	m_writerThread(0x0), m_writerThreadRunning(false), m_writeFailed(false), m_numHandledFrames(0), m_filePos(0)
+{
+}
+
+FubiRecordingWriter::~FubiRecordingWriter()
+{
+	close();
+}
+
+bool FubiRecordingWriter::open(const char* fileName, const RecordingInfo& info)
+{
+	close();
+
+	m_file.open(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!m_file.is_open())
+	{
+		Fubi_logErr("Could not open recording file \"%s\" for writing!\n", fileName);
+		return false;
+	}
+
+	m_info = info;
+	if (info.m_depthWidth <= 0 || info.m_depthHeight <= 0)
+	{
+		// No valid resolution, so no images
+		m_info.m_hasDepthData = m_info.m_hasUserLabelData = false;
+	}
+
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.m_magic, s_fileMagic, sizeof(header.m_magic));
+	header.m_version = Version;
+	header.m_numJoints = SkeletonJoint::NUM_JOINTS;
+	header.m_depthWidth = m_info.m_depthWidth;
+	header.m_depthHeight = m_info.m_depthHeight;
+	header.m_flags = (m_info.m_hasDepthData ? HasDepthFlag : 0) | (m_info.m_hasUserLabelData ? HasUserLabelFlag : 0);
+	m_file.write((const char*) &header, sizeof(header));
+	if (!m_file.good())
+	{
+		Fubi_logErr("Could not write to recording file \"%s\"!\n", fileName);
+		m_file.close();
+		return false;
+	}
+
+	m_filePos = sizeof(header);
+	m_frameOffsets.clear();
+	m_numFrames = 0;
+	m_numDroppedFrames = 0;
+	m_numHandledFrames = 0;
+	m_writeFailed = false;
+	m_writerThreadRunning = true;
+	m_writerThread = new std::thread(&FubiRecordingWriter::writerThreadLoop, this);
+	return true;
+}
+
+bool FubiRecordingWriter::writeFrame(const RecordedFrame& frame)
+{
+	if (m_writerThread == 0x0)
+		return false;
+
+	Buffer* buffer = 0x0;
+	if (!m_freeBuffers.pop(buffer))
+	{
+		if (m_allBuffers.size() >= s_maxPendingFrames)
+		{
+			if (m_numDroppedFrames++ == 0)
+				Fubi_logWrn("Recording can't keep up with the sensor, dropping frames!\n");
+			return false;
+		}
+		buffer = new Buffer();
+		m_allBuffers.push_back(buffer);
+	}
+
+	// Encode the frame, the buffers keep their capacity so this only allocates for the first frames
+	const unsigned short numUsers = std::min<unsigned short>(frame.m_numUsers, MaxUsers);
+	buffer->resize(getFrameSize(numUsers, m_info));
+	char* dst = &(*buffer)[0];
+	memset(dst, 0, buffer->size());
+
+	FrameHeader* header = (FrameHeader*) dst;
+	header->m_size = (unsigned int) buffer->size();
+	header->m_index = m_numFrames;
+	header->m_timeStamp = frame.m_timeStamp;
+	header->m_numUsers = numUsers;
+
+	UserRecord* users = (UserRecord*) (header + 1);
+	for (unsigned short i = 0; i < numUsers; ++i)
+	{
+		const RecordedUser& user = frame.m_users[i];
+		users[i].m_id = user.m_id;
+		users[i].m_isTracked = user.m_isTracked ? 1 : 0;
+		for (unsigned int j = 0; j < SkeletonJoint::NUM_JOINTS; ++j)
+		{
+			JointRecord& joint = users[i].m_joints[j];
+			const SkeletonJointPosition& pos = user.m_positions[j];
+			joint.m_position[0] = quantize(pos.m_position.x, 1.0f);
+			joint.m_position[1] = quantize(pos.m_position.y, 1.0f);
+			joint.m_position[2] = quantize(pos.m_position.z, 1.0f);
+			joint.m_positionConfidence = quantizeConfidence(pos.m_confidence);
+			const SkeletonJointOrientation& rot = user.m_orientations[j];
+			Quaternion q = rot.m_orientation.getQuaternion();
+			joint.m_orientation[0] = quantize(q.x, OrientationScale);
+			joint.m_orientation[1] = quantize(q.y, OrientationScale);
+			joint.m_orientation[2] = quantize(q.z, OrientationScale);
+			joint.m_orientation[3] = quantize(q.w, OrientationScale);
+			joint.m_orientationConfidence = quantizeConfidence(rot.m_confidence);
+		}
+	}
+
+	char* images = (char*) (users + numUsers);
+	const unsigned int numPixels = m_info.m_depthWidth * m_info.m_depthHeight;
+	if (m_info.m_hasDepthData)
+		images = writeImage(images, frame.m_depthData, numPixels);
+	if (m_info.m_hasUserLabelData)
+		images = writeImage(images, frame.m_userLabelData, numPixels);
+
+	// There are never more buffers than places in the queue
+	m_pendingBuffers.push(buffer);
+	++m_numFrames;
+	m_wakeCondition.notify_one();
+	return true;
+}
+
+void FubiRecordingWriter::writerThreadLoop()
+{
+	while (m_writerThreadRunning)
+	{
+		writePendingFrames();
+
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		if (m_writerThreadRunning && m_pendingBuffers.empty())
+			m_wakeCondition.wait_for(lock, std::chrono::milliseconds(10));
+	}
+	writePendingFrames();
+}
+
+void FubiRecordingWriter::writePendingFrames()
+{
+	Buffer* buffer = 0x0;
+	while (m_pendingBuffers.pop(buffer))
+	{
+		if (!m_writeFailed)
+		{
+			m_frameOffsets.push_back(m_filePos);
+			m_file.write(&(*buffer)[0], buffer->size());
+			m_filePos += buffer->size();
+			if (!m_file.good())
+			{
+				Fubi_logErr("Writing the recording failed, following frames are lost!\n");
+				m_writeFailed = true;
+			}
+		}
+		m_freeBuffers.push(buffer);
+		++m_numHandledFrames;
+	}
+}
+
+void FubiRecordingWriter::flush()
+{
+	while (m_writerThread && m_numHandledFrames < m_numFrames)
+	{
+		m_wakeCondition.notify_one();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+void FubiRecordingWriter::close()
+{
+	if (m_writerThread == 0x0)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_writerThreadRunning = false;
+	}
+	m_wakeCondition.notify_one();
+	m_writerThread->join();
+	delete m_writerThread;
+	m_writerThread = 0x0;
+
+	if (!m_writeFailed)
+	{
+		// Frame index at the end
+		IndexTrailer trailer;
+		memset(&trailer, 0, sizeof(trailer));
+		trailer.m_indexOffset = m_filePos;
+		trailer.m_numFrames = (unsigned int) m_frameOffsets.size();
+		memcpy(trailer.m_magic, s_indexMagic, sizeof(trailer.m_magic));
+		if (!m_frameOffsets.empty())
+			m_file.write((const char*) &m_frameOffsets[0], m_frameOffsets.size() * sizeof(unsigned long long));
+		m_file.write((const char*) &trailer, sizeof(trailer));
+	}
+	m_file.close();
+
+	Buffer* buffer = 0x0;
+	while (m_freeBuffers.pop(buffer))
+	{
+	}
+	for (unsigned int i = 0; i < m_allBuffers.size(); ++i)
+		delete m_allBuffers[i];
+	m_allBuffers.clear();
+	m_frameOffsets.clear();
+}
+
+int FubiRecordingFrameView::findUser(unsigned int id) const
+{
+	for (unsigned short i = 0; i < m_header->m_numUsers; ++i)
+	{
+		if (m_users[i].m_id == id)
+			return i;
+	}
+	return -1;
+}
+
+void FubiRecordingFrameView::getSkeletonJointData(unsigned short userIndex, SkeletonJoint::Joint joint,
+	SkeletonJointPosition& position, SkeletonJointOrientation& orientation) const
+{
+	const JointRecord& record = m_users[userIndex].m_joints[joint];
+	position.m_position = Vec3f(record.m_position[0], record.m_position[1], record.m_position[2]);
+	position.m_confidence = record.m_positionConfidence / ConfidenceScale;
+
+	float x = record.m_orientation[0], y = record.m_orientation[1], z = record.m_orientation[2], w = record.m_orientation[3];
+	float length = sqrtf(x*x + y*y + z*z + w*w);
+	if (length > 0)
+		orientation.m_orientation = Matrix3f(Quaternion(x / length, y / length, z / length, w / length));
+	else
+		orientation.m_orientation = Matrix3f();
+	orientation.m_confidence = record.m_orientationConfidence / ConfidenceScale;
+}
+
+FubiRecordingReader::FubiRecordingReader() : m_data(0x0), m_size(0), m_numFrames(0), m_frameOffsets(0x0)
+#if defined ( WIN32 ) || defined( _WINDOWS )
+	, m_fileHandle(0x0), m_mappingHandle(0x0)
+#endif
+{
+}
+
+FubiRecordingReader::~FubiRecordingReader()
+{
+	close();
+}
+
+bool FubiRecordingReader::open(const char* fileName)
+{
+	close();
+
+	// Map the whole file
+#if defined ( WIN32 ) || defined( _WINDOWS )
+	HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, 0x0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0x0);
+	LARGE_INTEGER fileSize;
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize))
+	{
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+		Fubi_logErr("Could not open recording file \"%s\"!\n", fileName);
+		return false;
+	}
+	m_fileHandle = file;
+	m_size = fileSize.QuadPart;
+	if (m_size >= sizeof(FileHeader))
+	{
+		m_mappingHandle = CreateFileMappingA(file, 0x0, PAGE_READONLY, 0, 0, 0x0);
+		if (m_mappingHandle)
+			m_data = (const char*) MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+#else
+	int file = ::open(fileName, O_RDONLY);
+	struct stat fileStat;
+	if (file < 0 || fstat(file, &fileStat) != 0)
+	{
+		if (file >= 0)
+			::close(file);
+		Fubi_logErr("Could not open recording file \"%s\"!\n", fileName);
+		return false;
+	}
+	m_size = fileStat.st_size;
+	if (m_size >= sizeof(FileHeader))
+	{
+		void* data = mmap(0x0, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED)
+		{
+			m_data = (const char*) data;
+			// Recordings are mostly read from the beginning to the end
+			posix_madvise(data, m_size, POSIX_MADV_SEQUENTIAL);
+		}
+	}
+	// The mapping stays valid without the descriptor
+	::close(file);
+#endif
+
+	const FileHeader* header = (const FileHeader*) m_data;
+	if (m_data == 0x0 || memcmp(header->m_magic, s_fileMagic, sizeof(header->m_magic)) != 0)
+	{
+		Fubi_logErr("\"%s\" is not a Fubi recording!\n", fileName);
+		close();
+		return false;
+	}
+	if (header->m_version != Version || header->m_numJoints != SkeletonJoint::NUM_JOINTS)
+	{
+		Fubi_logErr("Recording \"%s\" has version %d with %d joints, but only version %d with %d joints is supported!\n",
+			fileName, header->m_version, header->m_numJoints, Version, SkeletonJoint::NUM_JOINTS);
+		close();
+		return false;
+	}
+	m_info.m_depthWidth = header->m_depthWidth;
+	m_info.m_depthHeight = header->m_depthHeight;
+	m_info.m_hasDepthData = (header->m_flags & HasDepthFlag) != 0;
+	m_info.m_hasUserLabelData = (header->m_flags & HasUserLabelFlag) != 0;
+	if ((m_info.m_hasDepthData || m_info.m_hasUserLabelData) && (m_info.m_depthWidth <= 0 || m_info.m_depthHeight <= 0))
+	{
+		Fubi_logErr("Damaged recording \"%s\": images without a valid resolution!\n", fileName);
+		close();
+		return false;
+	}
+
+	// Use the stored index if it is complete and all its frames are intact, getFrame() relies on that
+	bool validIndex = false;
+	if (m_size >= sizeof(FileHeader) + sizeof(IndexTrailer))
+	{
+		const IndexTrailer* trailer = (const IndexTrailer*) (m_data + m_size - sizeof(IndexTrailer));
+		if (memcmp(trailer->m_magic, s_indexMagic, sizeof(trailer->m_magic)) == 0
+			&& (trailer->m_indexOffset % 8) == 0
+			&& trailer->m_indexOffset + (unsigned long long) trailer->m_numFrames * sizeof(unsigned long long) + sizeof(IndexTrailer) == m_size)
+		{
+			m_numFrames = trailer->m_numFrames;
+			m_frameOffsets = (const unsigned long long*) (m_data + trailer->m_indexOffset);
+			validIndex = m_numFrames > 0;
+			for (unsigned int i = 0; validIndex && i < m_numFrames; ++i)
+				validIndex = isValidFrame(m_frameOffsets[i]) && ((const FrameHeader*) (m_data + m_frameOffsets[i]))->m_index == i;
+		}
+	}
+	if (!validIndex)
+	{
+		if (!rebuildIndex())
+		{
+			Fubi_logErr("Recording \"%s\" does not contain any frames!\n", fileName);
+			close();
+			return false;
+		}
+		Fubi_logWrn("Recording \"%s\" has not been closed correctly or its index is damaged, found %d frames.\n", fileName, m_numFrames);
+	}
+
+	return true;
+}
+
+bool FubiRecordingReader::isValidFrame(unsigned long long offset)
+{
+	if ((offset % 8) != 0 || offset < sizeof(FileHeader) || offset + sizeof(FrameHeader) > m_size)
+		return false;
+	const FrameHeader* header = (const FrameHeader*) (m_data + offset);
+	return header->m_numUsers <= MaxUsers
+		&& header->m_size == getFrameSize(header->m_numUsers, m_info)
+		&& offset + header->m_size <= m_size;
+}
+
+bool FubiRecordingReader::rebuildIndex()
+{
+	m_rebuiltFrameOffsets.clear();
+	unsigned long long offset = sizeof(FileHeader);
+	while (isValidFrame(offset)
+		&& ((const FrameHeader*) (m_data + offset))->m_index == m_rebuiltFrameOffsets.size())
+	{
+		m_rebuiltFrameOffsets.push_back(offset);
+		offset += ((const FrameHeader*) (m_data + offset))->m_size;
+	}
+
+	m_numFrames = (unsigned int) m_rebuiltFrameOffsets.size();
+	m_frameOffsets = (m_numFrames > 0) ? &m_rebuiltFrameOffsets[0] : 0x0;
+	return m_numFrames > 0;
+}
+
+void FubiRecordingReader::close()
+{
+#if defined ( WIN32 ) || defined( _WINDOWS )
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mappingHandle)
+		CloseHandle(m_mappingHandle);
+	if (m_fileHandle)
+		CloseHandle(m_fileHandle);
+	m_mappingHandle = m_fileHandle = 0x0;
+#else
+	if (m_data)
+		munmap((void*) m_data, m_size);
+#endif
+	m_data = 0x0;
+	m_size = 0;
+	m_numFrames = 0;
+	m_frameOffsets = 0x0;
+	m_rebuiltFrameOffsets.clear();
+}
+
+bool FubiRecordingReader::getFrame(unsigned int index, FubiRecordingFrameView& frame)
+{
+	if (index >= m_numFrames)
+		return false;
+
+	frame.m_header = (const FrameHeader*) (m_data + m_frameOffsets[index]);
+	frame.m_users = (const UserRecord*) (frame.m_header + 1);
+	const unsigned short* images = (const unsigned short*) (frame.m_users + frame.m_header->m_numUsers);
+	const unsigned int numPixels = m_info.m_depthWidth * m_info.m_depthHeight;
+	frame.m_depthData = m_info.m_hasDepthData ? images : 0x0;
+	frame.m_userLabelData = m_info.m_hasUserLabelData ? (images + (m_info.m_hasDepthData ? numPixels : 0)) : 0x0;
+	return true;
+}
@@ -0,0 +1,243 @@
+// ****************************************************************************************
+//
+// Fubi Recording
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#pragma once
+
+#include "FubiUtils.h"
+#include "FubiSPSCQueue.h"
+
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace Fubi
+{
+	// Sensor level tracking data of one user in a recorded frame
+	struct RecordedUser
+	{
+		RecordedUser() : m_id(0), m_isTracked(false) {}
+
+		unsigned int m_id;
+		bool m_isTracked;
+		SkeletonJointPosition m_positions[SkeletonJoint::NUM_JOINTS];
+		SkeletonJointOrientation m_orientations[SkeletonJoint::NUM_JOINTS];
+	};
+
+	// One sensor frame to be recorded
+	struct RecordedFrame
+	{
+		RecordedFrame() : m_timeStamp(0), m_numUsers(0) {}
+
+		// In seconds, on the clock of Fubi::currentTime() while recording
+		double m_timeStamp;
+		unsigned short m_numUsers;
+		RecordedUser m_users[MaxUsers];
+		// Empty if the recording does not contain these images
+		std::vector<unsigned short> m_depthData;
+		std::vector<unsigned short> m_userLabelData;
+	};
+
+	// Properties of a whole recording
+	struct RecordingInfo
+	{
+		RecordingInfo(int depthWidth = 640, int depthHeight = 480, bool hasDepthData = false, bool hasUserLabelData = false)
+			: m_depthWidth(depthWidth), m_depthHeight(depthHeight), m_hasDepthData(hasDepthData), m_hasUserLabelData(hasUserLabelData)
+		{}
+		// Resolution of the sensor that has been recorded, also valid without depth images
+		int m_depthWidth;
+		int m_depthHeight;
+		bool m_hasDepthData;
+		bool m_hasUserLabelData;
+	};
+
+	// On disk layout of recordings (native byte order, every frame starts 8 byte aligned):
+	// FileHeader, frames (FrameHeader, UserRecord[numUsers], uint16[width*height] depth and/or user label image, padding),
+	// frame index (uint64 file offset per frame), IndexTrailer
+	// The index is written when the recording is closed, without it the reader rebuilds it by scanning the frames.
+	namespace RecordingFormat
+	{
+		static const unsigned int Version = 2;
+		static const unsigned int HasDepthFlag = 1;
+		static const unsigned int HasUserLabelFlag = 2;
+		// Joint positions are stored in whole millimeters, orientations as quaternions scaled to the short range
+		static const float OrientationScale = 32767.0f;
+		static const float ConfidenceScale = 255.0f;
+
+		struct FileHeader
+		{
+			char m_magic[8];
+			unsigned int m_version;
+			unsigned int m_numJoints;
+			int m_depthWidth;
+			int m_depthHeight;
+			unsigned int m_flags;
+			unsigned int m_reserved;
+		};
+
+		struct FrameHeader
+		{
+			// Size of the whole frame including this header and the padding
+			unsigned int m_size;
+			// Position of the frame in the recording
+			unsigned int m_index;
+			double m_timeStamp;
+			unsigned short m_numUsers;
+			unsigned short m_reserved;
+			unsigned int m_reserved2;
+		};
+
+		struct JointRecord
+		{
+			short m_position[3];
+			unsigned char m_positionConfidence;
+			unsigned char m_orientationConfidence;
+			short m_orientation[4];
+		};
+
+		struct UserRecord
+		{
+			unsigned int m_id;
+			unsigned int m_isTracked;
+			JointRecord m_joints[SkeletonJoint::NUM_JOINTS];
+		};
+
+		struct IndexTrailer
+		{
+			unsigned long long m_indexOffset;
+			unsigned int m_numFrames;
+			char m_magic[4];
+		};
+	}
+}
+
+// Writes skeleton recordings in the background: the frames are encoded by the caller and written to disk by a writer thread
+class FubiRecordingWriter
+{
+public:
+	FubiRecordingWriter();
+	~FubiRecordingWriter();
+
+	// Creates the file, writes the header and starts the writer thread
+	bool open(const char* fileName, const Fubi::RecordingInfo& info);
+	// Encodes one frame and passes it to the writer thread, never waits for the disk
+	// Returns false if the frame had to be dropped because the writer thread is too far behind
+	// Images are only written if enabled in the info given to open()
+	bool writeFrame(const Fubi::RecordedFrame& frame);
+	// Waits until the writer thread has handled all frames passed so far, for writers that must not drop frames
+	void flush();
+	// Writes all pending frames and the frame index, then closes the file
+	void close();
+
+	bool isOpen() { return m_writerThread != 0x0; }
+	// Whether writing to the disk has failed, frames passed afterwards are lost
+	bool hasFailed() { return m_writeFailed; }
+	const Fubi::RecordingInfo& getInfo() { return m_info; }
+	unsigned int getNumWrittenFrames() { return m_numFrames; }
+	unsigned int getNumDroppedFrames() { return m_numDroppedFrames; }
+
+private:
+	// Encoded frames that can be waiting for the writer thread at most
+	static const unsigned int s_maxPendingFrames = 64;
+	typedef std::vector<char> Buffer;
+
+	void writerThreadLoop();
+	// Write all frames the writer thread has received so far
+	void writePendingFrames();
+
+	std::ofstream m_file;
+	Fubi::RecordingInfo m_info;
+	unsigned int m_numFrames;
+	unsigned int m_numDroppedFrames;
+
+	// Encoded frames go from the caller to the writer thread and the buffers back again for reuse
+	FubiSPSCQueue<Buffer*, s_maxPendingFrames> m_pendingBuffers;
+	FubiSPSCQueue<Buffer*, s_maxPendingFrames> m_freeBuffers;
+	std::vector<Buffer*> m_allBuffers;
+
+	std::thread* m_writerThread;
+	std::atomic<bool> m_writerThreadRunning;
+	std::atomic<bool> m_writeFailed;
+	// Frames the writer thread is done with
+	std::atomic<unsigned int> m_numHandledFrames;
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCondition;
+	// Only used by the writer thread
+	std::vector<unsigned long long> m_frameOffsets;
+	unsigned long long m_filePos;
+};
+
+// Read-only view of one frame inside a memory mapped recording
+class FubiRecordingFrameView
+{
+public:
+	FubiRecordingFrameView() : m_header(0x0), m_users(0x0), m_depthData(0x0), m_userLabelData(0x0) {}
+
+	bool isValid() const { return m_header != 0x0; }
+	unsigned int getFrameIndex() const { return m_header->m_index; }
+	double getTimeStamp() const { return m_header->m_timeStamp; }
+	unsigned short getNumUsers() const { return m_header->m_numUsers; }
+	unsigned int getUserID(unsigned short userIndex) const { return m_users[userIndex].m_id; }
+	bool isTracked(unsigned short userIndex) const { return m_users[userIndex].m_isTracked != 0; }
+	// Index of the user with the given id in this frame, -1 if not contained
+	int findUser(unsigned int id) const;
+	// Decode the stored joint data of one user
+	void getSkeletonJointData(unsigned short userIndex, Fubi::SkeletonJoint::Joint joint,
+		Fubi::SkeletonJointPosition& position, Fubi::SkeletonJointOrientation& orientation) const;
+	// Pointers into the mapped file, 0x0 if the recording has no such images
+	const unsigned short* getDepthData() const { return m_depthData; }
+	const unsigned short* getUserLabelData() const { return m_userLabelData; }
+
+private:
+	friend class FubiRecordingReader;
+	const Fubi::RecordingFormat::FrameHeader* m_header;
+	const Fubi::RecordingFormat::UserRecord* m_users;
+	const unsigned short* m_depthData;
+	const unsigned short* m_userLabelData;
+};
+
+// Gives random access to the frames of a recording by mapping the file into memory, nothing is copied
+class FubiRecordingReader
+{
+public:
+	FubiRecordingReader();
+	~FubiRecordingReader();
+
+	// Maps the file and checks the header and the frame index
+	bool open(const char* fileName);
+	void close();
+
+	bool isOpen() { return m_data != 0x0; }
+	const Fubi::RecordingInfo& getInfo() { return m_info; }
+	unsigned int getNumFrames() { return m_numFrames; }
+
+	// Get a view on the frame with the given index, it stays valid until the reader is closed
+	bool getFrame(unsigned int index, FubiRecordingFrameView& frame);
+
+private:
+	// Collect the frame offsets by walking over all frames if the index is missing or damaged
+	bool rebuildIndex();
+	// Check that a frame lies completely inside the file and matches the header
+	bool isValidFrame(unsigned long long offset);
+
+	const char* m_data;
+	unsigned long long m_size;
+	Fubi::RecordingInfo m_info;
+	unsigned int m_numFrames;
+	// Either points into the mapped index or to the rebuilt one
+	const unsigned long long* m_frameOffsets;
+	std::vector<unsigned long long> m_rebuiltFrameOffsets;
+#if defined ( WIN32 ) || defined( _WINDOWS )
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif
+};
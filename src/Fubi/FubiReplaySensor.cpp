@@ -0,0 +1,176 @@
+// ****************************************************************************************
+//
+// Fubi Replay sensor
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+
+#include "FubiReplaySensor.h"
+
+#include <algorithm>
+
+using namespace Fubi;
+
+// Gap between the last frame and the first frame of the next loop
+static const double s_loopGap = 1.0 / 30.0;
+
+FubiReplaySensor::FubiReplaySensor()
+	: m_nextFrameIndex(0), m_hasNextFrame(false),
+	  m_timeOffset(0), m_trackingTimeStamp(-1), m_started(false), m_hasNewData(false), m_finished(false)
+{
+}
+
+FubiReplaySensor::~FubiReplaySensor()
+{
+	m_reader.close();
+}
+
+bool FubiReplaySensor::initWithOptions(const Fubi::SensorOptions& options)
+{
+	const ReplayOptions& replayOptions = options.m_replayOptions;
+	if (!m_reader.open(replayOptions.m_fileName.c_str()))
+		return false;
+
+	m_options = options;
+	m_hasNextFrame = readNextFrame();
+
+	// Only the recorded streams are available
+	const RecordingInfo& info = m_reader.getInfo();
+	m_options.m_depthOptions = StreamOptions(info.m_depthWidth, info.m_depthHeight, 30);
+	m_options.m_rgbOptions.invalidate();
+	m_options.m_irOptions.invalidate();
+
+	Fubi_logInfo("FubiReplaySensor: Replaying %d frames of \"%s\" %s%s\n", m_reader.getNumFrames(), replayOptions.m_fileName.c_str(),
+		replayOptions.m_realTime ? "in real time" : "as fast as possible", replayOptions.m_loop ? " in a loop" : "");
+	return true;
+}
+
+bool FubiReplaySensor::readNextFrame()
+{
+	if (m_nextFrameIndex >= m_reader.getNumFrames())
+	{
+		if (!m_options.m_replayOptions.m_loop)
+			return false;
+		m_nextFrameIndex = 0;
+		if (!m_reader.getFrame(m_nextFrameIndex++, m_nextFrame))
+			return false;
+		// Time goes on with the next loop
+		if (m_started)
+			m_timeOffset = m_trackingTimeStamp + s_loopGap - m_nextFrame.getTimeStamp();
+		return true;
+	}
+	return m_reader.getFrame(m_nextFrameIndex++, m_nextFrame);
+}
+
+void FubiReplaySensor::nextFrame()
+{
+	if (m_hasNextFrame)
+	{
+		m_currentFrame = m_nextFrame;
+		m_trackingTimeStamp = m_currentFrame.getTimeStamp() + m_timeOffset;
+		m_hasNextFrame = readNextFrame();
+	}
+	else
+	{
+		// End of the recording: the users leave
+		m_currentFrame = FubiRecordingFrameView();
+		m_finished = true;
+		Fubi_logInfo("FubiReplaySensor: Replay finished.\n");
+	}
+	m_hasNewData = true;
+}
+
+void FubiReplaySensor::update()
+{
+	m_hasNewData = false;
+	if (m_finished)
+		return;
+
+	double now = currentTime();
+	if (!m_started)
+	{
+		// Recorded time stamps are shifted to the start of the replay
+		m_timeOffset = now - m_nextFrame.getTimeStamp();
+		m_started = true;
+	}
+
+	if (m_options.m_replayOptions.m_realTime)
+	{
+		// Frames that are already overdue are skipped like a real sensor would drop them
+		while (!m_finished && (!m_hasNextFrame || m_nextFrame.getTimeStamp() + m_timeOffset <= now))
+			nextFrame();
+	}
+	else
+		nextFrame();
+}
+
+unsigned short FubiReplaySensor::getUserIDs(unsigned int* userIDs)
+{
+	if (!m_currentFrame.isValid())
+		return 0;
+	unsigned short numUsers = m_currentFrame.getNumUsers();
+	if (userIDs)
+	{
+		for (unsigned short i = 0; i < numUsers; ++i)
+			userIDs[i] = m_currentFrame.getUserID(i);
+	}
+	return numUsers;
+}
+
+bool FubiReplaySensor::hasNewTrackingData()
+{
+	return m_hasNewData;
+}
+
+bool FubiReplaySensor::isTracking(unsigned int id)
+{
+	if (!m_currentFrame.isValid())
+		return false;
+	int index = m_currentFrame.findUser(id);
+	return index >= 0 && m_currentFrame.isTracked((unsigned short) index);
+}
+
+void FubiReplaySensor::getSkeletonJointData(unsigned int id, Fubi::SkeletonJoint::Joint joint, Fubi::SkeletonJointPosition& position, Fubi::SkeletonJointOrientation& orientation)
+{
+	int index = m_currentFrame.isValid() ? m_currentFrame.findUser(id) : -1;
+	if (index >= 0 && joint < SkeletonJoint::NUM_JOINTS)
+		m_currentFrame.getSkeletonJointData((unsigned short) index, joint, position, orientation);
+	else
+	{
+		position.m_confidence = 0;
+		orientation.m_confidence = 0;
+	}
+}
+
+const unsigned short* FubiReplaySensor::getDepthData()
+{
+	return m_currentFrame.isValid() ? m_currentFrame.getDepthData() : 0x0;
+}
+
+const unsigned short* FubiReplaySensor::getUserLabelData()
+{
+	return m_currentFrame.isValid() ? m_currentFrame.getUserLabelData() : 0x0;
+}
+
+Fubi::Vec3f FubiReplaySensor::realWorldToProjective(const Fubi::Vec3f& realWorldVec)
+{
+	// Field of view of the Kinect/Xtion depth camera
+	static const double hFOV = 1.0144686707507438;
+	static const double vFOV = 0.78980943449644714;
+	const double realWorldXtoZ = tan(hFOV/2)*2;
+	const double realWorldYtoZ = tan(vFOV/2)*2;
+	const int xRes = m_options.m_depthOptions.m_width;
+	const int yRes = m_options.m_depthOptions.m_height;
+
+	Vec3f ret(0, 0, realWorldVec.z);
+	if (realWorldVec.z != 0)
+	{
+		ret.x = (float) (xRes / realWorldXtoZ * realWorldVec.x / realWorldVec.z + xRes / 2);
+		ret.y = (float) (yRes / 2 - yRes / realWorldYtoZ * realWorldVec.y / realWorldVec.z);
+	}
+	return ret;
+}
@@ -0,0 +1,74 @@
+// ****************************************************************************************
+//
+// Fubi Replay sensor
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#pragma once
+
+#include "FubiISensor.h"
+#include "FubiRecording.h"
+
+// The FubiReplaySensor plays back a skeleton recording as if it came from a real sensor
+class FubiReplaySensor : public FubiISensor
+{
+public:
+	FubiReplaySensor();
+	virtual ~FubiReplaySensor();
+
+	// Init with options for streams and tracking, the recording is given in the replay options
+	virtual bool initWithOptions(const Fubi::SensorOptions& options);
+
+	// Update should be called once per frame for the sensor to update its streams and tracking data
+	virtual void update();
+
+	// Get the ids of all currently valid users: Ids will be stored in userIDs (if not 0x0), returns the number of valid users
+	virtual unsigned short getUserIDs(unsigned int* userIDs);
+
+	// Check if the sensor has new tracking data available
+	virtual bool hasNewTrackingData();
+
+	// Check if that user with the given id is tracked by the sensor
+	virtual bool isTracking(unsigned int id);
+
+	// Get the current joint position and orientation of one user
+	virtual void getSkeletonJointData(unsigned int id, Fubi::SkeletonJoint::Joint joint, Fubi::SkeletonJointPosition& position, Fubi::SkeletonJointOrientation& orientation);
+
+	// Get Stream data, only available if contained in the recording
+	virtual const unsigned short* getDepthData();
+	virtual const unsigned short* getUserLabelData();
+
+	// No real sensor, so a projection with the default Kinect field of view
+	virtual Fubi::Vec3f realWorldToProjective(const Fubi::Vec3f& realWorldVec);
+
+	// Get the recorded time stamp of the current frame shifted to the start of the replay
+	virtual double getTrackingTimeStamp() { return m_trackingTimeStamp; }
+
+	// Whether the last frame of a recording that is not looped has been replayed
+	bool hasFinished() { return m_finished; }
+
+private:
+	// Move on to the next recorded frame
+	void nextFrame();
+	// Get the frame after the current one, wraps around when looping
+	bool readNextFrame();
+
+	FubiRecordingReader m_reader;
+
+	// Views on the current and the following frame, the latter is needed for the recorded timing
+	FubiRecordingFrameView m_currentFrame;
+	FubiRecordingFrameView m_nextFrame;
+	unsigned int m_nextFrameIndex;
+	bool m_hasNextFrame;
+
+	// Offset from the recorded time stamps to the replay time, grows with each loop
+	double m_timeOffset;
+	double m_trackingTimeStamp;
+	bool m_started;
+	bool m_hasNewData;
+	bool m_finished;
+};
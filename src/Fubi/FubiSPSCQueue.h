@@ -0,0 +1,62 @@
+// ****************************************************************************************
+//
+// Fubi SPSC Queue
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#pragma once
+
+#include <atomic>
+
+// Bounded lock-free queue for passing items from exactly one producer thread to exactly one consumer thread.
+// Neither side ever blocks: push() fails if the queue is full and pop() fails if it is empty.
+template <class T, unsigned int Capacity>
+class FubiSPSCQueue
+{
+public:
+	FubiSPSCQueue() : m_head(0), m_tail(0)
+	{
+	}
+
+	// Producer: add an item at the end, returns false if the queue is full
+	bool push(const T& item)
+	{
+		unsigned int tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head.load(std::memory_order_acquire) >= Capacity)
+			return false;
+		m_items[tail % Capacity] = item;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer: take the first item, returns false if the queue is empty
+	bool pop(T& item)
+	{
+		unsigned int head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire))
+			return false;
+		item = m_items[head % Capacity];
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer: whether there is currently nothing to pop
+	bool empty() const
+	{
+		return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_acquire);
+	}
+
+private:
+	// Not copyable
+	FubiSPSCQueue(const FubiSPSCQueue&);
+	FubiSPSCQueue& operator=(const FubiSPSCQueue&);
+
+	T m_items[Capacity];
+	// Free running counters of popped and pushed items, written only by the consumer respectively the producer
+	std::atomic<unsigned int> m_head;
+	std::atomic<unsigned int> m_tail;
+};
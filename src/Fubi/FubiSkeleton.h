@@ -0,0 +1,172 @@
+// ****************************************************************************************
+//
+// Fubi Skeleton
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#pragma once
+
+#include "FubiConfig.h"
+#include "FubiUtils.h"
+
+// The skeleton hierarchy as compile time tables, used to unroll the calculations over all joints
+namespace Fubi
+{
+	namespace Skeleton
+	{
+		// Joint each local orientation is relative to, the torso is the root and its own parent
+		constexpr SkeletonJoint::Joint Parents[SkeletonJoint::NUM_JOINTS] =
+		{
+			SkeletonJoint::NECK,			// HEAD
+			SkeletonJoint::TORSO,			// NECK
+			SkeletonJoint::TORSO,			// TORSO
+			SkeletonJoint::TORSO,			// WAIST
+			SkeletonJoint::NECK,			// LEFT_SHOULDER
+			SkeletonJoint::LEFT_SHOULDER,	// LEFT_ELBOW
+			SkeletonJoint::LEFT_ELBOW,		// LEFT_WRIST
+			SkeletonJoint::LEFT_WRIST,		// LEFT_HAND
+			SkeletonJoint::NECK,			// RIGHT_SHOULDER
+			SkeletonJoint::RIGHT_SHOULDER,	// RIGHT_ELBOW
+			SkeletonJoint::RIGHT_ELBOW,		// RIGHT_WRIST
+			SkeletonJoint::RIGHT_WRIST,		// RIGHT_HAND
+			SkeletonJoint::WAIST,			// LEFT_HIP
+			SkeletonJoint::LEFT_HIP,		// LEFT_KNEE
+			SkeletonJoint::LEFT_KNEE,		// LEFT_ANKLE
+			SkeletonJoint::LEFT_ANKLE,		// LEFT_FOOT
+			SkeletonJoint::WAIST,			// RIGHT_HIP
+			SkeletonJoint::RIGHT_HIP,		// RIGHT_KNEE
+			SkeletonJoint::RIGHT_KNEE,		// RIGHT_ANKLE
+			SkeletonJoint::RIGHT_ANKLE,		// RIGHT_FOOT
+			SkeletonJoint::HEAD,			// FACE_NOSE
+			SkeletonJoint::HEAD,			// FACE_LEFT_EAR
+			SkeletonJoint::HEAD,			// FACE_RIGHT_EAR
+			SkeletonJoint::HEAD,			// FACE_FOREHEAD
+			SkeletonJoint::HEAD				// FACE_CHIN
+		};
+
+		// How the global orientation of a joint is calculated from the positions if the sensor does not provide it
+		struct OrientationRule
+		{
+			enum Type
+			{
+				// y axis from m_joints[0] to m_joints[1], x axis from m_joints[2] to m_joints[3]
+				FROM_YX,
+				// Only the x axis from m_joints[0] to m_joints[1]
+				FROM_X,
+				// Only the y axis from m_joints[0] to m_joints[1]
+				FROM_Y,
+				// Same orientation as m_joints[0]
+				SAME_AS,
+				// Not calculated
+				NONE
+			};
+			Type m_type;
+			SkeletonJoint::Joint m_joints[4];
+		};
+
+		constexpr OrientationRule GlobalOrientationRules[SkeletonJoint::NUM_JOINTS] =
+		{
+			// HEAD: Same as neck
+			{ OrientationRule::SAME_AS, { SkeletonJoint::NECK } },
+			// NECK: Neck-to-head for y and left-to-right-shoulder for x
+			{ OrientationRule::FROM_YX, { SkeletonJoint::NECK, SkeletonJoint::HEAD, SkeletonJoint::LEFT_SHOULDER, SkeletonJoint::RIGHT_SHOULDER } },
+			// TORSO: Torso-to-neck for y and left-to-right-shoulder for x
+			{ OrientationRule::FROM_YX, { SkeletonJoint::TORSO, SkeletonJoint::NECK, SkeletonJoint::LEFT_SHOULDER, SkeletonJoint::RIGHT_SHOULDER } },
+			// WAIST: Same as torso
+			{ OrientationRule::SAME_AS, { SkeletonJoint::TORSO } },
+			// LEFT_SHOULDER: Elbow-to-shoulder for x
+			{ OrientationRule::FROM_X, { SkeletonJoint::LEFT_ELBOW, SkeletonJoint::LEFT_SHOULDER } },
+			// LEFT_ELBOW: Hand-to-elbow for x
+			{ OrientationRule::FROM_X, { SkeletonJoint::LEFT_HAND, SkeletonJoint::LEFT_ELBOW } },
+			// LEFT_WRIST, LEFT_HAND: Same as elbow
+			{ OrientationRule::SAME_AS, { SkeletonJoint::LEFT_ELBOW } },
+			{ OrientationRule::SAME_AS, { SkeletonJoint::LEFT_ELBOW } },
+			// RIGHT_SHOULDER: Shoulder-to-elbow for x
+			{ OrientationRule::FROM_X, { SkeletonJoint::RIGHT_SHOULDER, SkeletonJoint::RIGHT_ELBOW } },
+			// RIGHT_ELBOW: Elbow-to-hand for x
+			{ OrientationRule::FROM_X, { SkeletonJoint::RIGHT_ELBOW, SkeletonJoint::RIGHT_HAND } },
+			// RIGHT_WRIST, RIGHT_HAND: Same as elbow
+			{ OrientationRule::SAME_AS, { SkeletonJoint::RIGHT_ELBOW } },
+			{ OrientationRule::SAME_AS, { SkeletonJoint::RIGHT_ELBOW } },
+			// LEFT_HIP: Knee-to-hip for y and left-to-right-hip for x
+			{ OrientationRule::FROM_YX, { SkeletonJoint::LEFT_KNEE, SkeletonJoint::LEFT_HIP, SkeletonJoint::LEFT_HIP, SkeletonJoint::RIGHT_HIP } },
+			// LEFT_KNEE: Foot-to-knee for y
+			{ OrientationRule::FROM_Y, { SkeletonJoint::LEFT_FOOT, SkeletonJoint::LEFT_KNEE } },
+			// LEFT_ANKLE, LEFT_FOOT: Same as knee
+			{ OrientationRule::SAME_AS, { SkeletonJoint::LEFT_KNEE } },
+			{ OrientationRule::SAME_AS, { SkeletonJoint::LEFT_KNEE } },
+			// RIGHT_HIP: Knee-to-hip for y and left-to-right-hip for x
+			{ OrientationRule::FROM_YX, { SkeletonJoint::RIGHT_KNEE, SkeletonJoint::RIGHT_HIP, SkeletonJoint::LEFT_HIP, SkeletonJoint::RIGHT_HIP } },
+			// RIGHT_KNEE: Foot-to-knee for y
+			{ OrientationRule::FROM_Y, { SkeletonJoint::RIGHT_FOOT, SkeletonJoint::RIGHT_KNEE } },
+			// RIGHT_ANKLE, RIGHT_FOOT: Same as knee
+			{ OrientationRule::SAME_AS, { SkeletonJoint::RIGHT_KNEE } },
+			{ OrientationRule::SAME_AS, { SkeletonJoint::RIGHT_KNEE } },
+			// Face joints keep their orientation
+			{ OrientationRule::NONE }, { OrientationRule::NONE }, { OrientationRule::NONE }, { OrientationRule::NONE }, { OrientationRule::NONE }
+		};
+
+		// All joints ordered so that each one comes after its parent and after the joint its orientation is copied from
+		constexpr SkeletonJoint::Joint HierarchyOrder[SkeletonJoint::NUM_JOINTS] =
+		{
+			SkeletonJoint::TORSO, SkeletonJoint::WAIST, SkeletonJoint::NECK, SkeletonJoint::HEAD,
+			SkeletonJoint::LEFT_SHOULDER, SkeletonJoint::LEFT_ELBOW, SkeletonJoint::LEFT_WRIST, SkeletonJoint::LEFT_HAND,
+			SkeletonJoint::RIGHT_SHOULDER, SkeletonJoint::RIGHT_ELBOW, SkeletonJoint::RIGHT_WRIST, SkeletonJoint::RIGHT_HAND,
+			SkeletonJoint::LEFT_HIP, SkeletonJoint::LEFT_KNEE, SkeletonJoint::LEFT_ANKLE, SkeletonJoint::LEFT_FOOT,
+			SkeletonJoint::RIGHT_HIP, SkeletonJoint::RIGHT_KNEE, SkeletonJoint::RIGHT_ANKLE, SkeletonJoint::RIGHT_FOOT,
+			SkeletonJoint::FACE_NOSE, SkeletonJoint::FACE_LEFT_EAR, SkeletonJoint::FACE_RIGHT_EAR, SkeletonJoint::FACE_FOREHEAD, SkeletonJoint::FACE_CHIN
+		};
+
+		// The joints of the skeleton layout are the first ones of the hierarchy order and also the first ones of the joint enum,
+		// so the others can simply be left out. Their transformations are not calculated and keep their last values.
+#ifdef FUBI_SKELETON_WITHOUT_FACE
+		constexpr unsigned int NumLayoutJoints = SkeletonJoint::FACE_NOSE;
+#else
+		constexpr unsigned int NumLayoutJoints = SkeletonJoint::NUM_JOINTS;
+#endif
+
+		constexpr bool isInLayout(SkeletonJoint::Joint joint)
+		{
+			return (unsigned int) joint < NumLayoutJoints;
+		}
+
+		// Calls visitor.visit<Joint>() for each joint of the layout in hierarchy order, unrolled at compile time
+		template<unsigned int Index = 0, bool Done = (Index >= NumLayoutJoints)>
+		struct ForEachJoint
+		{
+			template<class Visitor>
+			static inline void apply(Visitor& visitor)
+			{
+				visitor.template visit<HierarchyOrder[Index]>();
+				ForEachJoint<Index + 1>::apply(visitor);
+			}
+		};
+		template<unsigned int Index>
+		struct ForEachJoint<Index, true>
+		{
+			template<class Visitor>
+			static inline void apply(Visitor&) {}
+		};
+
+		namespace Detail
+		{
+			constexpr unsigned int orderIndex(SkeletonJoint::Joint joint, unsigned int i = 0)
+			{
+				return (i >= SkeletonJoint::NUM_JOINTS || HierarchyOrder[i] == joint) ? i : orderIndex(joint, i + 1);
+			}
+			constexpr bool isValidOrder(unsigned int i = 0)
+			{
+				return i >= SkeletonJoint::NUM_JOINTS
+					|| ((Parents[HierarchyOrder[i]] == HierarchyOrder[i] || orderIndex(Parents[HierarchyOrder[i]]) < i)
+					&& (GlobalOrientationRules[HierarchyOrder[i]].m_type != OrientationRule::SAME_AS || orderIndex(GlobalOrientationRules[HierarchyOrder[i]].m_joints[0]) < i)
+					&& (i >= NumLayoutJoints || isInLayout(HierarchyOrder[i]))
+					&& isValidOrder(i + 1));
+			}
+		}
+		static_assert(Detail::isValidOrder(), "Each joint has to come after its parent and the joint its orientation is copied from, and the layout joints have to come first");
+	}
+}
@@ -0,0 +1,350 @@
+// ****************************************************************************************
+//
+// Fubi Synthetic sensor
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+
+#include "FubiSyntheticSensor.h"
+
+#include <algorithm>
+
+using namespace Fubi;
+
+// Field of view of the Kinect/Xtion depth camera
+static const double s_hFOV = 1.0144686707507438;
+static const double s_vFOV = 0.78980943449644714;
+
+// Height of the floor below the sensor and distance of the wall behind the users in millimeters
+static const float s_floorHeight = -1000.0f;
+static const unsigned short s_wallDepth = 4500;
+
+// Standing pose relative to the waist in millimeters, the arms are set by the gesture script
+static const float s_pose[SkeletonJoint::NUM_JOINTS][3] =
+{
+	{0, 700, 0}, {0, 500, 0}, {0, 250, 0}, {0, 0, 0},							// head, neck, torso, waist
+	{-180, 450, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},							// left shoulder, elbow, wrist, hand
+	{180, 450, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},								// right shoulder, elbow, wrist, hand
+	{-100, -50, 0}, {-110, -500, 0}, {-110, -920, 0}, {-110, -980, -100},		// left hip, knee, ankle, foot
+	{100, -50, 0}, {110, -500, 0}, {110, -920, 0}, {110, -980, -100},			// right hip, knee, ankle, foot
+	{0, 700, -100}, {-80, 700, 0}, {80, 700, 0}, {0, 780, -80}, {0, 620, -80}	// nose, left ear, right ear, forehead, chin
+};
+
+// One pose of the gesture script, reached from the previous one by linear interpolation
+struct Keyframe
+{
+	// Time to move from the previous pose into this one in seconds
+	float m_duration;
+	// Vertical offset of the whole body, e.g. for jumping
+	float m_height;
+	// Left elbow, left hand, right elbow and right hand relative to their shoulder (negative z is towards the sensor)
+	float m_arms[4][3];
+};
+
+#define ARMS_DOWN {-30, -280, 0}, {-50, -580, 0}
+#define RIGHT_ARM_DOWN {30, -280, 0}, {50, -580, 0}
+
+// The gestures of the MashtaCycle recognizers one after the other, each starting and ending with the arms down
+static const Keyframe s_script[] =
+{
+	// Idle
+	{1.0f, 0, {ARMS_DOWN, RIGHT_ARM_DOWN}},
+	// Angel: both arms move up from the sides
+	{0.5f, 0, {{-270, -120, 50}, {-520, -200, 50}, {270, -120, 50}, {520, -200, 50}}},
+	{0.6f, 0, {{-260, 150, 50}, {-480, 400, 50}, {260, 150, 50}, {480, 400, 50}}},
+	{0.5f, 0, {{-260, 150, 50}, {-480, 400, 50}, {260, 150, 50}, {480, 400, 50}}},
+	{0.6f, 0, {ARMS_DOWN, RIGHT_ARM_DOWN}},
+	// Jump
+	{0.4f, 0, {ARMS_DOWN, RIGHT_ARM_DOWN}},
+	{0.15f, 350, {ARMS_DOWN, RIGHT_ARM_DOWN}},
+	{0.2f, 0, {ARMS_DOWN, RIGHT_ARM_DOWN}},
+	{0.6f, 0, {ARMS_DOWN, RIGHT_ARM_DOWN}},
+	// ArmsCrossed: hands crossed in front of the chest
+	{0.6f, 0, {{100, -250, -150}, {330, -150, -250}, {-100, -250, -150}, {-330, -150, -250}}},
+	{1.0f, 0, {{100, -250, -150}, {330, -150, -250}, {-100, -250, -150}, {-330, -150, -250}}},
+	{0.6f, 0, {ARMS_DOWN, RIGHT_ARM_DOWN}},
+	// BothHandsInFront
+	{0.5f, 0, {{0, -150, -250}, {0, -50, -520}, {0, -150, -250}, {0, -50, -520}}},
+	{1.0f, 0, {{0, -150, -250}, {0, -50, -520}, {0, -150, -250}, {0, -50, -520}}},
+	{0.5f, 0, {ARMS_DOWN, RIGHT_ARM_DOWN}},
+	// RightHandNearHead with the left hand down
+	{0.5f, 0, {ARMS_DOWN, {120, -100, -80}, {-120, 230, -60}}},
+	{0.8f, 0, {ARMS_DOWN, {120, -100, -80}, {-120, 230, -60}}},
+	{0.5f, 0, {ARMS_DOWN, RIGHT_ARM_DOWN}},
+	// LeftHandScanning: the left hand in front moves from side to side
+	{0.5f, 0, {{-60, -150, -250}, {-50, 0, -550}, RIGHT_ARM_DOWN}},
+	{0.8f, 0, {{40, -150, -250}, {250, 0, -500}, RIGHT_ARM_DOWN}},
+	{0.8f, 0, {{-120, -150, -250}, {-350, 0, -500}, RIGHT_ARM_DOWN}},
+	{0.5f, 0, {ARMS_DOWN, RIGHT_ARM_DOWN}}
+};
+static const unsigned int s_scriptLength = sizeof(s_script) / sizeof(s_script[0]);
+
+#undef ARMS_DOWN
+#undef RIGHT_ARM_DOWN
+
+// Bones drawn into the depth image with their radius in millimeters
+static const struct { SkeletonJoint::Joint m_start, m_end; float m_radius; } s_bones[] =
+{
+	{SkeletonJoint::HEAD, SkeletonJoint::HEAD, 110.0f},
+	{SkeletonJoint::NECK, SkeletonJoint::WAIST, 160.0f},
+	{SkeletonJoint::LEFT_SHOULDER, SkeletonJoint::RIGHT_SHOULDER, 70.0f},
+	{SkeletonJoint::LEFT_SHOULDER, SkeletonJoint::LEFT_ELBOW, 55.0f},
+	{SkeletonJoint::LEFT_ELBOW, SkeletonJoint::LEFT_HAND, 45.0f},
+	{SkeletonJoint::RIGHT_SHOULDER, SkeletonJoint::RIGHT_ELBOW, 55.0f},
+	{SkeletonJoint::RIGHT_ELBOW, SkeletonJoint::RIGHT_HAND, 45.0f},
+	{SkeletonJoint::LEFT_HIP, SkeletonJoint::LEFT_KNEE, 75.0f},
+	{SkeletonJoint::LEFT_KNEE, SkeletonJoint::LEFT_FOOT, 60.0f},
+	{SkeletonJoint::RIGHT_HIP, SkeletonJoint::RIGHT_KNEE, 75.0f},
+	{SkeletonJoint::RIGHT_KNEE, SkeletonJoint::RIGHT_FOOT, 60.0f}
+};
+static const unsigned int s_numBones = sizeof(s_bones) / sizeof(s_bones[0]);
+
+FubiSyntheticSensor::FubiSyntheticSensor()
+	: m_numUsers(0), m_scriptDuration(0), m_projectionWidth(640), m_projectionHeight(480), m_focalLengthX(0), m_focalLengthY(0),
+	  m_startTime(0), m_frameDuration(1.0 / 30.0), m_frameIndex(0), m_trackingTimeStamp(-1), m_hasNewData(false)
+{
+	for (unsigned int k = 0; k < s_scriptLength; ++k)
+		m_scriptDuration += s_script[k].m_duration;
+}
+
+FubiSyntheticSensor::~FubiSyntheticSensor()
+{
+}
+
+bool FubiSyntheticSensor::initWithOptions(const Fubi::SensorOptions& options)
+{
+	const SyntheticOptions& syntheticOptions = options.m_syntheticOptions;
+	m_options = options;
+	m_numUsers = (unsigned short) std::min(syntheticOptions.m_numUsers, (unsigned int) MaxUsers);
+
+	m_random.seed(syntheticOptions.m_seed);
+	m_noise = std::normal_distribution<float>(0, std::max(syntheticOptions.m_jointNoise, 0.0f));
+	m_dropout = std::uniform_real_distribution<float>(0, 1.0f);
+
+	// Only the depth stream can be simulated, without it there is still a projection for the standard resolution
+	StreamOptions& depthOptions = m_options.m_depthOptions;
+	if (depthOptions.m_width > 0 && depthOptions.m_height > 0)
+	{
+		const unsigned int numPixels = depthOptions.m_width * depthOptions.m_height;
+		m_depthData.assign(numPixels, s_wallDepth);
+		m_userLabelData.assign(numPixels, 0);
+		m_projectionWidth = depthOptions.m_width;
+		m_projectionHeight = depthOptions.m_height;
+	}
+	else
+	{
+		depthOptions.invalidate();
+		m_depthData.clear();
+		m_userLabelData.clear();
+		m_projectionWidth = 640;
+		m_projectionHeight = 480;
+	}
+	m_focalLengthX = m_projectionWidth / (tan(s_hFOV/2)*2);
+	m_focalLengthY = m_projectionHeight / (tan(s_vFOV/2)*2);
+	m_frameDuration = 1.0 / ((depthOptions.m_fps > 0) ? depthOptions.m_fps : 30);
+	m_options.m_rgbOptions.invalidate();
+	m_options.m_irOptions.invalidate();
+
+	m_startTime = currentTime();
+	m_frameIndex = 0;
+	m_trackingTimeStamp = -1;
+	m_hasNewData = false;
+
+	Fubi_logInfo("FubiSyntheticSensor: Generating %d users with %.1fmm joint noise and %.1f%% dropouts %s\n",
+		m_numUsers, syntheticOptions.m_jointNoise, syntheticOptions.m_dropoutRate * 100.0f,
+		syntheticOptions.m_realTime ? "in real time" : "as fast as possible");
+	return true;
+}
+
+void FubiSyntheticSensor::update()
+{
+	m_hasNewData = false;
+	double frameTime = m_frameIndex * m_frameDuration;
+
+	if (m_options.m_syntheticOptions.m_realTime)
+	{
+		const double now = currentTime() - m_startTime;
+		if (now < frameTime)
+			return;
+		// Frames that would already be overdue are skipped like a real sensor would drop them
+		unsigned int frameIndex = (unsigned int) (now / m_frameDuration);
+		if (frameIndex > m_frameIndex)
+		{
+			m_frameIndex = frameIndex;
+			frameTime = m_frameIndex * m_frameDuration;
+		}
+	}
+
+	animateUsers(frameTime);
+	if (!m_depthData.empty())
+		renderImages();
+
+	m_trackingTimeStamp = m_startTime + frameTime;
+	++m_frameIndex;
+	m_hasNewData = true;
+}
+
+void FubiSyntheticSensor::animateUsers(double time)
+{
+	const SyntheticOptions& options = m_options.m_syntheticOptions;
+	for (unsigned short i = 0; i < m_numUsers; ++i)
+	{
+		// Every user starts at another point of the script and is a bit faster or slower
+		const double speed = 0.85 + (i % 4) * 0.1;
+		float t = (float) fmod(time * speed + i * m_scriptDuration / 7.0, m_scriptDuration);
+		unsigned int k = 0;
+		while (k < s_scriptLength-1 && t > s_script[k].m_duration)
+		{
+			t -= s_script[k].m_duration;
+			++k;
+		}
+		const Keyframe& from = s_script[(k + s_scriptLength - 1) % s_scriptLength];
+		const Keyframe& to = s_script[k];
+		const float w = std::min(t / to.m_duration, 1.0f);
+
+		// Users stand in rows of five in front of the sensor and sway a bit
+		const unsigned int row = i / 5;
+		const Vec3f waist(((i % 5) - 2.0f) * 700.0f + row * 350.0f + 50.0f * sinf(0.3f * (float) time + i),
+			(1.0f - w) * from.m_height + w * to.m_height,
+			2000.0f + row * 900.0f);
+
+		SkeletonJointPosition* positions = m_positions[i];
+		for (unsigned int j = 0; j < SkeletonJoint::NUM_JOINTS; ++j)
+			positions[j].m_position = waist + Vec3f(s_pose[j][0], s_pose[j][1], s_pose[j][2]);
+		for (unsigned int arm = 0; arm < 2; ++arm)
+		{
+			const unsigned int shoulder = (arm == 0) ? SkeletonJoint::LEFT_SHOULDER : SkeletonJoint::RIGHT_SHOULDER;
+			const float* fromElbow = from.m_arms[arm*2], *toElbow = to.m_arms[arm*2];
+			const float* fromHand = from.m_arms[arm*2+1], *toHand = to.m_arms[arm*2+1];
+			const Vec3f& shoulderPos = positions[shoulder].m_position;
+			Vec3f elbow = shoulderPos + Vec3f((1.0f-w)*fromElbow[0] + w*toElbow[0], (1.0f-w)*fromElbow[1] + w*toElbow[1], (1.0f-w)*fromElbow[2] + w*toElbow[2]);
+			Vec3f hand = shoulderPos + Vec3f((1.0f-w)*fromHand[0] + w*toHand[0], (1.0f-w)*fromHand[1] + w*toHand[1], (1.0f-w)*fromHand[2] + w*toHand[2]);
+			positions[shoulder+1].m_position = elbow;
+			positions[shoulder+2].m_position = elbow + (hand - elbow) * 0.85f;
+			positions[shoulder+3].m_position = hand;
+		}
+
+		for (unsigned int j = 0; j < SkeletonJoint::NUM_JOINTS; ++j)
+		{
+			if (options.m_jointNoise > 0)
+				positions[j].m_position += Vec3f(m_noise(m_random), m_noise(m_random), m_noise(m_random));
+			positions[j].m_confidence = (options.m_dropoutRate > 0 && m_dropout(m_random) < options.m_dropoutRate) ? 0 : 1.0f;
+		}
+	}
+}
+
+void FubiSyntheticSensor::renderImages()
+{
+	std::fill(m_depthData.begin(), m_depthData.end(), s_wallDepth);
+	std::fill(m_userLabelData.begin(), m_userLabelData.end(), 0);
+	for (unsigned short i = 0; i < m_numUsers; ++i)
+	{
+		for (unsigned int b = 0; b < s_numBones; ++b)
+			drawBone(m_positions[i][s_bones[b].m_start].m_position, m_positions[i][s_bones[b].m_end].m_position, s_bones[b].m_radius, i+1);
+	}
+}
+
+void FubiSyntheticSensor::drawBone(const Vec3f& start, const Vec3f& end, float radius, unsigned short userID)
+{
+	const int width = m_options.m_depthOptions.m_width;
+	const int height = m_options.m_depthOptions.m_height;
+	Vec3f projStart = realWorldToProjective(start);
+	Vec3f projEnd = realWorldToProjective(end);
+	if (projStart.z <= 0 || projEnd.z <= 0)
+		return;
+
+	// Enough discs to get a closed shape
+	const float pixelRadius = (float) (radius * m_focalLengthX / std::max(projStart.z, projEnd.z));
+	const float length = sqrtf((projEnd.x-projStart.x)*(projEnd.x-projStart.x) + (projEnd.y-projStart.y)*(projEnd.y-projStart.y));
+	const unsigned int numSteps = 1 + (unsigned int) (length / std::max(pixelRadius * 0.5f, 1.0f));
+	for (unsigned int s = 0; s <= numSteps; ++s)
+	{
+		const float w = (float) s / numSteps;
+		const Vec3f center = projStart + (projEnd - projStart) * w;
+		const int r = (int) (radius * m_focalLengthX / center.z);
+		const unsigned short depth = (unsigned short) std::min(center.z, (float) MaxDepth);
+		const int minX = std::max(0, (int) center.x - r), maxX = std::min(width - 1, (int) center.x + r);
+		const int minY = std::max(0, (int) center.y - r), maxY = std::min(height - 1, (int) center.y + r);
+		for (int y = minY; y <= maxY; ++y)
+		{
+			const int dy = y - (int) center.y;
+			for (int x = minX; x <= maxX; ++x)
+			{
+				const int dx = x - (int) center.x;
+				const unsigned int index = y * width + x;
+				if (dx*dx + dy*dy <= r*r && depth < m_depthData[index])
+				{
+					m_depthData[index] = depth;
+					m_userLabelData[index] = userID;
+				}
+			}
+		}
+	}
+}
+
+unsigned short FubiSyntheticSensor::getUserIDs(unsigned int* userIDs)
+{
+	if (userIDs)
+	{
+		for (unsigned short i = 0; i < m_numUsers; ++i)
+			userIDs[i] = i + 1;
+	}
+	return m_numUsers;
+}
+
+bool FubiSyntheticSensor::hasNewTrackingData()
+{
+	return m_hasNewData;
+}
+
+bool FubiSyntheticSensor::isTracking(unsigned int id)
+{
+	return id > 0 && id <= m_numUsers && m_frameIndex > 0;
+}
+
+void FubiSyntheticSensor::getSkeletonJointData(unsigned int id, Fubi::SkeletonJoint::Joint joint, Fubi::SkeletonJointPosition& position, Fubi::SkeletonJointOrientation& orientation)
+{
+	if (isTracking(id) && joint < SkeletonJoint::NUM_JOINTS)
+	{
+		position = m_positions[id-1][joint];
+		// Not simulated, so recognizers can treat them as tracking errors
+		orientation.m_orientation = Matrix3f();
+		orientation.m_confidence = 0;
+	}
+	else
+	{
+		position.m_confidence = 0;
+		orientation.m_confidence = 0;
+	}
+}
+
+const unsigned short* FubiSyntheticSensor::getDepthData()
+{
+	return m_depthData.empty() ? 0x0 : &m_depthData[0];
+}
+
+const unsigned short* FubiSyntheticSensor::getUserLabelData()
+{
+	return m_userLabelData.empty() ? 0x0 : &m_userLabelData[0];
+}
+
+Fubi::Vec3f FubiSyntheticSensor::realWorldToProjective(const Fubi::Vec3f& realWorldVec)
+{
+	Vec3f ret(0, 0, realWorldVec.z);
+	if (realWorldVec.z != 0)
+	{
+		ret.x = (float) (m_focalLengthX * realWorldVec.x / realWorldVec.z + m_projectionWidth / 2);
+		ret.y = (float) (m_projectionHeight / 2 - m_focalLengthY * realWorldVec.y / realWorldVec.z);
+	}
+	return ret;
+}
+
+Fubi::Plane FubiSyntheticSensor::getFloor()
+{
+	// Same convention as the OpenNI sensors: normal and its dot product with a point on the floor
+	return Plane(0, 1.0f, 0, s_floorHeight);
+}
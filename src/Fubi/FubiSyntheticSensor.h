@@ -0,0 +1,87 @@
+// ****************************************************************************************
+//
+// Fubi Synthetic sensor
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#pragma once
+
+#include "FubiISensor.h"
+
+#include <vector>
+#include <random>
+
+// The FubiSyntheticSensor generates a crowd of animated users instead of tracking real ones.
+// Each user loops through a script of the gestures of the MashtaCycle recognizers (Angel, Jump, ArmsCrossed,...),
+// starting at a different point of the script. Depth and user label images are rendered from the skeletons.
+// Joint orientations are not simulated, they are always the identity with zero confidence.
+class FubiSyntheticSensor : public FubiISensor
+{
+public:
+	FubiSyntheticSensor();
+	virtual ~FubiSyntheticSensor();
+
+	// Init with options for streams and tracking, the crowd is configured by the synthetic options
+	virtual bool initWithOptions(const Fubi::SensorOptions& options);
+
+	// Update should be called once per frame for the sensor to update its streams and tracking data
+	virtual void update();
+
+	// Get the ids of all currently valid users: Ids will be stored in userIDs (if not 0x0), returns the number of valid users
+	virtual unsigned short getUserIDs(unsigned int* userIDs);
+
+	// Check if the sensor has new tracking data available
+	virtual bool hasNewTrackingData();
+
+	// Check if that user with the given id is tracked by the sensor
+	virtual bool isTracking(unsigned int id);
+
+	// Get the current joint position and orientation of one user
+	virtual void getSkeletonJointData(unsigned int id, Fubi::SkeletonJoint::Joint joint, Fubi::SkeletonJointPosition& position, Fubi::SkeletonJointOrientation& orientation);
+
+	// Get Stream data, only available if the depth stream is enabled
+	virtual const unsigned short* getDepthData();
+	virtual const unsigned short* getUserLabelData();
+
+	// No real sensor, so a projection with the default Kinect field of view
+	virtual Fubi::Vec3f realWorldToProjective(const Fubi::Vec3f& realWorldVec);
+
+	// The floor the users are standing on
+	virtual Fubi::Plane getFloor();
+
+	// Get the simulated time stamp of the current frame
+	virtual double getTrackingTimeStamp() { return m_trackingTimeStamp; }
+
+private:
+	// Calculate the skeletons for the given time in seconds since the start
+	void animateUsers(double time);
+	// Render the users into the depth and user label image
+	void renderImages();
+	// Draw a bone as a row of discs into the images
+	void drawBone(const Fubi::Vec3f& start, const Fubi::Vec3f& end, float radius, unsigned short userID);
+
+	unsigned short m_numUsers;
+	// Length of one pass through the gesture script in seconds
+	double m_scriptDuration;
+	Fubi::SkeletonJointPosition m_positions[Fubi::MaxUsers][Fubi::SkeletonJoint::NUM_JOINTS];
+
+	std::vector<unsigned short> m_depthData;
+	std::vector<unsigned short> m_userLabelData;
+	// Image size and pixels per millimeter at one millimeter distance for the projection
+	int m_projectionWidth, m_projectionHeight;
+	double m_focalLengthX, m_focalLengthY;
+
+	std::mt19937 m_random;
+	std::normal_distribution<float> m_noise;
+	std::uniform_real_distribution<float> m_dropout;
+
+	double m_startTime;
+	double m_frameDuration;
+	unsigned int m_frameIndex;
+	double m_trackingTimeStamp;
+	bool m_hasNewData;
+};
@@ -0,0 +1,101 @@
+// ****************************************************************************************
+//
+// Fubi Thread Pool
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+
+#include "FubiThreadPool.h"
+
+FubiThreadPool::FubiThreadPool(unsigned int numThreads)
+	: m_stop(false), m_generation(0), m_numBusyWorkers(0), m_task(0x0), m_context(0x0), m_count(0), m_nextIndex(0)
+{
+	for (unsigned int i = 0; i < numThreads; ++i)
+	{
+		m_threads.push_back(std::thread(&FubiThreadPool::workerLoop, this));
+	}
+}
+
+FubiThreadPool::~FubiThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_startCondition.notify_all();
+
+	for (unsigned int i = 0; i < m_threads.size(); ++i)
+	{
+		m_threads[i].join();
+	}
+}
+
+void FubiThreadPool::parallelFor(unsigned int count, Task task, void* context)
+{
+	if (count == 0)
+		return;
+
+	if (m_threads.empty() || count == 1)
+	{
+		// Not worth waking up anyone
+		for (unsigned int i = 0; i < count; ++i)
+			task(context, i);
+		return;
+	}
+
+	// Start a new job
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = task;
+		m_context = context;
+		m_count = count;
+		m_nextIndex = 0;
+		m_numBusyWorkers = (unsigned int) m_threads.size();
+		++m_generation;
+	}
+	m_startCondition.notify_all();
+
+	// Help with the tasks
+	runTasks();
+
+	// And wait until all workers are done
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_numBusyWorkers > 0)
+		m_doneCondition.wait(lock);
+}
+
+void FubiThreadPool::workerLoop()
+{
+	unsigned int lastGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (!m_stop && m_generation == lastGeneration)
+				m_startCondition.wait(lock);
+			if (m_stop)
+				return;
+			lastGeneration = m_generation;
+		}
+
+		runTasks();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_numBusyWorkers == 0)
+				m_doneCondition.notify_one();
+		}
+	}
+}
+
+void FubiThreadPool::runTasks()
+{
+	for (unsigned int i = m_nextIndex++; i < m_count; i = m_nextIndex++)
+	{
+		m_task(m_context, i);
+	}
+}
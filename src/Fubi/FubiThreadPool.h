@@ -0,0 +1,60 @@
+// ****************************************************************************************
+//
+// Fubi Thread Pool
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Fixed number of worker threads that process independent tasks of one frame in parallel
+class FubiThreadPool
+{
+public:
+	// A task gets the context given to parallelFor() and its index
+	typedef void (*Task)(void* context, unsigned int index);
+
+	FubiThreadPool(unsigned int numThreads);
+	~FubiThreadPool();
+
+	// Run the task for all indices from 0 to count-1 on the workers and the calling thread
+	// Returns after all of them have finished
+	void parallelFor(unsigned int count, Task task, void* context);
+
+	unsigned int getNumThreads() const { return (unsigned int) m_threads.size(); }
+
+private:
+	// Not copyable
+	FubiThreadPool(const FubiThreadPool&);
+	FubiThreadPool& operator=(const FubiThreadPool&);
+
+	// Main loop of each worker
+	void workerLoop();
+	// Process tasks of the current job until there are none left
+	void runTasks();
+
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_startCondition, m_doneCondition;
+	bool m_stop;
+	// Incremented for each new job
+	unsigned int m_generation;
+	// Number of workers that have not yet finished the current job
+	unsigned int m_numBusyWorkers;
+
+	// The current job
+	Task m_task;
+	void* m_context;
+	unsigned int m_count;
+	std::atomic<unsigned int> m_nextIndex;
+};
@@ -0,0 +1,95 @@
+// ****************************************************************************************
+//
+// Fubi Tracking Snapshot
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#pragma once
+
+#include "FubiUtils.h"
+#include "FubiUser.h"
+
+#include <string>
+#include <vector>
+
+namespace Fubi
+{
+	// Maximum number of threads that can independently consume the snapshots of the tracking thread
+	static const unsigned int MaxSnapshotConsumers = 4;
+
+	// Copy of the state of one user at the time a snapshot was published
+	struct UserSnapshot
+	{
+		UserSnapshot() : m_id(0), m_inScene(false), m_isTracked(false)
+		{
+			m_currentTrackingData.timeStamp = 0;
+		}
+
+		// OpenNI id of this user
+		unsigned int m_id;
+		// Whether the user is currently seen in the depth image
+		bool m_inScene;
+		// Whether the user is currently tracked
+		bool m_isTracked;
+		// Skeleton joints (position/orientation) of the snapshot frame, read in the same way as FubiUser::TrackingData
+		// The local transformations are only valid for the joints used by the recognizers, see Fubi::setSnapshotLocalTransformations()
+		FubiUser::CompactTrackingData m_currentTrackingData;
+		// How often each user defined combination (same index as TrackingSnapshot::m_combinationNames)
+		// has been recognized for this user id since the recognizers have been loaded
+		// Compare with an older snapshot to find the recognitions in between
+		std::vector<unsigned int> m_combinationRecognitionCounts;
+	};
+
+	// Immutable state of all users published by the tracking thread once per tracking frame
+	struct TrackingSnapshot
+	{
+		TrackingSnapshot() : m_frameID(0), m_timeStamp(0), m_recognizerSetID(0), m_numUsers(0)
+		{
+		}
+
+		// Increasing number of the tracking frame, 0 if nothing has been published yet
+		unsigned int m_frameID;
+		// Time the snapshot has been taken in seconds
+		double m_timeStamp;
+		// Changes whenever the user defined recognizers are cleared, i.e. combination counts start again from zero
+		unsigned int m_recognizerSetID;
+		// Names of all user defined combination recognizers
+		std::vector<std::string> m_combinationNames;
+		// Number of valid users
+		unsigned short m_numUsers;
+		// Valid users ordered by their distance to the sensor (closest first)
+		UserSnapshot m_users[MaxUsers];
+	};
+
+	// Maximum number of recognition events waiting for the consumer, further ones are dropped
+	static const unsigned int MaxRecognitionEvents = 256;
+
+	// A user defined combination completed by a user, sent by the tracking thread at the end of the frame
+	struct RecognitionEvent
+	{
+		RecognitionEvent() : m_userID(0), m_combinationIndex(0), m_recognizerSetID(0), m_frameID(0), m_timeStamp(0)
+		{
+		}
+
+		// OpenNI id of the user
+		unsigned int m_userID;
+		// Index of the combination, the same as in TrackingSnapshot::m_combinationNames
+		unsigned int m_combinationIndex;
+		// Recognizer set the combination belongs to, see TrackingSnapshot::m_recognizerSetID
+		unsigned int m_recognizerSetID;
+		// Id of the first snapshot that contains the recognition in its counts
+		unsigned int m_frameID;
+		// Time stamp of the tracking frame in which the combination has been completed
+		double m_timeStamp;
+		// Tracking data of the user at the transitions between the states of the combination,
+		// only filled if enabled with setRecognitionEventUserStates()
+		std::vector<FubiUser::CompactTrackingData> m_userStates;
+	};
+
+	// Function called by the tracking thread for each recognition event, must return quickly
+	typedef void (*RecognitionEventCallback)(const RecognitionEvent& event, void* userData);
+}
@@ -0,0 +1,70 @@
+// ****************************************************************************************
+//
+// Fubi Triple Buffer
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#pragma once
+
+#include <atomic>
+
+// Lock-free triple buffer for handing data from exactly one producer to exactly one consumer thread.
+// The producer always has a buffer to write into and never waits, the consumer always gets the latest
+// published buffer and never sees a half written one. Buffers that are published while the consumer
+// does not fetch are silently replaced by newer ones.
+template <class T>
+class FubiTripleBuffer
+{
+public:
+	FubiTripleBuffer() : m_shared(1), m_writeIndex(0), m_readIndex(2)
+	{
+	}
+
+	// Producer: the buffer to fill before calling publish()
+	T& getWriteBuffer()
+	{
+		return m_buffers[m_writeIndex];
+	}
+
+	// Producer: make the write buffer the latest one and continue on a free buffer
+	// Note that the new write buffer contains old data that has to be overwritten completely
+	void publish()
+	{
+		m_writeIndex = m_shared.exchange(m_writeIndex | s_newDataFlag) & s_indexMask;
+	}
+
+	// Consumer: take over the latest published buffer, returns false if nothing new has been published since the last call
+	bool fetch()
+	{
+		if ((m_shared.load() & s_newDataFlag) == 0)
+			return false;
+		m_readIndex = m_shared.exchange(m_readIndex) & s_indexMask;
+		return true;
+	}
+
+	// Consumer: the buffer taken over with the last fetch(), stays valid until the next fetch()
+	const T& getReadBuffer() const
+	{
+		return m_buffers[m_readIndex];
+	}
+
+private:
+	// Not copyable
+	FubiTripleBuffer(const FubiTripleBuffer&);
+	FubiTripleBuffer& operator=(const FubiTripleBuffer&);
+
+	static const unsigned int s_indexMask = 3;
+	static const unsigned int s_newDataFlag = 4;
+
+	T m_buffers[3];
+	// Index of the buffer in between producer and consumer plus the flag whether it contains new data
+	std::atomic<unsigned int> m_shared;
+	// Only touched by the producer
+	unsigned int m_writeIndex;
+	// Only touched by the consumer
+	unsigned int m_readIndex;
+};
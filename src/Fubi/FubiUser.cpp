@@ -13,21 +13,63 @@
 
 #include "FubiISensor.h"
 #include "FubiUtils.h"
+#include "FubiSkeleton.h"
+#include "FubiLocalTransformations.h"
 #include "FubiCore.h"
+#include "FubiProfiler.h"
 #include "FubiImageProcessing.h"
 #include "FubiRecognizerFactory.h"
 #include "GestureRecognizer/CombinationRecognizer.h"
+#include "GestureRecognizer/JointRelationTable.h"
 
 using namespace Fubi;
 
+namespace
+{
+	// Applies the orientation rule of each joint, the rule type is a compile time constant so only one branch remains per joint
+	struct GlobalOrientationCalculator
+	{
+		GlobalOrientationCalculator(const SkeletonJointPosition* positions, SkeletonJointOrientation* orientations)
+			: m_positions(positions), m_orientations(orientations)
+		{}
+
+		template<SkeletonJoint::Joint J>
+		void visit()
+		{
+			const Skeleton::OrientationRule& rule = Skeleton::GlobalOrientationRules[J];
+			switch (rule.m_type)
+			{
+			case Skeleton::OrientationRule::FROM_YX:
+				jointOrientationFromPositionsYX(m_positions[rule.m_joints[0]], m_positions[rule.m_joints[1]],
+					m_positions[rule.m_joints[2]], m_positions[rule.m_joints[3]], m_orientations[J]);
+				break;
+			case Skeleton::OrientationRule::FROM_X:
+				jointOrientationFromPositionX(m_positions[rule.m_joints[0]], m_positions[rule.m_joints[1]], m_orientations[J]);
+				break;
+			case Skeleton::OrientationRule::FROM_Y:
+				jointOrientationFromPositionY(m_positions[rule.m_joints[0]], m_positions[rule.m_joints[1]], m_orientations[J]);
+				break;
+			case Skeleton::OrientationRule::SAME_AS:
+				m_orientations[J] = m_orientations[rule.m_joints[0]];
+				break;
+			default:
+				break;
+			}
+		}
+
+		const SkeletonJointPosition* m_positions;
+		SkeletonJointOrientation* m_orientations;
+	};
+}
+
 FubiUser::FubiUser() : m_inScene(false), m_id(0), m_isTracked(false),
 	m_lastRightFingerDetection(-1), m_lastLeftFingerDetection(-1), m_fingerTrackIntervall(0.1),
 	m_maxFingerCountForMedian(10), m_useConvexityDefectMethod(false),
-	m_lastBodyMeasurementUpdate(0)
+	m_lastBodyMeasurementUpdate(0), m_numJointRelationResults(0), m_trackingFrameID(1), m_currentTrackingSlot(0)
 {
 	//  Init tracking data timestamps
-	m_currentTrackingData.timeStamp = 0;
-	m_lastTrackingData.timeStamp = 0;
+	for (unsigned int i = 0; i < NumTrackingDataFrames; ++i)
+		m_trackingData[i].timeStamp = 0;
 
 	// Init the posture combination recognizers
 	for (unsigned int i = 0; i < Combinations::NUM_COMBINATIONS; ++i)
@@ -54,8 +96,8 @@ FubiUser::~FubiUser()
 
 bool FubiUser::closerToSensor(const FubiUser* u1, const FubiUser* u2)
 {
-	const SkeletonJointPosition& pos1 = u1->m_currentTrackingData.jointPositions[SkeletonJoint::TORSO];
-	const SkeletonJointPosition& pos2 = u2->m_currentTrackingData.jointPositions[SkeletonJoint::TORSO];
+	const SkeletonJointPosition& pos1 = u1->getCurrentTrackingData().jointPositions[SkeletonJoint::TORSO];
+	const SkeletonJointPosition& pos2 = u2->getCurrentTrackingData().jointPositions[SkeletonJoint::TORSO];
 
 	if (u1->m_isTracked && pos1.m_confidence > 0.1f)
 	{
@@ -84,8 +126,8 @@ bool FubiUser::closerToSensor(const FubiUser* u1, const FubiUser* u2)
 
 bool FubiUser::moreLeft(const FubiUser* u1, const FubiUser* u2)
 {
-	const SkeletonJointPosition& pos1 = u1->m_currentTrackingData.jointPositions[SkeletonJoint::TORSO];
-	const SkeletonJointPosition& pos2 = u2->m_currentTrackingData.jointPositions[SkeletonJoint::TORSO];
+	const SkeletonJointPosition& pos1 = u1->getCurrentTrackingData().jointPositions[SkeletonJoint::TORSO];
+	const SkeletonJointPosition& pos2 = u2->getCurrentTrackingData().jointPositions[SkeletonJoint::TORSO];
 
 	if (u1->m_isTracked && pos1.m_confidence > 0.1f)
 	{
@@ -112,13 +154,18 @@ bool FubiUser::moreLeft(const FubiUser* u1, const FubiUser* u2)
 
 void FubiUser::clearUserDefinedCombinationRecognizers()
 {
-	std::map<std::string, CombinationRecognizer*>::iterator iter;
-	std::map<std::string, CombinationRecognizer*>::iterator end = m_userDefinedCombinationRecognizers.end();
+	std::vector<CombinationRecognizer*>::iterator iter;
+	std::vector<CombinationRecognizer*>::iterator end = m_userDefinedCombinationRecognizers.end();
 	for (iter = m_userDefinedCombinationRecognizers.begin(); iter != end; ++iter)
 	{
-		delete iter->second;
+		delete *iter;
 	}
 	m_userDefinedCombinationRecognizers.clear();
+	m_recognizedCombinations.clear();
+	m_numJointRelationResults = 0;
+	// The cache slots are reassigned with the next recognizers
+	m_cachedResultFrames.clear();
+	m_cachedResults.clear();
 }
 
 
@@ -136,23 +183,28 @@ void FubiUser::enableCombinationRecognition(Fubi::Combinations::Combination post
 
 void FubiUser::enableCombinationRecognition(const CombinationRecognizer* recognizerTemplate, bool enable)
 {
-	if (recognizerTemplate)
+	// Only the templates registered in the core have an index
+	if (recognizerTemplate && recognizerTemplate->getUserDefinedIndex() >= 0)
 	{
-		std::map<std::string, CombinationRecognizer*>::iterator rec = m_userDefinedCombinationRecognizers.find(recognizerTemplate->getName());
-		if (rec != m_userDefinedCombinationRecognizers.end())
+		unsigned int index = (unsigned int) recognizerTemplate->getUserDefinedIndex();
+		if (index < m_userDefinedCombinationRecognizers.size() && m_userDefinedCombinationRecognizers[index])
 		{
 			if (enable)
-				rec->second->start();
+				m_userDefinedCombinationRecognizers[index]->start();
 			else
 			{
-				rec->second->stop();
+				m_userDefinedCombinationRecognizers[index]->stop();
 			}
 		}
 		else if (enable)
 		{
 			CombinationRecognizer* clonedRec = recognizerTemplate->clone();
 			clonedRec->setUser(this);
-			m_userDefinedCombinationRecognizers[recognizerTemplate->getName()] = clonedRec;
+			if (index >= m_userDefinedCombinationRecognizers.size())
+				m_userDefinedCombinationRecognizers.resize(index + 1, 0x0);
+			m_userDefinedCombinationRecognizers[index] = clonedRec;
+			// Each combination is recognized at most once per frame
+			m_recognizedCombinations.reserve(m_userDefinedCombinationRecognizers.size());
 			clonedRec->start();
 		}
 	}
@@ -202,7 +254,7 @@ void FubiUser::addFingerCount(int count, bool leftHand /*= false*/)
 				if (m_leftFingerCount.size() > m_maxFingerCountForMedian)
 					m_leftFingerCount.pop_front();
 			}
-			m_lastLeftFingerDetection = Fubi::currentTime();
+			m_lastLeftFingerDetection = getCurrentTrackingData().timeStamp;
 		}
 	}
 	else
@@ -215,7 +267,7 @@ void FubiUser::addFingerCount(int count, bool leftHand /*= false*/)
 				if (m_rightFingerCount.size() > m_maxFingerCountForMedian)
 					m_rightFingerCount.pop_front();
 			}
-			m_lastRightFingerDetection = Fubi::currentTime();
+			m_lastRightFingerDetection = getCurrentTrackingData().timeStamp;
 		}
 	}
 }
@@ -275,83 +327,126 @@ int FubiUser::getFingerCount(bool leftHand /*= false*/, bool getMedianOfLastFram
 	return fingerCount;
 }
 
-void FubiUser::updateTrackingData(FubiISensor* sensor)
+int FubiUser::getTrackedFingerCount(bool leftHand /*= false*/, bool getMedianOfLastFrames /*= true*/)
+{
+	double& lastDetection = leftHand ? m_lastLeftFingerDetection : m_lastRightFingerDetection;
+	std::deque<int>& fingerCount = leftHand ? m_leftFingerCount : m_rightFingerCount;
+	if (lastDetection == -1)
+	{
+		fingerCount.clear();
+		lastDetection = 0;
+	}
+
+	if (fingerCount.empty())
+		return -1;
+	return getMedianOfLastFrames ? calculateMedianFingerCount(fingerCount) : fingerCount.back();
+}
+
+void FubiUser::updateTrackingData(FubiISensor* sensor, double timeStamp /*= -1*/)
+{
+	if (sensor && fetchTrackingData(sensor, sensor->hasNewTrackingData(), timeStamp))
+	{
+		processTrackingData();
+		updateFingerCount();
+	}
+}
+
+bool FubiUser::fetchTrackingData(FubiISensor* sensor, bool newSensorData, double timeStamp /*= -1*/)
 {
 	if (sensor)
 	{
 		// First update tracking state
 		m_isTracked = sensor->isTracking(m_id);
 
-		if (sensor->hasNewTrackingData())
+		if (newSensorData)
 		{
-			// Update timestamp
-			m_lastTrackingData.timeStamp = m_currentTrackingData.timeStamp;
-			m_currentTrackingData.timeStamp = Fubi::currentTime();
+			// Results of the last frame are outdated now
+			m_numJointRelationResults = 0;
+			++m_trackingFrameID;
+
+			double newTimeStamp = (timeStamp >= 0) ? timeStamp : Fubi::currentTime();
 
 			// The other joints are only valid if the user is tracked
 			if (m_isTracked)
 			{
+				// Backup old tracking info by switching to the next slot, the sensor overwrites all joints
+				nextTrackingSlot();
+				TrackingData& data = getCurrentTrackingData();
+				data.timeStamp = newTimeStamp;
+
 				// Get all joint positions for that user
 				for (unsigned int j=0; j < SkeletonJoint::NUM_JOINTS; ++j)
 				{
-					// Backup old tracking info
-					m_lastTrackingData.jointPositions[j] = m_currentTrackingData.jointPositions[j];
-					m_lastTrackingData.localJointPositions[j] = m_currentTrackingData.localJointPositions[j];
-					m_lastTrackingData.jointOrientations[j] = m_currentTrackingData.jointOrientations[j];
-					m_lastTrackingData.localJointOrientations[j] = m_currentTrackingData.localJointOrientations[j];
-
-					// And get new one
-					sensor->getSkeletonJointData(m_id, (SkeletonJoint::Joint) j, m_currentTrackingData.jointPositions[j], m_currentTrackingData.jointOrientations[j]);
+					sensor->getSkeletonJointData(m_id, (SkeletonJoint::Joint) j, data.jointPositions[j], data.jointOrientations[j]);
 				}
 
-				// Calculate local transformations out of the global ones
-				calculateLocalTransformations();
-
-				// Update body measurements (out of the local transformations)
-				updateBodyMeasurements();
-						
-				// Immediately update the posture combination recognizers (Only if new joint data is here)
-				updateCombinationRecognizers();
-
-				// Check and update finger detection
-				updateFingerCount();
+				// Everything else is calculated in processTrackingData()
+				return true;
 			}
 			else
 			{
+				// Update timestamp
+				TrackingData& data = getCurrentTrackingData();
+				TrackingData& lastData = getLastTrackingData();
+				lastData.timeStamp = data.timeStamp;
+				data.timeStamp = newTimeStamp;
+
 				// Only try to get the torso (should be independent of complete tracking)
-				m_lastTrackingData.jointPositions[SkeletonJoint::TORSO] = m_currentTrackingData.jointPositions[SkeletonJoint::TORSO];
-				sensor->getSkeletonJointData(m_id, SkeletonJoint::TORSO, m_currentTrackingData.jointPositions[SkeletonJoint::TORSO], m_currentTrackingData.jointOrientations[SkeletonJoint::TORSO]);
+				lastData.jointPositions[SkeletonJoint::TORSO] = data.jointPositions[SkeletonJoint::TORSO];
+				sensor->getSkeletonJointData(m_id, SkeletonJoint::TORSO, data.jointPositions[SkeletonJoint::TORSO], data.jointOrientations[SkeletonJoint::TORSO]);
 			}
 		}
 	}
+	return false;
+}
+
+void FubiUser::processTrackingData()
+{
+	// Calculate the local transformations needed by the loaded recognizers out of the global ones
+	FubiCore* core = FubiCore::getInstance();
+	if (core)
+		updateLocalTransformations(core->getLocalTransformationJoints());
+
+	// Update body measurements (out of the local transformations)
+	updateBodyMeasurements();
+
+	updateJointHistory();
+						
+	// Immediately update the posture combination recognizers (Only if new joint data is here)
+	updateCombinationRecognizers();
 }
 
 
 void FubiUser::addNewTrackingData(Fubi::SkeletonJointPosition* positions,
 	double timeStamp /*= -1*/, Fubi::SkeletonJointOrientation* orientations /*= 0*/, Fubi::SkeletonJointOrientation* localOrientations /*= 0*/)
 {
+	// Results of the last frame are outdated now
+	m_numJointRelationResults = 0;
+	++m_trackingFrameID;
+
+	// Backup old tracking info by switching to the next slot
+	nextTrackingSlot();
+	TrackingData& data = getCurrentTrackingData();
+	const TrackingData& lastData = getLastTrackingData();
+
 	// Update timestamp
-	m_lastTrackingData.timeStamp = m_currentTrackingData.timeStamp;
 	if (timeStamp >= 0)
-		m_currentTrackingData.timeStamp = timeStamp;
+		data.timeStamp = timeStamp;
 	else
-		m_currentTrackingData.timeStamp = Fubi::currentTime();
+		data.timeStamp = Fubi::currentTime();
 
 	// Set new transformations
 	for (unsigned int j=0; j < SkeletonJoint::NUM_JOINTS; ++j)
 	{
-		SkeletonJoint::Joint joint = (SkeletonJoint::Joint) j;
-		// Backup old tracking info
-		m_lastTrackingData.jointPositions[joint] = m_currentTrackingData.jointPositions[joint];
-		m_lastTrackingData.jointOrientations[joint] = m_currentTrackingData.jointOrientations[joint];
-		m_lastTrackingData.localJointOrientations[joint] = m_currentTrackingData.localJointOrientations[joint];
-		// And get new one
-		m_currentTrackingData.jointPositions[joint] = positions[j];
-		if (orientations)
-			m_currentTrackingData.jointOrientations[joint] = orientations[j];
+		data.jointPositions[j] = positions[j];
+		// Orientations that are not given and not calculated out of the positions keep their last values
+		data.jointOrientations[j] = orientations ? orientations[j] : lastData.jointOrientations[j];
 		if (localOrientations)
-			m_currentTrackingData.localJointOrientations[joint] = localOrientations[j];
+			data.localJointOrientations[j] = localOrientations[j];
 	}
+	// Local transformations are calculated when needed, except for given local orientations
+	if (localOrientations)
+		m_localTransformationsDone[m_currentTrackingSlot].m_orientationJoints = LocalTransformationJoints::all().m_orientationJoints;
 
 	if (orientations == 0)
 	{
@@ -359,14 +454,15 @@ void FubiUser::addNewTrackingData(Fubi::SkeletonJointPosition* positions,
 		calculateGlobalOrientations();
 	}
 
-	if (localOrientations == 0)
-	{
-		// Calculate local orientations out of the global ones according to the OpenNI skeleton
-		calculateLocalTransformations();
-	}
+	// Calculate the remaining local transformations needed by the loaded recognizers out of the global ones
+	FubiCore* core = FubiCore::getInstance();
+	if (core)
+		updateLocalTransformations(core->getLocalTransformationJoints());
 
 	// Update body measurements (out of the local transformations)
 	updateBodyMeasurements();
+
+	updateJointHistory();
 						
 	// Immediately update the posture combination recognizers (Only if new joint data is here)
 	updateCombinationRecognizers();
@@ -375,168 +471,76 @@ void FubiUser::addNewTrackingData(Fubi::SkeletonJointPosition* positions,
 	updateFingerCount();
 }
 
-void FubiUser::calculateGlobalOrientations()
+void FubiUser::CompactTrackingData::set(const TrackingData& data)
 {
-	Vec3f vx;
-	Vec3f vy;
-	Vec3f temp;
-
-	// Torso uses left-to-right-shoulder for x and torso-to-neck for y
-	jointOrientationFromPositionsYX(m_currentTrackingData.jointPositions[SkeletonJoint::TORSO], m_currentTrackingData.jointPositions[SkeletonJoint::NECK], 
-		m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_SHOULDER], m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_SHOULDER],
-		m_currentTrackingData.jointOrientations[SkeletonJoint::TORSO]);
-
-	// Waist uses the same as torso
-	m_currentTrackingData.jointOrientations[SkeletonJoint::WAIST] = m_currentTrackingData.jointOrientations[SkeletonJoint::TORSO];
-
-	// Neck uses left-to-right-shoulder for x and neck-to-head for y
-	jointOrientationFromPositionsYX(m_currentTrackingData.jointPositions[SkeletonJoint::NECK], m_currentTrackingData.jointPositions[SkeletonJoint::HEAD],
-		m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_SHOULDER], m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_SHOULDER],
-		m_currentTrackingData.jointOrientations[SkeletonJoint::NECK]);
-
-	// Head uses same as neck
-	m_currentTrackingData.jointOrientations[SkeletonJoint::HEAD] = m_currentTrackingData.jointOrientations[SkeletonJoint::NECK]; 
-	
-	// Shoulder uses elbow-to-shoulder for x
-	jointOrientationFromPositionX(m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_ELBOW], m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_SHOULDER],
-		m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_SHOULDER]);
-
-	// Elbow uses hand-to-elbow for x
-	jointOrientationFromPositionX(m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_HAND], m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_ELBOW],
-		m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_ELBOW]);
-
-	// Hand/wrist uses the same as elbow
-	m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_WRIST] = m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_HAND] = m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_ELBOW];
-
-	// Hip uses knee-to-hip for y and left-to-right-hip for x
-	jointOrientationFromPositionsYX(m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_KNEE], m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_HIP],
-		m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_HIP], m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_HIP],
-		m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_HIP]);
-
-	// Knee users foot-to-knee for y 	
-	jointOrientationFromPositionY(m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_FOOT], m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_KNEE],
-		m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_KNEE]);
-
-	// Foot/Ankle uses the same as knee
-	m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_ANKLE] = m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_FOOT] = m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_KNEE];
-
-
-	// Shoulder uses shoulder-to-elbow for x
-	jointOrientationFromPositionX(m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_SHOULDER], m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_ELBOW],
-		m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_SHOULDER]);
-
-	// Elbow uses elbow-to-hand for x
-	jointOrientationFromPositionX(m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_ELBOW], m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_HAND],
-	m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_ELBOW]);
-
-	// Hand/wrist uses the same as elbow
-	m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_WRIST] = m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_HAND] = m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_ELBOW];
-
-	// Hip uses knee-to-hip for y and left-to-right-hip for x
-	jointOrientationFromPositionsYX(m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_KNEE], m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_HIP],
-		m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_HIP], m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_HIP],
-		m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_HIP]);
+	for (unsigned int i = 0; i < SkeletonJoint::NUM_JOINTS; ++i)
+	{
+		m_joints[i].set(data.jointPositions[i], data.jointOrientations[i]);
+		m_localJoints[i].set(data.localJointPositions[i], data.localJointOrientations[i]);
+	}
+	timeStamp = data.timeStamp;
+}
 
-	// Knee users foot-to-knee for y 		
-	jointOrientationFromPositionY(m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_FOOT], m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_KNEE],
-		m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_KNEE]);
+void FubiUser::CompactTrackingData::get(TrackingData& data) const
+{
+	for (unsigned int i = 0; i < SkeletonJoint::NUM_JOINTS; ++i)
+	{
+		data.jointPositions[i] = jointPositions[i];
+		data.jointOrientations[i] = jointOrientations[i];
+		data.localJointPositions[i] = localJointPositions[i];
+		data.localJointOrientations[i] = localJointOrientations[i];
+	}
+	data.timeStamp = timeStamp;
+}
 
-	// Foot/ankle uses the same as knee
-	m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_ANKLE] = m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_FOOT] = m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_KNEE];
+void FubiUser::calculateGlobalOrientations()
+{
+	// Unrolled over all joints of the skeleton layout, see Fubi::Skeleton::GlobalOrientationRules for the positions each orientation is calculated from
+	GlobalOrientationCalculator calculator(getCurrentTrackingData().jointPositions, getCurrentTrackingData().jointOrientations);
+	Skeleton::ForEachJoint<>::apply(calculator);
 }
 
-void FubiUser::calculateLocalTransformations()
+void FubiUser::updateLocalTransformations(const Fubi::LocalTransformationJoints& joints, bool lastFrameToo /*= false*/)
 {
-	// Calculate new relative orientations
-	// Torso is the root, so the local orientation is the same as the global one
-	m_currentTrackingData.localJointOrientations[SkeletonJoint::TORSO] = m_currentTrackingData.jointOrientations[SkeletonJoint::TORSO];
-	// Neck
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::NECK], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::TORSO], m_currentTrackingData.localJointOrientations[SkeletonJoint::NECK]);
-	// Head
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::HEAD], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::NECK], m_currentTrackingData.localJointOrientations[SkeletonJoint::HEAD]);
-	// Nose
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::FACE_NOSE], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::HEAD], m_currentTrackingData.localJointOrientations[SkeletonJoint::FACE_NOSE]);
-	// Chin
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::FACE_CHIN], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::HEAD], m_currentTrackingData.localJointOrientations[SkeletonJoint::FACE_CHIN]);
-	// Forehead
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::FACE_FOREHEAD], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::HEAD], m_currentTrackingData.localJointOrientations[SkeletonJoint::FACE_FOREHEAD]);
-	// Left ear
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::FACE_LEFT_EAR], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::HEAD], m_currentTrackingData.localJointOrientations[SkeletonJoint::FACE_LEFT_EAR]);
-	// Right ear
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::FACE_RIGHT_EAR], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::HEAD], m_currentTrackingData.localJointOrientations[SkeletonJoint::FACE_RIGHT_EAR]);
-	// Left shoulder
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_SHOULDER], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::HEAD], m_currentTrackingData.localJointOrientations[SkeletonJoint::LEFT_SHOULDER]);
-	// Left elbow
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_ELBOW], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_SHOULDER], m_currentTrackingData.localJointOrientations[SkeletonJoint::LEFT_ELBOW]);
-	// Left wrist
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_WRIST], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_ELBOW], m_currentTrackingData.localJointOrientations[SkeletonJoint::LEFT_WRIST]);
-	// Left hand
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_HAND], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_WRIST], m_currentTrackingData.localJointOrientations[SkeletonJoint::LEFT_HAND]);
-	// Right shoulder
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_SHOULDER], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::NECK], m_currentTrackingData.localJointOrientations[SkeletonJoint::RIGHT_SHOULDER]);
-	// Right elbow
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_ELBOW], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_SHOULDER], m_currentTrackingData.localJointOrientations[SkeletonJoint::RIGHT_ELBOW]);
-	// Right wrist
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_WRIST], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_ELBOW], m_currentTrackingData.localJointOrientations[SkeletonJoint::RIGHT_WRIST]);
-	// Right hand
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_HAND], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_WRIST], m_currentTrackingData.localJointOrientations[SkeletonJoint::RIGHT_HAND]);
-	// Waist
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::WAIST], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::TORSO], m_currentTrackingData.localJointOrientations[SkeletonJoint::WAIST]);
-	// Left hip
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_HIP], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::WAIST], m_currentTrackingData.localJointOrientations[SkeletonJoint::LEFT_HIP]);
-	// Left knee
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_KNEE], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_HIP], m_currentTrackingData.localJointOrientations[SkeletonJoint::LEFT_KNEE]);
-	// Left ankle
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_ANKLE], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_KNEE], m_currentTrackingData.localJointOrientations[SkeletonJoint::LEFT_ANKLE]);
-	// Left foot
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_FOOT], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::LEFT_ANKLE], m_currentTrackingData.localJointOrientations[SkeletonJoint::LEFT_FOOT]);
-	// Right hip
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_HIP], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::WAIST], m_currentTrackingData.localJointOrientations[SkeletonJoint::RIGHT_HIP]);
-	// Right knee
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_KNEE], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_HIP], m_currentTrackingData.localJointOrientations[SkeletonJoint::RIGHT_KNEE]);
-	// Right ankle
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_ANKLE], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_KNEE], m_currentTrackingData.localJointOrientations[SkeletonJoint::RIGHT_ANKLE]);
-	// Right foot
-	Fubi::calculateLocalRotation(m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_FOOT], 
-		m_currentTrackingData.jointOrientations[SkeletonJoint::RIGHT_ANKLE], m_currentTrackingData.localJointOrientations[SkeletonJoint::RIGHT_FOOT]);
-
-	// Calculate local positions (removing the torso transformation=loc+rot from the position data)
-	// Torso is the root, so the local pos is the same as the global one
-	m_currentTrackingData.localJointPositions[SkeletonJoint::TORSO] = m_currentTrackingData.jointPositions[SkeletonJoint::TORSO];
-	const SkeletonJointPosition& torsoPos = m_currentTrackingData.jointPositions[SkeletonJoint::TORSO];
-	const SkeletonJointOrientation& torsoRot = m_currentTrackingData.jointOrientations[SkeletonJoint::TORSO];
-	for (unsigned int i = 0; i < SkeletonJoint::NUM_JOINTS; ++i)
+	calculateLocalTransformations(m_trackingData[m_currentTrackingSlot], m_localTransformationsDone[m_currentTrackingSlot], joints);
+	if (lastFrameToo)
 	{
-		if (i != SkeletonJoint::TORSO)
-			Fubi::calculateLocalPosition(m_currentTrackingData.jointPositions[i], torsoPos, torsoRot, m_currentTrackingData.localJointPositions[i]);
+		unsigned int lastSlot = getTrackingSlot(1);
+		calculateLocalTransformations(m_trackingData[lastSlot], m_localTransformationsDone[lastSlot], joints);
 	}
 }
 
+void FubiUser::nextTrackingSlot()
+{
+	m_currentTrackingSlot = (m_currentTrackingSlot + 1) % NumTrackingDataFrames;
+	// Nothing calculated for the new data yet
+	m_localTransformationsDone[m_currentTrackingSlot] = LocalTransformationJoints();
+}
+
+void FubiUser::calculateLocalTransformations(TrackingData& data, Fubi::LocalTransformationJoints& done, const Fubi::LocalTransformationJoints& joints)
+{
+	LocalTransformationJoints missing(joints.m_positionJoints & ~done.m_positionJoints, joints.m_orientationJoints & ~done.m_orientationJoints);
+	if (missing.isEmpty())
+		return;
+
+	FubiProfileScope profile(ProfilingStage::LOCAL_TRANSFORMATIONS);
+
+	// Calculate new relative orientations and local positions (removing the torso transformation=loc+rot from the position data)
+	// All missing joints at once, see Fubi::Skeleton::Parents for the joints the orientations are relative to
+	Fubi::calculateLocalTransformations(data.jointPositions, data.jointOrientations, data.localJointPositions, data.localJointOrientations, missing);
+	done |= missing;
+}
+
 void FubiUser::updateCombinationRecognizers()
 {
+	FubiProfileScope profile(ProfilingStage::COMBINATION_RECOGNIZERS);
+
+	// Evaluate all joint relations at once, the recognizers then only look up their results
+	evaluateJointRelations();
+
+	// Recognitions of older frames have already been reported or nobody is interested in them
+	m_recognizedCombinations.clear();
+
 	// Update the posture combination recognizers
 	for (unsigned int i=0; i < Fubi::Combinations::NUM_COMBINATIONS; ++i)
 	{
@@ -550,32 +554,65 @@ void FubiUser::updateCombinationRecognizers()
 			m_combinationRecognizers[i]->update();
 		}
 	}
-	std::map<std::string, CombinationRecognizer*>::iterator iter;
-	std::map<std::string, CombinationRecognizer*>::iterator end = m_userDefinedCombinationRecognizers.end();
+	std::vector<CombinationRecognizer*>::iterator iter;
+	std::vector<CombinationRecognizer*>::iterator end = m_userDefinedCombinationRecognizers.end();
 	for (iter = m_userDefinedCombinationRecognizers.begin(); iter != end; ++iter)
 	{
-		if (iter->second)
+		if (*iter)
 		{
-			if (!iter->second->isActive() && Fubi::getAutoStartCombinationRecognition())
+			if (!(*iter)->isActive() && Fubi::getAutoStartCombinationRecognition())
 			{
 				// Reactivate combination recognizers that should already be active
-				iter->second->start();
+				(*iter)->start();
+			}
+			(*iter)->update();
+		}
+	}
+}
+
+void FubiUser::evaluateJointRelations()
+{
+	m_numJointRelationResults = 0;
+	FubiCore* core = FubiCore::getInstance();
+	if (core)
+	{
+		const JointRelationTable& table = core->getJointRelationTable();
+		unsigned int numWords = table.getNumResultWords();
+		if (numWords > 0)
+		{
+			if (m_jointRelationRecognized.size() < numWords)
+			{
+				m_jointRelationRecognized.resize(numWords);
+				m_jointRelationErrors.resize(numWords);
 			}
-			iter->second->update();
+			table.evaluate(this, &m_jointRelationRecognized[0], &m_jointRelationErrors[0]);
+			m_numJointRelationResults = table.getNumEntries();
 		}
 	}
 }
 
+void FubiUser::updateJointHistory()
+{
+	FubiCore* core = FubiCore::getInstance();
+	if (core)
+	{
+		m_jointHistory.addFrame(getCurrentTrackingData().timeStamp, getCurrentTrackingData().jointPositions, getCurrentTrackingData().localJointPositions,
+			core->getJointHistoryWindows().getWindows(), core->getJointHistoryWindows().getTrajectories());
+	}
+}
+
 void FubiUser::updateFingerCount()
 {
+	FubiProfileScope profile(ProfilingStage::FINGER_COUNT);
+
 	// Check and update finger detection
 	if (m_lastLeftFingerDetection > -1
-		&& (Fubi::currentTime() - m_lastLeftFingerDetection) > m_fingerTrackIntervall)
+		&& (getCurrentTrackingData().timeStamp - m_lastLeftFingerDetection) > m_fingerTrackIntervall)
 	{
 		addFingerCount(getFingerCount(true, false, m_useConvexityDefectMethod), true);
 	}
 	if (m_lastRightFingerDetection > -1
-		&& (Fubi::currentTime() - m_lastRightFingerDetection) > m_fingerTrackIntervall)
+		&& (getCurrentTrackingData().timeStamp - m_lastRightFingerDetection) > m_fingerTrackIntervall)
 	{
 		addFingerCount(getFingerCount(false, false, m_useConvexityDefectMethod), false);
 	}
@@ -587,35 +624,35 @@ void FubiUser::updateBodyMeasurements()
 	static const float updateIntervall = 0.5f;
 
 	// Only once per second
-	if (Fubi::currentTime()-m_lastBodyMeasurementUpdate > updateIntervall)
+	if (getCurrentTrackingData().timeStamp-m_lastBodyMeasurementUpdate > updateIntervall)
 	{
-		m_lastBodyMeasurementUpdate = Fubi::currentTime();
+		m_lastBodyMeasurementUpdate = getCurrentTrackingData().timeStamp;
 
 		// Select joints
 		SkeletonJoint::Joint footToTake = SkeletonJoint::RIGHT_FOOT;
 		SkeletonJoint::Joint kneeForFoot = SkeletonJoint::RIGHT_KNEE;
-		if (m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_FOOT].m_confidence > m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_FOOT].m_confidence)
+		if (getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_FOOT].m_confidence > getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_FOOT].m_confidence)
 		{
 			footToTake = SkeletonJoint::LEFT_FOOT;
 			kneeForFoot = SkeletonJoint::LEFT_KNEE;
 		}
 		SkeletonJoint::Joint hipToTake = SkeletonJoint::RIGHT_HIP;
 		SkeletonJoint::Joint kneeForHip = SkeletonJoint::RIGHT_KNEE;
-		if (m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_KNEE].m_confidence > m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_KNEE].m_confidence)
+		if (getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_KNEE].m_confidence > getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_KNEE].m_confidence)
 		{
 			hipToTake = SkeletonJoint::LEFT_HIP;
 			kneeForHip = SkeletonJoint::LEFT_KNEE;
 		}
 		SkeletonJoint::Joint handToTake = SkeletonJoint::RIGHT_HAND;
 		SkeletonJoint::Joint elbowForHand = SkeletonJoint::RIGHT_ELBOW;
-		if (m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_HAND].m_confidence > m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_HAND].m_confidence)
+		if (getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_HAND].m_confidence > getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_HAND].m_confidence)
 		{
 			handToTake = SkeletonJoint::LEFT_HAND;
 			elbowForHand = SkeletonJoint::LEFT_ELBOW;
 		}
 		SkeletonJoint::Joint shoulderToTake = SkeletonJoint::RIGHT_SHOULDER;
 		SkeletonJoint::Joint elbowForShoulder = SkeletonJoint::RIGHT_ELBOW;
-		if (m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_ELBOW].m_confidence > m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_ELBOW].m_confidence)
+		if (getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_ELBOW].m_confidence > getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_ELBOW].m_confidence)
 		{
 			shoulderToTake = SkeletonJoint::LEFT_SHOULDER;
 			elbowForShoulder = SkeletonJoint::LEFT_ELBOW;
@@ -623,36 +660,36 @@ void FubiUser::updateBodyMeasurements()
 
 		// Body height
 		//Add the neck-head distance to compensate for the missing upper head part
-		SkeletonJointPosition headEnd(m_currentTrackingData.jointPositions[SkeletonJoint::HEAD]);
-		headEnd.m_position = headEnd.m_position + (headEnd.m_position-m_currentTrackingData.jointPositions[SkeletonJoint::NECK].m_position);
-		Fubi::calculateBodyMeasurement(m_currentTrackingData.jointPositions[footToTake],
+		SkeletonJointPosition headEnd(getCurrentTrackingData().jointPositions[SkeletonJoint::HEAD]);
+		headEnd.m_position = headEnd.m_position + (headEnd.m_position-getCurrentTrackingData().jointPositions[SkeletonJoint::NECK].m_position);
+		Fubi::calculateBodyMeasurement(getCurrentTrackingData().jointPositions[footToTake],
 			headEnd, m_bodyMeasurements[BodyMeasurement::BODY_HEIGHT], filterFac);
 
 		// Torso height
-		Fubi::calculateBodyMeasurement(m_currentTrackingData.jointPositions[SkeletonJoint::WAIST],
-			m_currentTrackingData.jointPositions[SkeletonJoint::NECK], m_bodyMeasurements[BodyMeasurement::TORSO_HEIGHT],filterFac);
+		Fubi::calculateBodyMeasurement(getCurrentTrackingData().jointPositions[SkeletonJoint::WAIST],
+			getCurrentTrackingData().jointPositions[SkeletonJoint::NECK], m_bodyMeasurements[BodyMeasurement::TORSO_HEIGHT],filterFac);
 
 		// Shoulder width
-		Fubi::calculateBodyMeasurement(m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_SHOULDER],
-			m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_SHOULDER], m_bodyMeasurements[BodyMeasurement::SHOULDER_WIDTH],filterFac);
+		Fubi::calculateBodyMeasurement(getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_SHOULDER],
+			getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_SHOULDER], m_bodyMeasurements[BodyMeasurement::SHOULDER_WIDTH],filterFac);
 
 		// Hip width
-		Fubi::calculateBodyMeasurement(m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_HIP],
-			m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_HIP], m_bodyMeasurements[BodyMeasurement::HIP_WIDTH],filterFac);
+		Fubi::calculateBodyMeasurement(getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_HIP],
+			getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_HIP], m_bodyMeasurements[BodyMeasurement::HIP_WIDTH],filterFac);
 
 		// Arm lengths
-		Fubi::calculateBodyMeasurement(m_currentTrackingData.jointPositions[shoulderToTake],
-			m_currentTrackingData.jointPositions[elbowForShoulder], m_bodyMeasurements[BodyMeasurement::UPPER_ARM_LENGTH],filterFac);
-		Fubi::calculateBodyMeasurement(m_currentTrackingData.jointPositions[handToTake],
-			m_currentTrackingData.jointPositions[elbowForHand], m_bodyMeasurements[BodyMeasurement::LOWER_ARM_LENGTH],filterFac);
+		Fubi::calculateBodyMeasurement(getCurrentTrackingData().jointPositions[shoulderToTake],
+			getCurrentTrackingData().jointPositions[elbowForShoulder], m_bodyMeasurements[BodyMeasurement::UPPER_ARM_LENGTH],filterFac);
+		Fubi::calculateBodyMeasurement(getCurrentTrackingData().jointPositions[handToTake],
+			getCurrentTrackingData().jointPositions[elbowForHand], m_bodyMeasurements[BodyMeasurement::LOWER_ARM_LENGTH],filterFac);
 		m_bodyMeasurements[BodyMeasurement::ARM_LENGTH].m_dist = m_bodyMeasurements[BodyMeasurement::LOWER_ARM_LENGTH].m_dist + m_bodyMeasurements[BodyMeasurement::UPPER_ARM_LENGTH].m_dist;
 		m_bodyMeasurements[BodyMeasurement::ARM_LENGTH].m_confidence = minf(m_bodyMeasurements[BodyMeasurement::LOWER_ARM_LENGTH].m_confidence, m_bodyMeasurements[BodyMeasurement::UPPER_ARM_LENGTH].m_confidence);
 
 		// Leg lengths
-		Fubi::calculateBodyMeasurement(m_currentTrackingData.jointPositions[hipToTake],
-			m_currentTrackingData.jointPositions[kneeForHip], m_bodyMeasurements[BodyMeasurement::UPPER_LEG_LENGTH],filterFac);
-		Fubi::calculateBodyMeasurement(m_currentTrackingData.jointPositions[footToTake],
-			m_currentTrackingData.jointPositions[kneeForFoot], m_bodyMeasurements[BodyMeasurement::LOWER_LEG_LENGTH],filterFac);
+		Fubi::calculateBodyMeasurement(getCurrentTrackingData().jointPositions[hipToTake],
+			getCurrentTrackingData().jointPositions[kneeForHip], m_bodyMeasurements[BodyMeasurement::UPPER_LEG_LENGTH],filterFac);
+		Fubi::calculateBodyMeasurement(getCurrentTrackingData().jointPositions[footToTake],
+			getCurrentTrackingData().jointPositions[kneeForFoot], m_bodyMeasurements[BodyMeasurement::LOWER_LEG_LENGTH],filterFac);
 		m_bodyMeasurements[BodyMeasurement::LEG_LENGTH].m_dist = m_bodyMeasurements[BodyMeasurement::LOWER_LEG_LENGTH].m_dist + m_bodyMeasurements[BodyMeasurement::UPPER_LEG_LENGTH].m_dist;
 		m_bodyMeasurements[BodyMeasurement::LEG_LENGTH].m_confidence = minf(m_bodyMeasurements[BodyMeasurement::LOWER_LEG_LENGTH].m_confidence, m_bodyMeasurements[BodyMeasurement::UPPER_LEG_LENGTH].m_confidence);
 	}
@@ -666,4 +703,9 @@ void FubiUser::reset()
 	m_lastRightFingerDetection = -1;
 	m_lastLeftFingerDetection = -1;
 	m_lastBodyMeasurementUpdate = 0;
+	m_numJointRelationResults = 0;
+	++m_trackingFrameID;
+	m_jointHistory.clear();
+	for (unsigned int i = 0; i < NumTrackingDataFrames; ++i)
+		m_localTransformationsDone[i] = LocalTransformationJoints();
 }
\ No newline at end of file
@@ -12,8 +12,11 @@
 
 #include "FubiPredefinedGestures.h"
 #include "FubiUtils.h"
+#include "FubiJointHistory.h"
+#include "FubiLocalTransformations.h"
 
 #include <map>
+#include <algorithm>
 #include <deque>
 #include <queue>
 
@@ -42,12 +45,25 @@ public:
 
 	// Gets the finger count optionally calculated by the median of the last 10 calculations
 	int getFingerCount(bool leftHand = false, bool getMedianOfLastFrames = true, bool useOldConvexityDefectMethod = false);
+	// Same, but only out of the detections of the finger tracking, so it never renders the shared depth image
+	// and can be called while the users are processed in parallel
+	// Enables the finger tracking of the hand if necessary, its detections then follow with the next updateFingerCount()
+	int getTrackedFingerCount(bool leftHand = false, bool getMedianOfLastFrames = true);
 
 	// Stops and removes all user defined 
 	void clearUserDefinedCombinationRecognizers();
 
-	// Update the tracking info from the given sensor
-	void updateTrackingData(class FubiISensor* sensor);
+	// Update the tracking info from the given sensor with the time stamp of the sensor frame (-1 for the current time)
+	void updateTrackingData(class FubiISensor* sensor, double timeStamp = -1);
+
+	// Same as updateTrackingData(), but split in two steps for updating several users in parallel:
+	// First get the joints from the sensor (has to be done one user after the other as the sensor is shared),
+	// returns true if new data has to be processed
+	bool fetchTrackingData(class FubiISensor* sensor, bool newSensorData, double timeStamp = -1);
+	// Then calculate everything else out of them and update the recognizers (independent of other users)
+	void processTrackingData();
+	// And finally update the finger count, again one user after the other as it renders the shared depth image
+	void updateFingerCount();
 
 	// Reset the user to an initial state
 	void reset();
@@ -56,11 +72,51 @@ public:
 	void addNewTrackingData(Fubi::SkeletonJointPosition* positions,
 		double timeStamp = -1, Fubi::SkeletonJointOrientation* orientations = 0, Fubi::SkeletonJointOrientation* localOrientations = 0);
 
+	// Calculate the local transformations of the given joints in the current (and optionally also in the last) tracking data
+	// Only the joints requested by the loaded recognizers are calculated in each frame, so call this before reading any others
+	// Joints that have already been calculated for the frame are skipped
+	void updateLocalTransformations(const Fubi::LocalTransformationJoints& joints, bool lastFrameToo = false);
+
 	const Fubi::FingerCountImageData* getFingerCountImageData(bool left = false)
 	{
 		return left ? &m_leftFingerCountImage : &m_rightFingerCountImage;
 	}
 
+	// Shared results of recognizers with the same definition (see IGestureRecognizer::getDefinitionKey()) for the current tracking data
+	bool getCachedResult(unsigned int slot, Fubi::RecognitionResult::Result& result) const
+	{
+		if (slot < m_cachedResultFrames.size() && m_cachedResultFrames[slot] == m_trackingFrameID)
+		{
+			result = m_cachedResults[slot];
+			return true;
+		}
+		return false;
+	}
+	void setCachedResult(unsigned int slot, Fubi::RecognitionResult::Result result)
+	{
+		if (slot >= m_cachedResultFrames.size())
+		{
+			m_cachedResultFrames.resize(slot+1, 0);
+			m_cachedResults.resize(slot+1, Fubi::RecognitionResult::NOT_RECOGNIZED);
+		}
+		m_cachedResultFrames[slot] = m_trackingFrameID;
+		m_cachedResults[slot] = result;
+	}
+
+	// Get the result of an entry of the joint relation table for the current tracking data
+	// Returns false if the table has not been evaluated for this data yet
+	bool getJointRelationResult(unsigned int index, Fubi::RecognitionResult::Result& result) const
+	{
+		if (index >= m_numJointRelationResults)
+			return false;
+		unsigned int bit = 1u << (index % 32);
+		if (m_jointRelationErrors[index / 32] & bit)
+			result = Fubi::RecognitionResult::TRACKING_ERROR;
+		else
+			result = (m_jointRelationRecognized[index / 32] & bit) ? Fubi::RecognitionResult::RECOGNIZED : Fubi::RecognitionResult::NOT_RECOGNIZED;
+		return true;
+	}
+
 	// Whether the user is currently seen in the depth image
 	bool m_inScene;
 
@@ -79,7 +135,103 @@ public:
 		Fubi::SkeletonJointOrientation localJointOrientations[Fubi::SkeletonJoint::NUM_JOINTS];
 		double timeStamp;
 	};
-	TrackingData m_currentTrackingData, m_lastTrackingData;
+
+	// Number of frames of which the tracking data is kept, at least the current and the last one
+	static const unsigned int NumTrackingDataFrames = 2;
+
+	// Tracking data of the current frame and the ones before
+	// Each frame has its own slot, so on a new frame only the index of the current slot changes instead of copying the data
+	TrackingData& getCurrentTrackingData() { return m_trackingData[m_currentTrackingSlot]; }
+	const TrackingData& getCurrentTrackingData() const { return m_trackingData[m_currentTrackingSlot]; }
+	TrackingData& getLastTrackingData() { return getTrackingData(1); }
+	const TrackingData& getLastTrackingData() const { return getTrackingData(1); }
+	// framesAgo has to be less than NumTrackingDataFrames
+	TrackingData& getTrackingData(unsigned int framesAgo) { return m_trackingData[getTrackingSlot(framesAgo)]; }
+	const TrackingData& getTrackingData(unsigned int framesAgo) const { return m_trackingData[getTrackingSlot(framesAgo)]; }
+
+	// Compact copy of the tracking data for snapshots, with one Fubi::CompactSkeletonJoint record per joint
+	// (less than 60% of the memory). Reading works the same as for TrackingData, e.g. data.jointPositions[joint].m_position,
+	// only that the values are decoded on each access, the orientation matrices included
+	struct CompactTrackingData
+	{
+		CompactTrackingData() : timeStamp(0)
+		{
+			bindViews();
+			Fubi::SkeletonJointPosition position;
+			Fubi::SkeletonJointOrientation orientation;
+			for (unsigned int i = 0; i < Fubi::SkeletonJoint::NUM_JOINTS; ++i)
+			{
+				m_joints[i].set(position, orientation);
+				m_localJoints[i].set(position, orientation);
+			}
+		}
+		explicit CompactTrackingData(const TrackingData& data)
+		{
+			bindViews();
+			set(data);
+		}
+		// The views always refer to the own records, so only the records are copied
+		CompactTrackingData(const CompactTrackingData& other)
+			: timeStamp(other.timeStamp)
+		{
+			bindViews();
+			std::copy(other.m_joints, other.m_joints + Fubi::SkeletonJoint::NUM_JOINTS, m_joints);
+			std::copy(other.m_localJoints, other.m_localJoints + Fubi::SkeletonJoint::NUM_JOINTS, m_localJoints);
+		}
+		CompactTrackingData& operator=(const CompactTrackingData& other)
+		{
+			std::copy(other.m_joints, other.m_joints + Fubi::SkeletonJoint::NUM_JOINTS, m_joints);
+			std::copy(other.m_localJoints, other.m_localJoints + Fubi::SkeletonJoint::NUM_JOINTS, m_localJoints);
+			timeStamp = other.timeStamp;
+			return *this;
+		}
+		CompactTrackingData& operator=(const TrackingData& data)
+		{
+			set(data);
+			return *this;
+		}
+		void set(const TrackingData& data);
+		// Decode all joints into the full layout
+		void get(TrackingData& data) const;
+
+		// One record per joint with its position and orientation, in global and local space
+		Fubi::CompactSkeletonJoint m_joints[Fubi::SkeletonJoint::NUM_JOINTS];
+		Fubi::CompactSkeletonJoint m_localJoints[Fubi::SkeletonJoint::NUM_JOINTS];
+		double timeStamp;
+
+		// Read-only view on the records that returns one part of a joint like an array of TrackingData
+		template<class Element, Element (Fubi::CompactSkeletonJoint::*Get)() const>
+		struct JointView
+		{
+			JointView() : m_joints(0x0) {}
+			Element operator[](unsigned int joint) const
+			{
+				return (m_joints[joint].*Get)();
+			}
+			const Fubi::CompactSkeletonJoint* m_joints;
+		};
+		typedef JointView<Fubi::SkeletonJointPosition, &Fubi::CompactSkeletonJoint::getPosition> PositionView;
+		typedef JointView<Fubi::SkeletonJointOrientation, &Fubi::CompactSkeletonJoint::getOrientation> OrientationView;
+
+		// The position and orientation views read the same records
+		PositionView jointPositions;
+		OrientationView jointOrientations;
+		PositionView localJointPositions;
+		OrientationView localJointOrientations;
+
+	private:
+		// Point the views to the own records, done in the constructor bodies after the records exist
+		void bindViews()
+		{
+			jointPositions.m_joints = m_joints;
+			jointOrientations.m_joints = m_joints;
+			localJointPositions.m_joints = m_localJoints;
+			localJointOrientations.m_joints = m_localJoints;
+		}
+	};
+
+	// Joint positions of the last frames with the movement over the windows requested by the recognizers
+	FubiJointHistory m_jointHistory;
 
 	// The user's body measurements
 	Fubi::BodyMeasurementDistance m_bodyMeasurements[Fubi::BodyMeasurement::NUM_MEASUREMENTS];
@@ -87,8 +239,10 @@ public:
 
 	// One posture combination recognizer per posture combination
 	CombinationRecognizer* m_combinationRecognizers[Fubi::Combinations::NUM_COMBINATIONS];
-	// And all user defined ones that are currently enabled
-	std::map<std::string, CombinationRecognizer*> m_userDefinedCombinationRecognizers;
+	// And all user defined ones, indexed by the index of the user defined combination recognizer (0x0 if never enabled)
+	std::vector<CombinationRecognizer*> m_userDefinedCombinationRecognizers;
+	// User defined combinations recognized in the current frame, collected by FubiCore for the recognition events
+	std::vector<CombinationRecognizer*> m_recognizedCombinations;
 
 	// Time between the finger count detection of one hand
 	double m_fingerTrackIntervall;
@@ -105,11 +259,23 @@ private:
 
 	void calculateGlobalOrientations();
 
-	void calculateLocalTransformations();
+	// Calculate the local transformations of the joints that are requested, but not done yet in the given tracking data
+	static void calculateLocalTransformations(TrackingData& data, Fubi::LocalTransformationJoints& done, const Fubi::LocalTransformationJoints& joints);
+
+	unsigned int getTrackingSlot(unsigned int framesAgo) const
+	{
+		return (m_currentTrackingSlot + NumTrackingDataFrames - framesAgo) % NumTrackingDataFrames;
+	}
+	// The oldest slot becomes the current one, the former current data is the last one then
+	void nextTrackingSlot();
 
 	void updateCombinationRecognizers();
 
-	void updateFingerCount();
+	// Evaluate the joint relation table of the current recognizer set in one pass
+	void evaluateJointRelations();
+
+	// Add the current frame to the joint history
+	void updateJointHistory();
 
 	int calculateMedianFingerCount(const std::deque<int>& fingerCount);
 
@@ -118,4 +284,19 @@ private:
 	std::deque<int> m_rightFingerCount, m_leftFingerCount;		
 
 	Fubi::FingerCountImageData m_leftFingerCountImage, m_rightFingerCountImage;
+
+	// Result bits of the joint relation table, one bit per entry
+	std::vector<unsigned int> m_jointRelationRecognized, m_jointRelationErrors;
+	// Number of entries evaluated on the current tracking data, 0 if outdated
+	unsigned int m_numJointRelationResults;
+
+	// Counts the tracking data updates, cached results are only valid for the frame they were calculated in
+	unsigned int m_trackingFrameID;
+	std::vector<unsigned int> m_cachedResultFrames;
+	std::vector<Fubi::RecognitionResult::Result> m_cachedResults;
+
+	TrackingData m_trackingData[NumTrackingDataFrames];
+	unsigned int m_currentTrackingSlot;
+	// Joints of which the local transformations are already calculated, per slot of the tracking data
+	Fubi::LocalTransformationJoints m_localTransformationsDone[NumTrackingDataFrames];
 };
\ No newline at end of file
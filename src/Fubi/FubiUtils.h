@@ -12,6 +12,7 @@
 
 #include <cmath>
 #include <time.h>
+#include <chrono>
 #include <string>
 #include <map>
 
@@ -188,7 +189,11 @@ namespace Fubi
 			/** Sensor based on OpenNI 1.x**/
 			OPENNI1 = 2,
 			/** Sensor based on the Kinect for Windows SDK 1.x**/
-			KINECTSDK = 4
+			KINECTSDK = 4,
+			/** Replays a skeleton recording (see Fubi::startRecording()) instead of using a real sensor**/
+			REPLAY = 8,
+			/** Generates animated users performing scripted gestures, e.g. for scaling tests with many users**/
+			SYNTHETIC = 16
 		};
 	};
 
@@ -206,6 +211,36 @@ namespace Fubi
 		int m_fps;
 	};
 
+	struct ReplayOptions
+	{
+		ReplayOptions(const std::string& fileName = "", bool realTime = true, bool loop = false)
+			: m_fileName(fileName), m_realTime(realTime), m_loop(loop)
+		{}
+		// Recording to replay with the REPLAY sensor type
+		std::string m_fileName;
+		// Keep the recorded timing or replay as fast as possible (time stamps still follow the recording)
+		bool m_realTime;
+		// Start again from the beginning after the last frame
+		bool m_loop;
+	};
+
+	struct SyntheticOptions
+	{
+		SyntheticOptions(unsigned int numUsers = 1, float jointNoise = 0, float dropoutRate = 0, bool realTime = true, unsigned int seed = 0)
+			: m_numUsers(numUsers), m_jointNoise(jointNoise), m_dropoutRate(dropoutRate), m_realTime(realTime), m_seed(seed)
+		{}
+		// Number of generated users (up to MaxUsers)
+		unsigned int m_numUsers;
+		// Standard deviation of the noise added to the joint positions in millimeters
+		float m_jointNoise;
+		// Probability of a joint to lose its tracking (confidence 0) in a frame
+		float m_dropoutRate;
+		// Deliver the frames with the fps of the depth stream or a new frame on each update (time stamps still advance by one frame)
+		bool m_realTime;
+		// Seed for the noise and dropouts, the same seed gives the same data
+		unsigned int m_seed;
+	};
+
 	struct SensorOptions
 	{
 		SensorOptions(const StreamOptions& depthOptions = StreamOptions(),
@@ -232,6 +267,10 @@ namespace Fubi
 		float m_smoothing;
 		bool m_mirrorStreams;
 		SensorType::Type m_type;
+		// Only used by the REPLAY sensor type
+		ReplayOptions m_replayOptions;
+		// Only used by the SYNTHETIC sensor type
+		SyntheticOptions m_syntheticOptions;
 	};
 
 	struct FingerCountImageData
@@ -338,10 +377,13 @@ namespace Fubi
 
 	/**
 	 * \brief Number of seconds since the program start
+	 *        Measured with a monotonic high resolution wall clock, so it is independent of the CPU load and the number of threads
+	 *        (more precisely since the first call within this module)
 	 */
-	static double currentTime()
+	inline double currentTime()
 	{
-	  return double(clock()) / CLOCKS_PER_SEC;
+		static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
 	}
 
 	static const char* getJointName(SkeletonJoint::Joint id)
@@ -1176,6 +1218,44 @@ public:
 		return this->transposed() * d;
 	}
 
+	// Unit quaternion of this rotation matrix, the identity if it is no rotation (e.g. all zero for untracked joints)
+	Quaternion getQuaternion() const
+	{
+		if (determinant() <= 0)
+			return Quaternion(0, 0, 0, 1.0f);
+
+		// Matrix is stored column major: c[column][row]
+		const float r00 = c[0][0], r01 = c[1][0], r02 = c[2][0];
+		const float r10 = c[0][1], r11 = c[1][1], r12 = c[2][1];
+		const float r20 = c[0][2], r21 = c[1][2], r22 = c[2][2];
+		const float trace = r00 + r11 + r22;
+		float s;
+		if (trace > 0)
+		{
+			s = sqrtf(trace + 1.0f) * 2.0f;
+			return Quaternion((r21 - r12) / s, (r02 - r20) / s, (r10 - r01) / s, 0.25f * s);
+		}
+		if (r00 > r11 && r00 > r22)
+		{
+			s = sqrtf(1.0f + r00 - r11 - r22) * 2.0f;
+			if (s > 0)
+				return Quaternion(0.25f * s, (r01 + r10) / s, (r02 + r20) / s, (r21 - r12) / s);
+		}
+		else if (r11 > r22)
+		{
+			s = sqrtf(1.0f + r11 - r00 - r22) * 2.0f;
+			if (s > 0)
+				return Quaternion((r01 + r10) / s, 0.25f * s, (r12 + r21) / s, (r02 - r20) / s);
+		}
+		else
+		{
+			s = sqrtf(1.0f + r22 - r00 - r11) * 2.0f;
+			if (s > 0)
+				return Quaternion((r02 + r20) / s, (r12 + r21) / s, 0.25f * s, (r10 - r01) / s);
+		}
+		return Quaternion(0, 0, 0, 1.0f);
+	}
+
 	Vec3f getRot(bool inDegree = true) const
 	{
 		Vec3f rot;
@@ -1373,7 +1453,7 @@ public:
 	{
 		c[0][0] = m3.c[0][0]; c[1][0] = m3.c[1][0]; c[2][0] = m3.c[2][0]; c[3][0] = 0;
 		c[0][1] = m3.c[0][1]; c[1][1] = m3.c[1][1]; c[2][1] = m3.c[2][1]; c[3][1] = 0;
-		c[0][2] = m3.c[0][2]; c[1][2] = m3.c[1][2]; c[2][2] = m3.c[2][0]; c[3][2] = 0;
+		c[0][2] = m3.c[0][2]; c[1][2] = m3.c[1][2]; c[2][2] = m3.c[2][2]; c[3][2] = 0;
 		c[0][3] = 0;		  c[1][3] = 0;			c[2][3] = 0;		  c[3][3] = 1;
 	}
 
@@ -1531,7 +1611,7 @@ public:
 		Matrix4f m( Math::NO_INIT );
 
 		float d = determinant();
-		if( d == 0 ) return m;
+		if( d == 0 ) return Matrix4f();
 		d = 1.0f / d;
 		
 		m.c[0][0] = d * (c[1][2]*c[2][3]*c[3][1] - c[1][3]*c[2][2]*c[3][1] + c[1][3]*c[2][1]*c[3][2] - c[1][1]*c[2][3]*c[3][2] - c[1][2]*c[2][1]*c[3][3] + c[1][1]*c[2][2]*c[3][3]);
@@ -1838,6 +1918,51 @@ struct SkeletonJointOrientation
 	Matrix3f m_orientation;
 };
 
+// Position and orientation of a joint packed into 32 bytes for compact copies of the tracking data:
+// the orientation as unit quaternion (the matrix is derived on demand) and both confidences in 16 bit
+struct alignas(32) CompactSkeletonJoint
+{
+	void set(const SkeletonJointPosition& position, const SkeletonJointOrientation& orientation)
+	{
+		Quaternion q = orientation.m_orientation.getQuaternion();
+		m_orientation[0] = q.x;
+		m_orientation[1] = q.y;
+		m_orientation[2] = q.z;
+		m_orientation[3] = q.w;
+		m_position[0] = position.m_position.x;
+		m_position[1] = position.m_position.y;
+		m_position[2] = position.m_position.z;
+		m_positionConfidence = packConfidence(position.m_confidence);
+		m_orientationConfidence = packConfidence(orientation.m_confidence);
+	}
+	SkeletonJointPosition getPosition() const
+	{
+		return SkeletonJointPosition(m_position[0], m_position[1], m_position[2], m_positionConfidence / ConfidenceScale);
+	}
+	SkeletonJointOrientation getOrientation() const
+	{
+		return SkeletonJointOrientation(Quaternion(m_orientation[0], m_orientation[1], m_orientation[2], m_orientation[3]), m_orientationConfidence / ConfidenceScale);
+	}
+
+	// Plain data without constructor, so arrays of the records are cheap to create and copy
+	float m_orientation[4];
+	float m_position[3];
+	unsigned short m_positionConfidence;
+	unsigned short m_orientationConfidence;
+
+private:
+	static unsigned short packConfidence(float confidence)
+	{
+		if (confidence <= 0)
+			return 0;
+		if (confidence >= 1.0f)
+			return (unsigned short) ConfidenceScale;
+		return (unsigned short) (confidence * ConfidenceScale + 0.5f);
+	}
+	static constexpr float ConfidenceScale = 65535.0f;
+};
+static_assert(sizeof(CompactSkeletonJoint) == 32, "A compact joint has to fill exactly 32 bytes");
+
 struct BodyMeasurementDistance
 {
 	BodyMeasurementDistance() : m_confidence(0), m_dist(0) {}
@@ -16,13 +16,13 @@ using namespace Fubi;
 Fubi::RecognitionResult::Result ArmsCrossedRecognizer::recognizeOn(FubiUser* user)
 {
 	bool recognized = false;
-	const SkeletonJointPosition& rightElbow = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_ELBOW];
-	const SkeletonJointPosition& rightShoulder = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_SHOULDER];
-	const SkeletonJointPosition& rightHand = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_HAND];
+	const SkeletonJointPosition& rightElbow = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_ELBOW];
+	const SkeletonJointPosition& rightShoulder = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_SHOULDER];
+	const SkeletonJointPosition& rightHand = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_HAND];
 
-	const SkeletonJointPosition& leftHand = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_HAND];
-	const SkeletonJointPosition& leftElbow = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_ELBOW];
-	const SkeletonJointPosition& leftShoulder = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_SHOULDER];
+	const SkeletonJointPosition& leftHand = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_HAND];
+	const SkeletonJointPosition& leftElbow = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_ELBOW];
+	const SkeletonJointPosition& leftShoulder = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_SHOULDER];
 	
 	if (rightHand.m_confidence >= m_minConfidence && rightElbow.m_confidence >= m_minConfidence
 		&& leftHand.m_confidence >= m_minConfidence && leftElbow.m_confidence >= m_minConfidence
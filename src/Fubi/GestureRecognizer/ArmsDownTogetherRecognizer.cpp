@@ -17,10 +17,10 @@ using namespace Fubi;
 Fubi::RecognitionResult::Result ArmsDownTogetherRecognizer::recognizeOn(FubiUser* user)
 {
 	bool recognized = false;
-	const SkeletonJointPosition& rightHand = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_HAND];
-	const SkeletonJointPosition& rightShoulder = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_SHOULDER];
-	const SkeletonJointPosition& leftHand = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_HAND];
-	const SkeletonJointPosition& leftShoulder = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_SHOULDER];
+	const SkeletonJointPosition& rightHand = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_HAND];
+	const SkeletonJointPosition& rightShoulder = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_SHOULDER];
+	const SkeletonJointPosition& leftHand = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_HAND];
+	const SkeletonJointPosition& leftShoulder = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_SHOULDER];
 	if (rightHand.m_confidence >= m_minConfidence && rightShoulder.m_confidence >= m_minConfidence
 		&& leftHand.m_confidence >= m_minConfidence && leftShoulder.m_confidence >= m_minConfidence)
 	{
@@ -20,23 +20,104 @@ using namespace Fubi;
 
 const std::vector<IGestureRecognizer*> RecognitionState::s_emptyRecVec = std::vector<IGestureRecognizer*>();
 
+RecognitionStateList::~RecognitionStateList()
+{
+	for (std::vector<RecognitionState>::iterator iter = m_states.begin(); iter != m_states.end(); ++iter)
+	{
+		for (RecognitionState::GestureIter iter2 = iter->m_gestures.begin(); iter2 != iter->m_gestures.end(); ++iter2)
+		{
+			delete (*iter2);
+		}
+		iter->m_gestures.clear();
+
+		for (RecognitionState::GestureIter iter3 = iter->m_notGestures.begin(); iter3 != iter->m_notGestures.end(); ++iter3)
+		{
+			delete (*iter3);
+		}
+		iter->m_notGestures.clear();
+
+		for (RecognitionState::GestureIter iter4 = iter->m_alternativeGestures.begin(); iter4 != iter->m_alternativeGestures.end(); ++iter4)
+		{
+			delete (*iter4);
+		}
+		iter->m_alternativeGestures.clear();
+
+		for (RecognitionState::GestureIter iter5 = iter->m_alternativeNotGestures.begin(); iter5 != iter->m_alternativeNotGestures.end(); ++iter5)
+		{
+			delete (*iter5);
+		}
+		iter->m_alternativeNotGestures.clear();
+	}
+}
+
+void RecognitionStateList::updateFirstStateJoints()
+{
+	m_firstStateJoints = 0;
+	m_firstStateMinConfidence = Math::MaxFloat;
+	if (m_states.empty())
+		return;
+
+	const RecognitionState& state = m_states.front();
+	const std::vector<IGestureRecognizer*>* lists[] = { &state.m_gestures, &state.m_notGestures, &state.m_alternativeGestures, &state.m_alternativeNotGestures };
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		for (RecognitionState::GestureIter iter = lists[i]->begin(); iter != lists[i]->end(); ++iter)
+		{
+			unsigned int joints = (*iter)->getRequiredJoints();
+			if (joints == 0)
+			{
+				// Unknown requirements, so never skip the state
+				m_firstStateJoints = 0;
+				return;
+			}
+			m_firstStateJoints |= joints;
+			m_firstStateMinConfidence = minf(m_firstStateMinConfidence, (*iter)->m_minConfidence);
+		}
+	}
+}
+
+bool RecognitionStateList::isFirstStateUntracked(const FubiUser* user) const
+{
+	if (m_firstStateJoints == 0)
+		return false;
+
+	for (unsigned int joint = 0; joint < SkeletonJoint::NUM_JOINTS; ++joint)
+	{
+		if ((m_firstStateJoints & (1u << joint)) && user->getCurrentTrackingData().jointPositions[joint].m_confidence >= m_firstStateMinConfidence)
+			return false;
+	}
+	return true;
+}
+
 CombinationRecognizer::CombinationRecognizer(FubiUser* user, Combinations::Combination gestureID)
-	: m_currentState(-1), m_stateStart(0), m_minDurationPassed(false), m_user(user), m_running(false), m_gestureID(gestureID),
-	m_interruptionStart(0), m_interrupted(false), m_recognized(false), m_waitUntilLastStateRecognizersStop(false)
+	: m_running(false), m_sharedStates(new RecognitionStateList()), m_RecognitionStates(m_sharedStates->m_states),
+	m_numAttempts(0), m_maxAttempts(1), m_recognized(false), m_user(user), m_gestureID(gestureID),
+	m_waitUntilLastStateRecognizersStop(false), m_userDefinedIndex(-1),
+	m_firstUserState(0), m_numUserStates(0)
 {
 	m_name = getCombinationName(gestureID);
 }
 
 CombinationRecognizer::CombinationRecognizer(const std::string& recognizerName)	// Only for creating a template recognizer, will not work until m_user is set
-	: m_currentState(-1), m_stateStart(0), m_minDurationPassed(false), m_user(0x0), m_running(false), m_gestureID(Combinations::NUM_COMBINATIONS),
-	m_interruptionStart(0), m_interrupted(false), m_recognized(false), m_name(recognizerName), m_waitUntilLastStateRecognizersStop(false)
+	: m_running(false), m_sharedStates(new RecognitionStateList()), m_RecognitionStates(m_sharedStates->m_states),
+	m_numAttempts(0), m_maxAttempts(1), m_recognized(false), m_user(0x0), m_gestureID(Combinations::NUM_COMBINATIONS),
+	m_name(recognizerName), m_waitUntilLastStateRecognizersStop(false), m_userDefinedIndex(-1),
+	m_firstUserState(0), m_numUserStates(0)
 {
 }
 
 CombinationRecognizer::CombinationRecognizer(const CombinationRecognizer& other)
-	: m_currentState(-1), m_stateStart(0), m_minDurationPassed(false), m_user(other.m_user), m_running(false), m_gestureID(other.m_gestureID),
-	m_interruptionStart(0), m_interrupted(false), m_recognized(false), m_name(other.m_name), m_waitUntilLastStateRecognizersStop(other.m_waitUntilLastStateRecognizersStop)
+	: m_running(false),
+	m_sharedStates(other.hasUserStateRecognizers() ? std::shared_ptr<RecognitionStateList>(new RecognitionStateList()) : other.m_sharedStates),
+	m_RecognitionStates(m_sharedStates->m_states),
+	m_numAttempts(0), m_maxAttempts(other.m_maxAttempts), m_recognized(false), m_user(other.m_user), m_gestureID(other.m_gestureID),
+	m_name(other.m_name), m_waitUntilLastStateRecognizersStop(other.m_waitUntilLastStateRecognizersStop), m_userDefinedIndex(other.m_userDefinedIndex),
+	m_firstUserState(0), m_numUserStates(0)
 {
+	// Stateless recognizers are shared with the other, only recognizers with a state per user need a deep copy
+	if (m_sharedStates == other.m_sharedStates)
+		return;
+
 	for (std::vector<RecognitionState>::const_iterator iter = other.m_RecognitionStates.begin(); iter != other.m_RecognitionStates.end(); ++iter)
 	{
 		std::vector<IGestureRecognizer*> recognizers;
@@ -61,37 +142,33 @@ CombinationRecognizer::CombinationRecognizer(const CombinationRecognizer& other)
 		}
 		m_RecognitionStates.push_back(RecognitionState(recognizers, notRecognizers, iter->m_minDuration, iter->m_maxDuration, iter->m_timeForTransition, iter->m_maxInterruptionTime, iter->m_noInterrruptionBeforeMinDuration, alternativeRecognizers, alternativeNotRecognizers));
 	}
+	m_sharedStates->updateFirstStateJoints();
 }
 
 CombinationRecognizer::~CombinationRecognizer()
 {
 	stop();
+	// The recognizers are deleted with the last recognizer sharing them
+}
 
-	for (std::vector<RecognitionState>::iterator iter = m_RecognitionStates.begin(); iter != m_RecognitionStates.end(); ++iter)
+bool CombinationRecognizer::hasUserStateRecognizers() const
+{
+	for (std::vector<RecognitionState>::const_iterator iter = m_RecognitionStates.begin(); iter != m_RecognitionStates.end(); ++iter)
 	{
 		for (RecognitionState::GestureIter iter2 = iter->m_gestures.begin(); iter2 != iter->m_gestures.end(); ++iter2)
-		{
-			delete (*iter2);
-		}
-		iter->m_gestures.clear();
-
+			if ((*iter2)->hasUserState())
+				return true;
 		for (RecognitionState::GestureIter iter3 = iter->m_notGestures.begin(); iter3 != iter->m_notGestures.end(); ++iter3)
-		{
-			delete (*iter3);
-		}
-		iter->m_alternativeNotGestures.clear();
+			if ((*iter3)->hasUserState())
+				return true;
 		for (RecognitionState::GestureIter iter4 = iter->m_alternativeGestures.begin(); iter4 != iter->m_alternativeGestures.end(); ++iter4)
-		{
-			delete (*iter4);
-		}
-		iter->m_alternativeGestures.clear();
-
+			if ((*iter4)->hasUserState())
+				return true;
 		for (RecognitionState::GestureIter iter5 = iter->m_alternativeNotGestures.begin(); iter5 != iter->m_alternativeNotGestures.end(); ++iter5)
-		{
-			delete (*iter5);
-		}
-		iter->m_alternativeNotGestures.clear();
+			if ((*iter5)->hasUserState())
+				return true;
 	}
+	return false;
 }
 
 void CombinationRecognizer::start()
@@ -99,34 +176,116 @@ void CombinationRecognizer::start()
 	if (m_user && !m_running && m_RecognitionStates.size() > 0)
 	{
 		m_running = true;
-		m_currentState = -1;
-		m_minDurationPassed = true;
-		m_interrupted = false;
+		m_numAttempts = 0;
 		m_recognized = false;
-		m_userStates.clear();
+
+		// Room for two transitions per state plus the end of the last state, for each attempt and the result
+		// Only reserved on the first start, the tracking data is copied in on the transitions
+		unsigned int capacity = 2 * m_RecognitionStates.size() + 1;
+		if (m_attempts.size() < m_maxAttempts)
+			m_attempts.resize(m_maxAttempts);
+		for (unsigned int i = 0; i < m_attempts.size(); ++i)
+		{
+			if (m_attempts[i].m_userStates.capacity() < capacity)
+				m_attempts[i].m_userStates.reserve(capacity);
+		}
+		if (m_userStates.capacity() < capacity)
+			m_userStates.reserve(capacity);
+		m_firstUserState = 0;
+		m_numUserStates = 0;
+	}
+}
+
+void CombinationRecognizer::setRecognized(CombinationAttempt& attempt)
+{
+	// The rings have the same capacity, so swapping them does not allocate
+	m_userStates.swap(attempt.m_userStates);
+	m_firstUserState = attempt.m_firstUserState;
+	m_numUserStates = attempt.m_numUserStates;
+
+	// Several attempts succeeding in the same frame are reported once
+	if (!m_recognized && m_userDefinedIndex >= 0)
+		m_user->m_recognizedCombinations.push_back(this);
+	m_recognized = true;
+}
+
+void CombinationRecognizer::addUserState(CombinationAttempt& attempt)
+{
+	unsigned int capacity = attempt.m_userStates.capacity();
+	if (capacity > 0)
+	{
+		// The stored states contain the local transformations of all joints
+		m_user->updateLocalTransformations(LocalTransformationJoints::all());
+
+		unsigned int index = (attempt.m_firstUserState + attempt.m_numUserStates) % capacity;
+		// Fill the reserved space first, never growing beyond it
+		if (index < attempt.m_userStates.size())
+			attempt.m_userStates[index].set(m_user->getCurrentTrackingData());
+		else
+			attempt.m_userStates.push_back(FubiUser::CompactTrackingData(m_user->getCurrentTrackingData()));
+
+		// Overwrite the oldest transition if the ring is full
+		if (attempt.m_numUserStates < capacity)
+			++attempt.m_numUserStates;
+		else
+			attempt.m_firstUserState = (attempt.m_firstUserState + 1) % capacity;
 	}
 }
 
 void CombinationRecognizer::stop()
 {
 	m_running = false;
-	m_currentState = -1;
-	m_minDurationPassed = false;
-	m_interrupted = false;
+	m_numAttempts = 0;
+}
+
+bool CombinationRecognizer::isWaitingForLastStateFinish()
+{
+	if (m_waitUntilLastStateRecognizersStop && m_running && m_RecognitionStates.size() > 0)
+	{
+		for (unsigned int i = 0; i < m_numAttempts; ++i)
+		{
+			if (m_attempts[i].m_minDurationPassed && m_attempts[i].m_currentState == m_RecognitionStates.size()-1)
+				return true;
+		}
+	}
+	return false;
 }
 
 Fubi::RecognitionResult::Result CombinationRecognizer::getRecognitionProgress(std::vector<FubiUser::TrackingData>* userStates, bool restart)
+{
+	return getRecognitionProgress(userStates, 0x0, restart);
+}
+
+Fubi::RecognitionResult::Result CombinationRecognizer::getRecognitionProgress(std::vector<FubiUser::CompactTrackingData>* userStates, bool restart)
+{
+	return getRecognitionProgress(0x0, userStates, restart);
+}
+
+Fubi::RecognitionResult::Result CombinationRecognizer::getRecognitionProgress(std::vector<FubiUser::TrackingData>* userStates,
+	std::vector<FubiUser::CompactTrackingData>* compactUserStates, bool restart)
 {
 	bool recognized = m_recognized;
 
 	if (recognized)
 	{
-		if (userStates != 0x0)
+		// Transitions in chronological order in front of the given states
+		for (unsigned int i = 0; i < m_numUserStates; ++i)
 		{
-			userStates->insert(userStates->begin(), m_userStates.begin(), m_userStates.end());
+			const FubiUser::CompactTrackingData& state = m_userStates[(m_firstUserState + i) % m_userStates.capacity()];
+			if (userStates != 0x0)
+			{
+				// Decoded into the full layout only when handed out
+				userStates->insert(userStates->begin() + i, FubiUser::TrackingData());
+				state.get((*userStates)[i]);
+			}
+			else if (compactUserStates != 0x0)
+				compactUserStates->insert(compactUserStates->begin() + i, state);
 		}
 
-		if (restart)
+		if (m_maxAttempts > 1 && m_running)
+			// Still running with the other attempts
+			m_recognized = false;
+		else if (restart)
 			this->restart();
 		else
 			m_recognized = false;
@@ -143,7 +302,7 @@ bool CombinationRecognizer::areAllGesturesRecognized(const RecognitionState& sta
 	bool atLeastOneFailed = false;
 	for (RecognitionState::GestureIter iter = state.m_gestures.begin(); iter != state.m_gestures.end(); ++iter)
 	{
-		Fubi::RecognitionResult::Result res = (*iter)->recognizeOn(m_user);
+		Fubi::RecognitionResult::Result res = (*iter)->recognizeWithCache(m_user);
 		if (res == Fubi::RecognitionResult::NOT_RECOGNIZED 
 			|| (res == Fubi::RecognitionResult::TRACKING_ERROR && !(*iter)->m_ignoreOnTrackingError))
 		{ 
@@ -161,7 +320,7 @@ bool CombinationRecognizer::areAllGesturesRecognized(const RecognitionState& sta
 		{
 			// Not recognizers are "recognized" if the recognition fails,
 			// and fail if the recognition is successful or cannot be performed because of tracking errors
-			Fubi::RecognitionResult::Result res = (*iter)->recognizeOn(m_user);
+			Fubi::RecognitionResult::Result res = (*iter)->recognizeWithCache(m_user);
 			if (res == Fubi::RecognitionResult::RECOGNIZED 
 				|| (res == Fubi::RecognitionResult::TRACKING_ERROR && !(*iter)->m_ignoreOnTrackingError))
 			{ 
@@ -178,7 +337,7 @@ bool CombinationRecognizer::areAllGesturesRecognized(const RecognitionState& sta
 		// No recognition so try alternative recognizers
 		for (RecognitionState::GestureIter iter = state.m_alternativeGestures.begin(); iter != state.m_alternativeGestures.end(); ++iter)
 		{
-			Fubi::RecognitionResult::Result res = (*iter)->recognizeOn(m_user);
+			Fubi::RecognitionResult::Result res = (*iter)->recognizeWithCache(m_user);
 			if (res == Fubi::RecognitionResult::NOT_RECOGNIZED 
 				|| (res == Fubi::RecognitionResult::TRACKING_ERROR && !(*iter)->m_ignoreOnTrackingError))
 			{ 
@@ -196,7 +355,7 @@ bool CombinationRecognizer::areAllGesturesRecognized(const RecognitionState& sta
 			{
 				// Not recognizers are "recognized" if the recognition fails,
 				// and fail if the recognition is successful or cannot be performed because of tracking errors
-				Fubi::RecognitionResult::Result res = (*iter)->recognizeOn(m_user);
+				Fubi::RecognitionResult::Result res = (*iter)->recognizeWithCache(m_user);
 				if (res == Fubi::RecognitionResult::RECOGNIZED 
 					|| (res == Fubi::RecognitionResult::TRACKING_ERROR && !(*iter)->m_ignoreOnTrackingError))
 				{ 
@@ -215,157 +374,220 @@ void CombinationRecognizer::update()
 {
 	if (m_running && m_RecognitionStates.size() > 0)
 	{
-		if (m_minDurationPassed) // Min duration already passed
+		// All time measurements are done on the time stamp of the current tracking frame
+		double now = m_user->getCurrentTrackingData().timeStamp;
+
+		// The attempts that are already in progress, a new one is only checked from the next frame on
+		unsigned int numAttempts = m_numAttempts;
+
+		startAttempt(now);
+
+		for (unsigned int i = 0; i < numAttempts; )
 		{
-			// Check for the next state
-			bool movedToNextState = false;
-			int nextStateID = m_currentState+1;
-			if ((unsigned) nextStateID < m_RecognitionStates.size())
+			if (updateAttempt(m_attempts[i], now))
+				++i;
+			else
 			{
-				RecognitionState nextState = m_RecognitionStates[nextStateID];			
-				if (areAllGesturesRecognized(nextState))
-				{
-					// Next gestures performed so jump to next state
-					m_currentState = nextStateID;
-					m_minDurationPassed = false;
-					m_interrupted = false;
-					m_stateStart = currentTime();
-					m_userStates.push_back(m_user->m_currentTrackingData);
-					movedToNextState = true;
+				removeAttempt(i);
+				--numAttempts;
+			}
+		}
+
+		// A single attempt stops the recognition on success until the result is taken with getRecognitionProgress()
+		if (m_maxAttempts == 1 && m_recognized)
+			stop();
+	}
+}
+
+void CombinationRecognizer::startAttempt(double now)
+{
+	// No free attempt, or one is still in the first state anyway
+	if (m_numAttempts >= m_maxAttempts)
+		return;
+	for (unsigned int i = 0; i < m_numAttempts; ++i)
+	{
+		if (m_attempts[i].m_currentState == 0)
+			return;
+	}
+
+	// All recognizers of the first state would fail because of tracking errors, so no need to check them
+	if (m_sharedStates->isFirstStateUntracked(m_user))
+		return;
+
+	if (areAllGesturesRecognized(m_RecognitionStates[0]))
+	{
+		// First gestures performed so start in the first state
+		CombinationAttempt& attempt = m_attempts[m_numAttempts++];
+		attempt.m_currentState = 0;
+		attempt.m_minDurationPassed = false;
+		attempt.m_interrupted = false;
+		attempt.m_stateStart = now;
+		attempt.m_firstUserState = 0;
+		attempt.m_numUserStates = 0;
+		addUserState(attempt);
 #ifdef COMBINATIONREC_DEBUG_LOGGING
-					Fubi_logDbg("User %d - Combination %s - State %d\n", m_user->m_id, m_name.c_str(), m_currentState);
+		Fubi_logDbg("User %d - Combination %s - State %d\n", m_user->m_id, m_name.c_str(), attempt.m_currentState);
 #endif
-				}
-			}
-			
-			if (!movedToNextState && m_currentState > -1)
-			{
-				if (m_interrupted)
-				{
-					// Currently interrupted since:
-					double interruptionTime = currentTime() - m_interruptionStart;
-					bool checkTimeForTransition = m_RecognitionStates[m_currentState].m_timeForTransition >= 0 && m_currentState != m_RecognitionStates.size()-1;
-					if (interruptionTime < m_RecognitionStates[m_currentState].m_maxInterruptionTime && areAllGesturesRecognized(m_RecognitionStates[m_currentState]))
-					{
-						// Continued current state
-						m_interrupted = false;
-					}
-					// The next state has to be reached during time for transition or the current state has to be rekept before max interruption time
-					else if ((checkTimeForTransition && interruptionTime > m_RecognitionStates[m_currentState].m_timeForTransition
-								&& interruptionTime > m_RecognitionStates[m_currentState].m_maxInterruptionTime)
-							|| (!checkTimeForTransition && interruptionTime > m_RecognitionStates[m_currentState].m_maxInterruptionTime))
-					{
+	}
+}
+
+void CombinationRecognizer::removeAttempt(unsigned int index)
+{
+	// Swapping keeps the reserved rings of all attempts
+	for (unsigned int i = index; i+1 < m_numAttempts; ++i)
+		std::swap(m_attempts[i], m_attempts[i+1]);
+	--m_numAttempts;
+}
+
+bool CombinationRecognizer::updateAttempt(CombinationAttempt& attempt, double now)
+{
+	const RecognitionState& currentState = m_RecognitionStates[attempt.m_currentState];
+	bool isLastState = attempt.m_currentState == m_RecognitionStates.size()-1;
 
-						if (m_waitUntilLastStateRecognizersStop && m_currentState == m_RecognitionStates.size()-1)
-						{
-							// Last state finished --> recognized
-							m_recognized = true;
-							m_userStates.push_back(m_user->m_currentTrackingData);
+	if (attempt.m_minDurationPassed) // Min duration already passed
+	{
+		// Check for the next state
+		int nextStateID = attempt.m_currentState+1;
+		if ((unsigned) nextStateID < m_RecognitionStates.size())
+		{
+			const RecognitionState& nextState = m_RecognitionStates[nextStateID];
+			if (areAllGesturesRecognized(nextState))
+			{
+				// Next gestures performed so jump to next state
+				attempt.m_currentState = nextStateID;
+				attempt.m_minDurationPassed = false;
+				attempt.m_interrupted = false;
+				attempt.m_stateStart = now;
+				addUserState(attempt);
 #ifdef COMBINATIONREC_DEBUG_LOGGING
-							Fubi_logDbg("User %d -- Combination %s Recognized!\n", m_user->m_id, m_name.c_str());
+				Fubi_logDbg("User %d - Combination %s - State %d\n", m_user->m_id, m_name.c_str(), attempt.m_currentState);
 #endif
-							// Stop the recognition
-							stop();
-						}
-						else
-						{
-							// Fail, so restart
-							restart();
+				return true;
+			}
+		}
+
+		if (attempt.m_interrupted)
+		{
+			// Currently interrupted since:
+			double interruptionTime = now - attempt.m_interruptionStart;
+			bool checkTimeForTransition = currentState.m_timeForTransition >= 0 && !isLastState;
+			if (interruptionTime < currentState.m_maxInterruptionTime && areAllGesturesRecognized(currentState))
+			{
+				// Continued current state
+				attempt.m_interrupted = false;
+			}
+			// The next state has to be reached during time for transition or the current state has to be rekept before max interruption time
+			else if ((checkTimeForTransition && interruptionTime > currentState.m_timeForTransition
+						&& interruptionTime > currentState.m_maxInterruptionTime)
+					|| (!checkTimeForTransition && interruptionTime > currentState.m_maxInterruptionTime))
+			{
+
+				if (m_waitUntilLastStateRecognizersStop && isLastState)
+				{
+					// Last state finished --> recognized
+					addUserState(attempt);
+					setRecognized(attempt);
 #ifdef COMBINATIONREC_DEBUG_LOGGING
-							Fubi_logDbg("User %d - Combination %s - Next gestures too late\n", m_user->m_id, m_name.c_str());
+					Fubi_logDbg("User %d -- Combination %s Recognized!\n", m_user->m_id, m_name.c_str());
 #endif
-						}
-					}
-					// If m_timeForTransition < 0 the user has infinite time for performing the next state
+					return false;
 				}
-				else if (areAllGesturesRecognized(m_RecognitionStates[m_currentState]))
+				else
 				{
-					double timeInPose = currentTime()- m_stateStart;
-					if (m_RecognitionStates[m_currentState].m_maxDuration > 0 && timeInPose > m_RecognitionStates[m_currentState].m_maxDuration)
-					{
-						if (m_waitUntilLastStateRecognizersStop && m_currentState == m_RecognitionStates.size()-1)
-						{
-							// Last state finished --> recognized
-							m_userStates.push_back(m_user->m_currentTrackingData);
-							m_recognized = true;
+					// Fail, so drop the attempt
 #ifdef COMBINATIONREC_DEBUG_LOGGING
-							Fubi_logDbg("User %d -- Combination %s Recognized!\n", m_user->m_id, m_name.c_str());
+					Fubi_logDbg("User %d - Combination %s - Next gestures too late\n", m_user->m_id, m_name.c_str());
 #endif
-							// Stop the recognition
-							stop();
-						}
-						else
-						{
-							// Next gestures not performed before max duration is reached so restart recognition
-							restart();
+					return false;
+				}
+			}
+			// If m_timeForTransition < 0 the user has infinite time for performing the next state
+		}
+		else if (areAllGesturesRecognized(currentState))
+		{
+			double timeInPose = now - attempt.m_stateStart;
+			if (currentState.m_maxDuration > 0 && timeInPose > currentState.m_maxDuration)
+			{
+				if (m_waitUntilLastStateRecognizersStop && isLastState)
+				{
+					// Last state finished --> recognized
+					addUserState(attempt);
+					setRecognized(attempt);
 #ifdef COMBINATIONREC_DEBUG_LOGGING
-							Fubi_logDbg("User %d - Combination %s - Reached max duration\n", m_user->m_id, m_name.c_str());
+					Fubi_logDbg("User %d -- Combination %s Recognized!\n", m_user->m_id, m_name.c_str());
 #endif
-						}
-					}
+					return false;
 				}
 				else
 				{
-					// First frame of interruption
-					m_interrupted = true;
-					m_interruptionStart = currentTime();
+					// Next gestures not performed before max duration is reached so drop the attempt
+#ifdef COMBINATIONREC_DEBUG_LOGGING
+					Fubi_logDbg("User %d - Combination %s - Reached max duration\n", m_user->m_id, m_name.c_str());
+#endif
+					return false;
 				}
 			}
 		}
-		else if (m_currentState > -1)  // Min duration not yet passed
+		else
+		{
+			// First frame of interruption
+			attempt.m_interrupted = true;
+			attempt.m_interruptionStart = now;
+		}
+	}
+	else // Min duration not yet passed
+	{
+		bool gesturesRecognized = areAllGesturesRecognized(currentState);
+		double timePast = now - attempt.m_stateStart;
+		if (timePast < currentState.m_minDuration) // Within the min duration time frame
 		{
-			bool gesturesRecognized = areAllGesturesRecognized(m_RecognitionStates[m_currentState]);
-			double timePast = currentTime() - m_stateStart;
-			if (timePast < m_RecognitionStates[m_currentState].m_minDuration) // Within the min duration time frame
+			// Check if the current gestures are still fulfilled
+			if (!gesturesRecognized)
 			{
-				// Check if the current gestures are still fulfilled
-				if (!gesturesRecognized)
+				if (attempt.m_interrupted || currentState.m_noInterrruptionBeforeMinDuration)
 				{
-					if (m_interrupted || m_RecognitionStates[m_currentState].m_noInterrruptionBeforeMinDuration)
+					// Interrupted for more than one frame or no interruption allowed at all
+					if (currentState.m_noInterrruptionBeforeMinDuration || (now - attempt.m_interruptionStart) > currentState.m_maxInterruptionTime)
 					{
-						// Interrupted for more than one frame or no interruption allowed at all
-						if (m_RecognitionStates[m_currentState].m_noInterrruptionBeforeMinDuration || (currentTime() - m_interruptionStart) > m_RecognitionStates[m_currentState].m_maxInterruptionTime)
-						{
 #ifdef COMBINATIONREC_DEBUG_LOGGING
-							Fubi_logDbg("User %d -- Combination %s - State %d aborted before min duration %.2f\n", m_user->m_id, m_name.c_str(), m_currentState, m_RecognitionStates[m_currentState].m_minDuration);
+						Fubi_logDbg("User %d -- Combination %s - State %d aborted before min duration %.2f\n", m_user->m_id, m_name.c_str(), attempt.m_currentState, currentState.m_minDuration);
 #endif
-							// gestures aborted before min duration is reached
-							restart();
-						}
-					}
-					else
-					{
-						// First frame of interruption
-						m_interrupted = true;
-						m_interruptionStart = currentTime();
+						// gestures aborted before min duration is reached
+						return false;
 					}
 				}
 				else
-					m_interrupted = false;
+				{
+					// First frame of interruption
+					attempt.m_interrupted = true;
+					attempt.m_interruptionStart = now;
+				}
 			}
-			else if (!m_interrupted || gesturesRecognized) // Min duration passed
-			{
-				// Save user state information for the transition
-				m_userStates.push_back(m_user->m_currentTrackingData);
+			else
+				attempt.m_interrupted = false;
+		}
+		else if (!attempt.m_interrupted || gesturesRecognized) // Min duration passed
+		{
+			// Save user state information for the transition
+			addUserState(attempt);
 
-				if (!m_waitUntilLastStateRecognizersStop && m_currentState == m_RecognitionStates.size()-1)
-				{
-					// Last state finished --> recognized
-					m_recognized = true;
+			if (!m_waitUntilLastStateRecognizersStop && isLastState)
+			{
+				// Last state finished --> recognized
+				setRecognized(attempt);
 #ifdef COMBINATIONREC_DEBUG_LOGGING
-					Fubi_logDbg("User %d -- Combination %s Recognized!\n", m_user->m_id, m_name.c_str());
+				Fubi_logDbg("User %d -- Combination %s Recognized!\n", m_user->m_id, m_name.c_str());
 #endif
-					// Stop the recognition
-					stop();
-				}
-				else
-				{
-					// Min duration passed, check for the next state
-					m_minDurationPassed = true;
-				}
+				return false;
+			}
+			else
+			{
+				// Min duration passed, check for the next state
+				attempt.m_minDurationPassed = true;
 			}
 		}
 	}
+	return true;
 }
 
 void CombinationRecognizer::addState(const std::vector<IGestureRecognizer*>& gestureRecognizers, const std::vector<IGestureRecognizer*>& notRecognizers /*= s_emptyRecVec*/, double minDuration /*= 0*/,
@@ -373,13 +595,19 @@ void CombinationRecognizer::addState(const std::vector<IGestureRecognizer*>& ges
 	const std::vector<IGestureRecognizer*>& alternativeGestureRecognizers /*= RecognitionState::s_emptyRecVec*/, const std::vector<IGestureRecognizer*>& alternativeNotRecognizers /*= RecognitionState::s_emptyRecVec*/)
 {
 	if (!gestureRecognizers.empty() || !notRecognizers.empty())
+	{
 		m_RecognitionStates.push_back(RecognitionState(gestureRecognizers, notRecognizers, minDuration, maxDuration, timeForTransition, maxInterruption, noInterrruptionBeforeMinDuration, alternativeGestureRecognizers, alternativeNotRecognizers));
+		m_sharedStates->updateFirstStateJoints();
+	}
 }
 
 void CombinationRecognizer::addState(const RecognitionState& state)
 {
 	if (!state.m_gestures.empty() || !state.m_notGestures.empty())
+	{
 		m_RecognitionStates.push_back(state);
+		m_sharedStates->updateFirstStateJoints();
+	}
 }
 
 CombinationRecognizer* CombinationRecognizer::clone() const
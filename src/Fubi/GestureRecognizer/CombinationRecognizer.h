@@ -15,6 +15,7 @@
 #include "IGestureRecognizer.h"
 
 #include <vector>
+#include <memory>
 
 // A state of the combination recognizer
 struct RecognitionState
@@ -44,6 +45,45 @@ struct RecognitionState
 	bool m_noInterrruptionBeforeMinDuration;
 };
 
+// The states of a combination together with their recognizers
+// Shared by a template and the recognizers cloned from it for each user, so it must not change after the first clone
+struct RecognitionStateList
+{
+	RecognitionStateList() : m_firstStateJoints(0), m_firstStateMinConfidence(0) {}
+	// Deletes the recognizers of all states
+	~RecognitionStateList();
+
+	// Collects the joints the recognizers of the first state need, called whenever a state is added
+	void updateFirstStateJoints();
+	// True if none of these joints is tracked with the lowest confidence one of the recognizers needs,
+	// so all of them can only return tracking errors and the first state can not be reached
+	bool isFirstStateUntracked(const FubiUser* user) const;
+
+	std::vector<RecognitionState> m_states;
+	// Joints of the recognizers of the first state (one bit per joint), 0 if not all of them know their joints
+	unsigned int m_firstStateJoints;
+	float m_firstStateMinConfidence;
+};
+
+// One attempt to match the states of a combination, the recognizer may follow several of them at once
+struct CombinationAttempt
+{
+	CombinationAttempt() : m_currentState(-1), m_stateStart(0), m_interruptionStart(0), m_minDurationPassed(false), m_interrupted(false),
+		m_firstUserState(0), m_numUserStates(0) {}
+
+	// The current state index
+	int m_currentState;
+	// When the current state started or the transition started
+	double m_stateStart, m_interruptionStart;
+	// If min duration has been reached
+	bool m_minDurationPassed;
+	// If the gestures of the current state are temporarly not recognized
+	bool m_interrupted;
+	// Tracking data of the transitions of this attempt, a ring with the fixed capacity reserved on the first start
+	std::vector<FubiUser::CompactTrackingData> m_userStates;
+	unsigned int m_firstUserState, m_numUserStates;
+};
+
 class CombinationRecognizer
 {
 public:
@@ -62,17 +102,19 @@ public:
 	void restart() { stop(); start(); }
 
 	// True if a combination start is detected (First state recognized, but last one not yet)
-	bool isInProgress() {return m_currentState > -1; }
+	bool isInProgress() {return m_numAttempts > 0; }
 	// True if the recognizer is currently trying to detect the combination (Last state not yet recognized)
 	bool isRunning()	{ return m_running; }
 	// True if recognizer is currently trying to detect the combination or has already suceeded (running or recognized, but not stopped)
 	bool isActive()		{ return m_running || m_recognized; }
 	// True if already recognized, but still waiting for the last state to finish
-	bool isWaitingForLastStateFinish()		{ return m_waitUntilLastStateRecognizersStop && m_running && m_minDurationPassed && m_RecognitionStates.size() > 0 && (m_currentState == m_RecognitionStates.size()-1); }
+	bool isWaitingForLastStateFinish();
 	// @param userStates: vector were the user skeletonData and timestamps are stored for each transition during a recognition that has been successful
 	// @param restart: if true, the recognition will automatically restart if it is successful
 	// returns true if a combination is completed 
 	Fubi::RecognitionResult::Result getRecognitionProgress(std::vector<FubiUser::TrackingData>* userStates, bool restart);
+	// Same with the user states in the compact layout, as they are stored internally
+	Fubi::RecognitionResult::Result getRecognitionProgress(std::vector<FubiUser::CompactTrackingData>* userStates, bool restart);
 
 	// Add a state for this combination (used for creating the recognizer)
 	void addState(const std::vector<IGestureRecognizer*>& gestureRecognizers, const std::vector<IGestureRecognizer*>& notRecognizers = RecognitionState::s_emptyRecVec,
@@ -91,22 +133,50 @@ public:
 
 	void setWaitUntilLastStateRecognizersStop(bool enable) { m_waitUntilLastStateRecognizersStop = enable; }
 
+	// How many attempts to match the combination may run at once (default 1, set before the first start)
+	// With more than one, a new attempt starts whenever the first state is recognized while the others are already further,
+	// so quickly repeated combinations are recognized without waiting for the previous attempt to finish or fail
+	// A successful attempt does not stop the others, so the recognizer keeps running after a recognition
+	void setMaxConcurrentAttempts(unsigned int maxAttempts) { m_maxAttempts = (maxAttempts > 0) ? maxAttempts : 1; }
+	unsigned int getMaxConcurrentAttempts() const { return m_maxAttempts; }
+
+	// Index of a user defined combination in the loaded recognizer set, -1 for the predefined ones
+	void setUserDefinedIndex(int index) { m_userDefinedIndex = index; }
+	int getUserDefinedIndex() const { return m_userDefinedIndex; }
+
 protected:
 	bool areAllGesturesRecognized(const RecognitionState& state);
 
+	// Whether one of the recognizers needs a copy per user, so the states can not be shared
+	bool hasUserStateRecognizers() const;
+
+	// Start a new attempt if the first state is recognized
+	void startAttempt(double now);
+	// Advance an attempt that is already in progress, returns false if it has failed or succeeded
+	bool updateAttempt(CombinationAttempt& attempt, double now);
+	// Remove an attempt, keeping the others in the order they were started
+	void removeAttempt(unsigned int index);
+
+	// Save the current tracking data of the user for the transition
+	void addUserState(CombinationAttempt& attempt);
+
+	// Take the transitions of the successful attempt, mark the combination as recognized and report it to the user
+	void setRecognized(CombinationAttempt& attempt);
+
+	// Shared implementation of both getRecognitionProgress() variants, only one of the vectors is given
+	Fubi::RecognitionResult::Result getRecognitionProgress(std::vector<FubiUser::TrackingData>* userStates,
+		std::vector<FubiUser::CompactTrackingData>* compactUserStates, bool restart);
+
 
 	bool m_running;
 
-	// All recognition states ordered in time
-	std::vector<RecognitionState>	m_RecognitionStates;
-	// The current state index
-	int							m_currentState;
-	// When the current state started or the transition started
-	double						m_stateStart, m_interruptionStart;
-	// If min duration has been reached
-	bool						m_minDurationPassed;
-	// If the gestures of the current state are temporarly not recognized
-	bool						m_interrupted;
+	// All recognition states ordered in time, shared with the template and its other clones if possible
+	// Everything else is the state of this recognizer for its user
+	std::shared_ptr<RecognitionStateList> m_sharedStates;
+	std::vector<RecognitionState>&	m_RecognitionStates;
+	// The attempts in progress are the first m_numAttempts ones, ordered by their start
+	std::vector<CombinationAttempt>	m_attempts;
+	unsigned int				m_numAttempts, m_maxAttempts;
 	// If the recognition was successful
 	bool						m_recognized;
 	// User this recognizer is attachded to
@@ -118,5 +188,9 @@ protected:
 
 	bool						m_waitUntilLastStateRecognizersStop;
 
-	std::vector<FubiUser::TrackingData> m_userStates;
+	int							m_userDefinedIndex;
+
+	// Tracking data of the transitions of the last successful attempt, a ring with the fixed capacity reserved on the first start
+	std::vector<FubiUser::CompactTrackingData> m_userStates;
+	unsigned int m_firstUserState, m_numUserStates;
 };
\ No newline at end of file
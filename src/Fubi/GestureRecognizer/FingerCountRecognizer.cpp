@@ -9,8 +9,6 @@
 // 
 // ****************************************************************************************
 #include "FingerCountRecognizer.h"
-#include "../FubiImageProcessing.h"
-#include "../Fubi.h"
 
 using namespace Fubi;
 
@@ -34,11 +32,11 @@ Fubi::RecognitionResult::Result FingerCountRecognizer::recognizeOn(FubiUser* use
 {
 	bool leftHand = (m_handJoint == Fubi::SkeletonJoint::LEFT_HAND);
 	
-	SkeletonJointPosition* joint = &(user->m_currentTrackingData.jointPositions[m_handJoint]);
+	SkeletonJointPosition* joint = &(user->getCurrentTrackingData().jointPositions[m_handJoint]);
 	if (joint->m_confidence >= m_minConfidence)
 	{
-		m_lastRecognition = Fubi::getFingerCount(user->m_id, leftHand, m_useMedianCalculation);
-		/*m_lastRecognition = user->getFingerCount(leftHand);*/
+		// The recognizers are evaluated in parallel for the users, so the count must not be calculated here
+		m_lastRecognition = user->getTrackedFingerCount(leftHand, m_useMedianCalculation);
 		if (m_lastRecognition > -1 && m_lastRecognition >= m_minFingers && m_lastRecognition <= m_maxFingers)
 			return Fubi::RecognitionResult::RECOGNIZED;
 		else
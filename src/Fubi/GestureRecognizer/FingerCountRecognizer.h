@@ -24,6 +24,9 @@ public:
 	virtual Fubi::RecognitionResult::Result recognizeOn(FubiUser* user);
 	virtual IGestureRecognizer* clone();
 
+	// The last finger count is stored per user
+	virtual bool hasUserState() const { return true; }
+
 	int getLastFingerCount() {return m_lastRecognition;}
 
 private:
@@ -16,17 +16,74 @@
 
 #include <map>
 
+class JointRelationTable;
+class JointHistoryWindows;
+
 class IGestureRecognizer
 {
 public:
-	IGestureRecognizer() : m_ignoreOnTrackingError(false), m_minConfidence(0.51f) {}
-	IGestureRecognizer(bool ignoreOnTrackingError, float minconfidence) : m_ignoreOnTrackingError(ignoreOnTrackingError)
+	IGestureRecognizer() : m_ignoreOnTrackingError(false), m_minConfidence(0.51f), m_cacheSlot(-1) {}
+	IGestureRecognizer(bool ignoreOnTrackingError, float minconfidence) : m_ignoreOnTrackingError(ignoreOnTrackingError), m_cacheSlot(-1)
 	{ m_minConfidence = (minconfidence >= 0) ? minconfidence : 0.51f; }
 	virtual ~IGestureRecognizer() {}
 
 	virtual Fubi::RecognitionResult::Result recognizeOn(FubiUser* user) = 0;
 	virtual IGestureRecognizer* clone() = 0;
 
+	// Recognizers that can be evaluated in batch add their definition to the table of the recognizer set
+	// Called once the recognizer is complete, i.e. including the confidence set by the referencing combination
+	virtual void compileInto(JointRelationTable& table) {}
+	// Recognizers that look at the movement over a time window request it from the joint history of the users in the same way
+	virtual void requestHistoryWindows(JointHistoryWindows& windows) {}
+	// Recognizers that look at local positions or orientations request the joints they need,
+	// the users then only calculate the local transformations of the requested joints in each frame
+	virtual void requestLocalTransformations(Fubi::LocalTransformationJoints& joints) {}
+
+	// Whether the recognizer changes itself during the recognition and needs a copy per user
+	// All others are shared between the users by the combination recognizers
+	virtual bool hasUserState() const { return false; }
+
+	// Joints (one bit per joint) whose position confidence has to reach m_minConfidence for the recognizer,
+	// i.e. the result is a tracking error as soon as one of them is below
+	// Returns 0 if the tracking errors do not only depend on the joint positions
+	virtual unsigned int getRequiredJoints() const { return 0; }
+
+	// Unique key of the recognizer definition, recognizers with the same key share their results within a frame
+	// Returns false if the result depends on more than the definition and the current tracking data
+	virtual bool getDefinitionKey(std::string& key) const { return false; }
+
+	// Same as recognizeOn(), but takes the result from the cache of the user if it has already been calculated for this frame
+	Fubi::RecognitionResult::Result recognizeWithCache(FubiUser* user)
+	{
+		Fubi::RecognitionResult::Result result;
+		if (m_cacheSlot < 0)
+			result = recognizeOn(user);
+		else if (!user->getCachedResult((unsigned int) m_cacheSlot, result))
+		{
+			result = recognizeOn(user);
+			user->setCachedResult((unsigned int) m_cacheSlot, result);
+		}
+		return result;
+	}
+
 	bool m_ignoreOnTrackingError;
 	float m_minConfidence;
+	// Slot in the result cache of the users, -1 if the results are not cached
+	int m_cacheSlot;
+
+protected:
+	// Make sure the local transformations requested by the recognizer are calculated for the user,
+	// as they are only calculated in advance for the recognizers of the loaded combinations
+	void updateLocalTransformations(FubiUser* user, bool lastFrameToo = false)
+	{
+		Fubi::LocalTransformationJoints joints;
+		requestLocalTransformations(joints);
+		user->updateLocalTransformations(joints, lastFrameToo);
+	}
+
+	// Append the raw bytes of a value to a definition key
+	template<class T> static void appendToKey(std::string& key, const T& value)
+	{
+		key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
 };
\ No newline at end of file
@@ -20,6 +20,23 @@ JointOrientationRecognizer::JointOrientationRecognizer(Fubi::SkeletonJoint::Join
 	normalizeRotationVec(m_maxValues);
 }
 
+bool JointOrientationRecognizer::getDefinitionKey(std::string& key) const
+{
+	key = "JointOrientation";
+	appendToKey(key, m_joint);
+	appendToKey(key, m_minValues);
+	appendToKey(key, m_maxValues);
+	appendToKey(key, m_useLocalOrientations);
+	appendToKey(key, m_minConfidence);
+	return true;
+}
+
+void JointOrientationRecognizer::requestLocalTransformations(Fubi::LocalTransformationJoints& joints)
+{
+	if (m_useLocalOrientations)
+		joints.addOrientation(m_joint);
+}
+
 Fubi::RecognitionResult::Result JointOrientationRecognizer::recognizeOn(FubiUser* user)
 {
 	bool recognized = false;
@@ -28,7 +45,8 @@ Fubi::RecognitionResult::Result JointOrientationRecognizer::recognizeOn(FubiUser
 
 	if (m_useLocalOrientations)
 	{
-		const SkeletonJointOrientation& joint = user->m_currentTrackingData.localJointOrientations[m_joint];
+		updateLocalTransformations(user);
+		const SkeletonJointOrientation& joint = user->getCurrentTrackingData().localJointOrientations[m_joint];
 		if (joint.m_confidence >= m_minConfidence)
 		{
 			orient = joint.m_orientation.getRot();
@@ -37,7 +55,7 @@ Fubi::RecognitionResult::Result JointOrientationRecognizer::recognizeOn(FubiUser
 	}
 	else
 	{
-		const SkeletonJointOrientation& joint = user->m_currentTrackingData.jointOrientations[m_joint];
+		const SkeletonJointOrientation& joint = user->getCurrentTrackingData().jointOrientations[m_joint];
 		if (joint.m_confidence >= m_minConfidence)
 		{
 			orient = joint.m_orientation.getRot();
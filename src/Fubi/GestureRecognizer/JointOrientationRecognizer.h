@@ -25,6 +25,10 @@ public:
 	virtual Fubi::RecognitionResult::Result recognizeOn(FubiUser* user);
 	virtual IGestureRecognizer* clone() { return new JointOrientationRecognizer(*this); }
 
+	virtual bool getDefinitionKey(std::string& key) const;
+
+	virtual void requestLocalTransformations(Fubi::LocalTransformationJoints& joints);
+
 private:
 	Fubi::SkeletonJoint::Joint m_joint;
 	Fubi::Vec3f m_minValues, m_maxValues;
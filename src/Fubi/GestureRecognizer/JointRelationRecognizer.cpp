@@ -9,6 +9,7 @@
 // 
 // ****************************************************************************************
 #include "JointRelationRecognizer.h"
+#include "JointRelationTable.h"
 
 using namespace Fubi;
 
@@ -24,17 +25,50 @@ JointRelationRecognizer::JointRelationRecognizer(Fubi::SkeletonJoint::Joint join
 	  m_minValues(minValues), m_maxValues(maxValues), m_minDistance(minDistance), m_maxDistance(maxDistance), 
 	  m_useLocalPositions(useLocalPositions),
 	  IGestureRecognizer(false, minConfidence),
-	  m_measuringUnit(measuringUnit)
+	  m_measuringUnit(measuringUnit), m_tableIndex(-1)
 {
 }
 
+void JointRelationRecognizer::compileInto(JointRelationTable& table)
+{
+	m_tableIndex = (int) table.addEntry(m_joint, m_relJoint, m_minValues, m_maxValues, m_minDistance, m_maxDistance,
+		m_useLocalPositions, m_minConfidence, m_measuringUnit);
+}
+
+unsigned int JointRelationRecognizer::getRequiredJoints() const
+{
+	// Local positions are never more confident than the global ones
+	unsigned int joints = 0;
+	if (m_joint < SkeletonJoint::NUM_JOINTS)
+		joints |= 1u << m_joint;
+	if (m_relJoint < SkeletonJoint::NUM_JOINTS)
+		joints |= 1u << m_relJoint;
+	return joints;
+}
+
+void JointRelationRecognizer::requestLocalTransformations(Fubi::LocalTransformationJoints& joints)
+{
+	if (m_useLocalPositions)
+	{
+		joints.addPosition(m_joint);
+		joints.addPosition(m_relJoint);
+	}
+}
+
 Fubi::RecognitionResult::Result JointRelationRecognizer::recognizeOn(FubiUser* user)
 {
+	// Take the result of the batch evaluation if it is already done for this frame
+	Fubi::RecognitionResult::Result tableResult;
+	if (m_tableIndex >= 0 && user->getJointRelationResult((unsigned int) m_tableIndex, tableResult))
+		return tableResult;
+
 	bool recognized = false;
+
+	updateLocalTransformations(user);
 	
-	SkeletonJointPosition* joint = &(user->m_currentTrackingData.jointPositions[m_joint]);
+	SkeletonJointPosition* joint = &(user->getCurrentTrackingData().jointPositions[m_joint]);
 	if (m_useLocalPositions)
-		joint = &(user->m_currentTrackingData.localJointPositions[m_joint]);
+		joint = &(user->getCurrentTrackingData().localJointPositions[m_joint]);
 	
 	if (joint->m_confidence >= m_minConfidence)
 	{
@@ -44,9 +78,9 @@ Fubi::RecognitionResult::Result JointRelationRecognizer::recognizeOn(FubiUser* u
 
 		if (m_relJoint != Fubi::SkeletonJoint::NUM_JOINTS)
 		{
-			SkeletonJointPosition* relJoint = &(user->m_currentTrackingData.jointPositions[m_relJoint]);
+			SkeletonJointPosition* relJoint = &(user->getCurrentTrackingData().jointPositions[m_relJoint]);
 			if (m_useLocalPositions)
-				relJoint = &(user->m_currentTrackingData.localJointPositions[m_relJoint]);
+				relJoint = &(user->getCurrentTrackingData().localJointPositions[m_relJoint]);
 
 			vecValid = relJoint->m_confidence >= m_minConfidence;
 			if(vecValid)
@@ -31,6 +31,12 @@ public:
 	virtual Fubi::RecognitionResult::Result recognizeOn(FubiUser* user);
 	virtual IGestureRecognizer* clone() { return new JointRelationRecognizer(*this); }
 
+	virtual void compileInto(JointRelationTable& table);
+
+	virtual void requestLocalTransformations(Fubi::LocalTransformationJoints& joints);
+
+	virtual unsigned int getRequiredJoints() const;
+
 private:
 	Fubi::SkeletonJoint::Joint m_joint;
 	Fubi::SkeletonJoint::Joint m_relJoint;
@@ -39,4 +45,6 @@ private:
 	float m_maxDistance;
 	bool m_useLocalPositions;
 	Fubi::BodyMeasurement::Measurement m_measuringUnit;
+	// Entry in the joint relation table, -1 if not compiled
+	int m_tableIndex;
 };
\ No newline at end of file
@@ -0,0 +1,205 @@
+// ****************************************************************************************
+//
+// Joint Relation Table
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#include "JointRelationTable.h"
+
+#include "../FubiUser.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FUBI_JOINT_RELATION_SSE
+#include <emmintrin.h>
+#endif
+
+using namespace Fubi;
+
+JointRelationTable::JointRelationTable() : m_numEntries(0)
+{
+}
+
+unsigned int JointRelationTable::addEntry(Fubi::SkeletonJoint::Joint joint, Fubi::SkeletonJoint::Joint relJoint,
+	const Fubi::Vec3f& minValues, const Fubi::Vec3f& maxValues, float minDistance, float maxDistance,
+	bool useLocalPositions, float minConfidence, Fubi::BodyMeasurement::Measurement measuringUnit)
+{
+	// Local joints are stored behind the global ones, an absolute relation is relative to the origin
+	unsigned char jointIndex = (unsigned char) (useLocalPositions ? (joint + SkeletonJoint::NUM_JOINTS) : joint);
+	unsigned char relJointIndex = (unsigned char) OriginIndex;
+	if (relJoint != SkeletonJoint::NUM_JOINTS)
+		relJointIndex = (unsigned char) (useLocalPositions ? (relJoint + SkeletonJoint::NUM_JOINTS) : relJoint);
+	unsigned char unit = (unsigned char) measuringUnit;
+
+	// Reuse an identical entry
+	for (unsigned int i = 0; i < m_numEntries; ++i)
+	{
+		if (m_joints[i] == jointIndex && m_relJoints[i] == relJointIndex && m_measuringUnits[i] == unit
+			&& m_minConfidences[i] == minConfidence
+			&& m_minX[i] == minValues.x && m_maxX[i] == maxValues.x
+			&& m_minY[i] == minValues.y && m_maxY[i] == maxValues.y
+			&& m_minZ[i] == minValues.z && m_maxZ[i] == maxValues.z
+			&& m_minDistances[i] == minDistance && m_maxDistances[i] == maxDistance)
+		{
+			return i;
+		}
+	}
+
+	unsigned int index = m_numEntries++;
+	// Pad to whole blocks, padding entries are never recognized and masked out of the results anyway
+	unsigned int paddedSize = ((m_numEntries + BlockSize - 1) / BlockSize) * BlockSize;
+	m_joints.resize(paddedSize, (unsigned char) OriginIndex);
+	m_relJoints.resize(paddedSize, (unsigned char) OriginIndex);
+	m_measuringUnits.resize(paddedSize, (unsigned char) BodyMeasurement::NUM_MEASUREMENTS);
+	m_minConfidences.resize(paddedSize, 0);
+	m_minX.resize(paddedSize, Math::MaxFloat);
+	m_maxX.resize(paddedSize, -Math::MaxFloat);
+	m_minY.resize(paddedSize, Math::MaxFloat);
+	m_maxY.resize(paddedSize, -Math::MaxFloat);
+	m_minZ.resize(paddedSize, Math::MaxFloat);
+	m_maxZ.resize(paddedSize, -Math::MaxFloat);
+	m_minDistances.resize(paddedSize, Math::MaxFloat);
+	m_maxDistances.resize(paddedSize, -Math::MaxFloat);
+
+	m_joints[index] = jointIndex;
+	m_relJoints[index] = relJointIndex;
+	m_measuringUnits[index] = unit;
+	m_minConfidences[index] = minConfidence;
+	m_minX[index] = minValues.x;
+	m_maxX[index] = maxValues.x;
+	m_minY[index] = minValues.y;
+	m_maxY[index] = maxValues.y;
+	m_minZ[index] = minValues.z;
+	m_maxZ[index] = maxValues.z;
+	m_minDistances[index] = minDistance;
+	m_maxDistances[index] = maxDistance;
+
+	return index;
+}
+
+void JointRelationTable::clear()
+{
+	m_numEntries = 0;
+	m_joints.clear();
+	m_relJoints.clear();
+	m_measuringUnits.clear();
+	m_minConfidences.clear();
+	m_minX.clear();
+	m_maxX.clear();
+	m_minY.clear();
+	m_maxY.clear();
+	m_minZ.clear();
+	m_maxZ.clear();
+	m_minDistances.clear();
+	m_maxDistances.clear();
+}
+
+void JointRelationTable::evaluate(const FubiUser* user, unsigned int* recognizedBits, unsigned int* trackingErrorBits) const
+{
+	if (m_numEntries == 0)
+		return;
+
+	// Gather the joints of the user once, so each entry only needs two lookups
+	float jointX[NumGatheredJoints], jointY[NumGatheredJoints], jointZ[NumGatheredJoints], jointConfidence[NumGatheredJoints];
+	const FubiUser::TrackingData& data = user->getCurrentTrackingData();
+	for (unsigned int j = 0; j < SkeletonJoint::NUM_JOINTS; ++j)
+	{
+		const SkeletonJointPosition& global = data.jointPositions[j];
+		jointX[j] = global.m_position.x;
+		jointY[j] = global.m_position.y;
+		jointZ[j] = global.m_position.z;
+		jointConfidence[j] = global.m_confidence;
+		const SkeletonJointPosition& local = data.localJointPositions[j];
+		jointX[j + SkeletonJoint::NUM_JOINTS] = local.m_position.x;
+		jointY[j + SkeletonJoint::NUM_JOINTS] = local.m_position.y;
+		jointZ[j + SkeletonJoint::NUM_JOINTS] = local.m_position.z;
+		jointConfidence[j + SkeletonJoint::NUM_JOINTS] = local.m_confidence;
+	}
+	jointX[OriginIndex] = jointY[OriginIndex] = jointZ[OriginIndex] = 0;
+	jointConfidence[OriginIndex] = Math::MaxFloat;
+
+	// Measurements that are too short are never valid, no measuring unit means a division by one
+	float unitDist[BodyMeasurement::NUM_MEASUREMENTS + 1], unitConfidence[BodyMeasurement::NUM_MEASUREMENTS + 1];
+	for (unsigned int m = 0; m < BodyMeasurement::NUM_MEASUREMENTS; ++m)
+	{
+		const BodyMeasurementDistance& measure = user->m_bodyMeasurements[m];
+		unitDist[m] = measure.m_dist;
+		unitConfidence[m] = (measure.m_dist > Math::Epsilon) ? measure.m_confidence : -Math::MaxFloat;
+	}
+	unitDist[BodyMeasurement::NUM_MEASUREMENTS] = 1.0f;
+	unitConfidence[BodyMeasurement::NUM_MEASUREMENTS] = Math::MaxFloat;
+
+	unsigned int numWords = getNumResultWords();
+	for (unsigned int w = 0; w < numWords; ++w)
+	{
+		recognizedBits[w] = 0;
+		trackingErrorBits[w] = 0;
+	}
+
+	float x[BlockSize], y[BlockSize], z[BlockSize], dist[BlockSize];
+	float confidence[BlockSize], relConfidence[BlockSize], measureConfidence[BlockSize];
+	for (unsigned int block = 0; block < m_numEntries; block += BlockSize)
+	{
+		for (unsigned int k = 0; k < BlockSize; ++k)
+		{
+			unsigned int joint = m_joints[block + k];
+			unsigned int relJoint = m_relJoints[block + k];
+			unsigned int unit = m_measuringUnits[block + k];
+			x[k] = jointX[joint] - jointX[relJoint];
+			y[k] = jointY[joint] - jointY[relJoint];
+			z[k] = jointZ[joint] - jointZ[relJoint];
+			dist[k] = unitDist[unit];
+			confidence[k] = jointConfidence[joint];
+			relConfidence[k] = jointConfidence[relJoint];
+			measureConfidence[k] = unitConfidence[unit];
+		}
+
+		unsigned int validMask, recognizedMask;
+#ifdef FUBI_JOINT_RELATION_SSE
+		__m128 minConf = _mm_loadu_ps(&m_minConfidences[block]);
+		__m128 valid = _mm_and_ps(_mm_cmpge_ps(_mm_loadu_ps(confidence), minConf),
+			_mm_and_ps(_mm_cmpge_ps(_mm_loadu_ps(relConfidence), minConf), _mm_cmpge_ps(_mm_loadu_ps(measureConfidence), minConf)));
+
+		__m128 unitDiv = _mm_loadu_ps(dist);
+		__m128 vx = _mm_div_ps(_mm_loadu_ps(x), unitDiv);
+		__m128 vy = _mm_div_ps(_mm_loadu_ps(y), unitDiv);
+		__m128 vz = _mm_div_ps(_mm_loadu_ps(z), unitDiv);
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+
+		__m128 inRange = _mm_and_ps(_mm_cmpge_ps(vx, _mm_loadu_ps(&m_minX[block])), _mm_cmple_ps(vx, _mm_loadu_ps(&m_maxX[block])));
+		inRange = _mm_and_ps(inRange, _mm_and_ps(_mm_cmpge_ps(vy, _mm_loadu_ps(&m_minY[block])), _mm_cmple_ps(vy, _mm_loadu_ps(&m_maxY[block]))));
+		inRange = _mm_and_ps(inRange, _mm_and_ps(_mm_cmpge_ps(vz, _mm_loadu_ps(&m_minZ[block])), _mm_cmple_ps(vz, _mm_loadu_ps(&m_maxZ[block]))));
+		inRange = _mm_and_ps(inRange, _mm_and_ps(_mm_cmpge_ps(length, _mm_loadu_ps(&m_minDistances[block])), _mm_cmple_ps(length, _mm_loadu_ps(&m_maxDistances[block]))));
+
+		validMask = (unsigned int) _mm_movemask_ps(valid);
+		recognizedMask = (unsigned int) _mm_movemask_ps(_mm_and_ps(valid, inRange));
+#else
+		validMask = recognizedMask = 0;
+		for (unsigned int k = 0; k < BlockSize; ++k)
+		{
+			unsigned int i = block + k;
+			float minConf = m_minConfidences[i];
+			if (confidence[k] >= minConf && relConfidence[k] >= minConf && measureConfidence[k] >= minConf)
+			{
+				validMask |= 1u << k;
+				float vx = x[k] / dist[k], vy = y[k] / dist[k], vz = z[k] / dist[k];
+				float length = sqrtf(vx*vx + vy*vy + vz*vz);
+				if (vx >= m_minX[i] && vx <= m_maxX[i] && vy >= m_minY[i] && vy <= m_maxY[i] && vz >= m_minZ[i] && vz <= m_maxZ[i]
+					&& length >= m_minDistances[i] && length <= m_maxDistances[i])
+					recognizedMask |= 1u << k;
+			}
+		}
+#endif
+
+		// Leave out the padding of the last block
+		unsigned int usedMask = (1u << BlockSize) - 1;
+		if (block + BlockSize > m_numEntries)
+			usedMask = (1u << (m_numEntries - block)) - 1;
+		unsigned int word = block / 32, shift = block % 32;
+		recognizedBits[word] |= (recognizedMask & usedMask) << shift;
+		trackingErrorBits[word] |= (~validMask & usedMask) << shift;
+	}
+}
@@ -0,0 +1,67 @@
+// ****************************************************************************************
+//
+// Joint Relation Table
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+
+#pragma once
+
+#include "../FubiUtils.h"
+
+#include <vector>
+
+class FubiUser;
+
+// All joint relation recognizers of the loaded recognizer set compiled into one flat table (structure of arrays).
+// The whole table is evaluated for one user per frame in a single pass instead of calling each recognizer on its own.
+// Identical definitions share one entry, so the result of an entry may be used by many recognizers.
+class JointRelationTable
+{
+public:
+	// Entries are evaluated in blocks of this size, the arrays are padded accordingly
+	static const unsigned int BlockSize = 4;
+
+	JointRelationTable();
+
+	// Adds an entry for the given definition or returns the index of an identical one
+	unsigned int addEntry(Fubi::SkeletonJoint::Joint joint, Fubi::SkeletonJoint::Joint relJoint,
+		const Fubi::Vec3f& minValues, const Fubi::Vec3f& maxValues, float minDistance, float maxDistance,
+		bool useLocalPositions, float minConfidence, Fubi::BodyMeasurement::Measurement measuringUnit);
+
+	// Removes all entries
+	void clear();
+
+	unsigned int getNumEntries() const { return m_numEntries; }
+
+	// Number of result words (32 entries per word) needed for the current table
+	unsigned int getNumResultWords() const { return (m_numEntries + 31) / 32; }
+
+	// Evaluates all entries on the current tracking data of the user
+	// For entry i, bit (i%32) of word (i/32) is set in recognizedBits if the relation is fulfilled,
+	// or in trackingErrorBits if the confidence of the joints or the measuring unit is too low
+	// Both arrays need getNumResultWords() elements
+	void evaluate(const FubiUser* user, unsigned int* recognizedBits, unsigned int* trackingErrorBits) const;
+
+private:
+	// Index of the origin in the gathered joint arrays: all global joints, all local joints, then the origin
+	static const unsigned int OriginIndex = 2 * Fubi::SkeletonJoint::NUM_JOINTS;
+	static const unsigned int NumGatheredJoints = OriginIndex + 1;
+
+	unsigned int m_numEntries;
+
+	// Indices into the gathered joint arrays
+	std::vector<unsigned char> m_joints;
+	std::vector<unsigned char> m_relJoints;
+	// Index of the body measurement, NUM_MEASUREMENTS for none
+	std::vector<unsigned char> m_measuringUnits;
+	std::vector<float> m_minConfidences;
+	std::vector<float> m_minX, m_maxX;
+	std::vector<float> m_minY, m_maxY;
+	std::vector<float> m_minZ, m_maxZ;
+	std::vector<float> m_minDistances, m_maxDistances;
+};
@@ -15,10 +15,10 @@ using namespace Fubi;
 
 Fubi::RecognitionResult::Result LeftHandCloseToArmRecognizer::recognizeOn(FubiUser* user)
 {
-	const SkeletonJointPosition& leftHand = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_HAND];
-	const SkeletonJointPosition& rightHand = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_HAND];
-	const SkeletonJointPosition& rightShoulder = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_SHOULDER];
-	const SkeletonJointPosition& rightElbow = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_ELBOW];
+	const SkeletonJointPosition& leftHand = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_HAND];
+	const SkeletonJointPosition& rightHand = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_HAND];
+	const SkeletonJointPosition& rightShoulder = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_SHOULDER];
+	const SkeletonJointPosition& rightElbow = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_ELBOW];
 
 	Fubi::RecognitionResult::Result result = Fubi::RecognitionResult::NOT_RECOGNIZED;
 	if (leftHand.m_confidence >= m_minConfidence && rightElbow.m_confidence >= m_minConfidence)
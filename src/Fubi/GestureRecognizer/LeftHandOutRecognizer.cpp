@@ -14,8 +14,8 @@ using namespace Fubi;
 
 Fubi::RecognitionResult::Result LeftHandOutRecognizer::recognizeOn(FubiUser* user)
 {
-	const SkeletonJointPosition& leftHand = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_HAND];
-	const SkeletonJointPosition& leftShoulder = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_SHOULDER];
+	const SkeletonJointPosition& leftHand = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_HAND];
+	const SkeletonJointPosition& leftShoulder = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_SHOULDER];
 	Fubi::RecognitionResult::Result result = Fubi::RecognitionResult::NOT_RECOGNIZED;
 
 	if (leftHand.m_confidence >= m_minConfidence && leftShoulder.m_confidence >= m_minConfidence)
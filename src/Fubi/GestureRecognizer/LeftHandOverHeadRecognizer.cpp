@@ -14,8 +14,8 @@ using namespace Fubi;
 
 Fubi::RecognitionResult::Result LeftHandOverHeadRecognizer::recognizeOn(FubiUser* user)
 {
-	const SkeletonJointPosition& leftHand = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_HAND];
-	const SkeletonJointPosition& head = user->m_currentTrackingData.jointPositions[SkeletonJoint::HEAD];
+	const SkeletonJointPosition& leftHand = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_HAND];
+	const SkeletonJointPosition& head = user->getCurrentTrackingData().jointPositions[SkeletonJoint::HEAD];
 	if (leftHand.m_confidence >= m_minConfidence && head.m_confidence >= m_minConfidence)
 	{
 		if (leftHand.m_position.y > head.m_position.y)
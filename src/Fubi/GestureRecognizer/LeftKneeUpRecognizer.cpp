@@ -14,8 +14,8 @@ using namespace Fubi;
 
 Fubi::RecognitionResult::Result LeftKneeUpRecognizer::recognizeOn(FubiUser* user)
 {
-	const SkeletonJointPosition& leftKnee = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_KNEE];
-	const SkeletonJointPosition& leftHip = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_HIP];
+	const SkeletonJointPosition& leftKnee = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_KNEE];
+	const SkeletonJointPosition& leftHip = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_HIP];
 	if (leftKnee.m_confidence >= m_minConfidence && leftHip.m_confidence >= m_minConfidence)
 	{
 		if (abs(leftKnee.m_position.y - leftHip.m_position.y) < 250.0f)
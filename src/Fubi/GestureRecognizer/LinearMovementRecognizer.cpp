@@ -17,11 +17,11 @@ using namespace Fubi;
 LinearMovementRecognizer::LinearMovementRecognizer(Fubi::SkeletonJoint::Joint joint, Fubi::SkeletonJoint::Joint relJoint, 
 		const Fubi::Vec3f& direction, float minVel, float maxVel /*= Fubi::Math::MaxFloat*/, bool useLocalPos /*= false*/,
 		float minConfidence /*= -1.0f*/, float maxAngleDiff /*= 45.0f*/, 
-		bool useOnlyCorrectDirectionComponent /*= true*/)
-	: m_joint(joint), m_relJoint(relJoint), m_useRelJoint(true),
-	  m_minVel(minVel), m_maxVel(maxVel), m_useLocalPos(useLocalPos),
-	  m_maxAngleDiff(maxAngleDiff), m_useOnlyCorrectDirectionComponent(useOnlyCorrectDirectionComponent),
-	  IGestureRecognizer(false, minConfidence)
+		bool useOnlyCorrectDirectionComponent /*= true*/, float velocityWindow /*= 0*/)
+	: IGestureRecognizer(false, minConfidence),
+	  m_joint(joint), m_relJoint(relJoint), m_useOnlyCorrectDirectionComponent(useOnlyCorrectDirectionComponent),
+	  m_minVel(minVel), m_maxVel(maxVel), m_useRelJoint(true), m_useLocalPos(useLocalPos), m_maxAngleDiff(maxAngleDiff),
+	  m_velocityWindow((velocityWindow > 0) ? velocityWindow : 0), m_historyWindow(-1)
 {
 	m_directionValid = direction.length() > Math::Epsilon;
 	if (m_directionValid)
@@ -31,11 +31,11 @@ LinearMovementRecognizer::LinearMovementRecognizer(Fubi::SkeletonJoint::Joint jo
 LinearMovementRecognizer::LinearMovementRecognizer(Fubi::SkeletonJoint::Joint joint,
 		const Fubi::Vec3f& direction, float minVel, float maxVel /*= Fubi::Math::MaxFloat*/,
 		bool useLocalPos /*= false*/, float minConfidence /*= -1.0f*/, float maxAngleDiff /*= 45.0f*/, 
-		bool useOnlyCorrectDirectionComponent /*= true*/)
-	: m_joint(joint), m_useRelJoint(false),
-	m_minVel(minVel), m_maxVel(maxVel), m_useLocalPos(useLocalPos),
-	m_maxAngleDiff(maxAngleDiff), m_useOnlyCorrectDirectionComponent(useOnlyCorrectDirectionComponent),
-	IGestureRecognizer(false, minConfidence)
+		bool useOnlyCorrectDirectionComponent /*= true*/, float velocityWindow /*= 0*/)
+	: IGestureRecognizer(false, minConfidence),
+	m_joint(joint), m_useOnlyCorrectDirectionComponent(useOnlyCorrectDirectionComponent),
+	m_minVel(minVel), m_maxVel(maxVel), m_useRelJoint(false), m_useLocalPos(useLocalPos), m_maxAngleDiff(maxAngleDiff),
+	m_velocityWindow((velocityWindow > 0) ? velocityWindow : 0), m_historyWindow(-1)
 {
 	m_directionValid = direction.length() > Math::Epsilon;
 	if (m_directionValid)
@@ -45,117 +45,200 @@ LinearMovementRecognizer::LinearMovementRecognizer(Fubi::SkeletonJoint::Joint jo
 		m_minConfidence = minConfidence;
 }
 
-Fubi::RecognitionResult::Result LinearMovementRecognizer::recognizeOn(FubiUser* user)
+bool LinearMovementRecognizer::getDefinitionKey(std::string& key) const
 {
-	Fubi::RecognitionResult::Result result = Fubi::RecognitionResult::NOT_RECOGNIZED;
-	
-	if (user != 0x0)
+	key = "LinearMovement";
+	appendToKey(key, m_joint);
+	// Relative joint and direction are only set if they are used
+	appendToKey(key, m_useRelJoint);
+	if (m_useRelJoint)
+		appendToKey(key, m_relJoint);
+	appendToKey(key, m_directionValid);
+	if (m_directionValid)
+		appendToKey(key, m_direction);
+	appendToKey(key, m_useOnlyCorrectDirectionComponent);
+	appendToKey(key, m_minVel);
+	appendToKey(key, m_maxVel);
+	appendToKey(key, m_useLocalPos);
+	appendToKey(key, m_maxAngleDiff);
+	appendToKey(key, m_minConfidence);
+	appendToKey(key, m_velocityWindow);
+	return true;
+}
+
+void LinearMovementRecognizer::requestHistoryWindows(JointHistoryWindows& windows)
+{
+	if (m_velocityWindow > 0)
 	{
-		// Get joint positions
-		SkeletonJointPosition* joint = &(user->m_currentTrackingData.jointPositions[m_joint]);
-		SkeletonJointPosition* lastJoint = &(user->m_lastTrackingData.jointPositions[m_joint]);
-		if (m_useLocalPos)
+		m_historyWindow = (int) windows.addWindow(m_velocityWindow, m_minConfidence, m_joint, m_useLocalPos);
+		if (m_useRelJoint)
+			windows.addWindow(m_velocityWindow, m_minConfidence, m_relJoint, m_useLocalPos);
+	}
+}
+
+void LinearMovementRecognizer::requestLocalTransformations(Fubi::LocalTransformationJoints& joints)
+{
+	if (m_useLocalPos)
+	{
+		joints.addPosition(m_joint);
+		if (m_useRelJoint)
+			joints.addPosition(m_relJoint);
+	}
+}
+
+unsigned int LinearMovementRecognizer::getRequiredJoints() const
+{
+	// Local positions are never more confident than the global ones
+	unsigned int joints = 0;
+	if (m_joint < SkeletonJoint::NUM_JOINTS)
+		joints |= 1u << m_joint;
+	if (m_useRelJoint && m_relJoint < SkeletonJoint::NUM_JOINTS)
+		joints |= 1u << m_relJoint;
+	return joints;
+}
+
+bool LinearMovementRecognizer::getMovement(FubiUser* user, Fubi::Vec3f& movement, float& time)
+{
+	// Without a velocity window, the movement is also calculated out of the last frame
+	updateLocalTransformations(user, m_historyWindow < 0);
+
+	// Get joint positions
+	SkeletonJointPosition* joint = &(user->getCurrentTrackingData().jointPositions[m_joint]);
+	SkeletonJointPosition* lastJoint = &(user->getLastTrackingData().jointPositions[m_joint]);
+	if (m_useLocalPos)
+	{
+		joint = &(user->getCurrentTrackingData().localJointPositions[m_joint]);
+		lastJoint = &(user->getLastTrackingData().localJointPositions[m_joint]);
+	}
+
+	if (m_historyWindow >= 0)
+	{
+		// The joints have to be tracked now, their velocity is then taken from the tracked samples of the window
+		if (joint->m_confidence < m_minConfidence
+			|| !user->m_jointHistory.getVelocity((unsigned int) m_historyWindow, m_joint, m_useLocalPos, movement))
+			return false;
+		if (m_useRelJoint)
 		{
-			joint = &(user->m_currentTrackingData.localJointPositions[m_joint]);
-			lastJoint = &(user->m_lastTrackingData.localJointPositions[m_joint]);
+			SkeletonJointPosition* relJoint = &(user->getCurrentTrackingData().jointPositions[m_relJoint]);
+			if (m_useLocalPos)
+				relJoint = &(user->getCurrentTrackingData().localJointPositions[m_relJoint]);
+			Vec3f relVelocity(Fubi::Math::NO_INIT);
+			if (relJoint->m_confidence < m_minConfidence
+				|| !user->m_jointHistory.getVelocity((unsigned int) m_historyWindow, m_relJoint, m_useLocalPos, relVelocity))
+				return false;
+			movement -= relVelocity;
 		}
+		time = 1.0f;
+		return true;
+	}
 
-		// Check confidence
-		if (joint->m_confidence >= m_minConfidence && lastJoint->m_confidence >= m_minConfidence)
-		{
-			bool relJointsValid = false;
+	// Check confidence
+	if (joint->m_confidence >= m_minConfidence && lastJoint->m_confidence >= m_minConfidence)
+	{
+		bool relJointsValid = false;
 
-			// Calculate relative vector of current and last frame
-			Vec3f vector(Fubi::Math::NO_INIT);
-			Vec3f lastVector(Fubi::Math::NO_INIT);
-			if (m_useRelJoint)
+		// Calculate relative vector of current and last frame
+		Vec3f vector(Fubi::Math::NO_INIT);
+		Vec3f lastVector(Fubi::Math::NO_INIT);
+		if (m_useRelJoint)
+		{
+			// Using the other joint
+			SkeletonJointPosition* relJoint = &(user->getCurrentTrackingData().jointPositions[m_relJoint]);
+			SkeletonJointPosition* lastRelJoint = &(user->getLastTrackingData().jointPositions[m_relJoint]);
+			if (m_useLocalPos)
 			{
-				// Using the other joint
-				SkeletonJointPosition* relJoint = &(user->m_currentTrackingData.jointPositions[m_relJoint]);
-				SkeletonJointPosition* lastRelJoint = &(user->m_lastTrackingData.jointPositions[m_relJoint]);
-				if (m_useLocalPos)
-				{
-					relJoint = &(user->m_currentTrackingData.localJointPositions[m_relJoint]);
-					lastRelJoint = &(user->m_lastTrackingData.localJointPositions[m_relJoint]);
-				}
-				relJointsValid = relJoint->m_confidence >= m_minConfidence && lastRelJoint->m_confidence >= m_minConfidence;
-				if(relJointsValid)
-				{
-					vector = joint->m_position - relJoint->m_position;
-					lastVector = lastJoint->m_position -lastRelJoint->m_position;
-				}
+				relJoint = &(user->getCurrentTrackingData().localJointPositions[m_relJoint]);
+				lastRelJoint = &(user->getLastTrackingData().localJointPositions[m_relJoint]);
 			}
-			else
+			relJointsValid = relJoint->m_confidence >= m_minConfidence && lastRelJoint->m_confidence >= m_minConfidence;
+			if(relJointsValid)
 			{
-				// Absolute values (relative to Kinect position)
-				relJointsValid = true;
-				vector = joint->m_position;
-				lastVector =lastJoint->m_position;
+				vector = joint->m_position - relJoint->m_position;
+				lastVector = lastJoint->m_position -lastRelJoint->m_position;
 			}
+		}
+		else
+		{
+			// Absolute values (relative to Kinect position)
+			relJointsValid = true;
+			vector = joint->m_position;
+			lastVector =lastJoint->m_position;
+		}
+
+		if (relJointsValid)
+		{
+			// Get the difference between both vectors and the time
+			movement = vector - lastVector;
+			time = clamp(float(user->getCurrentTrackingData().timeStamp - user->getLastTrackingData().timeStamp), Math::Epsilon, Math::MaxFloat);
+			return true;
+		}
+	}
+	return false;
+}
+
+Fubi::RecognitionResult::Result LinearMovementRecognizer::recognizeOn(FubiUser* user)
+{
+	Fubi::RecognitionResult::Result result = Fubi::RecognitionResult::NOT_RECOGNIZED;
 	
-		
-			if (relJointsValid)
+	if (user != 0x0)
+	{
+		Vec3f diffVector(Fubi::Math::NO_INIT);
+		float diffTime;
+		if (getMovement(user, diffVector, diffTime))
+		{
+			float vel = 0;
+			float angleDiff = 0;
+			if (m_directionValid)
 			{
-				// Get the difference between both vectors and the time
-				Vec3f diffVector = vector - lastVector;
-				float diffTime = clamp(float(user->m_currentTrackingData.timeStamp - user->m_lastTrackingData.timeStamp), Math::Epsilon, Math::MaxFloat);
-	
-				float vel = 0;
-				float angleDiff = 0;
-				if (m_directionValid)
+				if (m_useOnlyCorrectDirectionComponent)
 				{
-					if (m_useOnlyCorrectDirectionComponent)
-					{
-						// Weight the vector components according to the given direction
-						// Apply the direction stretched to the same length on the vector
-						// Components in the correct direction will result in a positive value
-						// Components in the wrong direction have a negative value
-						Vec3f dirVector = diffVector * (m_direction * diffVector.length());
-			
-						// Build the sum of the weighted and signed components
-						float sum = dirVector.x + dirVector.y + dirVector.z;
-
-						// Calcluate the velocity (if there are too many negative values it may be less then zero)
-						vel = (sum <= 0) ? (-sqrt(-sum) / diffTime) : (sqrt(sum) / diffTime);
-					}
-					else
-						// calculate the velocity directly from the current vector
-						vel = diffVector.length() / diffTime;
-
-					// Additionally check the angle difference
-					angleDiff = radToDeg(acosf(diffVector.dot(m_direction) / (diffVector.length() * m_direction.length())));
+					// Weight the vector components according to the given direction
+					// Apply the direction stretched to the same length on the vector
+					// Components in the correct direction will result in a positive value
+					// Components in the wrong direction have a negative value
+					Vec3f dirVector = diffVector * (m_direction * diffVector.length());
+		
+					// Build the sum of the weighted and signed components
+					float sum = dirVector.x + dirVector.y + dirVector.z;
+
+					// Calcluate the velocity (if there are too many negative values it may be less then zero)
+					vel = (sum <= 0) ? (-sqrt(-sum) / diffTime) : (sqrt(sum) / diffTime);
 				}
 				else
-				{
-					// No direction given so check for movement speed in any direction
+					// calculate the velocity directly from the current vector
 					vel = diffVector.length() / diffTime;
-				}
 
-				// Check if velocity is in between the boundaries
-				if (vel >= m_minVel && vel <= m_maxVel && angleDiff <= m_maxAngleDiff)
-					result = RecognitionResult::RECOGNIZED;
-
-				//if (/*!recognized && */abs(vel) > 200)
-				//{
-				//	if (m_maxVel > 10000.0f)
-				//	{
-				//		Fubi_logInfo("Lin Gesture rec: vel=%4.0f <= %4.0f <= INF recognized=%s\n", 
-				//		  m_minVel, vel, (result == RecognitionResult::RECOGNIZED) ? "true" : "false");
-				//	}
-				//	else
-				//		Fubi_logInfo("Lin Gesture rec: vel=%4.0f <= %4.0f <= %4.0f recognized=%s\n", 
-				//		m_minVel, vel, m_maxVel, (result == RecognitionResult::RECOGNIZED) ? "true" : "false");
-				//	/*diffVector.normalize();
-
-				//	Fubi_logInfo("Lin Gesture rec: Hand.z=%.3f, targetDir=%.3f/%.3f/%.3f \n\t\tactualDir=%.3f/%.3f/%.3f vel=%.0f/%.0f recognized=%s\n", 
-				//		joint.m_position.z,
-				//		m_direction.x, m_direction.y, m_direction.z, 
-				//		diffVector.x, diffVector.y, diffVector.z,
-				//		vel, m_minVel, recognized ? "true" : "false");*/
-				//}
+				// Additionally check the angle difference
+				angleDiff = radToDeg(acosf(diffVector.dot(m_direction) / (diffVector.length() * m_direction.length())));
 			}
 			else
-				result = Fubi::RecognitionResult::TRACKING_ERROR;
+			{
+				// No direction given so check for movement speed in any direction
+				vel = diffVector.length() / diffTime;
+			}
+
+			// Check if velocity is in between the boundaries
+			if (vel >= m_minVel && vel <= m_maxVel && angleDiff <= m_maxAngleDiff)
+				result = RecognitionResult::RECOGNIZED;
+
+			//if (/*!recognized && */abs(vel) > 200)
+			//{
+			//	if (m_maxVel > 10000.0f)
+			//	{
+			//		Fubi_logInfo("Lin Gesture rec: vel=%4.0f <= %4.0f <= INF recognized=%s\n", 
+			//		  m_minVel, vel, (result == RecognitionResult::RECOGNIZED) ? "true" : "false");
+			//	}
+			//	else
+			//		Fubi_logInfo("Lin Gesture rec: vel=%4.0f <= %4.0f <= %4.0f recognized=%s\n", 
+			//		m_minVel, vel, m_maxVel, (result == RecognitionResult::RECOGNIZED) ? "true" : "false");
+			//	/*diffVector.normalize();
+
+			//	Fubi_logInfo("Lin Gesture rec: Hand.z=%.3f, targetDir=%.3f/%.3f/%.3f \n\t\tactualDir=%.3f/%.3f/%.3f vel=%.0f/%.0f recognized=%s\n", 
+			//		joint.m_position.z,
+			//		m_direction.x, m_direction.y, m_direction.z, 
+			//		diffVector.x, diffVector.y, diffVector.z,
+			//		vel, m_minVel, recognized ? "true" : "false");*/
+			//}
 		}
 		else
 			result = Fubi::RecognitionResult::TRACKING_ERROR;
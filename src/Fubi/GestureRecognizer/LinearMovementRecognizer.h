@@ -19,11 +19,11 @@ public:
 	LinearMovementRecognizer(Fubi::SkeletonJoint::Joint joint, Fubi::SkeletonJoint::Joint relJoint, 
 		const Fubi::Vec3f& direction, float minVel, float maxVel = Fubi::Math::MaxFloat,
 		bool useLocalPos = false, float minConfidence = -1.0f,
-		float maxAngleDiff = 45.0f, bool useOnlyCorrectDirectionComponent = true);
+		float maxAngleDiff = 45.0f, bool useOnlyCorrectDirectionComponent = true, float velocityWindow = 0);
 	LinearMovementRecognizer(Fubi::SkeletonJoint::Joint joint, const Fubi::Vec3f& direction,
 		float minVel, float maxVel = Fubi::Math::MaxFloat,
 		bool useLocalPos = false, float minConfidence = -1.0f,
-		float maxAngleDiff = 45.0f, bool useOnlyCorrectDirectionComponent = true);
+		float maxAngleDiff = 45.0f, bool useOnlyCorrectDirectionComponent = true, float velocityWindow = 0);
 
 	virtual ~LinearMovementRecognizer() {}
 
@@ -31,7 +31,20 @@ public:
 
 	virtual IGestureRecognizer* clone() { return new LinearMovementRecognizer(*this); }
 
+	virtual bool getDefinitionKey(std::string& key) const;
+
+	virtual unsigned int getRequiredJoints() const;
+
+	// With a velocity window, the velocity is taken from the joint history of the user
+	virtual void requestHistoryWindows(JointHistoryWindows& windows);
+
+	virtual void requestLocalTransformations(Fubi::LocalTransformationJoints& joints);
+
 private:
+	// Movement of the joint and the time it took, returns false on tracking errors
+	// Without a velocity window it is the difference to the last frame, otherwise the velocity over the window within one second
+	bool getMovement(FubiUser* user, Fubi::Vec3f& movement, float& time);
+
 	Fubi::SkeletonJoint::Joint m_joint;
 	Fubi::SkeletonJoint::Joint m_relJoint;
 	Fubi::Vec3f m_direction;
@@ -42,4 +55,8 @@ private:
 	bool m_useRelJoint;
 	bool m_useLocalPos;
 	float m_maxAngleDiff;
+	// Length of the window the velocity is averaged over in seconds, 0 for the last frame only
+	float m_velocityWindow;
+	// Index of the window in the joint history, -1 if not requested
+	int m_historyWindow;
 };
\ No newline at end of file
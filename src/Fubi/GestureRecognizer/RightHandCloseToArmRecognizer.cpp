@@ -14,10 +14,10 @@ using namespace Fubi;
 
 Fubi::RecognitionResult::Result RightHandCloseToArmRecognizer::recognizeOn(FubiUser* user)
 {
-	const SkeletonJointPosition& rightHand = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_HAND];
-	const SkeletonJointPosition& leftHand = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_HAND];
-	const SkeletonJointPosition& leftShoulder = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_SHOULDER];
-	const SkeletonJointPosition& leftElbow = user->m_currentTrackingData.jointPositions[SkeletonJoint::LEFT_ELBOW];
+	const SkeletonJointPosition& rightHand = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_HAND];
+	const SkeletonJointPosition& leftHand = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_HAND];
+	const SkeletonJointPosition& leftShoulder = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_SHOULDER];
+	const SkeletonJointPosition& leftElbow = user->getCurrentTrackingData().jointPositions[SkeletonJoint::LEFT_ELBOW];
 	Fubi::RecognitionResult::Result result = Fubi::RecognitionResult::NOT_RECOGNIZED;
 
 	if (rightHand.m_confidence >= m_minConfidence && leftElbow.m_confidence >= m_minConfidence)
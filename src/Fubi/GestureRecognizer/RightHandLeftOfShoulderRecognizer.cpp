@@ -15,8 +15,8 @@ using namespace Fubi;
 
 Fubi::RecognitionResult::Result RightHandLeftOfShoulderRecognizer::recognizeOn(FubiUser* user)
 {
-	const SkeletonJointPosition& rightHand = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_HAND];
-	const SkeletonJointPosition& rightShoulder = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_SHOULDER];
+	const SkeletonJointPosition& rightHand = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_HAND];
+	const SkeletonJointPosition& rightShoulder = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_SHOULDER];
 	if (rightHand.m_confidence >= m_minConfidence && rightShoulder.m_confidence >= m_minConfidence)
 	{
 		if (rightHand.m_position.x < rightShoulder.m_position.x)
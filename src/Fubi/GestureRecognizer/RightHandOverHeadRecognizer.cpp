@@ -14,8 +14,8 @@ using namespace Fubi;
 
 Fubi::RecognitionResult::Result RightHandOverHeadRecognizer::recognizeOn(FubiUser* user)
 {
-	const SkeletonJointPosition& rightHand = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_HAND];
-	const SkeletonJointPosition& head = user->m_currentTrackingData.jointPositions[SkeletonJoint::HEAD];
+	const SkeletonJointPosition& rightHand = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_HAND];
+	const SkeletonJointPosition& head = user->getCurrentTrackingData().jointPositions[SkeletonJoint::HEAD];
 	if (rightHand.m_confidence >= m_minConfidence && head.m_confidence >= m_minConfidence)
 	{
 		if (rightHand.m_position.y > head.m_position.y)
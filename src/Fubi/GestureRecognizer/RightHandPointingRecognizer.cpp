@@ -15,9 +15,9 @@ using namespace Fubi;
 
 Fubi::RecognitionResult::Result  RightHandPointingRecognizer::recognizeOn(FubiUser* user)
 {
-	const SkeletonJointPosition& rightHand = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_HAND];
-	const SkeletonJointPosition& rightShoulder = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_SHOULDER];
-	const SkeletonJointPosition& rightElbow = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_ELBOW];
+	const SkeletonJointPosition& rightHand = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_HAND];
+	const SkeletonJointPosition& rightShoulder = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_SHOULDER];
+	const SkeletonJointPosition& rightElbow = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_ELBOW];
 	if (rightHand.m_confidence >= m_minConfidence && rightShoulder.m_confidence >= m_minConfidence && rightElbow.m_confidence >= m_minConfidence)
 	{
 		Vec3f origin = rightShoulder.m_position;
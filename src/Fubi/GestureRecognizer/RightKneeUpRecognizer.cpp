@@ -14,8 +14,8 @@ using namespace Fubi;
 
 RecognitionResult::Result RightKneeUpRecognizer::recognizeOn(FubiUser* user)
 {
-	const SkeletonJointPosition& rightKnee = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_KNEE];
-	const SkeletonJointPosition& rightHip = user->m_currentTrackingData.jointPositions[SkeletonJoint::RIGHT_HIP];
+	const SkeletonJointPosition& rightKnee = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_KNEE];
+	const SkeletonJointPosition& rightHip = user->getCurrentTrackingData().jointPositions[SkeletonJoint::RIGHT_HIP];
 	if (rightKnee.m_confidence >= m_minConfidence && rightHip.m_confidence >= m_minConfidence)
 	{
 		if (abs(rightKnee.m_position.y - rightHip.m_position.y) < 250.0f)
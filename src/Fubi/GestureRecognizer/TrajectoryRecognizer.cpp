@@ -0,0 +1,369 @@
+// ****************************************************************************************
+//
+// Fubi Trajectory Recognizer
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+#include "TrajectoryRecognizer.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FUBI_TRAJECTORY_SSE
+#include <emmintrin.h>
+#endif
+
+using namespace Fubi;
+
+namespace
+{
+	// Orders template indices by their lower bound
+	struct LowerBoundLess
+	{
+		LowerBoundLess(const float* lowerBounds) : m_lowerBounds(lowerBounds) {}
+		bool operator()(unsigned int a, unsigned int b) const { return m_lowerBounds[a] < m_lowerBounds[b]; }
+		const float* m_lowerBounds;
+	};
+}
+
+TrajectoryRecognizer::TrajectoryRecognizer(Fubi::SkeletonJoint::Joint joint, Fubi::SkeletonJoint::Joint relJoint /*= Fubi::SkeletonJoint::NUM_JOINTS*/,
+	float duration /*= 1.0f*/, unsigned int numSamples /*= 32*/, float warpingWindow /*= 0.1f*/, float maxDistance /*= Fubi::Math::MaxFloat*/,
+	bool useLocalPositions /*= false*/, float minConfidence /*= -1.0f*/,
+	Fubi::BodyMeasurement::Measurement measuringUnit /*= Fubi::BodyMeasurement::NUM_MEASUREMENTS*/)
+	: IGestureRecognizer(false, minConfidence),
+	  m_joint(joint), m_relJoint(relJoint), m_useLocalPositions(useLocalPositions), m_measuringUnit(measuringUnit),
+	  m_duration((duration > Math::Epsilon) ? duration : 1.0f), m_numSamples((numSamples > 1) ? numSamples : 2),
+	  m_maxDistance(maxDistance), m_templates(new Templates()),
+	  m_trajectory(-1),
+	  m_lastUserID(0), m_lastTimeStamp(-1), m_lastResult(Fubi::RecognitionResult::NOT_RECOGNIZED), m_lastTemplate(-1), m_lastDistance(Math::MaxFloat)
+{
+	m_paddedSamples = ((m_numSamples + 3 + 3) / 4) * 4;
+	m_window = (unsigned int) ceilf(clamp(warpingWindow, 0.0f, 1.0f) * m_numSamples);
+	if (m_window >= m_numSamples)
+		m_window = m_numSamples - 1;
+
+	// At most two samples per query sample, independent of the sensor rate
+	m_minSampleInterval = m_duration / (2.0 * m_numSamples);
+
+	// The padding stays zero and adds nothing to the distances
+	m_queryX.resize(m_paddedSamples, 0);
+	m_queryY.resize(m_paddedSamples, 0);
+	m_queryZ.resize(m_paddedSamples, 0);
+	m_costs.resize(m_paddedSamples, 0);
+	m_contributions.resize(m_paddedSamples, 0);
+	m_rows.resize(2 * (m_numSamples + 1), Math::MaxFloat);
+}
+
+bool TrajectoryRecognizer::addTemplate(const std::vector<Fubi::Vec3f>& points)
+{
+	if (points.size() < 2)
+		return false;
+
+	Templates& templates = *m_templates;
+	unsigned int offset = templates.m_numTemplates * m_paddedSamples;
+	unsigned int size = offset + m_paddedSamples;
+	templates.m_x.resize(size, 0);
+	templates.m_y.resize(size, 0);
+	templates.m_z.resize(size, 0);
+	templates.m_lowerX.resize(size, 0);
+	templates.m_lowerY.resize(size, 0);
+	templates.m_lowerZ.resize(size, 0);
+	templates.m_upperX.resize(size, 0);
+	templates.m_upperY.resize(size, 0);
+	templates.m_upperZ.resize(size, 0);
+
+	// The points are expected at equal time steps, so they are resampled by their index
+	float step = (float) (points.size() - 1) / (m_numSamples - 1);
+	for (unsigned int i = 0; i < m_numSamples; ++i)
+	{
+		float pos = i * step;
+		unsigned int index = std::min((unsigned int) pos, (unsigned int) points.size() - 2);
+		float t = pos - index;
+		Vec3f point = points[index] * (1.0f - t) + points[index + 1] * t;
+		templates.m_x[offset + i] = point.x;
+		templates.m_y[offset + i] = point.y;
+		templates.m_z[offset + i] = point.z;
+	}
+
+	for (unsigned int i = 0; i < m_numSamples; ++i)
+	{
+		unsigned int start = (i > m_window) ? (i - m_window) : 0;
+		unsigned int end = std::min(i + m_window, m_numSamples - 1);
+		float minX = Math::MaxFloat, minY = Math::MaxFloat, minZ = Math::MaxFloat;
+		float maxX = -Math::MaxFloat, maxY = -Math::MaxFloat, maxZ = -Math::MaxFloat;
+		for (unsigned int j = start; j <= end; ++j)
+		{
+			minX = std::min(minX, templates.m_x[offset + j]);
+			minY = std::min(minY, templates.m_y[offset + j]);
+			minZ = std::min(minZ, templates.m_z[offset + j]);
+			maxX = std::max(maxX, templates.m_x[offset + j]);
+			maxY = std::max(maxY, templates.m_y[offset + j]);
+			maxZ = std::max(maxZ, templates.m_z[offset + j]);
+		}
+		templates.m_lowerX[offset + i] = minX;
+		templates.m_lowerY[offset + i] = minY;
+		templates.m_lowerZ[offset + i] = minZ;
+		templates.m_upperX[offset + i] = maxX;
+		templates.m_upperY[offset + i] = maxY;
+		templates.m_upperZ[offset + i] = maxZ;
+	}
+
+	templates.m_numTemplates++;
+	m_lowerBounds.resize(templates.m_numTemplates);
+	m_order.resize(templates.m_numTemplates);
+	return true;
+}
+
+unsigned int TrajectoryRecognizer::getRequiredJoints() const
+{
+	unsigned int joints = 0;
+	if (m_joint < SkeletonJoint::NUM_JOINTS)
+		joints |= 1u << m_joint;
+	if (m_relJoint < SkeletonJoint::NUM_JOINTS)
+		joints |= 1u << m_relJoint;
+	return joints;
+}
+
+void TrajectoryRecognizer::requestHistoryWindows(JointHistoryWindows& windows)
+{
+	m_trajectory = (int) windows.addTrajectory(JointHistoryTrajectory(m_joint, m_relJoint, m_useLocalPositions, m_minConfidence, m_duration, m_minSampleInterval));
+}
+
+void TrajectoryRecognizer::requestLocalTransformations(Fubi::LocalTransformationJoints& joints)
+{
+	if (m_useLocalPositions)
+	{
+		joints.addPosition(m_joint);
+		joints.addPosition(m_relJoint);
+	}
+}
+
+bool TrajectoryRecognizer::resampleQuery(const FubiJointHistory& history, float scale)
+{
+	unsigned int trajectory = (unsigned int) m_trajectory;
+	unsigned int numSamples = history.getNumTrajectorySamples(trajectory);
+	if (numSamples < 2)
+		return false;
+
+	double end = history.getTrajectoryTime(trajectory, numSamples - 1);
+	double start = end - m_duration;
+	if (history.getTrajectoryTime(trajectory, 0) > start + m_minSampleInterval)
+		return false;
+
+	double step = m_duration / (m_numSamples - 1);
+	unsigned int sample = 0;
+	double time0 = history.getTrajectoryTime(trajectory, 0), time1 = history.getTrajectoryTime(trajectory, 1);
+	for (unsigned int i = 0; i < m_numSamples; ++i)
+	{
+		double time = start + i * step;
+		while (sample + 2 < numSamples && time1 < time)
+		{
+			sample++;
+			time0 = time1;
+			time1 = history.getTrajectoryTime(trajectory, sample + 1);
+		}
+		double interval = time1 - time0;
+		float t = (interval > 0) ? (float) clamp((time - time0) / interval, 0.0, 1.0) : 1.0f;
+		Vec3f position = (history.getTrajectoryPosition(trajectory, sample) * (1.0f - t) + history.getTrajectoryPosition(trajectory, sample + 1) * t) * scale;
+		m_queryX[i] = position.x;
+		m_queryY[i] = position.y;
+		m_queryZ[i] = position.z;
+	}
+	return true;
+}
+
+float TrajectoryRecognizer::lowerBound(unsigned int templateIndex, float* contributions)
+{
+	const Templates& templates = *m_templates;
+	unsigned int offset = templateIndex * m_paddedSamples;
+	const float* lowerX = &templates.m_lowerX[offset];
+	const float* lowerY = &templates.m_lowerY[offset];
+	const float* lowerZ = &templates.m_lowerZ[offset];
+	const float* upperX = &templates.m_upperX[offset];
+	const float* upperY = &templates.m_upperY[offset];
+	const float* upperZ = &templates.m_upperZ[offset];
+
+	float sum = 0;
+#ifdef FUBI_TRAJECTORY_SSE
+	__m128 zero = _mm_setzero_ps();
+	__m128 total = zero;
+	for (unsigned int i = 0; i < m_paddedSamples; i += 4)
+	{
+		// Only one of the two differences can be positive
+		__m128 q = _mm_loadu_ps(&m_queryX[i]);
+		__m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(q, _mm_loadu_ps(upperX + i)), zero), _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(lowerX + i), q), zero));
+		q = _mm_loadu_ps(&m_queryY[i]);
+		__m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(q, _mm_loadu_ps(upperY + i)), zero), _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(lowerY + i), q), zero));
+		q = _mm_loadu_ps(&m_queryZ[i]);
+		__m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(q, _mm_loadu_ps(upperZ + i)), zero), _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(lowerZ + i), q), zero));
+		__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		if (contributions)
+			_mm_storeu_ps(contributions + i, dist);
+		total = _mm_add_ps(total, dist);
+	}
+	float lanes[4];
+	_mm_storeu_ps(lanes, total);
+	sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+	for (unsigned int i = 0; i < m_paddedSamples; ++i)
+	{
+		float dx = std::max(m_queryX[i] - upperX[i], 0.0f) + std::max(lowerX[i] - m_queryX[i], 0.0f);
+		float dy = std::max(m_queryY[i] - upperY[i], 0.0f) + std::max(lowerY[i] - m_queryY[i], 0.0f);
+		float dz = std::max(m_queryZ[i] - upperZ[i], 0.0f) + std::max(lowerZ[i] - m_queryZ[i], 0.0f);
+		float dist = dx*dx + dy*dy + dz*dz;
+		if (contributions)
+			contributions[i] = dist;
+		sum += dist;
+	}
+#endif
+	return sum;
+}
+
+float TrajectoryRecognizer::warpingDistance(unsigned int templateIndex, float abandonAbove)
+{
+	const Templates& templates = *m_templates;
+	unsigned int offset = templateIndex * m_paddedSamples;
+	const float* templateX = &templates.m_x[offset];
+	const float* templateY = &templates.m_y[offset];
+	const float* templateZ = &templates.m_z[offset];
+
+	// Lower bound of the rows still to come: m_contributions[i] is the sum of the contributions of the query samples i to n-1
+	float remaining = 0;
+	for (int i = (int) m_numSamples - 1; i >= 0; --i)
+	{
+		remaining += m_contributions[i];
+		m_contributions[i] = remaining;
+	}
+	m_contributions[m_numSamples] = 0;
+
+	// Two rows of the cost matrix, index 0 is the border in front of the first template sample
+	unsigned int n = m_numSamples;
+	float* previous = &m_rows[0];
+	float* current = &m_rows[n + 1];
+	std::fill(m_rows.begin(), m_rows.end(), Math::MaxFloat);
+	previous[0] = 0;
+
+	for (unsigned int i = 1; i <= n; ++i)
+	{
+		unsigned int start = (i > m_window + 1) ? (i - m_window) : 1;
+		unsigned int end = std::min(i + m_window, n);
+		unsigned int count = end - start + 1;
+
+		// Squared distances of the query sample to all template samples within the window
+		const float* x = templateX + start - 1;
+		const float* y = templateY + start - 1;
+		const float* z = templateZ + start - 1;
+#ifdef FUBI_TRAJECTORY_SSE
+		__m128 qx = _mm_set1_ps(m_queryX[i - 1]);
+		__m128 qy = _mm_set1_ps(m_queryY[i - 1]);
+		__m128 qz = _mm_set1_ps(m_queryZ[i - 1]);
+		for (unsigned int j = 0; j < count; j += 4)
+		{
+			__m128 dx = _mm_sub_ps(_mm_loadu_ps(x + j), qx);
+			__m128 dy = _mm_sub_ps(_mm_loadu_ps(y + j), qy);
+			__m128 dz = _mm_sub_ps(_mm_loadu_ps(z + j), qz);
+			_mm_storeu_ps(&m_costs[j], _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+		}
+#else
+		for (unsigned int j = 0; j < count; ++j)
+		{
+			float dx = x[j] - m_queryX[i - 1], dy = y[j] - m_queryY[i - 1], dz = z[j] - m_queryZ[i - 1];
+			m_costs[j] = dx*dx + dy*dy + dz*dz;
+		}
+#endif
+
+		current[start - 1] = Math::MaxFloat;
+		float rowMinimum = Math::MaxFloat;
+		for (unsigned int j = start; j <= end; ++j)
+		{
+			float best = std::min(std::min(previous[j - 1], previous[j]), current[j - 1]);
+			float value = m_costs[j - start] + best;
+			current[j] = value;
+			rowMinimum = std::min(rowMinimum, value);
+		}
+
+		// Every path to the end goes through this row and then through all following query samples
+		if (rowMinimum + m_contributions[i] >= abandonAbove)
+			return Math::MaxFloat;
+
+		std::swap(previous, current);
+	}
+
+	return (previous[n] < abandonAbove) ? previous[n] : Math::MaxFloat;
+}
+
+Fubi::RecognitionResult::Result TrajectoryRecognizer::recognizeOn(FubiUser* user)
+{
+	// The matching is only done once per frame of a user
+	FubiUser::TrackingData& data = user->getCurrentTrackingData();
+	if (user->m_id == m_lastUserID && data.timeStamp == m_lastTimeStamp)
+		return m_lastResult;
+	m_lastUserID = user->m_id;
+	m_lastTimeStamp = data.timeStamp;
+	m_lastTemplate = -1;
+	m_lastDistance = Math::MaxFloat;
+
+	// The trajectory itself is sampled by the joint history, but the joints have to be tracked in the current frame
+	updateLocalTransformations(user);
+	SkeletonJointPosition* joint = m_useLocalPositions ? &data.localJointPositions[m_joint] : &data.jointPositions[m_joint];
+	if (joint->m_confidence < m_minConfidence)
+		return m_lastResult = Fubi::RecognitionResult::TRACKING_ERROR;
+	if (m_relJoint != SkeletonJoint::NUM_JOINTS)
+	{
+		SkeletonJointPosition* relJoint = m_useLocalPositions ? &data.localJointPositions[m_relJoint] : &data.jointPositions[m_relJoint];
+		if (relJoint->m_confidence < m_minConfidence)
+			return m_lastResult = Fubi::RecognitionResult::TRACKING_ERROR;
+	}
+	float scale = 1.0f;
+	if (m_measuringUnit != BodyMeasurement::NUM_MEASUREMENTS)
+	{
+		BodyMeasurementDistance& measure = user->m_bodyMeasurements[m_measuringUnit];
+		if (measure.m_confidence < m_minConfidence || measure.m_dist <= Math::Epsilon)
+			return m_lastResult = Fubi::RecognitionResult::TRACKING_ERROR;
+		scale = 1.0f / measure.m_dist;
+	}
+
+	m_lastResult = Fubi::RecognitionResult::NOT_RECOGNIZED;
+	unsigned int numTemplates = m_templates->m_numTemplates;
+	if (m_trajectory < 0 || numTemplates == 0 || !resampleQuery(user->m_jointHistory, scale))
+		return m_lastResult;
+
+	// Sum of squared distances that corresponds to the maximum distance
+	float threshold = Math::MaxFloat;
+	if (m_maxDistance < sqrtf(Math::MaxFloat / m_numSamples))
+		threshold = m_maxDistance * m_maxDistance * m_numSamples;
+
+	// Templates with the lowest lower bound first, the others are skipped once their bound is above the best distance
+	for (unsigned int i = 0; i < numTemplates; ++i)
+	{
+		m_lowerBounds[i] = lowerBound(i, 0x0);
+		m_order[i] = i;
+	}
+	std::sort(m_order.begin(), m_order.end(), LowerBoundLess(&m_lowerBounds[0]));
+
+	float best = threshold;
+	for (unsigned int i = 0; i < numTemplates; ++i)
+	{
+		unsigned int index = m_order[i];
+		if (m_lowerBounds[index] >= best)
+			break;
+		lowerBound(index, &m_contributions[0]);
+		float distance = warpingDistance(index, best);
+		if (distance < best)
+		{
+			best = distance;
+			m_lastTemplate = (int) index;
+		}
+	}
+
+	if (m_lastTemplate >= 0)
+	{
+		m_lastDistance = sqrtf(best / m_numSamples);
+		m_lastResult = Fubi::RecognitionResult::RECOGNIZED;
+	}
+	return m_lastResult;
+}
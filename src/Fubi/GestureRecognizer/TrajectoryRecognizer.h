@@ -0,0 +1,112 @@
+// ****************************************************************************************
+//
+// Fubi Trajectory Recognizer
+// ---------------------------------------------------------
+// Copyright (C) 2010-2013 Felix Kistler
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/org/documents/epl-v10.html
+//
+// ****************************************************************************************
+
+#pragma once
+
+#include "IGestureRecognizer.h"
+
+#include <vector>
+#include <memory>
+
+// Matches the trajectory of a joint during the last seconds against recorded templates with dynamic time warping (DTW).
+// The trajectory is sampled relative to a reference joint by the joint history of the users with every frame
+// and divided by a body measurement if one is set.
+// Before the full DTW distance of a template is calculated, its LB_Keogh lower bound has to be below the best distance so far,
+// and the DTW calculation is abandoned as soon as it can not get below that distance anymore.
+class TrajectoryRecognizer : public IGestureRecognizer
+{
+public:
+	// duration: Length of the trajectory in seconds the templates are matched against
+	// numSamples: Number of samples the templates and the trajectory are resampled to
+	// warpingWindow: Fraction of the samples by which the matching may shift a sample in time (Sakoe-Chiba band)
+	// maxDistance: Maximum root mean square distance of the aligned samples for a recognition (in the measuring unit)
+	TrajectoryRecognizer(Fubi::SkeletonJoint::Joint joint, Fubi::SkeletonJoint::Joint relJoint = Fubi::SkeletonJoint::NUM_JOINTS,
+		float duration = 1.0f, unsigned int numSamples = 32, float warpingWindow = 0.1f, float maxDistance = Fubi::Math::MaxFloat,
+		bool useLocalPositions = false, float minConfidence = -1.0f,
+		Fubi::BodyMeasurement::Measurement measuringUnit = Fubi::BodyMeasurement::NUM_MEASUREMENTS);
+
+	virtual ~TrajectoryRecognizer() {}
+
+	// Add a recorded trajectory (in the same space as the sampled one), it is resampled to the number of samples
+	// Only allowed before the recognizer is cloned, as the clones share the templates
+	// Returns false if it has less than two points
+	bool addTemplate(const std::vector<Fubi::Vec3f>& points);
+
+	unsigned int getNumTemplates() const { return m_templates->m_numTemplates; }
+
+	virtual Fubi::RecognitionResult::Result recognizeOn(FubiUser* user);
+	virtual IGestureRecognizer* clone() { return new TrajectoryRecognizer(*this); }
+
+	// The working buffers and the last result are stored per user
+	virtual bool hasUserState() const { return true; }
+
+	virtual unsigned int getRequiredJoints() const;
+
+	virtual void requestHistoryWindows(JointHistoryWindows& windows);
+	virtual void requestLocalTransformations(Fubi::LocalTransformationJoints& joints);
+
+	// Template that matched best in the last recognition and its distance, -1 if no template was close enough
+	int getLastTemplate() { return m_lastTemplate; }
+	float getLastDistance() { return m_lastDistance; }
+
+private:
+	// The templates in structure of arrays layout, each one padded to m_paddedSamples
+	struct Templates
+	{
+		Templates() : m_numTemplates(0) {}
+
+		unsigned int m_numTemplates;
+		std::vector<float> m_x, m_y, m_z;
+		// LB_Keogh envelope: minimum and maximum of each coordinate within the warping window around each sample
+		std::vector<float> m_lowerX, m_lowerY, m_lowerZ;
+		std::vector<float> m_upperX, m_upperY, m_upperZ;
+	};
+
+	// Resample the last m_duration seconds of the trajectory to the query, returns false if it does not cover them yet
+	bool resampleQuery(const FubiJointHistory& history, float scale);
+	// Squared distance of the query to the envelope of a template, in total and optionally per sample
+	float lowerBound(unsigned int templateIndex, float* contributions);
+	// DTW distance (sum of squared distances) of the query to a template, or MaxFloat if it is not below abandonAbove
+	float warpingDistance(unsigned int templateIndex, float abandonAbove);
+
+	Fubi::SkeletonJoint::Joint m_joint;
+	Fubi::SkeletonJoint::Joint m_relJoint;
+	bool m_useLocalPositions;
+	Fubi::BodyMeasurement::Measurement m_measuringUnit;
+	float m_duration;
+	unsigned int m_numSamples;
+	// Samples are padded so the vectorized kernels can always process blocks of four beyond the last one
+	unsigned int m_paddedSamples;
+	// Warping window in samples
+	unsigned int m_window;
+	float m_maxDistance;
+
+	std::shared_ptr<Templates> m_templates;
+
+	// Trajectory in the joint history of the users, -1 until it has been requested
+	int m_trajectory;
+	double m_minSampleInterval;
+
+	// Working buffers, sized when a template is added so the recognition does not allocate
+	std::vector<float> m_queryX, m_queryY, m_queryZ;
+	std::vector<float> m_costs;
+	std::vector<float> m_rows;
+	std::vector<float> m_contributions;
+	std::vector<float> m_lowerBounds;
+	std::vector<unsigned int> m_order;
+
+	// Result of the last recognition, reused when called again for the same frame of the same user
+	unsigned int m_lastUserID;
+	double m_lastTimeStamp;
+	Fubi::RecognitionResult::Result m_lastResult;
+	int m_lastTemplate;
+	float m_lastDistance;
+};
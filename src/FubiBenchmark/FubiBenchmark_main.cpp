@@ -0,0 +1,618 @@
+// Benchmark of the recognition pipeline: replays sessions with different numbers of users through FubiCore
+// and reports the frame rate, latency percentiles and allocations per frame for the recognizer sets of both
+// FUBIforMashtaCycle modes, plus the cost of getImage for each depth image modification
+// and of the local transformations of one user compared to calculating them joint by joint.
+// It also checks that trajectory recognizers recognize at different sensor rates.
+// Without given recordings, the sessions are recorded from the synthetic sensor first.
+
+#include "../Fubi/Fubi.h"
+#include "../Fubi/FubiRecording.h"
+#include "../Fubi/FubiSyntheticSensor.h"
+#include "../Fubi/FubiLocalTransformations.h"
+#include "../Fubi/GestureRecognizer/TrajectoryRecognizer.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+#include <atomic>
+#include <algorithm>
+
+using namespace Fubi;
+
+// Count all heap allocations of the process, including the ones in the Fubi library
+// (works for the shared library on Linux and Mac OS, on Windows only the allocations of this executable are counted)
+static std::atomic<unsigned long long> s_numAllocations(0);
+
+void* operator new(size_t size)
+{
+	++s_numAllocations;
+	void* p = malloc(size ? size : 1);
+	if (p == 0x0)
+		throw std::bad_alloc();
+	return p;
+}
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+void operator delete(void* p) throw()
+{
+	free(p);
+}
+void operator delete[](void* p) throw()
+{
+	free(p);
+}
+void operator delete(void* p, size_t) throw()
+{
+	free(p);
+}
+void operator delete[](void* p, size_t) throw()
+{
+	free(p);
+}
+
+struct Session
+{
+	std::string fileName;
+	std::string name;
+	bool isTemporary;
+};
+
+// Settings
+static std::string perfRecognizersFile("MashtaCycleRecognizersPerf.xml");
+static std::string installRecognizersFile("MashtaCycleRecognizersInstall.xml");
+static unsigned int numFrames = 300;
+static int depthWidth = 640, depthHeight = 480;
+static bool benchmarkImages = true;
+// Fail if the recognition allocates memory after the warmup
+static bool checkAllocations = false;
+static bool checkTrajectories = false;
+static float jointNoise = 0, dropoutRate = 0;
+
+// Record frames of the synthetic sensor, so all sessions are replayed the same way as real recordings
+static bool writeSyntheticSession(const std::string& fileName, unsigned short numUsers)
+{
+	SensorOptions options(StreamOptions(depthWidth, depthHeight), StreamOptions(-1, -1, -1), StreamOptions(-1, -1, -1), SensorType::SYNTHETIC);
+	options.m_syntheticOptions = SyntheticOptions(numUsers, jointNoise, dropoutRate, false, numUsers);
+	FubiSyntheticSensor sensor;
+	if (!sensor.initWithOptions(options))
+		return false;
+
+	FubiRecordingWriter writer;
+	if (!writer.open(fileName.c_str(), RecordingInfo(depthWidth, depthHeight, benchmarkImages, benchmarkImages)))
+		return false;
+	RecordedFrame* frame = new RecordedFrame();
+	unsigned int userIDs[MaxUsers];
+	const unsigned int numPixels = depthWidth * depthHeight;
+	for (unsigned int i = 0; i < numFrames && !writer.hasFailed(); ++i)
+	{
+		sensor.update();
+		frame->m_timeStamp = sensor.getTrackingTimeStamp();
+		frame->m_numUsers = sensor.getUserIDs(userIDs);
+		for (unsigned short u = 0; u < frame->m_numUsers; ++u)
+		{
+			RecordedUser& user = frame->m_users[u];
+			user.m_id = userIDs[u];
+			user.m_isTracked = sensor.isTracking(user.m_id);
+			for (unsigned int j = 0; j < SkeletonJoint::NUM_JOINTS; ++j)
+				sensor.getSkeletonJointData(user.m_id, (SkeletonJoint::Joint) j, user.m_positions[j], user.m_orientations[j]);
+		}
+		if (benchmarkImages)
+		{
+			frame->m_depthData.assign(sensor.getDepthData(), sensor.getDepthData() + numPixels);
+			frame->m_userLabelData.assign(sensor.getUserLabelData(), sensor.getUserLabelData() + numPixels);
+		}
+		writer.writeFrame(*frame);
+		// Don't let the writer drop any frame
+		if ((i % 32) == 31)
+			writer.flush();
+	}
+	delete frame;
+	writer.close();
+	return !writer.hasFailed() && writer.getNumDroppedFrames() == 0;
+}
+static unsigned int getNumFrames(const std::string& fileName)
+{
+	FubiRecordingReader reader;
+	return reader.open(fileName.c_str()) ? reader.getNumFrames() : 0;
+}
+
+static bool startSession(const Session& session)
+{
+	// Fast replay in a loop, so the measurement can start after a first pass through the session
+	SensorOptions options(StreamOptions(), StreamOptions(-1, -1, -1), StreamOptions(-1, -1, -1), SensorType::REPLAY);
+	options.m_replayOptions = ReplayOptions(session.fileName, false, true);
+	return switchSensor(options);
+}
+
+struct RecognitionBenchmark
+{
+	std::string recognizers;
+	std::string session;
+	unsigned int numUsers;
+	double fps;
+	double allocationsPerFrame;
+	ProfilingStats updateUsers;
+	ProfilingStats combinationRecognizers;
+	double closestUsersMean;
+	double closestUsersP99;
+};
+
+struct LocalTransformationsBenchmark
+{
+	// Microseconds per user
+	double jointWise;
+	double batched;
+	// Largest difference of an orientation element, position coordinate or confidence between both
+	float maxDifference;
+};
+
+struct TrajectoryCheck
+{
+	float sensorRate;
+	unsigned int numSamples;
+	// Frames after the first duration, all of them should be recognized
+	unsigned int numFrames;
+	unsigned int numRecognized;
+};
+
+struct ImageBenchmark
+{
+	std::string session;
+	unsigned int numUsers;
+	DepthImageModification::Modification modification;
+	ProfilingStats getImage;
+};
+
+static bool benchmarkRecognition(const Session& session, unsigned int sessionFrames, const std::string& recognizersFile, RecognitionBenchmark& result)
+{
+	clearUserDefinedRecognizers();
+	if (!loadRecognizersFromXML(recognizersFile.c_str()))
+	{
+		std::cerr << "Couldn't load the recognizers from " << recognizersFile << std::endl;
+		return false;
+	}
+	if (!startSession(session))
+		return false;
+
+	// Warm up: new users get their recognizers and all buffers reach their final size
+	for (unsigned int i = 0; i < sessionFrames; ++i)
+		updateSensor();
+
+	resetProfiling();
+	const unsigned long long allocationsBefore = s_numAllocations;
+	const double start = getCurrentTime();
+	for (unsigned int i = 0; i < sessionFrames; ++i)
+		updateSensor();
+	const double duration = getCurrentTime() - start;
+	const unsigned long long allocations = s_numAllocations - allocationsBefore;
+
+	result.recognizers = recognizersFile;
+	result.session = session.name;
+	result.numUsers = getCurrentUsers();
+	result.fps = (duration > 0) ? sessionFrames / duration : 0;
+	result.allocationsPerFrame = (double) allocations / sessionFrames;
+	getProfilingStats(ProfilingStage::UPDATE_USERS, result.updateUsers);
+	getProfilingStats(ProfilingStage::COMBINATION_RECOGNIZERS, result.combinationRecognizers);
+
+	// Sorting the users by distance, as done for the OSC messages of each frame
+	std::vector<double> closestUsersTimes(sessionFrames);
+	for (unsigned int i = 0; i < sessionFrames; ++i)
+	{
+		updateSensor();
+		const unsigned long long start = FubiProfiler::now();
+		getClosestUsers();
+		closestUsersTimes[i] = (FubiProfiler::now() - start) / 1000000.0;
+	}
+	std::sort(closestUsersTimes.begin(), closestUsersTimes.end());
+	double sum = 0;
+	for (unsigned int i = 0; i < sessionFrames; ++i)
+		sum += closestUsersTimes[i];
+	result.closestUsersMean = sum / sessionFrames;
+	result.closestUsersP99 = closestUsersTimes[std::min(sessionFrames - 1, (unsigned int) (sessionFrames * 0.99))];
+	return true;
+}
+
+static bool benchmarkImage(const Session& session, unsigned int sessionFrames, DepthImageModification::Modification modification, ImageBenchmark& result)
+{
+	if (!startSession(session))
+		return false;
+	int width, height;
+	getDepthResolution(width, height);
+	if (width <= 0 || height <= 0)
+		return false;
+	std::vector<unsigned char> image(width*height*4);
+
+	for (unsigned int i = 0; i < sessionFrames; ++i)
+		updateSensor();
+	resetProfiling();
+	for (unsigned int i = 0; i < sessionFrames; ++i)
+	{
+		updateSensor();
+		getImage(&image[0], ImageType::Depth, ImageNumChannels::C4, ImageDepth::D8,
+			RenderOptions::Shapes | RenderOptions::Skeletons | RenderOptions::UserCaptions, modification);
+	}
+
+	result.session = session.name;
+	result.numUsers = getCurrentUsers();
+	result.modification = modification;
+	getProfilingStats(ProfilingStage::GET_IMAGE, result.getImage);
+	return true;
+}
+
+// The local transformations of one user as calculated before they were batched, one joint after the other
+static void calculateLocalTransformationsJointWise(const SkeletonJointPosition* positions, const SkeletonJointOrientation* orientations,
+	SkeletonJointPosition* localPositions, SkeletonJointOrientation* localOrientations)
+{
+	for (unsigned int j = 0; j < Skeleton::NumLayoutJoints; ++j)
+	{
+		if (j != SkeletonJoint::TORSO)
+		{
+			calculateLocalRotation(orientations[j], orientations[Skeleton::Parents[j]], localOrientations[j]);
+			calculateLocalPosition(positions[j], positions[SkeletonJoint::TORSO], orientations[SkeletonJoint::TORSO], localPositions[j]);
+		}
+	}
+	localOrientations[SkeletonJoint::TORSO] = orientations[SkeletonJoint::TORSO];
+	localPositions[SkeletonJoint::TORSO] = positions[SkeletonJoint::TORSO];
+}
+
+static float randomFloat(float min, float max)
+{
+	return min + (max - min) * ((float) rand() / (float) RAND_MAX);
+}
+
+static void benchmarkLocalTransformations(LocalTransformationsBenchmark& result)
+{
+	// Random skeletons, mostly with valid rotations and some with degenerated ones
+	const unsigned int numSkeletons = 64, numPasses = 500;
+	std::vector<SkeletonJointPosition> positions(numSkeletons * SkeletonJoint::NUM_JOINTS);
+	std::vector<SkeletonJointOrientation> orientations(numSkeletons * SkeletonJoint::NUM_JOINTS);
+	srand(42);
+	for (unsigned int i = 0; i < positions.size(); ++i)
+	{
+		positions[i] = SkeletonJointPosition(randomFloat(-1000.0f, 1000.0f), randomFloat(-1000.0f, 1000.0f), randomFloat(500.0f, 4000.0f), randomFloat(0, 1.0f));
+		if (i % 97 == 0)
+			orientations[i] = SkeletonJointOrientation(Matrix3f() * 0, randomFloat(0, 1.0f));
+		else
+			orientations[i] = SkeletonJointOrientation(Matrix3f::RotMat(randomFloat(-Math::Pi, Math::Pi), randomFloat(-Math::Pi, Math::Pi), randomFloat(-Math::Pi, Math::Pi)), randomFloat(0, 1.0f));
+	}
+
+	std::vector<SkeletonJointPosition> jointWisePositions(positions.size()), batchedPositions(positions.size());
+	std::vector<SkeletonJointOrientation> jointWiseOrientations(orientations.size()), batchedOrientations(orientations.size());
+	double start = currentTime();
+	for (unsigned int pass = 0; pass < numPasses; ++pass)
+	{
+		for (unsigned int s = 0; s < numSkeletons; ++s)
+		{
+			unsigned int first = s * SkeletonJoint::NUM_JOINTS;
+			calculateLocalTransformationsJointWise(&positions[first], &orientations[first], &jointWisePositions[first], &jointWiseOrientations[first]);
+		}
+	}
+	result.jointWise = (currentTime() - start) * 1000000.0 / (numPasses * numSkeletons);
+	start = currentTime();
+	for (unsigned int pass = 0; pass < numPasses; ++pass)
+	{
+		for (unsigned int s = 0; s < numSkeletons; ++s)
+		{
+			unsigned int first = s * SkeletonJoint::NUM_JOINTS;
+			calculateLocalTransformations(&positions[first], &orientations[first], &batchedPositions[first], &batchedOrientations[first]);
+		}
+	}
+	result.batched = (currentTime() - start) * 1000000.0 / (numPasses * numSkeletons);
+
+	// Joints outside of the skeleton layout are not calculated
+	result.maxDifference = 0;
+	for (unsigned int i = 0; i < positions.size(); ++i)
+	{
+		if (!Skeleton::isInLayout((SkeletonJoint::Joint) (i % SkeletonJoint::NUM_JOINTS)))
+			continue;
+		for (unsigned int e = 0; e < 9; ++e)
+			result.maxDifference = std::max(result.maxDifference, fabsf(jointWiseOrientations[i].m_orientation.x[e] - batchedOrientations[i].m_orientation.x[e]));
+		result.maxDifference = std::max(result.maxDifference, fabsf(jointWiseOrientations[i].m_confidence - batchedOrientations[i].m_confidence));
+		result.maxDifference = std::max(result.maxDifference, (jointWisePositions[i].m_position - batchedPositions[i].m_position).length());
+		result.maxDifference = std::max(result.maxDifference, fabsf(jointWisePositions[i].m_confidence - batchedPositions[i].m_confidence));
+	}
+}
+
+static void checkTrajectoryRates(std::vector<TrajectoryCheck>& results)
+{
+	// A hand circling around the torso for three seconds, matched against a template without distance limit,
+	// so every frame is recognized as soon as the trajectory covers the duration
+	static const float sensorRates[] = { 15.0f, 30.0f, 60.0f, 100.0f, 200.0f };
+	static const unsigned int sampleCounts[] = { 8, 10, 16, 32, 64 };
+	const float duration = 1.0f, totalTime = 3.0f, radius = 300.0f;
+	std::vector<Vec3f> templatePoints;
+	for (unsigned int i = 0; i < 20; ++i)
+		templatePoints.push_back(Vec3f(radius * cosf(i * 0.314f), radius * sinf(i * 0.314f), 0));
+
+	for (unsigned int r = 0; r < sizeof(sensorRates) / sizeof(sensorRates[0]); ++r)
+	{
+		for (unsigned int s = 0; s < sizeof(sampleCounts) / sizeof(sampleCounts[0]); ++s)
+		{
+			FubiUser user;
+			user.m_id = 1;
+			TrajectoryRecognizer recognizer(SkeletonJoint::RIGHT_HAND, SkeletonJoint::TORSO, duration, sampleCounts[s], 0.1f, 1.0e6f);
+			recognizer.addTemplate(templatePoints);
+			// The trajectory is sampled by the joint history of the user as in FubiUser::updateJointHistory()
+			JointHistoryWindows windows;
+			recognizer.requestHistoryWindows(windows);
+
+			TrajectoryCheck result = { sensorRates[r], sampleCounts[s], 0, 0 };
+			unsigned int numFrames = (unsigned int) (totalTime * sensorRates[r]);
+			for (unsigned int f = 0; f < numFrames; ++f)
+			{
+				double time = f / sensorRates[r];
+				FubiUser::TrackingData& data = user.getCurrentTrackingData();
+				data.timeStamp = time;
+				data.jointPositions[SkeletonJoint::TORSO] = SkeletonJointPosition(0, 0, 2000.0f, 1.0f);
+				data.jointPositions[SkeletonJoint::RIGHT_HAND] = SkeletonJointPosition(radius * cosf(6.283f * (float) time), radius * sinf(6.283f * (float) time), 1800.0f, 1.0f);
+				user.m_jointHistory.addFrame(time, data.jointPositions, data.localJointPositions, windows.getWindows(), windows.getTrajectories());
+				RecognitionResult::Result recognized = recognizer.recognizeOn(&user);
+				if (time > duration * 1.05f)
+				{
+					result.numFrames++;
+					if (recognized == RecognitionResult::RECOGNIZED)
+						result.numRecognized++;
+				}
+			}
+			results.push_back(result);
+		}
+	}
+}
+
+static const char* getModificationName(DepthImageModification::Modification modification)
+{
+	switch (modification)
+	{
+	case DepthImageModification::Raw:
+		return "Raw";
+	case DepthImageModification::UseHistogram:
+		return "UseHistogram";
+	case DepthImageModification::StretchValueRange:
+		return "StretchValueRange";
+	case DepthImageModification::ConvertToRGB:
+		return "ConvertToRGB";
+	}
+	return "";
+}
+
+static void writeResults(std::ostream& out, const std::vector<RecognitionBenchmark>& recognitionResults, const std::vector<ImageBenchmark>& imageResults,
+	const LocalTransformationsBenchmark& localTransformations, const std::vector<TrajectoryCheck>& trajectoryChecks)
+{
+	out << std::fixed << std::setprecision(3);
+	out << "# Recognition (latencies in ms, updateUsers per frame, combination recognizers per user and frame)" << std::endl;
+	out << "recognizers\tsession\tusers\tfps\tallocs/frame"
+		<< "\tupdateUsers mean\tp50\tp95\tp99\tmax"
+		<< "\tcombinations mean\tp50\tp95\tp99\tmax"
+		<< "\tgetClosestUsers mean\tp99" << std::endl;
+	for (unsigned int i = 0; i < recognitionResults.size(); ++i)
+	{
+		const RecognitionBenchmark& r = recognitionResults[i];
+		out << r.recognizers << "\t" << r.session << "\t" << r.numUsers << "\t" << r.fps << "\t" << r.allocationsPerFrame
+			<< "\t" << r.updateUsers.m_mean << "\t" << r.updateUsers.m_p50 << "\t" << r.updateUsers.m_p95 << "\t" << r.updateUsers.m_p99 << "\t" << r.updateUsers.m_max
+			<< "\t" << r.combinationRecognizers.m_mean << "\t" << r.combinationRecognizers.m_p50 << "\t" << r.combinationRecognizers.m_p95
+			<< "\t" << r.combinationRecognizers.m_p99 << "\t" << r.combinationRecognizers.m_max
+			<< "\t" << r.closestUsersMean << "\t" << r.closestUsersP99 << std::endl;
+	}
+
+	if (!imageResults.empty())
+	{
+		out << std::endl << "# getImage of the depth image with RGBA, 8 bit, shapes, skeletons and captions (latencies in ms)" << std::endl;
+		out << "session\tusers\tmodification\tmean\tp50\tp95\tp99\tmax" << std::endl;
+		for (unsigned int i = 0; i < imageResults.size(); ++i)
+		{
+			const ImageBenchmark& r = imageResults[i];
+			out << r.session << "\t" << r.numUsers << "\t" << getModificationName(r.modification)
+				<< "\t" << r.getImage.m_mean << "\t" << r.getImage.m_p50 << "\t" << r.getImage.m_p95 << "\t" << r.getImage.m_p99 << "\t" << r.getImage.m_max << std::endl;
+		}
+	}
+
+	out << std::endl << "# Local transformations of one user (in microseconds, largest difference between both)" << std::endl;
+	out << "joint-wise\tbatched\tspeedup\tmax difference" << std::endl;
+	out << localTransformations.jointWise << "\t" << localTransformations.batched
+		<< "\t" << ((localTransformations.batched > 0) ? localTransformations.jointWise / localTransformations.batched : 0)
+		<< "\t" << std::scientific << localTransformations.maxDifference << std::fixed << std::endl;
+
+	out << std::endl << "# Trajectory recognition of a circling hand (frames after the first second, recognized ones)" << std::endl;
+	out << "sensor rate	samples	frames	recognized" << std::endl;
+	for (unsigned int i = 0; i < trajectoryChecks.size(); ++i)
+	{
+		const TrajectoryCheck& r = trajectoryChecks[i];
+		out << r.sensorRate << "\t" << r.numSamples << "\t" << r.numFrames << "\t" << r.numRecognized << std::endl;
+	}
+}
+
+static void printUsage(const char* programName)
+{
+	std::cout << "Usage: " << programName << " [--users <n,n,...>] [--frames <n>] [--recording <file>]... [--no-images] [--check-allocations] [--check-trajectories] [--output <file>]" << std::endl
+		<< "  --users <n,n,...>   user counts of the synthetic sessions (1 to " << MaxUsers << "), default 1,2,4,8,12,15" << std::endl
+		<< "  --frames <n>        frames per synthetic session, default " << numFrames << std::endl
+		<< "  --recording <file>  benchmark a recorded session instead of the synthetic ones, can be repeated" << std::endl
+		<< "  --noise <mm>        standard deviation of the joint noise in the synthetic sessions, default 0" << std::endl
+		<< "  --dropouts <rate>   probability of a joint to lose its tracking per frame in the synthetic sessions, default 0" << std::endl
+		<< "  --no-images         skip the getImage benchmark (synthetic sessions are then recorded without images)" << std::endl
+		<< "  --check-allocations exit with an error if a steady state frame of the recognition allocates memory" << std::endl
+		<< "  --check-trajectories exit with an error if a trajectory recognizer misses frames at one of the sensor rates" << std::endl
+		<< "  --output <file>     also write the results as tab separated table to this file" << std::endl
+		<< "The recognizers are loaded from " << perfRecognizersFile << " and " << installRecognizersFile
+		<< " in the working directory." << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+	std::vector<unsigned int> userCounts;
+	std::vector<Session> sessions;
+	std::string outputFile;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if (arg == "--users" && i+1 < argc)
+		{
+			std::stringstream list(argv[++i]);
+			std::string count;
+			while (std::getline(list, count, ','))
+			{
+				unsigned int n = (unsigned int) atoi(count.c_str());
+				if (n < 1 || n > MaxUsers)
+				{
+					std::cerr << "Invalid user count " << count << std::endl;
+					return 1;
+				}
+				userCounts.push_back(n);
+			}
+		}
+		else if (arg == "--frames" && i+1 < argc)
+			numFrames = std::max(1, atoi(argv[++i]));
+		else if (arg == "--recording" && i+1 < argc)
+		{
+			Session session = { argv[i+1], argv[i+1], false };
+			sessions.push_back(session);
+			++i;
+		}
+		else if (arg == "--noise" && i+1 < argc)
+			jointNoise = (float) atof(argv[++i]);
+		else if (arg == "--dropouts" && i+1 < argc)
+			dropoutRate = (float) atof(argv[++i]);
+		else if (arg == "--no-images")
+			benchmarkImages = false;
+		else if (arg == "--check-allocations")
+			checkAllocations = true;
+		else if (arg == "--check-trajectories")
+			checkTrajectories = true;
+		else if (arg == "--output" && i+1 < argc)
+			outputFile = argv[++i];
+		else
+		{
+			printUsage(argv[0]);
+			return (arg == "--help" || arg == "-h") ? 0 : 1;
+		}
+	}
+
+	if (sessions.empty())
+	{
+		if (userCounts.empty())
+		{
+			static const unsigned int defaultUserCounts[] = { 1, 2, 4, 8, 12, 15 };
+			userCounts.assign(defaultUserCounts, defaultUserCounts + sizeof(defaultUserCounts) / sizeof(defaultUserCounts[0]));
+		}
+		for (unsigned int i = 0; i < userCounts.size(); ++i)
+		{
+			std::stringstream name;
+			name << "synthetic_" << userCounts[i] << "_users";
+			Session session = { "FubiBenchmark_" + name.str() + ".frec", name.str(), true };
+			std::cout << "Creating session " << session.name << "..." << std::endl;
+			if (!writeSyntheticSession(session.fileName, (unsigned short) userCounts[i]))
+			{
+				std::cerr << "Couldn't write " << session.fileName << std::endl;
+				remove(session.fileName.c_str());
+				return 1;
+			}
+			sessions.push_back(session);
+		}
+	}
+
+	// The first session only initializes Fubi, all following ones switch the sensor
+	SensorOptions options(StreamOptions(), StreamOptions(-1, -1, -1), StreamOptions(-1, -1, -1), SensorType::REPLAY);
+	options.m_replayOptions = ReplayOptions(sessions[0].fileName, false, true);
+	if (!init(options))
+	{
+		std::cerr << "Couldn't initialize Fubi with " << sessions[0].fileName << std::endl;
+		return 1;
+	}
+	setAutoStartCombinationRecognition(true);
+	enableProfiling(true);
+
+	std::vector<RecognitionBenchmark> recognitionResults;
+	std::vector<ImageBenchmark> imageResults;
+	const std::string recognizersFiles[2] = { perfRecognizersFile, installRecognizersFile };
+	for (unsigned int i = 0; i < sessions.size(); ++i)
+	{
+		const Session& session = sessions[i];
+		const unsigned int sessionFrames = getNumFrames(session.fileName);
+		if (sessionFrames == 0)
+			continue;
+		std::cout << "Benchmarking " << session.name << " (" << sessionFrames << " frames)..." << std::endl;
+
+		for (unsigned int j = 0; j < 2; ++j)
+		{
+			RecognitionBenchmark result;
+			if (benchmarkRecognition(session, sessionFrames, recognizersFiles[j], result))
+				recognitionResults.push_back(result);
+		}
+
+		if (benchmarkImages)
+		{
+			for (int m = DepthImageModification::Raw; m <= DepthImageModification::ConvertToRGB; ++m)
+			{
+				ImageBenchmark result;
+				if (benchmarkImage(session, sessionFrames, (DepthImageModification::Modification) m, result))
+					imageResults.push_back(result);
+			}
+		}
+	}
+	release();
+
+	LocalTransformationsBenchmark localTransformations;
+	benchmarkLocalTransformations(localTransformations);
+
+	std::vector<TrajectoryCheck> trajectoryChecks;
+	checkTrajectoryRates(trajectoryChecks);
+
+	for (unsigned int i = 0; i < sessions.size(); ++i)
+	{
+		if (sessions[i].isTemporary)
+			remove(sessions[i].fileName.c_str());
+	}
+
+	std::cout << std::endl;
+	writeResults(std::cout, recognitionResults, imageResults, localTransformations, trajectoryChecks);
+	if (!outputFile.empty())
+	{
+		std::ofstream file(outputFile.c_str());
+		if (file.is_open())
+			writeResults(file, recognitionResults, imageResults, localTransformations, trajectoryChecks);
+		else
+			std::cerr << "Couldn't write " << outputFile << std::endl;
+	}
+
+	if (checkAllocations)
+	{
+		bool allocated = false;
+		for (unsigned int i = 0; i < recognitionResults.size(); ++i)
+		{
+			if (recognitionResults[i].allocationsPerFrame > 0)
+			{
+				std::cerr << recognitionResults[i].recognizers << " on " << recognitionResults[i].session << " allocates "
+					<< recognitionResults[i].allocationsPerFrame << " times per frame" << std::endl;
+				allocated = true;
+			}
+		}
+		if (allocated)
+			return 2;
+	}
+
+	if (checkTrajectories)
+	{
+		bool missed = false;
+		for (unsigned int i = 0; i < trajectoryChecks.size(); ++i)
+		{
+			if (trajectoryChecks[i].numRecognized < trajectoryChecks[i].numFrames)
+			{
+				std::cerr << "Trajectory with " << trajectoryChecks[i].numSamples << " samples at " << trajectoryChecks[i].sensorRate << " Hz recognized only "
+					<< trajectoryChecks[i].numRecognized << " of " << trajectoryChecks[i].numFrames << " frames" << std::endl;
+				missed = true;
+			}
+		}
+		if (missed)
+			return 3;
+	}
+	return 0;
+}